@@ -0,0 +1,297 @@
+#include "Benchmark.h"
+
+#include "nlohmann/json.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <ctime>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using json = nlohmann::json;
+
+namespace {
+
+// "1.234 s", "12.3 ms", "850.0 us"
+std::string formatSeconds(double s) {
+    char buf[32];
+    if (s >= 1.0) std::snprintf(buf, sizeof(buf), "%.3f s", s);
+    else if (s >= 1e-3) std::snprintf(buf, sizeof(buf), "%.1f ms", s * 1e3);
+    else std::snprintf(buf, sizeof(buf), "%.1f us", s * 1e6);
+    return buf;
+}
+
+std::string formatKiB(double kib) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.1f MB", kib / 1024.0);
+    return buf;
+}
+
+json toJson(const BenchmarkRunner::Stats& s) {
+    return {{"mean", s.mean}, {"median", s.median}, {"stddev", s.stddev}, {"min", s.min}, {"max", s.max}};
+}
+
+BenchmarkRunner::Stats statsFromJson(const json& j) {
+    BenchmarkRunner::Stats s;
+    if (!j.is_object()) return s;
+    s.mean = j.value("mean", 0.0);
+    s.median = j.value("median", 0.0);
+    s.stddev = j.value("stddev", 0.0);
+    s.min = j.value("min", 0.0);
+    s.max = j.value("max", 0.0);
+    return s;
+}
+
+json readHistory(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) return json::object();
+    json history = json::parse(in, nullptr, false);
+    return history.is_object() ? history : json::object();
+}
+
+std::string localTime() {
+    std::time_t now = std::time(nullptr);
+    std::tm tm{};
+    localtime_r(&now, &tm);
+    char buf[32];
+    std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M", &tm);
+    return buf;
+}
+
+} // namespace
+
+BenchmarkRunner::Stats BenchmarkRunner::Stats::of(std::vector<double> values) {
+    Stats s;
+    if (values.empty()) return s;
+    std::sort(values.begin(), values.end());
+    const std::size_t n = values.size();
+    s.min = values.front();
+    s.max = values.back();
+    s.median = n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+    double sum = 0;
+    for (double v : values) sum += v;
+    s.mean = sum / n;
+    if (n > 1) {
+        double sq = 0;
+        for (double v : values) sq += (v - s.mean) * (v - s.mean);
+        s.stddev = std::sqrt(sq / (n - 1));
+    }
+    return s;
+}
+
+BenchmarkRunner::~BenchmarkRunner() {
+    cancel();
+}
+
+void BenchmarkRunner::cancel() {
+    if (!m_state->running) {
+        if (m_thread.joinable()) m_thread.join();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_state->mutex);
+        m_state->stopped = true;
+        if (m_state->child > 0) ::kill(m_state->child, SIGKILL);
+    }
+    // The killed run is reaped at once and the thread sees `stopped`
+    m_thread.join();
+    // A summary already posted still holds the old state; a new benchmark
+    // gets its own
+    auto state = std::make_shared<State>();
+    state->on_finished = std::move(m_state->on_finished);
+    m_state = std::move(state);
+}
+
+void BenchmarkRunner::start(Options options) {
+    if (m_state->running) return;
+    if (m_thread.joinable()) m_thread.join();   // the last benchmark's, already done
+    m_state->running = true;
+    m_state->completed = 0;
+    m_state->total = std::max(options.runs, 1) + std::max(options.warmup, 0);
+    auto state = m_state;
+    m_thread = std::thread([state, options = std::move(options)]() {
+        auto summary = std::make_shared<Summary>(measure(*state, options));
+        TaskScheduler::instance().post([state, summary]() {
+            if (state->stopped) return;
+            state->running = false;
+            if (state->on_finished) state->on_finished(std::move(*summary));
+        });
+    });
+}
+
+BenchmarkRunner::Summary BenchmarkRunner::measure(State& state, const Options& options) {
+    Summary summary;
+    summary.label = options.label;
+    summary.command = options.exe;
+    summary.args = options.args;
+    summary.flags = options.flags;
+    summary.when = localTime();
+    summary.runs = std::max(options.runs, 1);
+    summary.warmup = std::max(options.warmup, 0);
+
+    // Built before fork(): the child only execs
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>(options.exe.c_str()));
+    for (const std::string& arg : options.args) argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(nullptr);
+
+    std::vector<double> wall, user, sys, rss;
+    for (int i = 0; i < summary.warmup + summary.runs; ++i) {
+        std::unique_lock<std::mutex> lock(state.mutex);
+        if (state.stopped) return summary;
+        const auto started = std::chrono::steady_clock::now();
+        pid_t pid = ::fork();
+        if (pid < 0) {
+            summary.error = "cannot start " + options.exe;
+            return summary;
+        }
+        if (pid == 0) {
+            int null = ::open("/dev/null", O_RDWR);
+            if (null >= 0) {
+                ::dup2(null, STDIN_FILENO);
+                ::dup2(null, STDOUT_FILENO);
+                ::dup2(null, STDERR_FILENO);
+            }
+            if (!options.dir.empty() && ::chdir(options.dir.c_str()) != 0) ::_exit(127);
+            ::execv(argv[0], argv.data());
+            ::_exit(127);
+        }
+        state.child = pid;
+        lock.unlock();
+
+        int status = 0;
+        struct rusage usage{};
+        while (::wait4(pid, &status, 0, &usage) < 0 && errno == EINTR) {}
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started;
+        lock.lock();
+        state.child = 0;
+        if (state.stopped) return summary;
+        lock.unlock();
+
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            summary.error = WIFEXITED(status)
+                ? (WEXITSTATUS(status) == 127 ? "cannot run " + options.exe
+                                               : "the program exited with status " + std::to_string(WEXITSTATUS(status)))
+                : "the program was killed by signal " + std::to_string(WTERMSIG(status));
+            return summary;
+        }
+        if (i >= summary.warmup) {
+            wall.push_back(elapsed.count());
+            user.push_back(usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6);
+            sys.push_back(usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6);
+            rss.push_back(static_cast<double>(usage.ru_maxrss));   // KiB on Linux
+        }
+        ++state.completed;
+    }
+
+    summary.wall = Stats::of(wall);
+    summary.user = Stats::of(user);
+    summary.sys = Stats::of(sys);
+    summary.rss = Stats::of(rss);
+    return summary;
+}
+
+std::string BenchmarkRunner::historyPath(const std::string& dir) {
+    return (std::filesystem::path(dir.empty() ? "." : dir) / ".gedi-benchmarks.json").string();
+}
+
+std::optional<BenchmarkRunner::Summary> BenchmarkRunner::previous(const std::string& history_path, const std::string& label) {
+    const json history = readHistory(history_path);
+    auto it = history.find(label);
+    if (it == history.end() || !it->is_array() || it->empty()) return std::nullopt;
+
+    const json& j = it->back();
+    Summary s;
+    s.label = label;
+    s.command = j.value("command", "");
+    s.args = j.value("args", std::vector<std::string>{});
+    s.flags = j.value("flags", "");
+    s.when = j.value("when", "");
+    s.runs = j.value("runs", 0);
+    s.warmup = j.value("warmup", 0);
+    s.wall = statsFromJson(j.value("wall", json()));
+    s.user = statsFromJson(j.value("user", json()));
+    s.sys = statsFromJson(j.value("sys", json()));
+    s.rss = statsFromJson(j.value("rss_kib", json()));
+    return s;
+}
+
+bool BenchmarkRunner::record(const std::string& history_path, const Summary& summary) {
+    json history = readHistory(history_path);
+    json& runs = history[summary.label];
+    if (!runs.is_array()) runs = json::array();
+    runs.push_back({
+        {"command", summary.command}, {"args", summary.args}, {"flags", summary.flags}, {"when", summary.when},
+        {"runs", summary.runs}, {"warmup", summary.warmup},
+        {"wall", toJson(summary.wall)}, {"user", toJson(summary.user)}, {"sys", toJson(summary.sys)},
+        {"rss_kib", toJson(summary.rss)}
+    });
+    if (runs.size() > MAX_HISTORY) runs.erase(runs.begin(), runs.begin() + (runs.size() - MAX_HISTORY));
+
+    // Written next to the old file and renamed over it, so a crash leaves
+    // one or the other
+    const std::string tmp = history_path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out) return false;
+        out << history.dump(2) << '\n';
+        if (!out) return false;
+    }
+    return std::rename(tmp.c_str(), history_path.c_str()) == 0;
+}
+
+std::vector<std::string> BenchmarkRunner::report(const Summary& s, const std::optional<Summary>& before) {
+    std::vector<std::string> lines;
+    char buf[256];
+    std::string command = s.command;
+    for (const std::string& arg : s.args) command += " " + arg;
+    lines.push_back("Benchmark '" + s.label + "': " + command);
+    if (!s.flags.empty()) lines.push_back("  Flags: " + s.flags);
+    lines.push_back("");
+    std::snprintf(buf, sizeof(buf), "  Time (mean +- sd):    %10s +- %-10s  [User: %s, System: %s]",
+                  formatSeconds(s.wall.mean).c_str(), formatSeconds(s.wall.stddev).c_str(),
+                  formatSeconds(s.user.mean).c_str(), formatSeconds(s.sys.mean).c_str());
+    lines.push_back(buf);
+    std::snprintf(buf, sizeof(buf), "  Median:              %10s", formatSeconds(s.wall.median).c_str());
+    lines.push_back(buf);
+    std::snprintf(buf, sizeof(buf), "  Range (min ... max):  %10s ... %-10s %d runs, %d warmup",
+                  formatSeconds(s.wall.min).c_str(), formatSeconds(s.wall.max).c_str(), s.runs, s.warmup);
+    lines.push_back(buf);
+    std::snprintf(buf, sizeof(buf), "  Max RSS (mean +- sd): %10s +- %-10s  [max: %s]",
+                  formatKiB(s.rss.mean).c_str(), formatKiB(s.rss.stddev).c_str(), formatKiB(s.rss.max).c_str());
+    lines.push_back(buf);
+
+    lines.push_back("");
+    if (!before) {
+        lines.push_back("  No earlier run under this label to compare with.");
+        return lines;
+    }
+    lines.push_back("  Previous run (" + before->when + "):");
+    if (before->flags != s.flags) lines.push_back("  Flags: " + before->flags);
+    std::snprintf(buf, sizeof(buf), "  Time (mean +- sd):    %10s +- %-10s  [User: %s, System: %s]",
+                  formatSeconds(before->wall.mean).c_str(), formatSeconds(before->wall.stddev).c_str(),
+                  formatSeconds(before->user.mean).c_str(), formatSeconds(before->sys.mean).c_str());
+    lines.push_back(buf);
+    if (s.wall.mean > 0 && before->wall.mean > 0) {
+        // Ratio of the means; its deviation propagated from both as hyperfine does
+        const bool faster = s.wall.mean <= before->wall.mean;
+        const double ratio = faster ? before->wall.mean / s.wall.mean : s.wall.mean / before->wall.mean;
+        const double sd = ratio * std::sqrt(std::pow(s.wall.stddev / s.wall.mean, 2) +
+                                            std::pow(before->wall.stddev / before->wall.mean, 2));
+        std::snprintf(buf, sizeof(buf), "  %.2f +- %.2f times %s than the previous run", ratio, sd,
+                      faster ? "faster" : "slower");
+        lines.push_back(buf);
+        std::snprintf(buf, sizeof(buf), "  Max RSS: %s -> %s", formatKiB(before->rss.mean).c_str(),
+                      formatKiB(s.rss.mean).c_str());
+        lines.push_back(buf);
+    }
+    return lines;
+}
@@ -0,0 +1,111 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <sys/types.h>
+#include <thread>
+#include <vector>
+#include "TaskScheduler.h"
+
+// Runs a program a number of times and measures it, the way hyperfine does:
+// some warmup runs that are not counted, then wall, user and system time
+// and peak memory of each run, from wait4().  The program's input and
+// output are /dev/null, so what is measured is the program rather than the
+// terminal.
+//
+// The runs happen one after the other on a thread of the runner's own,
+// which spends its time blocked in wait4() and so is kept off the
+// TaskScheduler's workers.  Summaries are kept per label in a small JSON history file, so a run can
+// be compared with the previous one under the same label -- typically
+// after changing the compiler settings.
+class BenchmarkRunner {
+public:
+    struct Options {
+        std::string exe;
+        std::vector<std::string> args;
+        std::string dir;       // working directory; empty for the editor's
+        std::string label;
+        std::string flags;     // compiler flags the program was built with, for the record
+        int runs = 10;
+        int warmup = 3;
+    };
+
+    struct Stats {
+        double mean = 0, median = 0, stddev = 0, min = 0, max = 0;
+        static Stats of(std::vector<double> values);
+    };
+
+    struct Summary {
+        std::string label;
+        std::string command;
+        std::vector<std::string> args;
+        std::string flags;
+        std::string when;      // local time, "2024-05-01 14:03"
+        int runs = 0;
+        int warmup = 0;
+        Stats wall, user, sys; // seconds
+        Stats rss;             // peak resident set, KiB
+        std::string error;     // set when the program could not be measured
+    };
+
+    BenchmarkRunner() = default;
+    ~BenchmarkRunner();
+    BenchmarkRunner(const BenchmarkRunner&) = delete;
+    BenchmarkRunner& operator=(const BenchmarkRunner&) = delete;
+
+    // Called on the UI thread with the summary once all runs are done, or
+    // with `error` set when a run fails to start or exits with a non-zero
+    // status.
+    void onFinished(std::function<void(Summary)> fn) { m_state->on_finished = std::move(fn); }
+
+    // UI thread only.  Does nothing while a benchmark is running.
+    void start(Options options);
+    // Stops the benchmark, killing the run in progress, and waits for its
+    // thread.  No summary follows.  Call before the editor exits.
+    void cancel();
+
+    bool running() const { return m_state->running; }
+    // Runs finished so far, warmup included, and their total.
+    int completed() const { return m_state->completed; }
+    int total() const { return m_state->total; }
+
+    // <dir>/.gedi-benchmarks.json
+    static std::string historyPath(const std::string& dir);
+    // The latest summary recorded under `label`.
+    static std::optional<Summary> previous(const std::string& history_path, const std::string& label);
+    // Adds `summary` to the history; the oldest ones of a label go after
+    // MAX_HISTORY.  Returns false if the file could not be written.
+    static bool record(const std::string& history_path, const Summary& summary);
+
+    // hyperfine-style report, compared with `before` if there is one.
+    static std::vector<std::string> report(const Summary& summary, const std::optional<Summary>& before);
+
+private:
+    static constexpr int MAX_HISTORY = 50;
+
+    // Shared with the thread.  A summary posted after cancel() finds
+    // `stopped` set and is dropped.
+    struct State {
+        std::function<void(Summary)> on_finished;
+        bool running = false;                 // UI thread only
+        std::atomic<int> completed{0};
+        std::atomic<int> total{0};
+        // Held around fork() and by cancel(), so a run is either killed or
+        // never started
+        std::mutex mutex;
+        pid_t child = 0;                      // run in progress
+        bool stopped = false;
+    };
+
+    static Summary measure(State& state, const Options& options);
+
+    std::shared_ptr<State> m_state = std::make_shared<State>();
+    std::thread m_thread;
+};
+
+#endif // BENCHMARK_H
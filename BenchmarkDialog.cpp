@@ -0,0 +1,104 @@
+#include "BenchmarkDialog.h"
+#include <algorithm>
+
+BenchmarkDialog::BenchmarkDialog(int runs, int warmup, const std::string& args,
+                                 const std::string& label)
+    : DialogBase("Benchmark", /*w=*/60, /*h=*/15)
+    , runs_buf_(std::to_string(runs))
+    , warmup_buf_(std::to_string(warmup))
+    , args_buf_(args)
+    , label_buf_(label)
+{}
+
+DialogResult BenchmarkDialog::show(Renderer& renderer, int runs, int warmup,
+                                   const std::string& args, const std::string& label)
+{
+    BenchmarkDialog dlg(runs, warmup, args, label);
+    return dlg.run(renderer);
+}
+
+void BenchmarkDialog::onInit()
+{
+    setFocusCount(static_cast<int>(Focus::_count));
+    setFocus(static_cast<int>(Focus::RUNS));
+    setButtonRowFocusIndex(static_cast<int>(Focus::BTN_ROW));
+
+    // ── Inputs ────────────────────────────────────────────────────────────────
+    addInput({
+        .focus_index = static_cast<int>(Focus::RUNS),
+        .field_x = 16, .field_y = 2, .field_w = 8,
+        .label   = "Runs:",
+        .label_x = 3, .label_y = 2,
+        .buffer  = runs_buf_,
+        .numeric_only = true,
+    });
+    addInput({
+        .focus_index = static_cast<int>(Focus::WARMUP),
+        .field_x = 16, .field_y = 4, .field_w = 8,
+        .label   = "Warmup runs:",
+        .label_x = 3, .label_y = 4,
+        .buffer  = warmup_buf_,
+        .numeric_only = true,
+    });
+    addInput({
+        .focus_index = static_cast<int>(Focus::ARGS),
+        .field_x = 16, .field_y = 6, .field_w = 41,
+        .label   = "Arguments:",
+        .label_x = 3, .label_y = 6,
+        .buffer  = args_buf_,
+    });
+    addInput({
+        .focus_index = static_cast<int>(Focus::LABEL),
+        .field_x = 16, .field_y = 8, .field_w = 41,
+        .label   = "Label:",
+        .label_x = 3, .label_y = 8,
+        .buffer  = label_buf_,
+    });
+
+    // ── Button row ────────────────────────────────────────────────────────────
+    addButtons(ButtonRow{
+        .buttons = {
+            Button{
+                .label = " &Run ",
+                .x = 16, .y = 12,
+                .on_activate = [this]() -> HandleResult {
+                    int runs = 0, warmup = 0;
+                    try { runs = std::stoi(runs_buf_); } catch (...) {}
+                    try { warmup = std::stoi(warmup_buf_); } catch (...) {}
+                    result().accept();
+                    result().set("runs",   std::to_string(std::max(runs, 1)));
+                    result().set("warmup", std::to_string(std::max(warmup, 0)));
+                    result().set("args",   args_buf_);
+                    result().set("label",  label_buf_);
+                    return HandleResult::CLOSE;
+                }
+            },
+            Button{
+                .label = " &Cancel ",
+                .x = 32, .y = 12,
+                .on_activate = [this]() -> HandleResult {
+                    result().cancel();
+                    return HandleResult::CLOSE;
+                }
+            },
+        }
+    });
+
+    // ── Arrow-key navigation ──────────────────────────────────────────────────
+    nav_.link(Direction::DOWN, Focus::RUNS,    Focus::WARMUP)
+        .link(Direction::UP,   Focus::WARMUP,  Focus::RUNS)
+        .link(Direction::DOWN, Focus::WARMUP,  Focus::ARGS)
+        .link(Direction::UP,   Focus::ARGS,    Focus::WARMUP)
+        .link(Direction::DOWN, Focus::ARGS,    Focus::LABEL)
+        .link(Direction::UP,   Focus::LABEL,   Focus::ARGS)
+        .link(Direction::DOWN, Focus::LABEL,   Focus::BTN_ROW)
+        .link(Direction::UP,   Focus::BTN_ROW, Focus::LABEL);
+    setNavigation(nav_);
+}
+
+void BenchmarkDialog::onDraw(Renderer& renderer, int startx, int starty)
+{
+    renderer.drawText(startx + 3, starty + 10,
+                      "Runs and warmup do not apply to Google Benchmark",
+                      Renderer::CP_DIALOG);
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include "DialogBase.h"
+#include "Renderer.h"
+#include <string>
+
+// Asks how often to run the program for a benchmark, with which arguments
+// and under which label to record it.  Result keys: "runs", "warmup",
+// "args", "label".
+class BenchmarkDialog : private DialogBase {
+public:
+    static DialogResult show(Renderer& renderer, int runs, int warmup,
+                             const std::string& args, const std::string& label);
+private:
+    BenchmarkDialog(int runs, int warmup, const std::string& args, const std::string& label);
+
+    void onInit() override;
+    void onDraw(Renderer& renderer, int startx, int starty) override;
+
+    DeclareCyclicEnum(Focus, RUNS, WARMUP, ARGS, LABEL, BTN_ROW);
+
+    std::string runs_buf_;
+    std::string warmup_buf_;
+    std::string args_buf_;
+    std::string label_buf_;
+    NavigationGraph<Focus> nav_;
+};
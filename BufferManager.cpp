@@ -10,6 +10,14 @@ int BufferManager::addBuffer() {
     return m_currentIndex;
 }
 
+int BufferManager::adoptBuffer(EditorBuffer&& buffer) {
+    m_buffers.push_back(std::move(buffer));
+    int index = (int)m_buffers.size() - 1;
+    m_buffers.back().bufferNr = index + 1;
+    if (m_currentIndex == -1) m_currentIndex = index;
+    return index;
+}
+
 void BufferManager::removeBuffer(int index) {
     if (index < 0 || index >= (int)m_buffers.size()) return;
     
@@ -36,6 +44,14 @@ EditorBuffer& BufferManager::currentBuffer() {
     return m_buffers[m_currentIndex];
 }
 
+int BufferManager::findByFileId(FileId id) const {
+    if (id == INVALID_FILE_ID) return -1;
+    for (size_t i = 0; i < m_buffers.size(); ++i) {
+        if (m_buffers[i].file_id == id) return (int)i;
+    }
+    return -1;
+}
+
 void BufferManager::setCurrentBufferIndex(int index) {
     if (index >= -1 && index < (int)m_buffers.size()) {
         m_currentIndex = index;
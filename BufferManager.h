@@ -10,10 +10,15 @@ public:
     BufferManager();
     
     int addBuffer();
+    // Appends an already loaded buffer without changing the current buffer.
+    int adoptBuffer(EditorBuffer&& buffer);
     void removeBuffer(int index);
     
     EditorBuffer& getBuffer(int index);
     EditorBuffer& currentBuffer();
+
+    // Index of the buffer editing `id`, or -1 if the file is not open.
+    int findByFileId(FileId id) const;
     
     int currentBufferIndex() const { return m_currentIndex; }
     void setCurrentBufferIndex(int index);
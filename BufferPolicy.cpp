@@ -0,0 +1,47 @@
+#include "BufferPolicy.h"
+#include "EditorBuffer.h"
+#include "FileLoader.h"
+
+BufferMode BufferPolicy::classify(std::uintmax_t bytes, int lines, std::size_t longest_line) {
+    if (bytes >= HUGE_BYTES || lines >= HUGE_LINES || longest_line >= HUGE_LINE_LENGTH)
+        return BufferMode::Huge;
+    if (bytes >= LARGE_BYTES || lines >= LARGE_LINES || longest_line >= LARGE_LINE_LENGTH)
+        return BufferMode::Large;
+    return BufferMode::Full;
+}
+
+void BufferPolicy::update(EditorBuffer& buffer) {
+    if (buffer.mode_pinned) return;
+    BufferMode mode = classify(buffer.load_bytes_total, buffer.total_lines, buffer.longest_line);
+    if (mode > buffer.mode) setMode(buffer, mode);
+}
+
+void BufferPolicy::pin(EditorBuffer& buffer, BufferMode mode) {
+    buffer.mode_pinned = true;
+    setMode(buffer, mode);
+}
+
+void BufferPolicy::unpin(EditorBuffer& buffer) {
+    buffer.mode_pinned = false;
+    setMode(buffer, classify(buffer.load_bytes_total, buffer.total_lines, buffer.longest_line));
+}
+
+const char* BufferPolicy::name(BufferMode mode) {
+    switch (mode) {
+    case BufferMode::Large: return "LARGE";
+    case BufferMode::Huge:  return "HUGE";
+    default:                return "FULL";
+    }
+}
+
+bool BufferPolicy::readOnlyAfterLoad(const EditorBuffer& buffer) {
+    return mappedReadOnly(buffer.mode) || FileLoader::isSystemFile(buffer.filename);
+}
+
+void BufferPolicy::setMode(EditorBuffer& buffer, BufferMode mode) {
+    buffer.mode = mode;
+    // A load still in progress keeps the buffer read-only until it ends;
+    // stdin and binary buffers are read-only whatever the mode
+    if (buffer.load_id == 0 && buffer.file_id != INVALID_FILE_ID && !buffer.hex_view)
+        buffer.read_only = readOnlyAfterLoad(buffer);
+}
@@ -0,0 +1,62 @@
+#ifndef BUFFERPOLICY_H
+#define BUFFERPOLICY_H
+
+#include <cstddef>
+#include <cstdint>
+
+struct EditorBuffer;
+
+// How much of the editor's per-line machinery a buffer gets.  Larger files
+// trade features for responsiveness instead of freezing the UI.
+enum class BufferMode {
+    Full,    // everything
+    Large,   // plain rendering, journal undo, no smart indent or soft wrap, cheap scrollbar
+    Huge     // as Large, plus read-only text streamed from a mapping
+};
+
+// Picks a BufferMode from the size and shape of a loaded file and answers
+// which features the mode allows.
+class BufferPolicy {
+public:
+    // A file is Large if it reaches any of these...
+    static constexpr std::uintmax_t LARGE_BYTES = 16u * 1024 * 1024;
+    static constexpr int LARGE_LINES = 250000;
+    static constexpr std::size_t LARGE_LINE_LENGTH = 10000;   // minified code, one-line JSON
+    // ...and Huge if it reaches any of these.
+    static constexpr std::uintmax_t HUGE_BYTES = 512u * 1024 * 1024;
+    static constexpr int HUGE_LINES = 5000000;
+    static constexpr std::size_t HUGE_LINE_LENGTH = 1024 * 1024;
+
+    static BufferMode classify(std::uintmax_t bytes, int lines, std::size_t longest_line);
+
+    // Re-classifies `buffer` from load_bytes_total, total_lines and
+    // longest_line unless the user pinned a mode.  Only ever degrades, so
+    // a file growing during a progressive load never flips back and forth.
+    static void update(EditorBuffer& buffer);
+
+    // Sets a mode chosen by the user (stays until the file is reloaded) and
+    // adjusts read-only state to match.
+    static void pin(EditorBuffer& buffer, BufferMode mode);
+    // Returns to automatic classification.
+    static void unpin(EditorBuffer& buffer);
+
+    static const char* name(BufferMode mode);
+
+    // Whether a file stays read-only once loading has finished: system
+    // headers and Huge buffers.
+    static bool readOnlyAfterLoad(const EditorBuffer& buffer);
+
+    static bool syntaxHighlighting(BufferMode mode) { return mode == BufferMode::Full; }
+    static bool snapshotUndo(BufferMode mode) { return mode == BufferMode::Full; }
+    static bool smartIndent(BufferMode mode) { return mode == BufferMode::Full; }
+    static bool walkFromHead(BufferMode mode) { return mode == BufferMode::Full; }   // view position, scrollbar
+    static bool softWrap(BufferMode mode) { return mode == BufferMode::Full; }
+    static bool mappedReadOnly(BufferMode mode) { return mode == BufferMode::Huge; }
+    static bool languageServer(BufferMode mode) { return mode == BufferMode::Full; }
+    static bool overviewFromText(BufferMode mode) { return mode == BufferMode::Full; }   // else from the file on disk
+
+private:
+    static void setMode(EditorBuffer& buffer, BufferMode mode);
+};
+
+#endif // BUFFERPOLICY_H
@@ -0,0 +1,246 @@
+#include "BufferSnapshot.h"
+#include "EditorBuffer.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+// Ids given to new chunks; 0 is never handed out.  Snapshots are captured
+// on the UI thread only.
+std::uint32_t g_last_chunk_id = 0;
+
+std::uint32_t nextChunkId() {
+    if (++g_last_chunk_id == 0) ++g_last_chunk_id;
+    return g_last_chunk_id;
+}
+
+// Past this many marked chunks a full capture is as cheap
+constexpr std::size_t MAX_MARKED_CHUNKS = 1024;
+
+} // namespace
+
+void BufferSnapshot::Changes::mark(const Line* line) {
+    if (all) return;
+    if (line->snapshot_chunk == 0 || chunks.size() >= MAX_MARKED_CHUNKS) {
+        markAll();
+        return;
+    }
+    if (chunks.empty() || chunks.back() != line->snapshot_chunk) chunks.push_back(line->snapshot_chunk);
+}
+
+std::shared_ptr<const BufferSnapshot> BufferSnapshot::capture(Line* head, std::uint64_t version,
+                                                              FileId file_id,
+                                                              const BufferSnapshot* previous,
+                                                              const Changes& changes) {
+    std::shared_ptr<BufferSnapshot> snap;
+    auto begin = [&]() {
+        snap.reset(new BufferSnapshot());
+        snap->m_version = version;
+        snap->m_file_id = file_id;
+    };
+
+    auto push = [&](std::shared_ptr<const Chunk> chunk, const Line* first, const Line* last, std::uint32_t id) {
+        snap->m_starts.push_back(snap->m_line_count);
+        snap->m_ids.push_back(id);
+        snap->m_heads.push_back(first);
+        snap->m_tails.push_back(last);
+        snap->m_line_count += chunk->size();
+        snap->m_chunks.push_back(std::move(chunk));
+    };
+    auto share = [&](std::size_t c) {
+        push(previous->m_chunks[c], previous->m_heads[c], previous->m_tails[c], previous->m_ids[c]);
+    };
+    // Copies `n` lines into a new chunk and returns the line after them
+    bool copied = false;
+    auto copy = [&](Line* first, std::size_t n) {
+        if (!copied) snap->m_fresh_begin = snap->m_line_count;
+        snap->m_fresh_end = snap->m_line_count + n;
+        copied = true;
+        const std::uint32_t id = nextChunkId();
+        auto chunk = std::make_shared<Chunk>();
+        chunk->reserve(n);
+        Line* q = first;
+        const Line* last = nullptr;
+        for (; chunk->size() < n; q = q->next) {
+            q->snapshot_chunk = id;
+            chunk->push_back(q->text);
+            last = q;
+        }
+        push(std::move(chunk), first, last, id);
+        return q;
+    };
+
+    // Lines not covered by a shared chunk, copied in chunks of even size.
+    // They are kept as a run of the list rather than copied one by one, and
+    // whole chunks are cut off its front once it is long enough.
+    Line* pending = nullptr;
+    std::size_t pending_n = 0;
+    auto add = [&](Line* p) {
+        if (!pending) pending = p;
+        if (++pending_n == 2 * CHUNK_LINES) {
+            pending = copy(pending, CHUNK_LINES);
+            pending_n -= CHUNK_LINES;
+        }
+    };
+    auto flush = [&]() {
+        for (std::size_t pieces = (pending_n + CHUNK_LINES - 1) / CHUNK_LINES; pieces; --pieces) {
+            const std::size_t n = pending_n / pieces + (pending_n % pieces ? 1 : 0);
+            pending = copy(pending, n);
+            pending_n -= n;
+        }
+        pending = nullptr;
+    };
+
+    // With the changes known, only the lines between the unchanged chunks
+    // around each run of marked ones are read.  Returns false if the list
+    // does not fit `previous` where it should, i.e. an edit went unmarked.
+    auto incremental = [&]() {
+        std::unordered_set<std::uint32_t> marked(changes.chunks.begin(), changes.chunks.end());
+        auto changed = [&](std::size_t c) { return marked.count(previous->m_ids[c]) != 0; };
+        const std::size_t n = previous->chunkCount();
+        snap->m_chunks.reserve(n + 2);
+        snap->m_starts.reserve(n + 2);
+        snap->m_ids.reserve(n + 2);
+        snap->m_heads.reserve(n + 2);
+        snap->m_tails.reserve(n + 2);
+        Line* expect = head;           // where the next chunk has to start
+        std::size_t c = 0;
+        while (c < n) {
+            if (!changed(c)) {
+                if (previous->m_heads[c] != expect) return false;
+                share(c);
+                expect = previous->m_tails[c]->next;
+                ++c;
+                continue;
+            }
+            while (true) {
+                while (c < n && changed(c)) ++c;
+                const Line* stop = c < n ? previous->m_heads[c] : nullptr;
+                for (; expect != stop; expect = expect->next) {
+                    if (!expect) return false;
+                    add(expect);
+                }
+                // Too few lines for a chunk of their own: take the next
+                // chunk along, so chunks don't keep shrinking
+                if (c < n && pending_n < CHUNK_LINES / 4) {
+                    ++c;
+                    continue;
+                }
+                break;
+            }
+            flush();
+        }
+        // Lines appended since
+        for (; expect; expect = expect->next) add(expect);
+        flush();
+
+        // Chunks are shared in order, so what precedes the first copy and
+        // follows the last is the same in both
+        snap->m_from_base = true;
+        snap->m_base_version = previous->m_version;
+        if (!copied) snap->m_fresh_begin = snap->m_fresh_end = snap->m_line_count;
+        return true;
+    };
+
+    begin();
+    if (previous && !changes.all && incremental()) return snap;
+    begin();
+    pending = nullptr;
+    pending_n = 0;
+    copied = false;
+
+    // Where each chunk of `previous` started.  A node found here is only a
+    // hint: it may have been edited, or freed and handed out again, so the
+    // chunk is shared only if all of its lines still follow it unchanged.
+    std::unordered_map<const Line*, std::size_t> old_heads;
+    if (previous) {
+        old_heads.reserve(previous->m_heads.size());
+        for (std::size_t c = 0; c < previous->m_heads.size(); ++c) old_heads.emplace(previous->m_heads[c], c);
+    }
+
+    Line* p = head;
+    while (p) {
+        auto it = old_heads.find(p);
+        if (it != old_heads.end()) {
+            const auto& old = previous->m_chunks[it->second];
+            const std::uint32_t id = previous->m_ids[it->second];
+            Line* q = p;
+            const Line* last = nullptr;
+            std::size_t n = 0;
+            // Stamped as they are compared; lines that turn out not to
+            // match are copied, and stamped again, below
+            while (q && n < old->size() && (*old)[n] == q->text) {
+                q->snapshot_chunk = id;
+                last = q;
+                q = q->next;
+                ++n;
+            }
+            if (n == old->size()) {
+                // Small pieces left by edits are copied together with their
+                // neighbour instead, so chunks don't keep shrinking.
+                if (old->size() >= CHUNK_LINES / 4 && (pending_n == 0 || pending_n >= CHUNK_LINES / 4)) {
+                    flush();
+                    push(old, p, last, id);
+                    p = q;
+                    continue;
+                }
+                for (; p != q; p = p->next) add(p);
+                continue;
+            }
+        }
+        add(p);
+        p = p->next;
+    }
+    flush();
+    return snap;
+}
+
+std::size_t BufferSnapshot::chunkOf(std::size_t idx) const {
+    // Chunks are CHUNK_LINES long until the buffer is edited, so try there first
+    std::size_t c = std::min(idx / CHUNK_LINES, m_starts.size() - 1);
+    if (m_starts[c] <= idx && (c + 1 == m_starts.size() || idx < m_starts[c + 1])) return c;
+    return static_cast<std::size_t>(std::upper_bound(m_starts.begin(), m_starts.end(), idx) - m_starts.begin()) - 1;
+}
+
+BufferSnapshot::Diff BufferSnapshot::diff(const BufferSnapshot& old, const BufferSnapshot& now) {
+    const std::size_t n_old = old.lineCount(), n_new = now.lineCount();
+    const std::size_t shorter = std::min(n_old, n_new);
+    Diff d;
+    if (now.m_from_base && now.m_base_version == old.m_version && now.m_file_id == old.m_file_id) {
+        d.head = now.m_fresh_begin;
+        d.tail = n_new - now.m_fresh_end;
+    } else {
+        for (std::size_t c = 0; c < old.chunkCount() && c < now.chunkCount() && old.chunk(c) == now.chunk(c); ++c) {
+            d.head += old.chunk(c)->size();
+        }
+        for (std::size_t c = 1; c <= old.chunkCount() && c <= now.chunkCount(); ++c) {
+            const auto& chunk = old.chunk(old.chunkCount() - c);
+            if (chunk != now.chunk(now.chunkCount() - c) || d.head + d.tail + chunk->size() > shorter) break;
+            d.tail += chunk->size();
+        }
+    }
+    while (d.head < n_old - d.tail && d.head < n_new - d.tail && old.line(d.head) == now.line(d.head)) ++d.head;
+    while (d.tail < n_old - d.head && d.tail < n_new - d.head &&
+           old.line(n_old - 1 - d.tail) == now.line(n_new - 1 - d.tail)) {
+        ++d.tail;
+    }
+    return d;
+}
+
+const std::string& BufferSnapshot::text() const {
+    std::call_once(m_text_once, [this] {
+        std::size_t size = 0;
+        for (const auto& chunk : m_chunks)
+            for (const auto& l : *chunk) size += l.size() + 1;
+        m_text.reserve(size);
+        for (const auto& chunk : m_chunks) {
+            for (const auto& l : *chunk) {
+                m_text += l;
+                m_text += '\n';
+            }
+        }
+    });
+    return m_text;
+}
@@ -0,0 +1,119 @@
+#ifndef BUFFERSNAPSHOT_H
+#define BUFFERSNAPSHOT_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "PathRegistry.h"
+
+struct Line;
+
+// Read-only copy of a buffer's text at one version.
+//
+// Snapshots are handed out as shared_ptr<const BufferSnapshot> and never
+// change after construction, so any thread may read them without locking
+// while the UI keeps editing the live Line list.  Lines are stored in
+// chunks of up to CHUNK_LINES lines; a new snapshot reuses every chunk of
+// its predecessor whose lines did not change, so successive snapshots of a
+// large file share almost all of their memory.
+//
+// Every captured line is stamped with the id of its chunk.  Edits record
+// the chunks of the lines they change in a Changes set, and capture()
+// re-reads only the list between the unchanged chunks around them; every
+// other chunk is taken over from the previous snapshot without looking at
+// its lines.  Chunks vary in size as a result.
+//
+// When the changes are not known, capture() walks the whole list instead
+// and finds the chunks of `previous` again by the Line node each started
+// at, comparing their lines before sharing them.
+class BufferSnapshot final {
+public:
+    static constexpr std::size_t CHUNK_LINES = 256;
+    using Chunk = std::vector<std::string>;
+
+    // Chunks of the latest snapshot of a buffer that edits have touched
+    // since.  Lines appended after the last chunk need no mark.
+    struct Changes {
+        bool all = true;                       // anything may have changed
+        std::vector<std::uint32_t> chunks;
+
+        // `line` was changed, or is about to be destroyed.  A line inserted
+        // since the snapshot counts for the chunk stamped on it, if any.
+        void mark(const Line* line);
+        void markAll() { all = true; chunks.clear(); }
+    };
+
+    // Copies the list starting at `head` and stamps its lines.  Chunks of
+    // `previous` that `changes` leaves out are shared instead of
+    // duplicated; `changes` must hold every edit since `previous`.
+    static std::shared_ptr<const BufferSnapshot> capture(Line* head, std::uint64_t version,
+                                                         FileId file_id,
+                                                         const BufferSnapshot* previous,
+                                                         const Changes& changes);
+
+    std::uint64_t version() const { return m_version; }
+    FileId fileId() const { return m_file_id; }
+    std::size_t lineCount() const { return m_line_count; }
+
+    // 0-based line access.
+    const std::string& line(std::size_t idx) const {
+        std::size_t c = chunkOf(idx);
+        return (*m_chunks[c])[idx - m_starts[c]];
+    }
+
+    // The chunks themselves: a chunk shared with another snapshot is the
+    // same object, so readers can cache per-chunk results by its address.
+    std::size_t chunkCount() const { return m_chunks.size(); }
+    const std::shared_ptr<const Chunk>& chunk(std::size_t idx) const { return m_chunks[idx]; }
+    // Index of the chunk holding line `idx`.
+    std::size_t chunkOf(std::size_t idx) const;
+
+    // Lines that differ between `old` and `now`, two snapshots of the same
+    // buffer: the first `head` and the last `tail` lines of both are equal,
+    // so lines [head, old.lineCount() - tail) of `old` became lines
+    // [head, now.lineCount() - tail) of `now`.  When `now` was captured
+    // from `old` with its changes known, only the lines it copied afresh
+    // are looked at; otherwise shared chunks at either end are skipped
+    // without comparing their lines.
+    struct Diff {
+        std::size_t head = 0;
+        std::size_t tail = 0;
+    };
+    static Diff diff(const BufferSnapshot& old, const BufferSnapshot& now);
+
+    // Whole document, each line terminated by '\n'.  Built on first use and
+    // cached, so repeated callers (e.g. CXUnsavedFile contents) pay once per
+    // version.
+    const std::string& text() const;
+
+private:
+    BufferSnapshot() = default;
+
+    std::uint64_t m_version = 0;
+    FileId m_file_id = INVALID_FILE_ID;
+    std::size_t m_line_count = 0;
+    std::vector<std::shared_ptr<const Chunk>> m_chunks;
+    std::vector<std::size_t> m_starts;     // first line of each chunk
+    std::vector<std::uint32_t> m_ids;
+    // The nodes each chunk started and ended at when it was captured.
+    // Followed only for chunks no change was recorded for; the nodes of the
+    // others may be gone by now.
+    std::vector<const Line*> m_heads;
+    std::vector<const Line*> m_tails;
+    // Set when captured from the snapshot of version m_base_version with
+    // its changes known: lines outside [m_fresh_begin, m_fresh_end) are in
+    // chunks shared with it, at the same distance from either end.
+    std::uint64_t m_base_version = 0;
+    bool m_from_base = false;
+    std::size_t m_fresh_begin = 0;
+    std::size_t m_fresh_end = 0;
+
+    mutable std::once_flag m_text_once;
+    mutable std::string m_text;
+};
+
+using BufferSnapshotPtr = std::shared_ptr<const BufferSnapshot>;
+
+#endif // BUFFERSNAPSHOT_H
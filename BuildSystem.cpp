@@ -267,19 +267,15 @@ std::vector<CompileMessage> BuildSystem::parseCompilerOutput(const std::string&
         if (std::regex_search(line, match, re_diag)) {
             std::string raw_file = match[1].str();
 
-            // Resolve filename to absolute path
-            if (!raw_file.empty() && raw_file[0] == '/') {
-                msg.filename = raw_file;
-            } else if (!base_dir.empty()) {
-                std::string candidate = base_dir + "/" + raw_file;
-                std::error_code ec;
-                auto abs = std::filesystem::weakly_canonical(candidate, ec);
-                if (!ec && std::filesystem::exists(abs))
-                    msg.filename = abs.string();
-                else
-                    msg.filename = raw_file;
+            // Resolve filename through the path registry; repeated
+            // diagnostics for the same file cost a hash lookup, not a realpath
+            if (!raw_file.empty() && raw_file[0] != '/' && !base_dir.empty()) {
+                FileId candidate = PathRegistry::instance().intern(base_dir + "/" + raw_file);
+                msg.file_id = PathRegistry::instance().exists(candidate)
+                                  ? candidate
+                                  : PathRegistry::instance().intern(raw_file);
             } else {
-                msg.filename = raw_file;
+                msg.file_id = PathRegistry::instance().intern(raw_file);
             }
 
             const std::string& type_str = match[4].str();
@@ -19,7 +19,7 @@ struct CompilationResult {
 struct CompileMessage {
     enum CompileMessageType { CMSG_NONE, CMSG_ERROR, CMSG_WARNING, CMSG_NOTE };
     std::string full_text;
-    std::string filename;   // absolute path to source file, empty if unknown
+    FileId file_id = INVALID_FILE_ID;   // source file, INVALID_FILE_ID if unknown
     CompileMessageType type = CMSG_NONE;
     int line = -1;
     int col  = -1;
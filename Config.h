@@ -8,12 +8,21 @@ struct Config {
     bool smart_indentation = true;
     int indentation_width = 4;
     bool show_line_numbers = true;
+    bool soft_wrap = false;             // wrap long lines at the window edge instead of scrolling
     std::string color_scheme_name = "Obsidian";
     int compile_mode = -1;
     int optimization_level = -1;
     std::vector<bool> security_flags = {true, true, true, true, true};
     std::string extra_compile_flags = "-Wall";
     std::map<std::string, std::string> keybindings;
+    int stream_memory_limit_mb = 256;   // lines read from stdin kept in memory, 0 = unlimited
+    bool stream_spill_to_file = true;   // copy stdin to a temp file so dropped lines are not lost
+    bool tidy_on_save = false;          // run clang-tidy on a C/C++ file after it is saved
+    std::string tidy_checks;            // --checks for clang-tidy; empty: .clang-tidy files decide
+    bool lsp_enabled = true;            // use a language server for definitions, references, diagnostics
+    std::string lsp_command = "clangd --background-index --pch-storage=memory";
+    bool semantic_highlighting = true;  // colour types, members, macros and enum constants via libclang
+    double benchmark_regression_pct = 5.0;  // Google Benchmark: CPU time this much above the baseline is flagged
 };
 
 
@@ -19,12 +19,21 @@ void ConfigManager::loadConfig(Config& config) {
             if (data.contains("smart_indentation")) config.smart_indentation = data["smart_indentation"];
             if (data.contains("indentation_width")) config.indentation_width = data["indentation_width"];
             if (data.contains("show_line_numbers")) config.show_line_numbers = data["show_line_numbers"];
+            if (data.contains("soft_wrap")) config.soft_wrap = data["soft_wrap"];
             if (data.contains("color_scheme")) config.color_scheme_name = data["color_scheme"];
             if (data.contains("compile_mode")) config.compile_mode = data["compile_mode"];
             if (data.contains("optimization_level")) config.optimization_level = data["optimization_level"];
             if (data.contains("security_flags")) config.security_flags = data["security_flags"].get<std::vector<bool>>();
             if (data.contains("extra_compile_flags")) config.extra_compile_flags = data["extra_compile_flags"];
             if (data.contains("keybindings")) config.keybindings = data["keybindings"].get<std::map<std::string, std::string>>();
+            if (data.contains("stream_memory_limit_mb")) config.stream_memory_limit_mb = data["stream_memory_limit_mb"];
+            if (data.contains("stream_spill_to_file")) config.stream_spill_to_file = data["stream_spill_to_file"];
+            if (data.contains("tidy_on_save")) config.tidy_on_save = data["tidy_on_save"];
+            if (data.contains("tidy_checks")) config.tidy_checks = data["tidy_checks"];
+            if (data.contains("lsp_enabled")) config.lsp_enabled = data["lsp_enabled"];
+            if (data.contains("lsp_command")) config.lsp_command = data["lsp_command"];
+            if (data.contains("semantic_highlighting")) config.semantic_highlighting = data["semantic_highlighting"];
+            if (data.contains("benchmark_regression_pct")) config.benchmark_regression_pct = data["benchmark_regression_pct"];
         }
     } catch (const json::parse_error& e) {
         // We can't easily call msgwin here without a pointer to TextEditor or a callback.
@@ -38,12 +47,21 @@ void ConfigManager::saveConfig(const Config& config) {
     j["smart_indentation"] = config.smart_indentation;
     j["indentation_width"] = config.indentation_width;
     j["show_line_numbers"] = config.show_line_numbers;
+    j["soft_wrap"] = config.soft_wrap;
     j["color_scheme"] = config.color_scheme_name;
     j["compile_mode"] = config.compile_mode;
     j["optimization_level"] = config.optimization_level;
     j["security_flags"] = config.security_flags;
     j["extra_compile_flags"] = config.extra_compile_flags;
     j["keybindings"] = config.keybindings;
+    j["stream_memory_limit_mb"] = config.stream_memory_limit_mb;
+    j["stream_spill_to_file"] = config.stream_spill_to_file;
+    j["tidy_on_save"] = config.tidy_on_save;
+    j["tidy_checks"] = config.tidy_checks;
+    j["lsp_enabled"] = config.lsp_enabled;
+    j["lsp_command"] = config.lsp_command;
+    j["semantic_highlighting"] = config.semantic_highlighting;
+    j["benchmark_regression_pct"] = config.benchmark_regression_pct;
     
     std::ofstream o(m_configPath);
     if (o.is_open()) {
@@ -68,11 +86,20 @@ void ConfigManager::createDefaultConfigFile(const std::string& path) {
     j["smart_indentation"] = true;
     j["indentation_width"] = 4;
     j["show_line_numbers"] = true;
+    j["soft_wrap"] = false;
     j["color_scheme"] = "Obsidian";
     j["compile_mode"] = -1;
     j["optimization_level"] = -1;
     j["security_flags"] = {true, true, true, true, true};
     j["extra_compile_flags"] = "-Wall";
+    j["stream_memory_limit_mb"] = 256;
+    j["stream_spill_to_file"] = true;
+    j["tidy_on_save"] = false;
+    j["tidy_checks"] = "";
+    j["lsp_enabled"] = true;
+    j["lsp_command"] = "clangd --background-index --pch-storage=memory";
+    j["semantic_highlighting"] = true;
+    j["benchmark_regression_pct"] = 5.0;
     j["keybindings"] = {
         {"new", "Ctrl+N"}, {"open", "Ctrl+O"}, {"save", "Ctrl+S"}, {"exit", "Alt+X"},
         {"undo", "Alt+BS"}, {"redo", "Alt+Y"}, {"cut", "Ctrl+X"}, {"copy", "Ctrl+C"},
@@ -1,19 +1,25 @@
 #include "EditorBuffer.h"
 
 EditorBuffer::EditorBuffer(const EditorBuffer &other) :
-    total_lines(other.total_lines), filename(other.filename), changed(other.changed),
-    is_new_file(other.is_new_file), insert_mode(other.insert_mode),
+    total_lines(other.total_lines), filename(other.filename), file_id(other.file_id), version(other.version),
+    generation(other.generation), head_lines_dropped(other.head_lines_dropped),
+    changed(other.changed), is_new_file(other.is_new_file), insert_mode(other.insert_mode),
     cursor_col(other.cursor_col), current_line_num(other.current_line_num),
     cursor_screen_y(other.cursor_screen_y), horizontal_scroll_offset(other.horizontal_scroll_offset),
     selecting(other.selecting), selection_anchor_col(other.selection_anchor_col),
     selection_anchor_linenum(other.selection_anchor_linenum), syntax_type(other.syntax_type),
-    keywords(other.keywords), in_multiline_comment(other.in_multiline_comment)
+    keywords(other.keywords),
+    load_bytes_total(other.load_bytes_total), load_bytes_done(other.load_bytes_done),
+    mode(other.mode), mode_pinned(other.mode_pinned), longest_line(other.longest_line),
+    wrap_top_row(other.wrap_top_row),
+    hex_view(other.hex_view),
+    m_snapshot(other.m_snapshot)
 {
     if (!other.document_head) {
         document_head = nullptr; current_line = nullptr; first_visible_line = nullptr; selection_anchor_line = nullptr;
         return;
     }
-    document_head = new Line{other.document_head->text};
+    document_head = line_pool.create(other.document_head->text);
     Line* this_curr = document_head;
     const Line* other_curr = other.document_head;
     if (other_curr == other.current_line) current_line = this_curr;
@@ -21,7 +27,7 @@ EditorBuffer::EditorBuffer(const EditorBuffer &other) :
     if (other_curr == other.selection_anchor_line) selection_anchor_line = this_curr;
     other_curr = other_curr->next;
     while(other_curr) {
-        this_curr->next = new Line{other_curr->text, this_curr};
+        this_curr->next = line_pool.create(other_curr->text, this_curr);
         this_curr = this_curr->next;
         if (other_curr == other.current_line) current_line = this_curr;
         if (other_curr == other.first_visible_line) first_visible_line = this_curr;
@@ -31,16 +37,14 @@ EditorBuffer::EditorBuffer(const EditorBuffer &other) :
 }
 
 EditorBuffer::EditorBuffer(int nr) : bufferNr(nr) {
-    document_head = new Line();
+    document_head = line_pool.create();
 
     current_line = document_head;
     first_visible_line = document_head;
 }
 
-EditorBuffer::~EditorBuffer() {
-    Line* p = document_head;
-    while (p != nullptr) { Line* q = p; p = p->next; delete q; }
-}
+// line_pool releases the document slab by slab
+EditorBuffer::~EditorBuffer() = default;
 
 EditorBuffer &EditorBuffer::operator=(const EditorBuffer &other) {
     if (this == &other) return *this;
@@ -50,9 +54,10 @@ EditorBuffer &EditorBuffer::operator=(const EditorBuffer &other) {
 }
 
 EditorBuffer::EditorBuffer(EditorBuffer &&other) noexcept :
-    document_head(other.document_head), total_lines(other.total_lines),
-    filename(std::move(other.filename)), changed(other.changed),
-    is_new_file(other.is_new_file), insert_mode(other.insert_mode),
+    line_pool(std::move(other.line_pool)), document_head(other.document_head), total_lines(other.total_lines),
+    filename(std::move(other.filename)), file_id(other.file_id), version(other.version),
+    generation(other.generation), head_lines_dropped(other.head_lines_dropped),
+    changed(other.changed), is_new_file(other.is_new_file), insert_mode(other.insert_mode),
     current_line(other.current_line), first_visible_line(other.first_visible_line),
     cursor_col(other.cursor_col), current_line_num(other.current_line_num),
     cursor_screen_y(other.cursor_screen_y), horizontal_scroll_offset(other.horizontal_scroll_offset),
@@ -60,17 +65,26 @@ EditorBuffer::EditorBuffer(EditorBuffer &&other) noexcept :
     selection_anchor_col(other.selection_anchor_col), selection_anchor_linenum(other.selection_anchor_linenum),
     undo_stack(std::move(other.undo_stack)), redo_stack(std::move(other.redo_stack)),
     syntax_type(other.syntax_type), keywords(std::move(other.keywords)),
-    in_multiline_comment(other.in_multiline_comment)
+    load_id(other.load_id), load_tail(other.load_tail),
+    load_bytes_total(other.load_bytes_total), load_bytes_done(other.load_bytes_done),
+    filter_view(std::move(other.filter_view)),
+    mode(other.mode), mode_pinned(other.mode_pinned), longest_line(other.longest_line),
+    wrap_layout(std::move(other.wrap_layout)), wrap_top_row(other.wrap_top_row),
+    overview(std::move(other.overview)), search_matches(std::move(other.search_matches)),
+    syntax_model(std::move(other.syntax_model)), semantic(std::move(other.semantic)),
+    hex_view(std::move(other.hex_view)),
+    m_snapshot(std::move(other.m_snapshot)), m_changes(std::move(other.m_changes))
 {
     other.document_head = nullptr;
+    other.load_id = 0; other.load_tail = nullptr;
 }
 
 EditorBuffer &EditorBuffer::operator=(EditorBuffer &&other) noexcept {
     if (this == &other) return *this;
-    Line* p = document_head;
-    while (p != nullptr) { Line* q = p; p = p->next; delete q; }
+    line_pool = std::move(other.line_pool);
     document_head = other.document_head; total_lines = other.total_lines;
-    filename = std::move(other.filename); changed = other.changed;
+    filename = std::move(other.filename); file_id = other.file_id; version = other.version; changed = other.changed;
+    generation = other.generation; head_lines_dropped = other.head_lines_dropped;
     is_new_file = other.is_new_file; insert_mode = other.insert_mode;
     current_line = other.current_line; first_visible_line = other.first_visible_line;
     cursor_col = other.cursor_col; current_line_num = other.current_line_num;
@@ -79,7 +93,25 @@ EditorBuffer &EditorBuffer::operator=(EditorBuffer &&other) noexcept {
     selection_anchor_col = other.selection_anchor_col; selection_anchor_linenum = other.selection_anchor_linenum;
     undo_stack = std::move(other.undo_stack); redo_stack = std::move(other.redo_stack);
     syntax_type = other.syntax_type; keywords = std::move(other.keywords);
-    in_multiline_comment = other.in_multiline_comment;
+    load_id = other.load_id; load_tail = other.load_tail;
+    load_bytes_total = other.load_bytes_total; load_bytes_done = other.load_bytes_done;
+    filter_view = std::move(other.filter_view);
+    mode = other.mode; mode_pinned = other.mode_pinned; longest_line = other.longest_line;
+    wrap_layout = std::move(other.wrap_layout); wrap_top_row = other.wrap_top_row;
+    overview = std::move(other.overview); search_matches = std::move(other.search_matches);
+    syntax_model = std::move(other.syntax_model); semantic = std::move(other.semantic);
+    hex_view = std::move(other.hex_view);
+    m_snapshot = std::move(other.m_snapshot);
+    m_changes = std::move(other.m_changes);
     other.document_head = nullptr;
+    other.load_id = 0; other.load_tail = nullptr;
     return *this;
 }
+
+BufferSnapshotPtr EditorBuffer::snapshot() const {
+    if (!m_snapshot || m_snapshot->version() != version || m_snapshot->fileId() != file_id) {
+        m_snapshot = BufferSnapshot::capture(document_head, version, file_id, m_snapshot.get(), m_changes);
+        m_changes = BufferSnapshot::Changes{false, {}};
+    }
+    return m_snapshot;
+}
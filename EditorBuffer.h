@@ -4,22 +4,31 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <memory>
 #include "CompilerSettings.h"
+#include "PathRegistry.h"
+#include "BufferSnapshot.h"
+#include "BufferPolicy.h"
+#include "LinePool.h"
 
-struct Line {
-    std::string text;
-    Line* prev = nullptr;
-    Line* next = nullptr;
-    bool selected = false;
-    int selection_start_col = 0;
-    int selection_end_col = 0;
-};
+class FilteredView;
+class HexView;
+class OverviewRuler;
+class SearchMatches;
+class SemanticHighlights;
+class SyntaxModel;
+class WrapLayout;
 
 struct UndoRecord {
     std::vector<std::string> lines;
     int cursor_line_num;
     int cursor_col;
     int first_visible_line_num;
+    // Journal records (buffers not in BufferMode::Full) hold only the lines
+    // starting at first_line of a document that had total_lines lines;
+    // first_line == 0 means `lines` is the whole document.
+    int first_line = 0;
+    int total_lines = 0;
 };
 
 struct EditorBuffer final {
@@ -40,10 +49,39 @@ public:
 
     EditorBuffer& operator=(EditorBuffer&& other) noexcept;
 
+    // Marks the text as modified: sets `changed` and bumps `version`.
+    // Every edit of the Line list must end with a call to touch().  An edit
+    // confined to `line` and the lines it inserted after it passes the line,
+    // and the next snapshot copies only the chunk around it; without one
+    // the whole text is read again.
+    void touch() { m_changes.markAll(); bump(); }
+    void touch(const Line* line) { m_changes.mark(line); bump(); }
+
+    // For edits that change more than the line passed to touch(), or that
+    // bump `version` without touch(): records a changed line, before it is
+    // destroyed.  Lines appended at the end need no mark.
+    void markChanged(const Line* line) { m_changes.mark(line); }
+    void markAllChanged() { m_changes.markAll(); }
+
+    // Immutable copy of the current text for background readers.  Returns the
+    // cached snapshot while `version` is unchanged; UI thread only.
+    BufferSnapshotPtr snapshot() const;
+
 public:
+    // Owns every Line of the document: create and destroy them through it.
+    // Not copied; a copy of the buffer allocates its own lines.
+    LinePool line_pool;
     Line *document_head = nullptr;
     int total_lines = 1;
     std::string filename{"noname00.cpp"};
+    FileId file_id = INVALID_FILE_ID;
+    std::uint64_t version = 0;      // incremented on every text modification
+    // Incremented when lines may have been freed or rewritten (edits,
+    // reloads); appending lines only bumps `version`.  Line pointers kept
+    // outside the buffer stay valid while it is unchanged, except for lines
+    // trimmed off the head of a stream, which are counted separately.
+    std::uint64_t generation = 0;
+    std::uint64_t head_lines_dropped = 0;
     bool changed = false;
     bool is_new_file = true;
     bool read_only = false;
@@ -60,12 +98,61 @@ public:
     int selection_anchor_linenum = 1;
     SyntaxType syntax_type = ST_NONE;
     std::map<std::string, int> keywords;
-    bool in_multiline_comment = false;
     int bufferNr = 1;
     std::vector<UndoRecord> undo_stack;
     std::vector<UndoRecord> redo_stack;
     CompilerSettings compiler_settings;
 
+    // Progressive loading (see FileLoader::loadPrefix), stdin streaming and
+    // follow mode.  load_id is non-zero while lines are still being appended;
+    // load_tail is the last line appended so far.  load_bytes_done is the
+    // number of file bytes the text was read from.  Copies of a buffer never
+    // continue a load.
+    std::uint64_t load_id = 0;
+    Line* load_tail = nullptr;
+    std::uintmax_t load_bytes_total = 0;
+    std::uintmax_t load_bytes_done = 0;
+
+    // Active "only show matching lines" view, if any.  Not copied.
+    std::shared_ptr<FilteredView> filter_view;
+
+    // Feature level chosen by BufferPolicy when the file was loaded, or by
+    // the user if mode_pinned.  longest_line is tracked by the loader.
+    BufferMode mode = BufferMode::Full;
+    bool mode_pinned = false;
+    std::size_t longest_line = 0;
+
+    // Soft-wrap row counts, built on first use while wrapping is on.  Not
+    // copied.  wrap_top_row is how many rows of first_visible_line are
+    // scrolled off the top of the screen.
+    std::shared_ptr<WrapLayout> wrap_layout;
+    int wrap_top_row = 0;
+
+    // Summary behind the overview column, built on first draw.  Not copied.
+    std::shared_ptr<OverviewRuler> overview;
+
+    // Matches of the incremental search term while searching.  Not copied.
+    std::shared_ptr<SearchMatches> search_matches;
+
+    // Lexer states and brackets behind highlighting and bracket matching,
+    // built on first draw.  Not copied.
+    std::shared_ptr<SyntaxModel> syntax_model;
+
+    // libclang's colours for types, members, macros and enum constants,
+    // while semantic highlighting is on.  Not copied.
+    std::shared_ptr<SemanticHighlights> semantic;
+
+    // Set for binary files: the buffer holds no text and is shown as a hex
+    // dump of the mapped file instead.
+    std::shared_ptr<HexView> hex_view;
+
+private:
+    void bump() { changed = true; ++version; ++generation; }
+
+    mutable BufferSnapshotPtr m_snapshot;
+    // Edits since m_snapshot.  Not copied: a copy's lines are new.
+    mutable BufferSnapshot::Changes m_changes;
+
 };
 
 #endif // EDITORBUFFER_H
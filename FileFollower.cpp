@@ -0,0 +1,197 @@
+#include "FileFollower.h"
+
+#include <chrono>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+std::int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+void FileFollower::follow(FileId id) {
+    if (id == INVALID_FILE_ID || m_states.count(id)) return;
+    m_states[id] = State{};
+    m_watcher.add(id);
+}
+
+void FileFollower::unfollow(FileId id, BufferManager& buffers) {
+    auto it = m_states.find(id);
+    if (it == m_states.end()) return;
+    int idx = buffers.findByFileId(id);
+    if (idx != -1) {
+        EditorBuffer& buffer = buffers.getBuffer(idx);
+        if (it->second.load_id != 0 && buffer.load_id == it->second.load_id) {
+            buffer.load_id = 0;
+            buffer.load_tail = nullptr;
+            buffer.read_only = BufferPolicy::readOnlyAfterLoad(buffer);
+        }
+    }
+    release(it->second);
+    m_watcher.remove(id);
+    m_states.erase(it);
+}
+
+void FileFollower::release(State& st) {
+    if (st.fd >= 0) close(st.fd);
+    st.fd = -1;
+}
+
+// Takes over a freshly loaded buffer: from here on only bytes past what
+// read_file() consumed are read.
+bool FileFollower::attach(State& st, EditorBuffer& buffer) {
+    release(st);
+    st = State{};
+
+    const std::string path = PathRegistry::instance().path(buffer.file_id);
+    st.fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (st.fd < 0) return false;
+    struct stat sb;
+    if (fstat(st.fd, &sb) != 0) { release(st); return false; }
+    st.dev = sb.st_dev;
+    st.ino = sb.st_ino;
+    st.offset = static_cast<off_t>(buffer.load_bytes_done);
+
+    // A last line without '\n' may still be completed by the writer
+    char last = '\n';
+    if (st.offset > 0 && pread(st.fd, &last, 1, st.offset - 1) == 1) st.tail_open = (last != '\n');
+
+    Line* tail = buffer.document_head;
+    while (tail && tail->next) tail = tail->next;
+
+    st.load_id = FileLoader::nextLoadId();
+    buffer.load_id = st.load_id;
+    buffer.load_tail = tail;
+    buffer.read_only = true;
+    st.pending = true;
+    return true;
+}
+
+// The name now belongs to a different file (log rotation): finish the old
+// file's unterminated line and continue with the new file from offset 0.
+bool FileFollower::switchIfRotated(State& st, EditorBuffer& buffer) {
+    const std::string path = PathRegistry::instance().path(buffer.file_id);
+    struct stat cur;
+    if (stat(path.c_str(), &cur) != 0 || (cur.st_ino == st.ino && cur.st_dev == st.dev)) return false;
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    close(st.fd);
+    st.fd = fd;
+    st.dev = cur.st_dev;
+    st.ino = cur.st_ino;
+    st.offset = 0;
+    if (!st.carry.empty()) {
+        LineChunk rest = FileLoader::splitChunk("", 0, st.carry, true);
+        FileLoader::appendChunk(buffer, rest);
+    }
+    st.tail_open = false;
+    return true;
+}
+
+void FileFollower::appendLines(State& st, EditorBuffer& buffer, LineChunk& chunk) {
+    Line* last = buffer.load_tail ? buffer.load_tail : buffer.document_head;
+    bool follow_cursor = (buffer.current_line == last);
+
+    if (st.tail_open && buffer.load_tail) {
+        // The first completed line continues the buffer's last line
+        Line* first = chunk.head;
+        buffer.markChanged(buffer.load_tail);
+        buffer.load_tail->text += first->text;
+        chunk.head = first->next;
+        if (chunk.head) chunk.head->prev = nullptr; else chunk.tail = nullptr;
+        chunk.count--;
+        chunk.pool.destroy(first);
+        ++buffer.version;
+    }
+    st.tail_open = false;
+    FileLoader::appendChunk(buffer, chunk);
+
+    if (follow_cursor) {
+        buffer.current_line = buffer.load_tail;
+        buffer.current_line_num = buffer.total_lines;
+        buffer.cursor_col = 1;
+    }
+}
+
+void FileFollower::readAppended(State& st, EditorBuffer& buffer) {
+    st.pending = false;
+
+    // Second pass only after a rotation: drain the new file right away.
+    for (int pass = 0; pass < 2; ++pass) {
+        struct stat sb;
+        if (fstat(st.fd, &sb) != 0) return;
+
+        if (sb.st_size < st.offset) {
+            // Truncated in place (copytruncate): start over from the top
+            st.offset = 0;
+            st.carry.clear();
+            st.tail_open = false;
+        }
+
+        if (sb.st_size > st.offset) {
+            std::size_t want = static_cast<std::size_t>(sb.st_size - st.offset);
+            bool more = want > TICK_BUDGET;
+            if (more) want = TICK_BUDGET;
+
+            std::vector<char> data(want);
+            ssize_t got = pread(st.fd, data.data(), want, st.offset);
+            if (got <= 0) return;
+            st.offset += got;
+
+            LineChunk chunk = FileLoader::splitChunk(data.data(), static_cast<std::size_t>(got), st.carry, false);
+            if (chunk.count > 0) appendLines(st, buffer, chunk);
+            if (more) { st.pending = true; return; }
+        }
+
+        if (!switchIfRotated(st, buffer)) return;
+    }
+}
+
+void FileFollower::tick(BufferManager& buffers) {
+    if (m_states.empty()) return;
+
+    for (FileId id : m_watcher.poll()) {
+        auto it = m_states.find(id);
+        if (it != m_states.end()) it->second.pending = true;
+    }
+    // Without inotify (or for changes it cannot see, e.g. NFS) fall back
+    // to a cheap fstat once a second.
+    std::int64_t now = nowMs();
+    if (now - m_last_fallback_ms >= FALLBACK_POLL_MS) {
+        m_last_fallback_ms = now;
+        for (auto& [id, st] : m_states) st.pending = true;
+    }
+
+    for (auto it = m_states.begin(); it != m_states.end();) {
+        State& st = it->second;
+        int idx = buffers.findByFileId(it->first);
+        if (idx == -1) {
+            if (st.load_id != 0) {
+                // Buffer was closed
+                release(st);
+                m_watcher.remove(it->first);
+                it = m_states.erase(it);
+                continue;
+            }
+            ++it;   // not opened yet (background load)
+            continue;
+        }
+
+        EditorBuffer& buffer = buffers.getBuffer(idx);
+        if (st.load_id == 0 || buffer.load_id != st.load_id) {
+            // Not attached yet, or the buffer was reloaded. Wait for a
+            // progressive load to finish before taking over.
+            if (buffer.load_id != 0 && buffer.load_id != st.load_id) { ++it; continue; }
+            if (!attach(st, buffer)) { ++it; continue; }
+        }
+        if (st.pending) readAppended(st, buffer);
+        ++it;
+    }
+}
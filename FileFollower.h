@@ -0,0 +1,59 @@
+#ifndef FILEFOLLOWER_H
+#define FILEFOLLOWER_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <sys/types.h>
+#include "BufferManager.h"
+#include "FileLoader.h"
+#include "FileWatcher.h"
+
+// Follow mode ("tail -f") for buffers backed by growing files.
+//
+// The buffer is loaded through the normal read_file() path first; after that
+// only bytes past the last known offset are read and split, so following a
+// multi-gigabyte log costs nothing but the appended data.  Truncation
+// (copytruncate) restarts at offset 0, rotation (a new file under the same
+// name) switches to the new file.  The buffer is read-only while followed.
+class FileFollower {
+public:
+    // Starts following the buffer editing `id` as soon as it is open and
+    // fully loaded.
+    void follow(FileId id);
+    // Stops following; the buffer becomes editable again.
+    void unfollow(FileId id, BufferManager& buffers);
+    bool isFollowing(FileId id) const { return m_states.count(id) != 0; }
+
+    // Called once per main loop iteration; reads newly appended data.
+    void tick(BufferManager& buffers);
+
+private:
+    struct State {
+        std::uint64_t load_id = 0;   // 0 until the buffer was attached
+        int fd = -1;
+        dev_t dev = 0;
+        ino_t ino = 0;
+        off_t offset = 0;
+        std::string carry;           // unterminated last line
+        bool tail_open = false;      // buffer's last line may still grow
+        bool pending = true;         // re-check the file on this tick
+    };
+
+    bool attach(State& st, EditorBuffer& buffer);
+    void readAppended(State& st, EditorBuffer& buffer);
+    void appendLines(State& st, EditorBuffer& buffer, LineChunk& chunk);
+    bool switchIfRotated(State& st, EditorBuffer& buffer);
+    void release(State& st);
+
+    // Bytes read per file and tick; the rest waits for the next tick.
+    static constexpr std::size_t TICK_BUDGET = 4u * 1024 * 1024;
+    // How often files are re-checked when no inotify event arrived.
+    static constexpr int FALLBACK_POLL_MS = 1000;
+
+    FileWatcher m_watcher;
+    std::map<FileId, State> m_states;
+    std::int64_t m_last_fallback_ms = 0;
+};
+
+#endif // FILEFOLLOWER_H
@@ -0,0 +1,264 @@
+#include "FileLoader.h"
+#include "SyntaxHighlighter.h"
+#include "HexView.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+std::atomic<std::uint64_t> g_next_load_id{1};
+
+void clearDocument(EditorBuffer& buffer) {
+    buffer.markAllChanged();
+    buffer.line_pool.clear();
+    buffer.document_head = nullptr;
+    buffer.total_lines = 0;
+    buffer.load_id = 0;
+    buffer.load_tail = nullptr;
+    buffer.load_bytes_total = buffer.load_bytes_done = 0;
+    buffer.hex_view.reset();
+    buffer.mode = BufferMode::Full;
+    buffer.mode_pinned = false;
+    buffer.longest_line = 0;
+}
+
+// Common tail of load() and loadPrefix().
+void finishLoad(EditorBuffer& buffer) {
+    buffer.current_line = buffer.first_visible_line = buffer.document_head;
+    buffer.current_line_num = 1; buffer.cursor_col = 1; buffer.changed = false;
+    ++buffer.version;
+    ++buffer.generation;
+
+    buffer.file_id = PathRegistry::instance().intern(buffer.filename);
+    BufferPolicy::update(buffer);
+    buffer.read_only = BufferPolicy::readOnlyAfterLoad(buffer);
+    SyntaxHighlighter::setSyntaxType(buffer);
+}
+
+// Bytes inspected by isBinary(), the same amount git looks at.
+constexpr std::size_t BINARY_PROBE_BYTES = 8000;
+
+} // namespace
+
+bool FileLoader::isBinary(const std::string& path) {
+    std::ifstream f(path, std::ios::binary);
+    char probe[BINARY_PROBE_BYTES];
+    f.read(probe, sizeof(probe));
+    return std::memchr(probe, 0, static_cast<std::size_t>(f.gcount())) != nullptr;
+}
+
+void FileLoader::load(EditorBuffer& buffer) {
+    clearDocument(buffer);
+
+    if (isBinary(buffer.filename)) {
+        if (auto file = MappedFile::open(buffer.filename)) {
+            buffer.document_head = buffer.line_pool.create();
+            buffer.total_lines = 1;
+            buffer.is_new_file = false;
+            buffer.load_bytes_total = buffer.load_bytes_done = file->size();
+            buffer.hex_view = std::make_shared<HexView>(std::move(file));
+            finishLoad(buffer);
+            buffer.read_only = true;
+            buffer.syntax_type = EditorBuffer::ST_NONE;
+            return;
+        }
+    }
+
+    std::ifstream f(buffer.filename);
+    Line* current = nullptr;
+    std::string line_str;
+    if (f.is_open()) {
+        buffer.is_new_file = false;
+        while (getline(f, line_str)) {
+            buffer.total_lines++;
+            // eof() is only set here if the last line had no '\n'
+            buffer.load_bytes_done += line_str.size() + (f.eof() ? 0 : 1);
+            if (!line_str.empty() && line_str.back() == '\r') { line_str.pop_back(); }
+            buffer.longest_line = std::max(buffer.longest_line, line_str.size());
+            Line* new_line = buffer.line_pool.create(std::move(line_str));
+            if (buffer.document_head == nullptr) { buffer.document_head = current = new_line; }
+            else { current->next = new_line; new_line->prev = current; current = new_line; }
+        }
+        f.close();
+    }
+    buffer.load_bytes_total = buffer.load_bytes_done;
+    if (buffer.document_head == nullptr) {
+        buffer.document_head = buffer.line_pool.create();
+        buffer.total_lines = 1;
+    }
+    finishLoad(buffer);
+}
+
+bool FileLoader::isSystemFile(const std::string& path) {
+    return path.rfind("/usr/include", 0) == 0 || path.rfind("/usr/local/include", 0) == 0;
+}
+
+bool FileLoader::isProgressive(const std::string& path) {
+    std::error_code ec;
+    std::uintmax_t size = std::filesystem::file_size(path, ec);
+    return !ec && size >= PROGRESSIVE_THRESHOLD;
+}
+
+std::uint64_t FileLoader::nextLoadId() {
+    return g_next_load_id++;
+}
+
+std::uintmax_t FileLoader::loadPrefix(EditorBuffer& buffer) {
+    clearDocument(buffer);
+
+    std::error_code ec;
+    buffer.load_bytes_total = std::filesystem::file_size(buffer.filename, ec);
+    if (ec) buffer.load_bytes_total = 0;
+
+    std::vector<char> data(PREFIX_BYTES);
+    std::ifstream f(buffer.filename, std::ios::binary);
+    std::size_t got = 0;
+    if (f.is_open()) {
+        buffer.is_new_file = false;
+        f.read(data.data(), data.size());
+        got = static_cast<std::size_t>(f.gcount());
+    }
+
+    // Only complete lines; the partial one is re-read by the streamer.
+    std::size_t consumed = got;
+    while (consumed > 0 && data[consumed - 1] != '\n') consumed--;
+
+    std::string carry;
+    LineChunk chunk = splitChunk(data.data(), consumed, carry, false);
+    buffer.document_head = buffer.line_pool.create();
+    buffer.total_lines = 1;
+    appendChunk(buffer, chunk);
+    finishLoad(buffer);
+
+    buffer.read_only = true;
+    buffer.load_id = nextLoadId();
+    buffer.load_bytes_done = consumed;
+    return consumed;
+}
+
+LineChunk FileLoader::splitChunk(const char* data, std::size_t len, std::string& carry, bool final) {
+    LineChunk chunk;
+    auto emit = [&chunk](std::string&& text) {
+        if (!text.empty() && text.back() == '\r') text.pop_back();
+        Line* l = chunk.pool.create(std::move(text));
+        if (!chunk.head) { chunk.head = chunk.tail = l; }
+        else { chunk.tail->next = l; l->prev = chunk.tail; chunk.tail = l; }
+        chunk.count++;
+        chunk.bytes += l->text.size();
+        chunk.longest = std::max(chunk.longest, l->text.size());
+    };
+
+    std::size_t pos = 0;
+    while (pos < len) {
+        const char* nl = static_cast<const char*>(std::memchr(data + pos, '\n', len - pos));
+        if (!nl) break;
+        std::size_t end = nl - data;
+        carry.append(data + pos, end - pos);
+        emit(std::move(carry));
+        carry.clear();
+        pos = end + 1;
+    }
+    carry.append(data + pos, len - pos);
+    if (final && !carry.empty()) {
+        emit(std::move(carry));
+        carry.clear();
+    }
+    return chunk;
+}
+
+void FileLoader::appendChunk(EditorBuffer& buffer, LineChunk& chunk) {
+    if (!chunk.head) return;
+    buffer.line_pool.adopt(chunk.pool);
+    if (!buffer.load_tail) {
+        // The buffer only holds its empty placeholder line: reuse it.
+        Line* first = chunk.head;
+        buffer.markChanged(buffer.document_head);
+        buffer.document_head->text = std::move(first->text);
+        buffer.document_head->next = first->next;
+        if (first->next) first->next->prev = buffer.document_head;
+        buffer.load_tail = (chunk.tail == first) ? buffer.document_head : chunk.tail;
+        buffer.total_lines += chunk.count - 1;
+        buffer.line_pool.destroy(first);
+    } else {
+        buffer.load_tail->next = chunk.head;
+        chunk.head->prev = buffer.load_tail;
+        buffer.load_tail = chunk.tail;
+        buffer.total_lines += chunk.count;
+    }
+    buffer.longest_line = std::max(buffer.longest_line, chunk.longest);
+    BufferPolicy::update(buffer);
+    ++buffer.version;
+    chunk = LineChunk{};
+}
+
+void FileLoader::freeChunk(LineChunk& chunk) {
+    chunk = LineChunk{};
+}
+
+std::size_t FileLoader::dropHeadLines(EditorBuffer& buffer, std::size_t bytes) {
+    std::size_t freed = 0;
+    int dropped = 0;
+    // Never drop the last line: load_tail and the cursor need a home.
+    while (freed < bytes && buffer.document_head && buffer.document_head->next) {
+        Line* victim = buffer.document_head;
+        buffer.document_head = victim->next;
+        buffer.document_head->prev = nullptr;
+
+        if (buffer.current_line == victim) { buffer.current_line = buffer.document_head; buffer.cursor_col = 1; }
+        if (buffer.first_visible_line == victim) buffer.first_visible_line = buffer.document_head;
+        if (buffer.selection_anchor_line == victim) { buffer.selection_anchor_line = nullptr; buffer.selecting = false; }
+        if (buffer.load_tail == victim) buffer.load_tail = buffer.document_head;
+
+        freed += victim->text.size();
+        buffer.markChanged(victim);
+        buffer.line_pool.destroy(victim);
+        dropped++;
+    }
+    if (dropped == 0) return 0;
+
+    buffer.total_lines -= dropped;
+    buffer.head_lines_dropped += dropped;
+    buffer.current_line_num = std::max(1, buffer.current_line_num - dropped);
+    buffer.selection_anchor_linenum = std::max(1, buffer.selection_anchor_linenum - dropped);
+    ++buffer.version;
+    return freed;
+}
+
+FileArgument FileLoader::parseArgument(const std::string& arg) {
+    FileArgument result{arg, -1, false};
+
+    size_t last_colon = arg.find_last_of(':');
+    if (last_colon != std::string::npos && last_colon > 0) {
+        std::string line_part = arg.substr(last_colon + 1);
+        bool is_numeric = !line_part.empty();
+        for (char c : line_part) if (!std::isdigit(static_cast<unsigned char>(c))) { is_numeric = false; break; }
+
+        if (is_numeric) {
+            try {
+                result.line = std::stoi(line_part);
+                result.path = arg.substr(0, last_colon);
+            } catch (...) {
+                result.line = -1;
+            }
+        }
+    }
+    return result;
+}
+
+void FileLoader::jumpToLine(EditorBuffer& buffer, int line) {
+    if (line <= 0) return;
+    if (line > buffer.total_lines) line = buffer.total_lines;
+    buffer.current_line_num = line;
+    buffer.current_line = buffer.document_head;
+    for (int i = 1; i < line; ++i) {
+        if (buffer.current_line->next) {
+            buffer.current_line = buffer.current_line->next;
+        } else break;
+    }
+}
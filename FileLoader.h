@@ -0,0 +1,85 @@
+#ifndef FILELOADER_H
+#define FILELOADER_H
+
+#include <cstdint>
+#include <string>
+#include "EditorBuffer.h"
+
+// A file named on the command line, optionally suffixed with ":line".
+struct FileArgument {
+    std::string path;
+    int line = -1;
+    bool follow = false;   // preceded by -f / --follow
+};
+
+// Lines split off a block of file data, linked to each other but not yet
+// to any buffer.  They live in the chunk's own pool until appendChunk()
+// hands it to the buffer, so chunks may be built on any thread.
+struct LineChunk {
+    LinePool pool;
+    Line* head = nullptr;
+    Line* tail = nullptr;
+    int count = 0;
+    std::size_t bytes = 0;   // sum of line lengths
+    std::size_t longest = 0;
+};
+
+// Reads files into buffers.  load() touches nothing but the buffer it is
+// given, so it may run on a worker thread for a buffer that is not yet in
+// the BufferManager.
+class FileLoader {
+public:
+    // Replaces the text of `buffer` with the contents of buffer.filename and
+    // sets up read-only state, file id and syntax type.  A missing file
+    // yields an empty buffer that is still marked as new; a binary file is
+    // memory-mapped into a read-only hex view.
+    static void load(EditorBuffer& buffer);
+
+    // Files at least this large are loaded progressively.
+    static constexpr std::uintmax_t PROGRESSIVE_THRESHOLD = 16u * 1024 * 1024;
+    // Bytes read synchronously by loadPrefix(): comfortably more than a
+    // screenful.
+    static constexpr std::size_t PREFIX_BYTES = 256u * 1024;
+    // Block size used when streaming the remainder.
+    static constexpr std::size_t STREAM_CHUNK_BYTES = 4u * 1024 * 1024;
+
+    static bool isProgressive(const std::string& path);
+
+    // Like load(), but reads only the first PREFIX_BYTES (up to the last
+    // complete line) and leaves the buffer read-only with a fresh load_id.
+    // Returns the byte offset at which streaming must resume.
+    static std::uintmax_t loadPrefix(EditorBuffer& buffer);
+
+    // Unique, non-zero id for a new progressive load or stream.
+    static std::uint64_t nextLoadId();
+
+    // Splits `len` bytes into lines.  An unterminated last line is kept in
+    // `carry` for the next call unless `final` is set.  Thread-safe.
+    static LineChunk splitChunk(const char* data, std::size_t len, std::string& carry, bool final);
+
+    // Links `chunk` after buffer.load_tail and takes ownership of it.
+    static void appendChunk(EditorBuffer& buffer, LineChunk& chunk);
+    // Releases the lines of a chunk that no buffer wants any more.
+    static void freeChunk(LineChunk& chunk);
+
+    // Deletes lines from the top of a streaming buffer until at least
+    // `bytes` of text have been released, keeping the cursor, the view and
+    // load_tail valid.  Returns the number of bytes released.
+    static std::size_t dropHeadLines(EditorBuffer& buffer, std::size_t bytes);
+
+    // A NUL byte in the first few kilobytes marks a file as binary; such
+    // files are shown in a HexView instead of being split into lines.
+    static bool isBinary(const std::string& path);
+
+    // Headers under /usr/include are opened read-only.
+    static bool isSystemFile(const std::string& path);
+
+    // Splits "path:123" into path and line; other arguments are returned
+    // unchanged with line = -1.
+    static FileArgument parseArgument(const std::string& arg);
+
+    // Moves the cursor of `buffer` to `line` (clamped to the document).
+    static void jumpToLine(EditorBuffer& buffer, int line);
+};
+
+#endif // FILELOADER_H
@@ -0,0 +1,121 @@
+#include "FileWatcher.h"
+
+#include <filesystem>
+#include <set>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+FileWatcher::FileWatcher() {
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+}
+
+FileWatcher::~FileWatcher() {
+    if (m_fd >= 0) close(m_fd);
+}
+
+void FileWatcher::watchFile(FileId id) {
+    const std::string path = PathRegistry::instance().path(id);
+    int wd = inotify_add_watch(m_fd, path.c_str(), IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF);
+    if (wd < 0) return;
+    m_file_watches[wd] = id;
+    m_wd_of[id] = wd;
+}
+
+void FileWatcher::unwatchFile(FileId id) {
+    auto it = m_wd_of.find(id);
+    if (it == m_wd_of.end() || it->second < 0) return;
+    // inotify shares one wd between all watches of the same inode
+    bool shared = false;
+    for (const auto& [other, wd] : m_wd_of) if (other != id && wd == it->second) shared = true;
+    if (!shared) inotify_rm_watch(m_fd, it->second);
+    m_file_watches.erase(it->second);
+    it->second = -1;
+}
+
+void FileWatcher::add(FileId id) {
+    if (m_fd < 0 || id == INVALID_FILE_ID || m_wd_of.count(id)) return;
+    watchFile(id);
+
+    const fs::path p(PathRegistry::instance().path(id));
+    int dwd = inotify_add_watch(m_fd, p.parent_path().c_str(),
+                                IN_CREATE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE);
+    if (dwd >= 0) m_dir_watches[dwd].emplace(p.filename().string(), id);
+    if (!m_wd_of.count(id)) m_wd_of[id] = -1;   // file missing for now; the dir watch reports it
+}
+
+void FileWatcher::remove(FileId id) {
+    auto it = m_wd_of.find(id);
+    if (it == m_wd_of.end()) return;
+    unwatchFile(id);
+    for (auto dw = m_dir_watches.begin(); dw != m_dir_watches.end();) {
+        auto& names = dw->second;
+        for (auto n = names.begin(); n != names.end();) {
+            if (n->second == id) n = names.erase(n); else ++n;
+        }
+        // The last file of the directory: its watch goes too
+        if (names.empty()) {
+            inotify_rm_watch(m_fd, dw->first);
+            dw = m_dir_watches.erase(dw);
+        } else {
+            ++dw;
+        }
+    }
+    m_wd_of.erase(it);
+}
+
+std::vector<FileId> FileWatcher::poll() {
+    std::set<FileId> changed;
+    if (m_fd < 0) return {};
+
+    alignas(inotify_event) char buf[16 * 1024];
+    while (true) {
+        ssize_t len = read(m_fd, buf, sizeof(buf));
+        if (len <= 0) break;
+        for (char* ptr = buf; ptr < buf + len;) {
+            auto* ev = reinterpret_cast<inotify_event*>(ptr);
+            ptr += sizeof(inotify_event) + ev->len;
+
+            auto fw = m_file_watches.find(ev->wd);
+            if (fw != m_file_watches.end()) {
+                FileId id = fw->second;
+                changed.insert(id);
+                if (ev->mask & (IN_MOVE_SELF | IN_DELETE_SELF | IN_IGNORED)) {
+                    // The inode we watched is gone from this path.  The
+                    // kernel drops the watch itself only once it is deleted.
+                    PathRegistry::instance().invalidate(id);
+                    if (ev->mask & IN_IGNORED) {
+                        m_file_watches.erase(fw);
+                        m_wd_of[id] = -1;
+                    } else {
+                        unwatchFile(id);
+                    }
+                }
+                continue;
+            }
+
+            auto dw = m_dir_watches.find(ev->wd);
+            if (dw != m_dir_watches.end() && (ev->mask & IN_IGNORED)) {
+                m_dir_watches.erase(dw);   // the directory itself is gone
+                continue;
+            }
+            if (dw != m_dir_watches.end() && ev->len > 0) {
+                auto range = dw->second.equal_range(ev->name);
+                for (auto n = range.first; n != range.second; ++n) {
+                    FileId id = n->second;
+                    changed.insert(id);
+                    PathRegistry::instance().invalidate(id);
+                    if (ev->mask & (IN_CREATE | IN_MOVED_TO)) {
+                        // A new file took the name: watch the new inode.  The
+                        // old one may live on under another name (log.1), so
+                        // its watch is removed rather than left to fire.
+                        unwatchFile(id);
+                        watchFile(id);
+                    }
+                }
+            }
+        }
+    }
+    return std::vector<FileId>(changed.begin(), changed.end());
+}
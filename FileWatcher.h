@@ -0,0 +1,42 @@
+#ifndef FILEWATCHER_H
+#define FILEWATCHER_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include "PathRegistry.h"
+
+// inotify based change notification for individual files.
+//
+// Besides the file itself, the directory entry is watched through the parent
+// directory, so a file that is deleted, renamed away or replaced by a new
+// one (log rotation) is still reported under its id.  poll() never blocks.
+// Files that move or disappear are invalidated in the PathRegistry.
+class FileWatcher {
+public:
+    FileWatcher();
+    ~FileWatcher();
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // False if inotify could not be initialised; callers fall back to
+    // polling with stat().
+    bool available() const { return m_fd >= 0; }
+
+    void add(FileId id);
+    void remove(FileId id);
+
+    // Ids of watched files that changed since the last call.
+    std::vector<FileId> poll();
+
+private:
+    void watchFile(FileId id);
+    void unwatchFile(FileId id);
+
+    int m_fd = -1;
+    std::map<int, FileId> m_file_watches;                          // wd -> file
+    std::map<int, std::multimap<std::string, FileId>> m_dir_watches; // wd -> name -> file
+    std::map<FileId, int> m_wd_of;
+};
+
+#endif // FILEWATCHER_H
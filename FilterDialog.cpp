@@ -0,0 +1,89 @@
+#include "FilterDialog.h"
+
+FilterDialog::FilterDialog(const std::string& initial_include,
+                           const std::string& initial_exclude)
+    : DialogBase("Filter Lines", /*w=*/60, /*h=*/11)
+    , include_buf_(initial_include)
+    , exclude_buf_(initial_exclude)
+{}
+
+DialogResult FilterDialog::show(Renderer& renderer,
+                                const std::string& initial_include,
+                                const std::string& initial_exclude)
+{
+    FilterDialog dlg(initial_include, initial_exclude);
+    return dlg.run(renderer);
+}
+
+void FilterDialog::onInit()
+{
+    setFocusCount(static_cast<int>(Focus::_count));
+    setFocus(static_cast<int>(Focus::INCLUDE));
+    setButtonRowFocusIndex(static_cast<int>(Focus::BTN_ROW));
+
+    // ── Inputs ────────────────────────────────────────────────────────────────
+    addInput({
+        .focus_index = static_cast<int>(Focus::INCLUDE),
+        .field_x = 20, .field_y = 2, .field_w = 37,
+        .label   = "Show lines with:",
+        .label_x = 3, .label_y = 2,
+        .buffer  = include_buf_,
+    });
+    addInput({
+        .focus_index = static_cast<int>(Focus::EXCLUDE),
+        .field_x = 20, .field_y = 4, .field_w = 37,
+        .label   = "Hide lines with:",
+        .label_x = 3, .label_y = 4,
+        .buffer  = exclude_buf_,
+    });
+
+    // ── Button row (all three buttons share one Tab stop) ─────────────────────
+    addButtons(ButtonRow{
+        .buttons = {
+            Button{
+                .label = " &Filter ",
+                .x = 6, .y = 8,
+                .on_activate = [this]() -> HandleResult {
+                    result().accept();
+                    result().set("include", include_buf_);
+                    result().set("exclude", exclude_buf_);
+                    result().set("regex",   "0");
+                    return HandleResult::CLOSE;
+                }
+            },
+            Button{
+                .label = " &Regex ",
+                .x = 23, .y = 8,
+                .on_activate = [this]() -> HandleResult {
+                    result().accept();
+                    result().set("include", include_buf_);
+                    result().set("exclude", exclude_buf_);
+                    result().set("regex",   "1");
+                    return HandleResult::CLOSE;
+                }
+            },
+            Button{
+                .label = " &Cancel ",
+                .x = 41, .y = 8,
+                .on_activate = [this]() -> HandleResult {
+                    result().cancel();
+                    return HandleResult::CLOSE;
+                }
+            },
+        }
+    });
+
+    // ── Arrow-key navigation ──────────────────────────────────────────────────
+    nav_.link(Direction::DOWN, Focus::INCLUDE, Focus::EXCLUDE)
+        .link(Direction::UP,   Focus::EXCLUDE, Focus::INCLUDE)
+        .link(Direction::DOWN, Focus::EXCLUDE, Focus::BTN_ROW)
+        .link(Direction::UP,   Focus::BTN_ROW, Focus::EXCLUDE);
+    setNavigation(nav_);
+}
+
+void FilterDialog::onDraw(Renderer& renderer, int startx, int starty)
+{
+    renderer.drawText(startx + 3, starty + 6,
+                      "Separate terms with |   Regex: one expression per field",
+                      Renderer::CP_DIALOG);
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "DialogBase.h"
+#include "Renderer.h"
+#include <string>
+
+class FilterDialog : private DialogBase {
+public:
+    static DialogResult show(Renderer& renderer,
+                             const std::string& initial_include = "",
+                             const std::string& initial_exclude = "");
+private:
+    FilterDialog(const std::string& initial_include,
+                 const std::string& initial_exclude);
+
+    void onInit() override;
+    void onDraw(Renderer& renderer, int startx, int starty) override;
+
+    // INCLUDE + EXCLUDE inputs + BTN_ROW (all three buttons are one tab stop)
+    DeclareCyclicEnum(Focus, INCLUDE, EXCLUDE, BTN_ROW);
+
+    std::string include_buf_;
+    std::string exclude_buf_;
+    NavigationGraph<Focus> nav_;
+};
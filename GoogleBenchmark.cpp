@@ -0,0 +1,258 @@
+#include "GoogleBenchmark.h"
+
+#include "nlohmann/json.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+
+using json = nlohmann::json;
+
+namespace {
+
+// The name of a flag every Google Benchmark binary has, and the name the
+// shared library is asked for by
+constexpr std::string_view MARKERS[] = {"benchmark_list_tests", "libbenchmark.so"};
+constexpr std::size_t LONGEST_MARKER = 20;
+
+// Keys of a benchmark entry that are numbers but not counters
+bool isCounter(const std::string& key) {
+    static const char* const fixed[] = {"family_index", "per_family_instance_index", "repetitions",
+                                        "repetition_index", "threads", "iterations", "real_time",
+                                        "cpu_time", "cpu_coefficient", "real_coefficient", "rms"};
+    return std::none_of(std::begin(fixed), std::end(fixed), [&](const char* k) { return key == k; });
+}
+
+double toNanoseconds(double value, const std::string& unit) {
+    if (unit == "us") return value * 1e3;
+    if (unit == "ms") return value * 1e6;
+    if (unit == "s") return value * 1e9;
+    return value;
+}
+
+json toJson(const GoogleBenchmark::Entry& e) {
+    json counters = json::array();
+    for (const auto& [name, value] : e.counters) counters.push_back({name, value});
+    return {{"name", e.name}, {"aggregate", e.aggregate}, {"iterations", e.iterations},
+            {"real_ns", e.real_ns}, {"cpu_ns", e.cpu_ns}, {"counters", counters}, {"error", e.error}};
+}
+
+GoogleBenchmark::Entry entryFromJson(const json& j) {
+    GoogleBenchmark::Entry e;
+    e.name = j.value("name", "");
+    e.aggregate = j.value("aggregate", "");
+    e.iterations = j.value("iterations", 0LL);
+    e.real_ns = j.value("real_ns", 0.0);
+    e.cpu_ns = j.value("cpu_ns", 0.0);
+    e.error = j.value("error", "");
+    for (const json& c : j.value("counters", json::array())) {
+        if (c.is_array() && c.size() == 2 && c[0].is_string() && c[1].is_number())
+            e.counters.emplace_back(c[0].get<std::string>(), c[1].get<double>());
+    }
+    return e;
+}
+
+json readBaselines(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) return json::object();
+    json baselines = json::parse(in, nullptr, false);
+    return baselines.is_object() ? baselines : json::object();
+}
+
+// "1.23", "12.3", "123" -- three significant digits
+std::string threeDigits(double v) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), v >= 100 ? "%.0f" : v >= 10 ? "%.1f" : "%.2f", v);
+    return buf;
+}
+
+} // namespace
+
+void GoogleBenchmark::Progress::scan(std::string_view output) {
+    std::size_t end = output.rfind('\n');
+    if (end == std::string_view::npos || end < m_scanned) return;
+    std::string_view fresh = output.substr(m_scanned, end + 1 - m_scanned);
+    m_scanned = end + 1;
+
+    while (!fresh.empty()) {
+        std::size_t nl = fresh.find('\n');
+        std::string_view line = fresh.substr(0, nl);
+        fresh.remove_prefix(nl + 1);
+        line.remove_prefix(std::min(line.find_first_not_of(" \t"), line.size()));
+        if (line.rfind("\"name\": \"", 0) == 0) {
+            line.remove_prefix(9);
+            m_last = std::string(line.substr(0, line.rfind('"')));
+        } else if (line.rfind("\"time_unit\":", 0) == 0) {
+            ++m_finished;
+        }
+    }
+}
+
+bool GoogleBenchmark::detect(const std::string& exe) {
+    std::ifstream in(exe, std::ios::binary);
+    if (!in) return false;
+    // Read in blocks; the tail of each is kept in case the name straddles two
+    std::string block(1 << 20, '\0');
+    std::size_t carry = 0;
+    while (in) {
+        in.read(block.data() + carry, static_cast<std::streamsize>(block.size() - carry));
+        const std::size_t have = carry + static_cast<std::size_t>(in.gcount());
+        const std::string_view data(block.data(), have);
+        for (std::string_view marker : MARKERS) {
+            if (data.find(marker) != std::string_view::npos) return true;
+        }
+        carry = std::min(have, LONGEST_MARKER - 1);
+        std::copy(block.begin() + (have - carry), block.begin() + have, block.begin());
+    }
+    return false;
+}
+
+bool GoogleBenchmark::hasBenchmarkFlag(const std::vector<std::string>& args) {
+    return std::any_of(args.begin(), args.end(),
+                       [](const std::string& a) { return a.rfind("--benchmark_", 0) == 0; });
+}
+
+std::optional<GoogleBenchmark::Report> GoogleBenchmark::parse(std::string_view output, std::string& error) {
+    // The report starts with a '{' at the beginning of a line; anything the
+    // program printed before (or after) it is left out
+    std::size_t start = output.rfind("{", 0) == 0 ? 0 : output.find("\n{");
+    std::size_t end = output.rfind('}');
+    if (start == std::string_view::npos || end == std::string_view::npos || end < start) {
+        error = "There is no JSON report in the output.";
+        return std::nullopt;
+    }
+    if (output[start] == '\n') ++start;
+    json j = json::parse(output.substr(start, end + 1 - start), nullptr, false);
+    if (j.is_discarded() || !j.is_object() || !j.contains("benchmarks")) {
+        error = "The JSON report is incomplete or malformed.";
+        return std::nullopt;
+    }
+
+    Report report;
+    if (const json& ctx = j.value("context", json::object()); ctx.is_object()) {
+        report.context = ctx.value("host_name", "");
+        if (int cpus = ctx.value("num_cpus", 0); cpus > 0) {
+            report.context += (report.context.empty() ? "" : ", ") + std::to_string(cpus) + " x " +
+                              std::to_string(static_cast<long>(ctx.value("mhz_per_cpu", 0.0))) + " MHz CPUs";
+        }
+        if (std::string build = ctx.value("library_build_type", ""); !build.empty())
+            report.context += (report.context.empty() ? "" : ", ") + build + " library";
+        report.cpu_scaling = ctx.value("cpu_scaling_enabled", false);
+    }
+
+    for (const json& b : j["benchmarks"]) {
+        if (!b.is_object()) continue;
+        // Coefficients of variation are ratios, and BigO/RMS fits have no
+        // time per iteration; neither compares as a time
+        if (b.value("aggregate_unit", "time") != "time" || !b.contains("cpu_time")) continue;
+        Entry e;
+        e.name = b.value("name", "");
+        if (b.value("run_type", "") == "aggregate") e.aggregate = b.value("aggregate_name", "aggregate");
+        e.iterations = b.value("iterations", 0LL);
+        const std::string unit = b.value("time_unit", "ns");
+        e.real_ns = toNanoseconds(b.value("real_time", 0.0), unit);
+        e.cpu_ns = toNanoseconds(b.value("cpu_time", 0.0), unit);
+        if (b.value("error_occurred", false)) e.error = b.value("error_message", "error");
+        else if (b.contains("skip_message")) e.error = b.value("skip_message", "skipped");
+        for (const auto& [key, value] : b.items()) {
+            if (value.is_number() && isCounter(key)) e.counters.emplace_back(key, value.get<double>());
+        }
+        report.entries.push_back(std::move(e));
+    }
+    return report;
+}
+
+std::vector<GoogleBenchmark::Comparison> GoogleBenchmark::compare(const Report& report, const Report* baseline,
+                                                                  double threshold_pct) {
+    std::unordered_map<std::string, std::vector<const Entry*>> before;
+    if (baseline) {
+        for (const Entry& b : baseline->entries) before[b.name].push_back(&b);
+    }
+    std::unordered_map<std::string, std::size_t> seen;
+
+    std::vector<Comparison> result;
+    result.reserve(report.entries.size());
+    for (const Entry& e : report.entries) {
+        Comparison c;
+        c.entry = &e;
+        const std::size_t nth = seen[e.name]++;
+        auto it = before.find(e.name);
+        if (e.error.empty() && it != before.end() && nth < it->second.size()) {
+            const Entry& b = *it->second[nth];
+            if (b.error.empty() && b.cpu_ns > 0) {
+                c.cpu_delta_pct = (e.cpu_ns - b.cpu_ns) / b.cpu_ns * 100.0;
+                c.regression = *c.cpu_delta_pct > threshold_pct && e.aggregate != "stddev";
+            }
+        }
+        result.push_back(c);
+    }
+    return result;
+}
+
+std::string GoogleBenchmark::baselinePath(const std::string& dir) {
+    return (std::filesystem::path(dir.empty() ? "." : dir) / ".gedi-gbench-baseline.json").string();
+}
+
+std::optional<GoogleBenchmark::Report> GoogleBenchmark::baseline(const std::string& path, const std::string& label,
+                                                                 std::string* when) {
+    const json baselines = readBaselines(path);
+    auto it = baselines.find(label);
+    if (it == baselines.end() || !it->is_object()) return std::nullopt;
+
+    Report report;
+    report.context = it->value("context", "");
+    report.cpu_scaling = it->value("cpu_scaling", false);
+    for (const json& e : it->value("entries", json::array())) report.entries.push_back(entryFromJson(e));
+    if (when) *when = it->value("when", "");
+    return report;
+}
+
+bool GoogleBenchmark::saveBaseline(const std::string& path, const std::string& label,
+                                   const Report& report, const std::string& flags) {
+    json baselines = readBaselines(path);
+    json entries = json::array();
+    for (const Entry& e : report.entries) entries.push_back(toJson(e));
+
+    std::time_t now = std::time(nullptr);
+    std::tm tm{};
+    localtime_r(&now, &tm);
+    char when[32];
+    std::strftime(when, sizeof(when), "%Y-%m-%d %H:%M", &tm);
+
+    baselines[label] = {{"when", when}, {"flags", flags}, {"context", report.context},
+                        {"cpu_scaling", report.cpu_scaling}, {"entries", entries}};
+
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out) return false;
+        out << baselines.dump(2) << '\n';
+        if (!out) return false;
+    }
+    return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+std::string GoogleBenchmark::formatTime(double ns) {
+    if (ns >= 1e9) return threeDigits(ns / 1e9) + " s";
+    if (ns >= 1e6) return threeDigits(ns / 1e6) + " ms";
+    if (ns >= 1e3) return threeDigits(ns / 1e3) + " us";
+    return threeDigits(ns) + " ns";
+}
+
+std::string GoogleBenchmark::formatCounter(const std::string& name, double value) {
+    const bool bytes = name == "bytes_per_second";
+    const double base = bytes ? 1024.0 : 1000.0;
+    static const char* const decimal[] = {"", "k", "M", "G", "T"};
+    static const char* const binary[] = {"", "Ki", "Mi", "Gi", "Ti"};
+    int scale = 0;
+    double v = std::fabs(value);
+    while (v >= base && scale < 4) { v /= base; ++scale; }
+    const std::string number = (value < 0 ? "-" : "") + threeDigits(v);
+    if (bytes) return number + " " + binary[scale] + "B/s";
+    if (name == "items_per_second") return number + " " + decimal[scale] + "/s";
+    return name + "=" + number + decimal[scale];
+}
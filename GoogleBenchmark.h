@@ -0,0 +1,96 @@
+#ifndef GOOGLEBENCHMARK_H
+#define GOOGLEBENCHMARK_H
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Programs built on Google Benchmark (github.com/google/benchmark) and what
+// they write with --benchmark_format=json.
+//
+// The report is parsed into one Entry per benchmark run or aggregate, with
+// times converted to nanoseconds so that reports with different time
+// units compare.  A report can be kept as the baseline of a label, in a
+// small JSON file next to the benchmark history, and later reports are
+// compared with it entry by entry.
+class GoogleBenchmark {
+public:
+    struct Entry {
+        std::string name;           // "BM_Sort/1024", "BM_Sort/1024_mean"
+        std::string aggregate;      // "mean", "median", "stddev"... of repetitions; empty for a run
+        long long iterations = 0;
+        double real_ns = 0;         // per iteration
+        double cpu_ns = 0;
+        // bytes_per_second, items_per_second and user counters, by name
+        std::vector<std::pair<std::string, double>> counters;
+        std::string error;          // set for a benchmark that skipped with an error
+    };
+
+    struct Report {
+        std::string context;        // "host, 8 x 3400 MHz CPUs, release library"
+        bool cpu_scaling = false;   // frequency scaling was on; times are noisy
+        std::vector<Entry> entries;
+    };
+
+    // An entry beside the one of the same name in the baseline.
+    struct Comparison {
+        const Entry* entry = nullptr;
+        std::optional<double> cpu_delta_pct;   // +12.5 is 12.5% slower; none without a baseline entry
+        bool regression = false;               // slower by more than the threshold; never for a spread
+    };
+
+    // Follows a report as it is written, one complete line at a time: the
+    // JSON reporter puts every key on a line of its own and writes each
+    // benchmark when it finishes.
+    class Progress {
+    public:
+        // Looks at what `output` has gained since the last call.
+        void scan(std::string_view output);
+        void reset() { *this = Progress(); }
+
+        int finished() const { return m_finished; }
+        const std::string& last() const { return m_last; }
+
+    private:
+        std::size_t m_scanned = 0;
+        int m_finished = 0;
+        std::string m_last;
+    };
+
+    // Whether `exe` is linked with Google Benchmark, going by the names of
+    // its command-line flags in the binary, or by the name of the shared
+    // library when it is linked dynamically.
+    static bool detect(const std::string& exe);
+    // Whether `args` has a --benchmark_ flag, which marks the program as
+    // one whatever detect() says.
+    static bool hasBenchmarkFlag(const std::vector<std::string>& args);
+
+    // Reads the JSON report in `output`, which may have other output of
+    // the program around it.  On failure, returns nothing and sets `error`.
+    static std::optional<Report> parse(std::string_view output, std::string& error);
+
+    // Compares every entry of `report` with `baseline`, if there is one.
+    // Repetitions share a name; the n-th of a name goes with the n-th.
+    static std::vector<Comparison> compare(const Report& report, const Report* baseline,
+                                           double threshold_pct);
+
+    // <dir>/.gedi-gbench-baseline.json
+    static std::string baselinePath(const std::string& dir);
+    // The baseline of `label`, and when it was saved.
+    static std::optional<Report> baseline(const std::string& path, const std::string& label,
+                                          std::string* when = nullptr);
+    // Makes `report` the baseline of `label`.  Returns false if the file
+    // could not be written.
+    static bool saveBaseline(const std::string& path, const std::string& label,
+                             const Report& report, const std::string& flags);
+
+    // "12.3 ns", "4.56 ms"
+    static std::string formatTime(double ns);
+    // "1.2 GiB/s" for bytes_per_second, "3.4 M/s" for items_per_second,
+    // "name=5.6k" for the rest
+    static std::string formatCounter(const std::string& name, double value);
+};
+
+#endif // GOOGLEBENCHMARK_H
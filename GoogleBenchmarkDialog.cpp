@@ -0,0 +1,186 @@
+#include "GoogleBenchmarkDialog.h"
+#include "utils.h"
+#include <ncurses.h>
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+enum Column { NAME, TIME, CPU, ITERATIONS, COUNTERS, DELTA, COLUMN_COUNT };
+const char* const HEADERS[COLUMN_COUNT] = {"Benchmark", "Time", "CPU", "Iterations", "Counters", "vs base"};
+
+std::string fit(std::string s, int width, bool right) {
+    if (width <= 0) return "";
+    if ((int)s.size() > width) s = s.substr(0, width);
+    std::string pad(width - s.size(), ' ');
+    return right ? pad + s : s + pad;
+}
+
+std::string counters(const GoogleBenchmark::Entry& e) {
+    if (!e.error.empty()) return e.error;
+    std::string text;
+    for (const auto& [name, value] : e.counters) {
+        if (!text.empty()) text += "  ";
+        text += GoogleBenchmark::formatCounter(name, value);
+    }
+    return text;
+}
+
+std::string delta(const GoogleBenchmark::Comparison& c) {
+    if (!c.cpu_delta_pct) return "";
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%+.1f%%%s", *c.cpu_delta_pct, c.regression ? "!" : "");
+    return buf;
+}
+
+// Rows without a value for the column go last in either direction
+bool less(const GoogleBenchmark::Comparison& a, const GoogleBenchmark::Comparison& b, int column) {
+    const GoogleBenchmark::Entry& x = *a.entry;
+    const GoogleBenchmark::Entry& y = *b.entry;
+    switch (column) {
+    case NAME:       return x.name < y.name;
+    case TIME:       return x.real_ns < y.real_ns;
+    case CPU:        return x.cpu_ns < y.cpu_ns;
+    case ITERATIONS: return x.iterations < y.iterations;
+    case COUNTERS: {
+        double vx = x.counters.empty() ? 0 : x.counters.front().second;
+        double vy = y.counters.empty() ? 0 : y.counters.front().second;
+        return vx < vy;
+    }
+    default:         return a.cpu_delta_pct.value_or(0) < b.cpu_delta_pct.value_or(0);
+    }
+}
+
+bool hasValue(const GoogleBenchmark::Comparison& c, int column) {
+    if (column == DELTA) return c.cpu_delta_pct.has_value();
+    if (column == COUNTERS) return !c.entry->counters.empty();
+    return true;
+}
+
+} // namespace
+
+bool GoogleBenchmarkDialog::show(Renderer& renderer, const std::string& label, const GoogleBenchmark::Report& report,
+                                 std::vector<GoogleBenchmark::Comparison> rows, const std::string& baseline,
+                                 double threshold_pct) {
+    int h = std::max(renderer.getHeight() - 4, 15);
+    int w = std::max(std::min(renderer.getWidth() - 4, 140), 70);
+    int starty = (renderer.getHeight() - h) / 2;
+    int startx = (renderer.getWidth() - w) / 2;
+
+    WINDOW* behind = newwin(h + 1, w + 1, starty, startx);
+    copywin(stdscr, behind, starty, startx, 0, 0, h, w, FALSE);
+
+    renderer.drawShadow(startx, starty, w, h);
+    renderer.drawBoxWithTitle(startx, starty, w, h, Renderer::CP_DIALOG, Renderer::DOUBLE,
+                              " Google Benchmark: " + label + " ", Renderer::CP_DIALOG_TITLE, A_BOLD);
+
+    // Column widths: the name and the counters share what the numbers leave
+    const int inner = w - 4;
+    int widths[COLUMN_COUNT] = {0, 10, 10, 11, 0, 9};
+    const int rest = std::max(inner - (widths[TIME] + widths[CPU] + widths[ITERATIONS] + widths[DELTA] + 5), 20);
+    widths[NAME] = rest * 3 / 5;
+    widths[COUNTERS] = rest - widths[NAME];
+
+    const int regressions = (int)std::count_if(rows.begin(), rows.end(),
+                                               [](const GoogleBenchmark::Comparison& c) { return c.regression; });
+    char threshold[16];
+    std::snprintf(threshold, sizeof(threshold), "%g%%", threshold_pct);
+    std::string summary = baseline.empty()
+        ? "No baseline yet; this run is saved as the baseline."
+        : baseline + ": " + (regressions ? formatCount(regressions) + " regression(s)" : std::string("no regressions")) +
+          " beyond " + threshold + " CPU time";
+    std::string context = report.context;
+    if (report.cpu_scaling) context += (context.empty() ? "" : "   ") + std::string("CPU scaling is on; times are noisy");
+
+    const std::vector<GoogleBenchmark::Comparison> report_order = rows;
+    int sort_column = -1;          // report order
+    bool descending = false;
+    int scroll_pos = 0;
+    const int list_y = 5;
+    const int visible_h = h - list_y - 4;
+    nodelay(stdscr, FALSE);
+
+    bool pressed = false, save = false;
+    while (true) {
+        wattron(stdscr, COLOR_PAIR(Renderer::CP_DIALOG));
+        for (int i = 1; i < h - 1; ++i) mvwaddstr(stdscr, starty + i, startx + 1, std::string(w - 2, ' ').c_str());
+        wattroff(stdscr, COLOR_PAIR(Renderer::CP_DIALOG));
+
+        renderer.drawText(startx + 2, starty + 1, fit(summary, inner, false),
+                          regressions ? Renderer::CP_COMPILE_ERROR : Renderer::CP_DIALOG);
+        renderer.drawText(startx + 2, starty + 2, fit(context, inner, false), Renderer::CP_DIALOG);
+
+        int x = startx + 2;
+        for (int c = 0; c < COLUMN_COUNT; ++c) {
+            std::string head = HEADERS[c];
+            if (c == sort_column) head += descending ? " v" : " ^";
+            renderer.drawText(x, starty + list_y - 1, fit(head, widths[c], c != NAME && c != COUNTERS),
+                              Renderer::CP_DIALOG, c == sort_column ? A_BOLD | A_UNDERLINE : A_BOLD);
+            x += widths[c] + 1;
+        }
+
+        for (int i = 0; i < visible_h && scroll_pos + i < (int)rows.size(); ++i) {
+            const GoogleBenchmark::Comparison& row = rows[scroll_pos + i];
+            const GoogleBenchmark::Entry& e = *row.entry;
+            const bool measured = e.error.empty();
+            const std::string cells[COLUMN_COUNT] = {
+                e.name, measured ? GoogleBenchmark::formatTime(e.real_ns) : "",
+                measured ? GoogleBenchmark::formatTime(e.cpu_ns) : "",
+                measured ? std::to_string(e.iterations) : "", counters(e), delta(row)};
+            const int pair = row.regression || !e.error.empty() ? Renderer::CP_COMPILE_ERROR : Renderer::CP_DIALOG;
+            x = startx + 2;
+            for (int c = 0; c < COLUMN_COUNT; ++c) {
+                renderer.drawText(x, starty + list_y + i, fit(cells[c], widths[c], c != NAME && c != COUNTERS), pair);
+                x += widths[c] + 1;
+            }
+        }
+
+        renderer.drawText(startx + 2, starty + h - 4,
+                          fit("Tab/Shift+Tab: sort column   R: reverse   " + formatCount(rows.size()) + " rows", inner, false),
+                          Renderer::CP_DIALOG);
+        renderer.drawButton(startx + w / 2 - 15, starty + h - 3, " &Baseline ", save, pressed && save);
+        renderer.drawButton(startx + w / 2 + 3, starty + h - 3, " &Close ", !save, pressed && !save);
+        renderer.refresh();
+
+        if (pressed) {
+            napms(100);
+            break;
+        }
+
+        wint_t ch = renderer.getChar();
+        const int max_scroll = std::max(0, (int)rows.size() - visible_h);
+        int new_sort = sort_column;
+        if (ch == KEY_UP) { if (scroll_pos > 0) scroll_pos--; }
+        else if (ch == KEY_DOWN) { if (scroll_pos < max_scroll) scroll_pos++; }
+        else if (ch == KEY_PPAGE) scroll_pos = std::max(0, scroll_pos - visible_h);
+        else if (ch == KEY_NPAGE) scroll_pos = std::min(max_scroll, scroll_pos + visible_h);
+        else if (ch == KEY_HOME) scroll_pos = 0;
+        else if (ch == KEY_END) scroll_pos = max_scroll;
+        else if (ch == '\t' || ch == KEY_RIGHT) new_sort = sort_column + 1 < COLUMN_COUNT ? sort_column + 1 : -1;
+        else if (ch == KEY_BTAB || ch == KEY_LEFT) new_sort = sort_column > -1 ? sort_column - 1 : COLUMN_COUNT - 1;
+        else if (ch == 'r' || ch == 'R') descending = !descending;
+        else if (ch == 'b' || ch == 'B') { save = true; pressed = true; }
+        else if (ch == 27 || ch == ' ' || ch == KEY_ENTER || ch == 10 || ch == 13 || tolower(ch) == 'c') pressed = true;
+        else continue;
+
+        if (new_sort != sort_column) {
+            sort_column = new_sort;
+            descending = sort_column == DELTA;   // the worst regressions first
+        }
+        rows = report_order;
+        if (sort_column >= 0) {
+            std::stable_sort(rows.begin(), rows.end(), [&](const auto& a, const auto& b) {
+                if (hasValue(a, sort_column) != hasValue(b, sort_column)) return hasValue(a, sort_column);
+                return descending ? less(b, a, sort_column) : less(a, b, sort_column);
+            });
+        } else if (descending) {
+            std::reverse(rows.begin(), rows.end());
+        }
+    }
+
+    copywin(behind, stdscr, 0, 0, starty, startx, h, w, FALSE);
+    delwin(behind);
+    nodelay(stdscr, TRUE);
+    renderer.showCursor();
+    return save;
+}
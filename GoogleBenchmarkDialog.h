@@ -0,0 +1,24 @@
+#ifndef GOOGLEBENCHMARKDIALOG_H
+#define GOOGLEBENCHMARKDIALOG_H
+
+#include "GoogleBenchmark.h"
+#include "Renderer.h"
+#include <string>
+#include <vector>
+
+// The results of a Google Benchmark run as a table: time and CPU time per
+// iteration, iterations, counters and the change of CPU time against the
+// baseline.  Tab and Shift+Tab pick the column to sort by, R reverses the
+// order; rows slower than the baseline by more than the threshold are
+// marked.
+class GoogleBenchmarkDialog {
+public:
+    // `baseline` describes what the deltas are against ("Baseline of
+    // 2024-05-01 14:03"), empty when there is none.  Returns true if the
+    // user asked to make this report the new baseline.
+    static bool show(Renderer& renderer, const std::string& label, const GoogleBenchmark::Report& report,
+                     std::vector<GoogleBenchmark::Comparison> rows, const std::string& baseline,
+                     double threshold_pct);
+};
+
+#endif // GOOGLEBENCHMARKDIALOG_H
@@ -0,0 +1,96 @@
+#include "HexView.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace {
+
+const char HEX_DIGITS[] = "0123456789abcdef";
+
+// memmem() is run over slices of this size so a search of a huge file can
+// be cancelled.
+constexpr std::uint64_t SEARCH_SLICE = 64u * 1024 * 1024;
+
+std::uint64_t findIn(const MappedFile& file, std::uint64_t begin, std::uint64_t end,
+                     const std::string& needle, const CancellationToken& token) {
+    const unsigned char* data = file.data();
+    for (std::uint64_t pos = begin; pos < end; pos += SEARCH_SLICE) {
+        if (token.cancelled()) return HexView::NOT_FOUND;
+        // Overlap the slices so matches across a boundary are found
+        std::uint64_t slice_end = std::min(end, pos + SEARCH_SLICE + needle.size() - 1);
+        const void* hit = nullptr;
+        if (!file.guarded([&] { hit = memmem(data + pos, slice_end - pos, needle.data(), needle.size()); }))
+            return HexView::NOT_FOUND;
+        if (hit) return static_cast<const unsigned char*>(hit) - data;
+    }
+    return HexView::NOT_FOUND;
+}
+
+} // namespace
+
+int HexView::hexColumn(int byte_in_row) const {
+    return offsetDigits() + 2 + byte_in_row * 3 + (byte_in_row >= BYTES_PER_ROW / 2 ? 1 : 0);
+}
+
+int HexView::asciiColumn(int byte_in_row) const {
+    return hexColumn(BYTES_PER_ROW - 1) + 5 + byte_in_row;
+}
+
+std::string HexView::formatRow(std::uint64_t row) const {
+    const std::uint64_t offset = row * BYTES_PER_ROW;
+    if (offset >= size() && !(offset == 0 && size() == 0)) return "";
+    const int digits = offsetDigits();
+    const int n = static_cast<int>(std::min<std::uint64_t>(BYTES_PER_ROW, size() - offset));
+    unsigned char bytes[BYTES_PER_ROW];
+
+    std::string s(asciiColumn(BYTES_PER_ROW) + 1, ' ');
+    for (int i = 0; i < digits; ++i) s[digits - 1 - i] = HEX_DIGITS[(offset >> (4 * i)) & 0xf];
+    if (n > 0 && !m_file->guarded([&] { std::memcpy(bytes, m_file->data() + offset, n); })) {
+        s.replace(hexColumn(0), std::string::npos, "(truncated on disk since it was opened)");
+        return s;
+    }
+    for (int i = 0; i < n; ++i) {
+        s[hexColumn(i)]     = HEX_DIGITS[bytes[i] >> 4];
+        s[hexColumn(i) + 1] = HEX_DIGITS[bytes[i] & 0xf];
+        s[asciiColumn(i)]   = (bytes[i] >= 0x20 && bytes[i] < 0x7f) ? static_cast<char>(bytes[i]) : '.';
+    }
+    s[asciiColumn(0) - 1] = '|';
+    s[asciiColumn(n)] = '|';
+    s.resize(asciiColumn(n) + 1);
+    return s;
+}
+
+std::uint64_t HexView::find(const MappedFile& file, const std::string& needle,
+                            std::uint64_t from, const CancellationToken& token) {
+    if (needle.empty() || needle.size() > file.size()) return NOT_FOUND;
+    std::uint64_t start = std::min(from + 1, file.size());
+    std::uint64_t hit = findIn(file, start, file.size(), needle, token);
+    if (hit == NOT_FOUND) hit = findIn(file, 0, std::min(file.size(), start + needle.size() - 1), needle, token);
+    return hit;
+}
+
+bool HexView::parseHex(const std::string& text, std::string& bytes) {
+    bytes.clear();
+    int high = -1;
+    for (char c : text) {
+        if (c == ' ') continue;
+        if (!std::isxdigit(static_cast<unsigned char>(c))) return false;
+        int v = std::isdigit(static_cast<unsigned char>(c)) ? c - '0' : std::tolower(c) - 'a' + 10;
+        if (high < 0) { high = v; continue; }
+        bytes.push_back(static_cast<char>(high << 4 | v));
+        high = -1;
+    }
+    return high < 0 && !bytes.empty();
+}
+
+bool HexView::parseOffset(const std::string& text, std::uint64_t& offset) {
+    try {
+        std::size_t used = 0;
+        bool hex = text.size() > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X');
+        offset = std::stoull(hex ? text.substr(2) : text, &used, hex ? 16 : 10);
+        return used == (hex ? text.size() - 2 : text.size());
+    } catch (...) {
+        return false;
+    }
+}
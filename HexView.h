@@ -0,0 +1,62 @@
+#ifndef HEXVIEW_H
+#define HEXVIEW_H
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "MappedFile.h"
+#include "TaskScheduler.h"
+
+// Hex dump of a binary file.  The file is memory-mapped and each row of
+// BYTES_PER_ROW bytes is formatted from the mapping when it is drawn, so
+// nothing is stored per row and opening a multi-gigabyte file costs no more
+// than opening a small one.
+class HexView {
+public:
+    static constexpr int BYTES_PER_ROW = 16;
+    static constexpr std::uint64_t NOT_FOUND = ~std::uint64_t{0};
+
+    explicit HexView(std::shared_ptr<const MappedFile> file) : m_file(std::move(file)) {}
+
+    std::uint64_t size() const { return m_file->size(); }
+    // An empty file still shows its one (empty) row.
+    std::uint64_t rowCount() const {
+        return std::max<std::uint64_t>(1, (size() + BYTES_PER_ROW - 1) / BYTES_PER_ROW);
+    }
+
+    // "000001f0  48 65 6c 6c 6f 20 77 6f  72 6c 64 0a 00 00 00 00  |Hello world.....|"
+    // Rows the file was truncated under since it was mapped say so instead.
+    std::string formatRow(std::uint64_t row) const;
+
+    // Columns of a byte's hex pair and its ASCII character within a row.
+    int hexColumn(int byte_in_row) const;
+    int asciiColumn(int byte_in_row) const;
+
+    // First occurrence of `needle` after `from`, wrapping around at the end
+    // of the file; NOT_FOUND if there is none, the token was cancelled or
+    // the file was truncated.  Thread-safe.
+    static std::uint64_t find(const MappedFile& file, const std::string& needle,
+                              std::uint64_t from, const CancellationToken& token);
+
+    const std::shared_ptr<const MappedFile>& file() const { return m_file; }
+
+    // "de ad be ef" or "deadbeef" to bytes; false if not an even number of
+    // hex digits.
+    static bool parseHex(const std::string& text, std::string& bytes);
+    // Decimal or 0x-prefixed hex offset.
+    static bool parseOffset(const std::string& text, std::uint64_t& offset);
+
+    std::uint64_t cursor = 0;       // selected byte
+    std::uint64_t top_row = 0;      // first row on screen
+    std::size_t match_len = 0;      // bytes highlighted from cursor after a search
+    bool searching = false;
+    CancellationToken search_token;
+
+private:
+    int offsetDigits() const { return size() > 0xffffffffull ? 12 : 8; }
+
+    std::shared_ptr<const MappedFile> m_file;
+};
+
+#endif // HEXVIEW_H
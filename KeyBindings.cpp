@@ -44,6 +44,8 @@ void KeyBindings::loadDefaults() {
     addBinding(ACT_REPLACE, CTRL('R'), "Ctrl+R");
     addBinding(ACT_GOTO_LINE, -1, "");
     addBinding(ACT_GO_TO_DEFINITION, KEY_F(12), "F12");
+    addBinding(ACT_RENAME_SYMBOL, KEY_F(14), "Shift+F2");
+    addBinding(ACT_FIND_REFERENCES, KEY_F(24), "Shift+F12");
     addBinding(ACT_COMPILE, KEY_ALT(KEY_F(9)), "Alt+F9"); 
     addBinding(ACT_RUN, CTRL(KEY_F(9)), "Ctrl+F9"); 
     addBinding(ACT_COMPILE_OPTIONS, -1, "");
@@ -58,6 +60,14 @@ void KeyBindings::loadDefaults() {
     addBinding(ACT_TOGGLE_PROJECT_PANEL, KEY_ALT('0'), "Alt+0");
     addBinding(ACT_CLOSE_PROJECT, -1, "");
     addBinding(ACT_PROJECT_PROPERTIES, -1, "");
+    addBinding(ACT_FOLLOW, -1, "");
+    addBinding(ACT_FILTER, -1, "");
+    addBinding(ACT_BUFFER_MODE, -1, "");
+    addBinding(ACT_SOFT_WRAP, -1, "");
+    addBinding(ACT_TIDY_PROJECT, -1, "");
+    addBinding(ACT_TIDY_FINDINGS, -1, "");
+    addBinding(ACT_TOGGLE_TERMINAL, KEY_ALT('T'), "Alt+T");
+    addBinding(ACT_BENCHMARK, -1, "");
 }
 
 int KeyBindings::getKey(EditorAction action) const {
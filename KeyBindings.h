@@ -19,6 +19,16 @@ enum EditorAction {
     ACT_SETTINGS, ACT_HELP, ACT_ABOUT, ACT_TOGGLE_COMMENT,
     ACT_TOGGLE_PROJECT_PANEL, ACT_CLOSE_PROJECT,
     ACT_PROJECT_PROPERTIES,
+    ACT_FOLLOW,
+    ACT_FILTER,
+    ACT_BUFFER_MODE,
+    ACT_SOFT_WRAP,
+    ACT_RENAME_SYMBOL,
+    ACT_FIND_REFERENCES,
+    ACT_TIDY_PROJECT,
+    ACT_TIDY_FINDINGS,
+    ACT_TOGGLE_TERMINAL,
+    ACT_BENCHMARK,
     ACT_UNKNOWN
 };
 
@@ -65,7 +75,17 @@ class KeyBindings {
         ActionMapping{ACT_GO_TO_DEFINITION, "go_to_definition"},
         ActionMapping{ACT_TOGGLE_PROJECT_PANEL, "toggle_project_panel"},
         ActionMapping{ACT_CLOSE_PROJECT,        "close_project"},
-        ActionMapping{ACT_PROJECT_PROPERTIES,   "project_properties"}
+        ActionMapping{ACT_PROJECT_PROPERTIES,   "project_properties"},
+        ActionMapping{ACT_FOLLOW,               "follow"},
+        ActionMapping{ACT_FILTER,               "filter"},
+        ActionMapping{ACT_BUFFER_MODE,          "buffer_mode"},
+        ActionMapping{ACT_SOFT_WRAP,            "soft_wrap"},
+        ActionMapping{ACT_RENAME_SYMBOL,        "rename_symbol"},
+        ActionMapping{ACT_FIND_REFERENCES,      "find_references"},
+        ActionMapping{ACT_TIDY_PROJECT,         "tidy_project"},
+        ActionMapping{ACT_TIDY_FINDINGS,        "tidy_findings"},
+        ActionMapping{ACT_TOGGLE_TERMINAL,      "toggle_terminal"},
+        ActionMapping{ACT_BENCHMARK,            "benchmark"}
     };
 
 public:
@@ -0,0 +1,205 @@
+#include "LineFilter.h"
+
+#include <algorithm>
+
+namespace {
+
+// Splits "foo|bar" into trimmed, non-empty terms.
+std::vector<std::string> splitTerms(const std::string& field) {
+    std::vector<std::string> terms;
+    std::size_t start = 0;
+    while (start <= field.size()) {
+        std::size_t end = field.find('|', start);
+        if (end == std::string::npos) end = field.size();
+        std::string term = field.substr(start, end - start);
+        term.erase(0, term.find_first_not_of(" \t"));
+        term.erase(term.find_last_not_of(" \t") + 1);
+        if (!term.empty()) terms.push_back(std::move(term));
+        start = end + 1;
+    }
+    return terms;
+}
+
+// How often a scan task checks for cancellation and reports progress.
+constexpr std::size_t PROGRESS_LINES = 4096;
+
+} // namespace
+
+std::string FilterSpec::describe() const {
+    std::string s;
+    if (!include.empty()) s += include;
+    if (!exclude.empty()) s += (s.empty() ? "" : " ") + std::string("-(") + exclude + ")";
+    return regex ? "/" + s + "/" : s;
+}
+
+std::shared_ptr<const LineFilter> LineFilter::compile(const FilterSpec& spec, std::string& error) {
+    std::shared_ptr<LineFilter> filter(new LineFilter());
+    auto add = [&](const std::string& field, std::vector<std::unique_ptr<LineMatcher>>& out) {
+        if (spec.regex) {
+            if (!field.empty()) out.push_back(std::make_unique<LineMatcher>(field, true));
+        } else {
+            for (const auto& term : splitTerms(field)) out.push_back(std::make_unique<LineMatcher>(term, false));
+        }
+    };
+    try {
+        add(spec.include, filter->m_include);
+        add(spec.exclude, filter->m_exclude);
+    } catch (const std::regex_error& e) {
+        error = std::string("Invalid regular expression: ") + e.what();
+        return nullptr;
+    }
+    return filter;
+}
+
+bool LineFilter::keep(std::string_view line) const {
+    if (!m_include.empty() &&
+        std::none_of(m_include.begin(), m_include.end(), [&](const auto& m) { return m->matches(line); }))
+        return false;
+    return std::none_of(m_exclude.begin(), m_exclude.end(), [&](const auto& m) { return m->matches(line); });
+}
+
+FilteredView::~FilteredView() {
+    if (m_scan) m_scan->token.cancel();
+}
+
+int FilteredView::scanPercent() const {
+    if (!m_scan || m_scan->line_count == 0) return 0;
+    return static_cast<int>(m_scan->scanned.load(std::memory_order_relaxed) * 100 / m_scan->line_count);
+}
+
+void FilteredView::refilter(EditorBuffer& buffer, FilterSpec spec, std::shared_ptr<const LineFilter> filter) {
+    m_spec = std::move(spec);
+    m_filter = std::move(filter);
+    cursor = top = 0;
+    startScan(buffer);
+}
+
+void FilteredView::startScan(EditorBuffer& buffer) {
+    if (m_scan) m_scan->token.cancel();
+    m_rows.clear();
+    m_generation = buffer.generation;
+    m_dropped = buffer.head_lines_dropped;
+    m_last = nullptr;
+    m_last_len = 0;
+    m_last_num = 0;
+
+    auto scan = std::make_shared<Scan>();
+    scan->snapshot = buffer.snapshot();
+    scan->line_count = scan->snapshot->lineCount();
+    scan->dropped_at_start = buffer.head_lines_dropped;
+    std::size_t chunks = std::max<std::size_t>(1, (scan->line_count + SCAN_CHUNK_LINES - 1) / SCAN_CHUNK_LINES);
+    scan->hits.resize(chunks);
+    scan->remaining = chunks;
+    m_scan = scan;
+
+    for (std::size_t i = 0; i < chunks; ++i) {
+        TaskScheduler::instance().submit(TaskLane::Visible,
+            [scan, filter = m_filter, i](const CancellationToken& token) {
+                const BufferSnapshot& snap = *scan->snapshot;
+                std::size_t begin = i * SCAN_CHUNK_LINES;
+                std::size_t end = std::min(begin + SCAN_CHUNK_LINES, scan->line_count);
+                std::vector<std::uint32_t>& hits = scan->hits[i];
+                for (std::size_t idx = begin; idx < end; ++idx) {
+                    if (filter->keep(snap.line(idx))) hits.push_back(static_cast<std::uint32_t>(idx));
+                    if ((idx - begin + 1) % PROGRESS_LINES == 0) {
+                        if (token.cancelled()) return;
+                        scan->scanned.fetch_add(PROGRESS_LINES, std::memory_order_relaxed);
+                    }
+                }
+                if (scan->remaining.fetch_sub(1) == 1) scan->done = true;
+            }, scan->token);
+    }
+}
+
+// Turns the line numbers found by a finished scan into rows.  The scan ran
+// on a snapshot, so lines trimmed from the head since then are skipped.
+void FilteredView::adoptScan(EditorBuffer& buffer) {
+    std::shared_ptr<Scan> scan = std::move(m_scan);
+    const std::uint64_t shift = buffer.head_lines_dropped - scan->dropped_at_start;
+    std::size_t count = scan->line_count;
+    if (buffer.load_id != 0 && !buffer.load_tail) count = 0;   // only the placeholder line
+    if (count <= shift) return;
+
+    std::size_t total = 0;
+    for (const auto& hits : scan->hits) total += hits.size();
+    m_rows.reserve(total);
+
+    Line* p = buffer.document_head;
+    std::size_t num = 1;
+    for (const auto& hits : scan->hits) {
+        for (std::uint32_t idx : hits) {
+            if (idx < shift) continue;
+            std::size_t target = idx - shift + 1;
+            while (num < target) { p = p->next; ++num; }
+            m_rows.push_back({p, static_cast<int>(num)});
+        }
+    }
+    while (num < count - shift) { p = p->next; ++num; }
+    m_last = p;
+    m_last_num = static_cast<int>(num);
+    m_last_len = scan->snapshot->line(count - 1).size();
+}
+
+void FilteredView::dropHead(std::uint64_t count) {
+    auto first_kept = std::find_if(m_rows.begin(), m_rows.end(),
+                                   [&](const Row& r) { return (std::uint64_t)r.line_num > count; });
+    int erased = static_cast<int>(first_kept - m_rows.begin());
+    m_rows.erase(m_rows.begin(), first_kept);
+    for (Row& r : m_rows) r.line_num -= static_cast<int>(count);
+    cursor = std::max(0, cursor - erased);
+    top = std::max(0, top - erased);
+
+    if ((std::uint64_t)m_last_num <= count) {
+        m_last = nullptr;
+        m_last_num = 0;
+    } else {
+        m_last_num -= static_cast<int>(count);
+    }
+}
+
+// Filters the lines after the last one examined.  A tailing view keeps the
+// cursor on the newest match.
+void FilteredView::filterAppended(EditorBuffer& buffer) {
+    if (buffer.load_id != 0 && !buffer.load_tail) return;   // only the placeholder line
+    bool follow = buffer.load_id != 0 && !m_rows.empty() && cursor == (int)m_rows.size() - 1;
+
+    if (m_last && m_last->text.size() != m_last_len) {
+        // Follow mode completed a partial last line
+        bool listed = !m_rows.empty() && m_rows.back().line == m_last;
+        bool keep = m_filter->keep(m_last->text);
+        if (listed && !keep) m_rows.pop_back();
+        else if (!listed && keep) m_rows.push_back({m_last, m_last_num});
+        m_last_len = m_last->text.size();
+    }
+
+    Line* p = m_last ? m_last->next : buffer.document_head;
+    int num = m_last_num + 1;
+    for (; p; p = p->next, ++num) {
+        if (m_filter->keep(p->text)) m_rows.push_back({p, num});
+        m_last = p;
+        m_last_num = num;
+        m_last_len = p->text.size();
+    }
+
+    if (follow) cursor = (int)m_rows.size() - 1;
+    cursor = std::clamp(cursor, 0, std::max(0, (int)m_rows.size() - 1));
+}
+
+void FilteredView::sync(EditorBuffer& buffer) {
+    if (!m_filter) return;
+    if (buffer.generation != m_generation) {
+        // Edited or reloaded: none of the Line pointers can be trusted
+        cursor = top = 0;
+        startScan(buffer);
+        return;
+    }
+    if (buffer.head_lines_dropped != m_dropped) {
+        dropHead(buffer.head_lines_dropped - m_dropped);
+        m_dropped = buffer.head_lines_dropped;
+    }
+    if (m_scan) {
+        if (!m_scan->done) return;
+        adoptScan(buffer);
+    }
+    filterAppended(buffer);
+}
@@ -0,0 +1,115 @@
+#ifndef LINEFILTER_H
+#define LINEFILTER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "EditorBuffer.h"
+#include "SearchEngine.h"
+#include "TaskScheduler.h"
+
+// What a filtered view shows.  Plain terms are separated by '|'; in regex
+// mode each field is a single expression.  A line is kept if it matches any
+// include term (every line, when there is none) and no exclude term.
+struct FilterSpec {
+    std::string include;
+    std::string exclude;
+    bool regex = false;
+
+    bool empty() const { return include.empty() && exclude.empty(); }
+    std::string describe() const;
+};
+
+// Compiled FilterSpec.  Immutable once built; shared by the worker tasks.
+class LineFilter {
+public:
+    // Returns nullptr and fills `error` if a regex does not compile.
+    static std::shared_ptr<const LineFilter> compile(const FilterSpec& spec, std::string& error);
+
+    bool keep(std::string_view line) const;
+
+private:
+    LineFilter() = default;
+
+    std::vector<std::unique_ptr<LineMatcher>> m_include;
+    std::vector<std::unique_ptr<LineMatcher>> m_exclude;
+};
+
+// "Only show lines matching X" for one buffer: a compact index of the
+// matching lines that drawTextArea renders in place of the document.
+//
+// A full (re)filter runs on the task scheduler over a BufferSnapshot, split
+// into chunks that are scanned in parallel; the hits come back as line
+// numbers and are turned into Line pointers by sync() on the UI thread.
+// After that, lines appended by a stream or follow mode are filtered
+// incrementally by sync() instead of recomputing the view.
+class FilteredView {
+public:
+    struct Row {
+        Line* line;
+        int line_num;   // 1-based line number in the document
+    };
+
+    // Lines per parallel scan task.
+    static constexpr std::size_t SCAN_CHUNK_LINES = 64 * BufferSnapshot::CHUNK_LINES;
+
+    FilteredView() = default;
+    ~FilteredView();
+    FilteredView(const FilteredView&) = delete;
+    FilteredView& operator=(const FilteredView&) = delete;
+
+    // Brings the index up to date with `buffer`: picks up a finished scan,
+    // accounts for lines trimmed from the head of a stream, filters newly
+    // appended lines and restarts the scan if the text was edited or
+    // reloaded.  UI thread only; call before using rows().
+    void sync(EditorBuffer& buffer);
+
+    // Sets the filter and starts a background scan of the whole buffer,
+    // cancelling any scan still running for the previous filter.
+    void refilter(EditorBuffer& buffer, FilterSpec spec, std::shared_ptr<const LineFilter> filter);
+
+    const FilterSpec& spec() const { return m_spec; }
+    const std::vector<Row>& rows() const { return m_rows; }
+    bool scanning() const { return m_scan != nullptr; }
+    int scanPercent() const;
+
+    // Selected row and first row on screen.
+    int cursor = 0;
+    int top = 0;
+    int horizontal_scroll_offset = 1;
+
+private:
+    // Shared between the scan tasks and the UI thread.
+    struct Scan {
+        CancellationToken token;
+        std::size_t line_count = 0;            // lines in the snapshot
+        std::uint64_t dropped_at_start = 0;    // buffer.head_lines_dropped when started
+        BufferSnapshotPtr snapshot;
+        std::vector<std::vector<std::uint32_t>> hits;   // one slot per chunk
+        std::atomic<std::size_t> remaining{0};
+        std::atomic<std::size_t> scanned{0};
+        std::atomic<bool> done{false};
+    };
+
+    void startScan(EditorBuffer& buffer);
+    void adoptScan(EditorBuffer& buffer);
+    void dropHead(std::uint64_t count);
+    void filterAppended(EditorBuffer& buffer);
+
+    FilterSpec m_spec;
+    std::shared_ptr<const LineFilter> m_filter;
+    std::vector<Row> m_rows;
+    std::shared_ptr<Scan> m_scan;
+
+    // What the rows were built from
+    std::uint64_t m_generation = 0;
+    std::uint64_t m_dropped = 0;
+    Line* m_last = nullptr;         // last line examined
+    std::size_t m_last_len = 0;     // its length then (follow mode may extend it)
+    int m_last_num = 0;
+};
+
+#endif // LINEFILTER_H
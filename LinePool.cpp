@@ -0,0 +1,162 @@
+#include "LinePool.h"
+
+#include <bitset>
+#include <new>
+#include <utility>
+
+namespace {
+
+// Slabs are aligned to their size, so the slab of a node is found by
+// masking its address.
+constexpr std::size_t SLAB_BYTES = 64 * 1024;
+
+// Overlays the storage of a destroyed node.
+struct FreeNode {
+    FreeNode* next;
+};
+
+} // namespace
+
+struct LinePool::Slab {
+    Slab* prev = nullptr;        // in m_slabs
+    Slab* next = nullptr;
+    Slab* open_prev = nullptr;   // in m_open
+    Slab* open_next = nullptr;
+    bool open = false;
+    FreeNode* free = nullptr;
+    std::uint32_t used = 0;      // nodes handed out so far, destroyed or not
+    std::uint32_t live = 0;
+
+    // The nodes follow the header
+    static constexpr std::size_t header() { return (sizeof(Slab) + alignof(Line) - 1) / alignof(Line) * alignof(Line); }
+    static constexpr std::size_t capacity() { return (SLAB_BYTES - header()) / sizeof(Line); }
+
+    Line* nodes() { return reinterpret_cast<Line*>(reinterpret_cast<char*>(this) + header()); }
+
+    static Slab* of(const Line* line) {
+        return reinterpret_cast<Slab*>(reinterpret_cast<std::uintptr_t>(line) & ~(std::uintptr_t)(SLAB_BYTES - 1));
+    }
+};
+
+LinePool::LinePool(LinePool&& other) noexcept :
+    m_slabs(other.m_slabs), m_open(other.m_open), m_live(other.m_live)
+{
+    other.m_slabs = other.m_open = nullptr;
+    other.m_live = 0;
+}
+
+LinePool& LinePool::operator=(LinePool&& other) noexcept {
+    if (this == &other) return *this;
+    clear();
+    m_slabs = other.m_slabs; m_open = other.m_open; m_live = other.m_live;
+    other.m_slabs = other.m_open = nullptr;
+    other.m_live = 0;
+    return *this;
+}
+
+Line* LinePool::create(std::string text, Line* prev) {
+    Slab* slab = m_open ? m_open : newSlab();
+    void* mem;
+    if (slab->free) {
+        mem = slab->free;
+        slab->free = slab->free->next;
+    } else {
+        mem = slab->nodes() + slab->used++;
+    }
+    slab->live++;
+    m_live++;
+    if (!slab->free && slab->used == Slab::capacity()) markFull(slab);
+    return new (mem) Line{std::move(text), prev};
+}
+
+void LinePool::destroy(Line* line) {
+    Slab* slab = Slab::of(line);
+    line->~Line();
+    slab->free = new (static_cast<void*>(line)) FreeNode{slab->free};
+    slab->live--;
+    m_live--;
+    // An empty slab goes back at once, except the last one: a buffer that
+    // loses and regains a line should not free and map a slab each time.
+    if (slab->live == 0 && (slab->prev || slab->next)) {
+        releaseSlab(slab);
+        return;
+    }
+    markOpen(slab);
+}
+
+void LinePool::clear() {
+    while (m_slabs) {
+        Slab* slab = m_slabs;
+        m_slabs = slab->next;
+        if (slab->live > 0) {
+            std::bitset<Slab::capacity()> freed;
+            for (FreeNode* f = slab->free; f; f = f->next) {
+                freed.set(reinterpret_cast<Line*>(f) - slab->nodes());
+            }
+            for (std::uint32_t i = 0; i < slab->used; ++i) {
+                if (!freed.test(i)) slab->nodes()[i].~Line();
+            }
+        }
+        slab->~Slab();
+        ::operator delete(slab, std::align_val_t(SLAB_BYTES));
+    }
+    m_open = nullptr;
+    m_live = 0;
+}
+
+void LinePool::adopt(LinePool& other) {
+    if (this == &other || !other.m_slabs) return;
+
+    Slab* last = other.m_slabs;
+    while (last->next) last = last->next;
+    last->next = m_slabs;
+    if (m_slabs) m_slabs->prev = last;
+    m_slabs = other.m_slabs;
+
+    if (other.m_open) {
+        Slab* last_open = other.m_open;
+        while (last_open->open_next) last_open = last_open->open_next;
+        last_open->open_next = m_open;
+        if (m_open) m_open->open_prev = last_open;
+        m_open = other.m_open;
+    }
+
+    m_live += other.m_live;
+    other.m_slabs = other.m_open = nullptr;
+    other.m_live = 0;
+}
+
+LinePool::Slab* LinePool::newSlab() {
+    void* mem = ::operator new(SLAB_BYTES, std::align_val_t(SLAB_BYTES));
+    Slab* slab = new (mem) Slab();
+    slab->next = m_slabs;
+    if (m_slabs) m_slabs->prev = slab;
+    m_slabs = slab;
+    markOpen(slab);
+    return slab;
+}
+
+void LinePool::releaseSlab(Slab* slab) {
+    markFull(slab);
+    if (slab->prev) slab->prev->next = slab->next; else m_slabs = slab->next;
+    if (slab->next) slab->next->prev = slab->prev;
+    slab->~Slab();
+    ::operator delete(slab, std::align_val_t(SLAB_BYTES));
+}
+
+void LinePool::markOpen(Slab* slab) {
+    if (slab->open) return;
+    slab->open = true;
+    slab->open_prev = nullptr;
+    slab->open_next = m_open;
+    if (m_open) m_open->open_prev = slab;
+    m_open = slab;
+}
+
+void LinePool::markFull(Slab* slab) {
+    if (!slab->open) return;
+    slab->open = false;
+    if (slab->open_prev) slab->open_prev->open_next = slab->open_next; else m_open = slab->open_next;
+    if (slab->open_next) slab->open_next->open_prev = slab->open_prev;
+    slab->open_prev = slab->open_next = nullptr;
+}
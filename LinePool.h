@@ -0,0 +1,66 @@
+#ifndef LINEPOOL_H
+#define LINEPOOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+struct Line {
+    std::string text;
+    Line* prev = nullptr;
+    Line* next = nullptr;
+    bool selected = false;
+    int selection_start_col = 0;
+    int selection_end_col = 0;
+    // Id of the BufferSnapshot chunk the line was last captured in; 0 for a
+    // line no snapshot has seen
+    std::uint32_t snapshot_chunk = 0;
+};
+
+// Allocator for the Line nodes of one buffer.
+//
+// Nodes are carved out of 64 KiB slabs; a destroyed node goes on its slab's
+// free list and is handed out again by the next create().  A slab is given
+// back as soon as its last node is destroyed, so lines trimmed off the head
+// of a stream return their memory.  Destroying or clearing the pool releases
+// every slab at once instead of freeing each node.  Short line texts live
+// inside the node (small string optimisation) and need no allocation of
+// their own.
+//
+// A pool is not thread-safe.  Lines built on a worker thread come from a
+// pool of their own, which the buffer adopt()s when it takes the lines.
+class LinePool {
+public:
+    LinePool() = default;
+    ~LinePool() { clear(); }
+    LinePool(LinePool&& other) noexcept;
+    LinePool& operator=(LinePool&& other) noexcept;
+    LinePool(const LinePool&) = delete;
+    LinePool& operator=(const LinePool&) = delete;
+
+    Line* create(std::string text = {}, Line* prev = nullptr);
+    // `line` must come from this pool (or one it adopted).
+    void destroy(Line* line);
+
+    // Destroys every line still alive and releases all slabs.
+    void clear();
+
+    // Takes over the slabs and lines of `other`, leaving it empty.
+    void adopt(LinePool& other);
+
+    std::size_t liveLines() const { return m_live; }
+
+private:
+    struct Slab;
+
+    Slab* newSlab();
+    void releaseSlab(Slab* slab);
+    void markOpen(Slab* slab);
+    void markFull(Slab* slab);
+
+    Slab* m_slabs = nullptr;   // every slab
+    Slab* m_open = nullptr;    // slabs with a free node
+    std::size_t m_live = 0;
+};
+
+#endif // LINEPOOL_H
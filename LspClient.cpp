@@ -0,0 +1,448 @@
+#include "LspClient.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <string_view>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+// How long stop() waits for the server to exit before killing it, and how
+// long one that hung up gets after SIGTERM
+constexpr int STOP_WAIT_MS = 500;
+// How long a server that hung up gets to exit by itself before SIGTERM
+constexpr int HANG_UP_GRACE_MS = 100;
+
+bool isUnreserved(unsigned char c) {
+    return std::isalnum(c) || c == '-' || c == '.' || c == '_' || c == '~' || c == '/';
+}
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Length of the Content-Length header value in `headers`, -1 if missing.
+long contentLength(const std::string& headers) {
+    static const char name[] = "content-length:";
+    for (std::size_t start = 0; start < headers.size(); ) {
+        std::size_t end = headers.find("\r\n", start);
+        if (end == std::string::npos) end = headers.size();
+        if (end - start > sizeof(name) - 1 &&
+            strncasecmp(headers.c_str() + start, name, sizeof(name) - 1) == 0) {
+            return std::strtol(headers.c_str() + start + sizeof(name) - 1, nullptr, 10);
+        }
+        start = end + 2;
+    }
+    return -1;
+}
+
+} // namespace
+
+LspClient::~LspClient() {
+    stop();
+}
+
+bool LspClient::start(const std::vector<std::string>& command, const std::string& root_dir,
+                      json initialization_options) {
+    if (running() || command.empty()) return false;
+
+    // A socket rather than two pipes: send() with MSG_NOSIGNAL turns a dead
+    // server into EPIPE instead of a SIGPIPE that would take the editor down
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0) return false;
+
+    std::vector<char*> argv;
+    for (const std::string& arg : command) argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(nullptr);
+
+    pid_t pid = ::fork();
+    if (pid < 0) {
+        ::close(fds[0]);
+        ::close(fds[1]);
+        return false;
+    }
+    if (pid == 0) {
+        ::dup2(fds[1], STDIN_FILENO);
+        ::dup2(fds[1], STDOUT_FILENO);
+        int null = ::open("/dev/null", O_WRONLY);
+        if (null >= 0) ::dup2(null, STDERR_FILENO);
+        // Keep the terminal's signals (Ctrl+C) away from the server
+        ::setsid();
+        ::execvp(argv[0], argv.data());
+        ::_exit(127);
+    }
+    ::close(fds[1]);
+    ::fcntl(fds[0], F_SETFL, ::fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+
+    m_pid = pid;
+    m_fd = fds[0];
+    m_hung_up = false;
+    m_signals_sent = 0;
+    m_ready = false;
+    m_utf8 = false;
+    m_exit_reason.clear();
+    m_in.clear();
+    m_out.clear();
+    m_held.clear();
+
+    json capabilities = {
+        {"general", {{"positionEncodings", {"utf-8", "utf-16"}}}},
+        {"window", {{"workDoneProgress", true}}},
+        {"textDocument", {
+            {"synchronization", {{"didSave", false}}},
+            {"definition", {{"linkSupport", false}}},
+            {"hover", {{"contentFormat", {"plaintext"}}}},
+            {"publishDiagnostics", {{"relatedInformation", false}}},
+        }},
+    };
+    m_initialize_id = m_next_id++;
+    send({{"jsonrpc", "2.0"}, {"id", m_initialize_id}, {"method", "initialize"},
+          {"params", {
+              {"processId", static_cast<int>(::getpid())},
+              {"rootUri", uri(root_dir)},
+              {"capabilities", capabilities},
+              {"initializationOptions", std::move(initialization_options)},
+              {"offsetEncoding", {"utf-8", "utf-16"}},   // clangd before LSP 3.17
+          }}});
+    flush();
+    return true;
+}
+
+void LspClient::stop() {
+    if (!running()) return;
+    if (m_ready) {
+        m_held.clear();
+        send({{"jsonrpc", "2.0"}, {"id", m_next_id++}, {"method", "shutdown"}});
+        send({{"jsonrpc", "2.0"}, {"method", "exit"}});
+        flush();
+    }
+    ::shutdown(m_fd, SHUT_WR);
+    int status = 0;
+    pid_t done = 0;
+    for (int waited = 0; (done = ::waitpid(m_pid, &status, WNOHANG)) == 0 && waited < STOP_WAIT_MS; waited += 10) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (done == 0) {
+        ::kill(m_pid, SIGKILL);
+        ::waitpid(m_pid, &status, 0);
+    }
+    ::close(m_fd);
+    m_fd = -1;
+    m_pid = -1;
+    m_ready = false;
+    m_pending.clear();
+    m_documents.clear();
+    m_progress.clear();
+    m_exit_reason = "stopped";
+}
+
+int LspClient::request(const std::string& method, json params, ReplyHandler handler) {
+    if (!running()) {
+        handler(nullptr, "language server is not running");
+        return 0;
+    }
+    int id = m_next_id++;
+    m_pending[id] = std::move(handler);
+    send({{"jsonrpc", "2.0"}, {"id", id}, {"method", method}, {"params", std::move(params)}});
+    return id;
+}
+
+void LspClient::cancel(int id) {
+    if (m_pending.erase(id)) notify("$/cancelRequest", {{"id", id}});
+}
+
+void LspClient::notify(const std::string& method, json params) {
+    if (!running()) return;
+    send({{"jsonrpc", "2.0"}, {"method", method}, {"params", std::move(params)}});
+}
+
+void LspClient::onNotification(const std::string& method, NotificationHandler handler) {
+    m_notification_handlers[method] = std::move(handler);
+}
+
+void LspClient::open(const BufferSnapshotPtr& snapshot, const std::string& language_id) {
+    if (!running() || isOpen(snapshot->fileId())) return;
+    Document& doc = m_documents[snapshot->fileId()];
+    doc.sent = snapshot;
+    doc.version = 1;
+    notify("textDocument/didOpen", {{"textDocument", {
+        {"uri", uri(PathRegistry::instance().path(snapshot->fileId()))},
+        {"languageId", language_id},
+        {"version", doc.version},
+        {"text", snapshot->text()},
+    }}});
+}
+
+void LspClient::change(const BufferSnapshotPtr& snapshot) {
+    auto it = m_documents.find(snapshot->fileId());
+    if (it == m_documents.end() || it->second.sent == snapshot) return;
+    Document& doc = it->second;
+    const BufferSnapshot& now = *snapshot;
+    const std::size_t n_old = doc.sent->lineCount(), n_new = now.lineCount();
+    const auto [head, tail] = BufferSnapshot::diff(*doc.sent, now);
+    doc.sent = snapshot;
+    if (head == n_old && head == n_new) return;
+
+    // Every line ends in '\n' (see BufferSnapshot::text()), so whole lines
+    // can be replaced without knowing their lengths
+    std::string text;
+    for (std::size_t i = head; i < n_new - tail; ++i) {
+        text += now.line(i);
+        text += '\n';
+    }
+    ++doc.version;
+    notify("textDocument/didChange", {
+        {"textDocument", {{"uri", uri(PathRegistry::instance().path(snapshot->fileId()))}, {"version", doc.version}}},
+        {"contentChanges", json::array({{
+            {"range", {{"start", {{"line", head}, {"character", 0}}},
+                       {"end", {{"line", n_old - tail}, {"character", 0}}}}},
+            {"text", std::move(text)},
+        }})},
+    });
+}
+
+void LspClient::close(FileId file) {
+    if (!m_documents.erase(file)) return;
+    notify("textDocument/didClose", {{"textDocument", {{"uri", uri(PathRegistry::instance().path(file))}}}});
+}
+
+std::vector<FileId> LspClient::openDocuments() const {
+    std::vector<FileId> files;
+    for (const auto& [file, doc] : m_documents) files.push_back(file);
+    return files;
+}
+
+void LspClient::send(const json& message) {
+    std::string body = message.dump(-1, ' ', false, json::error_handler_t::replace);
+    std::string framed = "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+    if (!m_ready && !(message.contains("id") && message["id"] == m_initialize_id && message.contains("method"))) {
+        m_held.push_back(std::move(framed));
+        return;
+    }
+    m_out += framed;
+}
+
+void LspClient::flush() {
+    while (!m_out.empty() && m_fd >= 0) {
+        ssize_t n = ::send(m_fd, m_out.data(), m_out.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n > 0) { m_out.erase(0, n); continue; }
+        if (n < 0 && errno == EINTR) continue;
+        // EAGAIN: the server is busy reading; the rest goes on the next pump
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) m_out.clear();
+        break;
+    }
+}
+
+bool LspClient::pump(std::size_t max_bytes) {
+    if (!running()) return false;
+    if (m_hung_up) return reap();
+    flush();
+
+    char buf[16384];
+    bool eof = false;
+    for (std::size_t got = 0; got < max_bytes; ) {
+        ssize_t n = ::recv(m_fd, buf, std::min(sizeof(buf), max_bytes - got), MSG_DONTWAIT);
+        if (n > 0) { m_in.append(buf, n); got += n; continue; }
+        if (n < 0 && errno == EINTR) continue;
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) eof = true;
+        break;
+    }
+    bool ran = drain();
+
+    if (eof) {
+        m_hung_up = true;
+        m_hung_up_at = std::chrono::steady_clock::now();
+        return reap() || ran;
+    }
+    flush();
+    return ran;
+}
+
+// Collects the server once it has hung up, never waiting for it: one that
+// is still running after a moment gets SIGTERM, and SIGKILL on a later pump
+// if that does not end it.  Returns true once it is gone.
+bool LspClient::reap() {
+    int status = 0;
+    const pid_t done = ::waitpid(m_pid, &status, WNOHANG);
+    if (done == 0) {
+        const auto waited = std::chrono::steady_clock::now() - m_hung_up_at;
+        // The server leads a session of its own (see start()): its helpers go too
+        if (m_signals_sent == 0 && waited >= std::chrono::milliseconds(HANG_UP_GRACE_MS)) {
+            ::kill(-m_pid, SIGTERM);
+            m_signals_sent = 1;
+        } else if (m_signals_sent == 1 && waited >= std::chrono::milliseconds(HANG_UP_GRACE_MS + STOP_WAIT_MS)) {
+            ::kill(-m_pid, SIGKILL);
+            m_signals_sent = 2;
+        }
+        return false;
+    }
+    std::string reason = "language server exited";
+    if (done > 0 && m_signals_sent > 0) reason = "language server closed its connection";
+    else if (done > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 127) reason = "language server not found";
+    else if (done > 0 && WIFSIGNALED(status)) reason = "language server crashed";
+    exited(reason);
+    return true;
+}
+
+// Splits the bytes read into messages and dispatches the complete ones.
+bool LspClient::drain() {
+    bool ran = false;
+    std::size_t pos = 0;
+    while (running()) {
+        std::size_t header_end = m_in.find("\r\n\r\n", pos);
+        if (header_end == std::string::npos) break;
+        long length = contentLength(m_in.substr(pos, header_end - pos));
+        std::size_t body = header_end + 4;
+        if (length < 0) { pos = body; continue; }   // not a header we understand: skip it
+        if (m_in.size() - body < static_cast<std::size_t>(length)) break;
+        json message = json::parse(m_in.begin() + body, m_in.begin() + body + length, nullptr, false);
+        pos = body + length;
+        if (!message.is_discarded()) {
+            dispatch(message);
+            ran = true;
+        }
+    }
+    m_in.erase(0, pos);
+    return ran;
+}
+
+void LspClient::dispatch(const json& message) {
+    const bool has_id = message.contains("id") && !message["id"].is_null();
+    if (!message.contains("method")) {
+        if (!has_id || !message["id"].is_number_integer()) return;
+        const int id = message["id"];
+        if (id == m_initialize_id) {
+            const json& caps = message.value("result", json::object()).value("capabilities", json::object());
+            std::string encoding = caps.value("positionEncoding", "");
+            if (encoding.empty()) encoding = message.value("result", json::object()).value("offsetEncoding", "utf-16");
+            m_utf8 = encoding == "utf-8";
+            m_ready = true;
+            send({{"jsonrpc", "2.0"}, {"method", "initialized"}, {"params", json::object()}});
+            for (const std::string& held : m_held) m_out += held;
+            m_held.clear();
+            return;
+        }
+        auto it = m_pending.find(id);
+        if (it == m_pending.end()) return;   // cancelled
+        ReplyHandler handler = std::move(it->second);
+        m_pending.erase(it);
+        if (message.contains("error")) handler(nullptr, message["error"].value("message", "request failed"));
+        else handler(message.value("result", json()), "");
+        return;
+    }
+
+    const std::string method = message["method"];
+    const json params = message.value("params", json::object());
+    if (has_id) {
+        // Requests from the server.  None needs more than an empty answer;
+        // workspace/configuration wants one entry per item asked for.
+        json result = nullptr;
+        if (method == "workspace/configuration") result = json::array();
+        if (method == "workspace/configuration" && params.contains("items")) {
+            for (std::size_t i = 0; i < params["items"].size(); ++i) result.push_back(nullptr);
+        }
+        send({{"jsonrpc", "2.0"}, {"id", message["id"]}, {"result", result}});
+        return;
+    }
+
+    if (method == "$/progress" && params.contains("token") && params.contains("value")) {
+        const std::string token = params["token"].is_string() ? params["token"].get<std::string>() : params["token"].dump();
+        const json& value = params["value"];
+        const std::string kind = value.value("kind", "");
+        if (kind == "end") {
+            m_progress.erase(token);
+        } else {
+            auto& [title, percent] = m_progress[token];
+            if (value.contains("title")) title = value["title"];
+            if (value.contains("percentage") && value["percentage"].is_number()) percent = value["percentage"];
+        }
+    }
+    auto it = m_notification_handlers.find(method);
+    if (it != m_notification_handlers.end()) it->second(params);
+}
+
+void LspClient::exited(const std::string& reason) {
+    ::close(m_fd);
+    m_fd = -1;
+    m_pid = -1;
+    m_ready = false;
+    m_exit_reason = reason;
+    m_documents.clear();
+    m_progress.clear();
+    m_held.clear();
+    m_out.clear();
+    std::map<int, ReplyHandler> pending = std::move(m_pending);
+    m_pending.clear();
+    for (auto& [id, handler] : pending) handler(nullptr, reason);
+}
+
+std::string LspClient::progress() const {
+    for (const auto& [token, state] : m_progress) {
+        if (state.first.empty()) continue;
+        return state.first + (state.second > 0 ? " " + std::to_string(state.second) + "%" : "");
+    }
+    return "";
+}
+
+int LspClient::toCharacter(const std::string& line, std::size_t byte) const {
+    byte = std::min(byte, line.size());
+    if (m_utf8) return static_cast<int>(byte);
+    int units = 0;
+    for (std::size_t i = 0; i < byte; ++i) {
+        unsigned char c = line[i];
+        if ((c & 0xC0) != 0x80) units += c >= 0xF0 ? 2 : 1;   // 4-byte sequences are surrogate pairs
+    }
+    return units;
+}
+
+std::size_t LspClient::toByte(const std::string& line, int character) const {
+    if (character <= 0) return 0;
+    if (m_utf8) return std::min<std::size_t>(character, line.size());
+    int units = 0;
+    std::size_t i = 0;
+    for (; i < line.size() && units < character; ++i) {
+        unsigned char c = line[i];
+        if ((c & 0xC0) != 0x80) units += c >= 0xF0 ? 2 : 1;
+        while (i + 1 < line.size() && (static_cast<unsigned char>(line[i + 1]) & 0xC0) == 0x80) ++i;
+    }
+    return i;
+}
+
+std::string LspClient::uri(const std::string& path) {
+    static const char digits[] = "0123456789ABCDEF";
+    std::string out = "file://";
+    for (unsigned char c : path) {
+        if (isUnreserved(c)) out += static_cast<char>(c);
+        else { out += '%'; out += digits[c >> 4]; out += digits[c & 15]; }
+    }
+    return out;
+}
+
+std::string LspClient::path(const std::string& uri) {
+    std::string_view rest(uri);
+    if (rest.rfind("file://", 0) != 0) return "";
+    rest.remove_prefix(7);
+    std::string out;
+    for (std::size_t i = 0; i < rest.size(); ++i) {
+        int hi, lo;
+        if (rest[i] == '%' && i + 2 < rest.size() && (hi = hexValue(rest[i + 1])) >= 0 && (lo = hexValue(rest[i + 2])) >= 0) {
+            out += static_cast<char>(hi * 16 + lo);
+            i += 2;
+        } else {
+            out += rest[i];
+        }
+    }
+    return out;
+}
@@ -0,0 +1,118 @@
+#ifndef LSPCLIENT_H
+#define LSPCLIENT_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+#include "BufferSnapshot.h"
+#include "PathRegistry.h"
+#include "nlohmann/json.hpp"
+
+// Client side of the Language Server Protocol: JSON-RPC over the stdin and
+// stdout of a locally spawned server such as clangd, which keeps its own
+// background index and preambles warm across requests.
+//
+// Nothing blocks and nothing needs a lock: pump() is called once per main
+// loop iteration, writes what is queued, reads a bounded amount of what the
+// server has ready and runs the reply and notification handlers on the UI
+// thread.  Requests return an id that cancel() withdraws; a cancelled
+// request's handler never runs.  Documents are synced incrementally: each
+// change is sent as the one range of lines that differs from the snapshot
+// the server saw last.
+class LspClient {
+public:
+    using json = nlohmann::json;
+    // `error` is empty on success; otherwise `result` is null.
+    using ReplyHandler = std::function<void(const json& result, const std::string& error)>;
+    using NotificationHandler = std::function<void(const json& params)>;
+
+    LspClient() = default;
+    ~LspClient();
+    LspClient(const LspClient&) = delete;
+    LspClient& operator=(const LspClient&) = delete;
+
+    // Spawns `command` (argv[0] is looked up in PATH) and sends `initialize`
+    // for the workspace at `root_dir`.  Returns false if the process could
+    // not be created; a command that does not exist shows up as the server
+    // exiting on the next pump().
+    bool start(const std::vector<std::string>& command, const std::string& root_dir,
+               json initialization_options = json::object());
+    // Asks the server to shut down and reaps it.
+    void stop();
+
+    bool running() const { return m_pid > 0; }
+    // The server answered `initialize`.  Requests made before are held back
+    // until then.
+    bool ready() const { return m_ready; }
+    // Why the server is no longer running, empty while it is.
+    const std::string& exitReason() const { return m_exit_reason; }
+
+    int request(const std::string& method, json params, ReplyHandler handler);
+    void cancel(int id);
+    void notify(const std::string& method, json params);
+    void onNotification(const std::string& method, NotificationHandler handler);
+
+    // Document sync.  open() and change() take the buffer's current
+    // snapshot; change() is a no-op if the server already has that version.
+    bool isOpen(FileId file) const { return m_documents.count(file) != 0; }
+    void open(const BufferSnapshotPtr& snapshot, const std::string& language_id);
+    void change(const BufferSnapshotPtr& snapshot);
+    void close(FileId file);
+    std::vector<FileId> openDocuments() const;
+
+    // Reads at most `max_bytes`.  Returns true if a handler ran.
+    bool pump(std::size_t max_bytes);
+
+    // Title and percentage of the server's work in progress (indexing),
+    // empty when there is none.
+    std::string progress() const;
+
+    // Positions: the server is asked for UTF-8 offsets, but one that only
+    // speaks UTF-16 gets its columns converted.  Both are 0-based.
+    int toCharacter(const std::string& line, std::size_t byte) const;
+    std::size_t toByte(const std::string& line, int character) const;
+
+    static std::string uri(const std::string& path);
+    static std::string path(const std::string& uri);
+
+private:
+    struct Document {
+        BufferSnapshotPtr sent;   // what the server has
+        int version = 0;
+    };
+
+    void send(const json& message);
+    void flush();
+    void dispatch(const json& message);
+    bool drain();
+    bool reap();
+    void exited(const std::string& reason);
+
+    pid_t m_pid = -1;
+    int m_fd = -1;             // socket connected to the server's stdin and stdout
+    // The server closed its end of the socket but may not have exited yet;
+    // pump() reaps it without waiting, terminating it if it lingers
+    bool m_hung_up = false;
+    std::chrono::steady_clock::time_point m_hung_up_at;
+    int m_signals_sent = 0;    // SIGTERM, then SIGKILL
+    bool m_ready = false;
+    bool m_utf8 = false;
+    std::string m_exit_reason;
+
+    int m_next_id = 1;
+    int m_initialize_id = 0;
+    std::map<int, ReplyHandler> m_pending;
+    std::map<std::string, NotificationHandler> m_notification_handlers;
+    std::vector<std::string> m_held;   // framed messages waiting for initialize
+    std::string m_out;                 // framed bytes not yet written
+    std::string m_in;                  // bytes read, not yet a whole message
+
+    std::map<FileId, Document> m_documents;
+    std::map<std::string, std::pair<std::string, int>> m_progress;   // token -> title, percent
+};
+
+#endif // LSPCLIENT_H
@@ -0,0 +1,70 @@
+#include "MappedFile.h"
+
+#include <csetjmp>
+#include <csignal>
+#include <fcntl.h>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Set while the thread runs a guarded read; SIGBUS is delivered to the
+// thread that faulted, so the handler knows where to return to.
+thread_local sigjmp_buf* t_fault_return = nullptr;
+struct sigaction g_previous_bus;
+
+void onBusError(int, siginfo_t*, void*) {
+    if (t_fault_return) siglongjmp(*t_fault_return, 1);
+    // Not a guarded read: put the old action back and let the faulting
+    // instruction raise the signal again
+    sigaction(SIGBUS, &g_previous_bus, nullptr);
+}
+
+} // namespace
+
+bool MappedFile::runGuarded(void (*fn)(void*), void* arg) {
+    static std::once_flag installed;
+    std::call_once(installed, [] {
+        struct sigaction sa {};
+        sa.sa_sigaction = onBusError;
+        sa.sa_flags = SA_SIGINFO;
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGBUS, &sa, &g_previous_bus);
+    });
+
+    sigjmp_buf here;
+    sigjmp_buf* outer = t_fault_return;
+    if (sigsetjmp(here, 1) != 0) {
+        t_fault_return = outer;
+        return false;
+    }
+    t_fault_return = &here;
+    fn(arg);
+    t_fault_return = outer;
+    return true;
+}
+
+std::shared_ptr<const MappedFile> MappedFile::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return nullptr;
+
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || !S_ISREG(sb.st_mode)) { close(fd); return nullptr; }
+
+    std::shared_ptr<MappedFile> file(new MappedFile());
+    file->m_size = static_cast<std::uint64_t>(sb.st_size);
+    if (file->m_size > 0) {
+        void* p = mmap(nullptr, file->m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) { close(fd); return nullptr; }
+        file->m_data = static_cast<const unsigned char*>(p);
+    }
+    // The mapping keeps the file alive
+    close(fd);
+    return file;
+}
+
+MappedFile::~MappedFile() {
+    if (m_data) munmap(const_cast<unsigned char*>(m_data), m_size);
+}
@@ -0,0 +1,45 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Read-only memory mapping of a whole file.  Mapping costs the same for a
+// few bytes or many gigabytes; pages are read from disk only when touched.
+// The contents never change through this object, so any thread may read
+// them.
+//
+// If another process truncates the file, touching a page past the new end
+// raises SIGBUS.  Reads that must survive that go through guarded().
+class MappedFile {
+public:
+    // Returns nullptr if the file cannot be opened or mapped.
+    static std::shared_ptr<const MappedFile> open(const std::string& path);
+
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char* data() const { return m_data; }
+    std::uint64_t size() const { return m_size; }
+
+    // Runs `fn`, which reads from data(), and returns false if it touched
+    // a page the file no longer has.  `fn` is abandoned at the fault, so it
+    // must not own anything that needs cleaning up: plain reads, memcpy,
+    // memmem.
+    template <typename Fn>
+    bool guarded(Fn&& fn) const {
+        return runGuarded([](void* f) { (*static_cast<Fn*>(f))(); }, &fn);
+    }
+
+private:
+    MappedFile() = default;
+
+    static bool runGuarded(void (*fn)(void*), void* arg);
+
+    const unsigned char* m_data = nullptr;
+    std::uint64_t m_size = 0;
+};
+
+#endif // MAPPEDFILE_H
@@ -0,0 +1,262 @@
+#include "OverviewRuler.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string_view>
+
+namespace {
+
+// Read at a time by a pass over the file on disk.
+constexpr std::size_t FILE_BLOCK_BYTES = 1 << 20;
+
+std::uint32_t lineHash(const std::string& text) {
+    return static_cast<std::uint32_t>(std::hash<std::string_view>{}(text));
+}
+
+std::uint8_t lineDensity(const std::string& text) {
+    std::size_t n = 0;
+    for (unsigned char c : text) {
+        if (!std::isspace(c) && ++n == UINT8_MAX) break;
+    }
+    return static_cast<std::uint8_t>(n);
+}
+
+} // namespace
+
+OverviewRuler::~OverviewRuler() {
+    if (m_pass) m_pass->token.cancel();
+}
+
+void OverviewRuler::sync(EditorBuffer& buffer, std::shared_ptr<const LineMatcher> matcher) {
+    if (m_pass && m_pass->done) adoptPass();
+    if (m_pass) return;
+    const bool from_file = !BufferPolicy::overviewFromText(buffer.mode);
+    const bool summarized = m_pass_started != std::chrono::steady_clock::time_point{};
+    if (summarized && buffer.version == m_version && buffer.changed == m_changed && matcher == m_matcher &&
+        from_file == m_from_file) {
+        return;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    if (summarized && now - m_pass_started < (from_file ? FILE_PASS_INTERVAL : TEXT_PASS_INTERVAL)) return;
+    if (from_file && buffer.file_id == INVALID_FILE_ID) return;   // nothing on disk to read
+    m_pass_started = now;
+    startPass(buffer, std::move(matcher));
+}
+
+void OverviewRuler::startPass(EditorBuffer& buffer, std::shared_ptr<const LineMatcher> matcher) {
+    auto pass = std::make_shared<Pass>();
+    pass->version = buffer.version;
+    if (BufferPolicy::overviewFromText(buffer.mode)) pass->snapshot = buffer.snapshot();
+    else pass->path = PathRegistry::instance().path(buffer.file_id);
+    pass->matcher = std::move(matcher);
+    pass->previous = m_summaries;
+    pass->baseline = m_baseline;
+    pass->saved = !buffer.changed;
+    m_pass = pass;
+
+    TaskScheduler::instance().submit(TaskLane::Background,
+        [pass](const CancellationToken& token) {
+            if (pass->snapshot) run(*pass, token);
+            else runFile(*pass, token);
+        }, pass->token);
+}
+
+void OverviewRuler::run(Pass& pass, const CancellationToken& token) {
+    const BufferSnapshot& snap = *pass.snapshot;
+    auto summaries = std::make_shared<Summaries>();
+    summaries->reserve(snap.chunkCount());
+
+    for (std::size_t c = 0; c < snap.chunkCount(); ++c) {
+        if (token.cancelled()) return;
+        const auto& chunk = snap.chunk(c);
+        std::shared_ptr<const ChunkSummary> old;
+        if (pass.previous) {
+            auto it = pass.previous->find(chunk.get());
+            if (it != pass.previous->end()) old = it->second;
+        }
+        if (old && old->matcher == pass.matcher) {
+            (*summaries)[chunk.get()] = std::move(old);
+            continue;
+        }
+
+        auto summary = std::make_shared<ChunkSummary>();
+        summary->chunk = chunk;
+        summary->matcher = pass.matcher;
+        if (old) {
+            // Only the search term changed
+            summary->density = old->density;
+            summary->hash = old->hash;
+        } else {
+            summary->density.reserve(chunk->size());
+            summary->hash.reserve(chunk->size());
+            for (const std::string& line : *chunk) {
+                summary->density.push_back(lineDensity(line));
+                summary->hash.push_back(lineHash(line));
+            }
+        }
+        if (pass.matcher) {
+            summary->hits.reserve(chunk->size());
+            for (const std::string& line : *chunk) {
+                summary->hits.push_back(static_cast<std::uint16_t>(std::min<std::size_t>(pass.matcher->count(line), UINT16_MAX)));
+            }
+        }
+        (*summaries)[chunk.get()] = std::move(summary);
+    }
+
+    if (pass.saved) {
+        auto baseline = std::make_shared<Baseline>();
+        baseline->snapshot = pass.snapshot;
+        baseline->chunks.reserve(summaries->size());
+        baseline->sorted_hashes.reserve(snap.lineCount());
+        for (const auto& [chunk, summary] : *summaries) {
+            baseline->chunks.insert(chunk);
+            baseline->sorted_hashes.insert(baseline->sorted_hashes.end(), summary->hash.begin(), summary->hash.end());
+        }
+        std::sort(baseline->sorted_hashes.begin(), baseline->sorted_hashes.end());
+        pass.new_baseline = std::move(baseline);
+    }
+
+    // Fold the lines into bins.  A line counts as changed if no line of the
+    // baseline has its text; chunks the baseline shares, wherever they sit
+    // now, are skipped whole.
+    const std::size_t n = snap.lineCount();
+    const std::size_t bin_count = std::min(n, MAX_BINS);
+    std::vector<Bin> bins(bin_count);
+    const Baseline* baseline = pass.saved ? nullptr : pass.baseline.get();
+    std::size_t line = 0;
+    for (std::size_t c = 0; c < snap.chunkCount(); ++c) {
+        const auto& chunk = snap.chunk(c);
+        const ChunkSummary& summary = *summaries->at(chunk.get());
+        const bool unchanged = !baseline || baseline->chunks.count(chunk.get()) != 0;
+        for (std::size_t i = 0; i < chunk->size(); ++i, ++line) {
+            Bin& bin = bins[(std::uint64_t)line * bin_count / n];
+            ++bin.lines;
+            bin.chars += summary.density[i];
+            if (!summary.hits.empty()) bin.hits += summary.hits[i];
+            if (!unchanged && !bin.changed &&
+                !std::binary_search(baseline->sorted_hashes.begin(), baseline->sorted_hashes.end(), summary.hash[i])) {
+                bin.changed = true;
+            }
+        }
+        if (token.cancelled()) return;
+    }
+
+    pass.summaries = std::move(summaries);
+    pass.bins = std::move(bins);
+    pass.line_count = n;
+    pass.done = true;
+}
+
+// Summarizes the file behind a buffer too large to snapshot.  Lines go to
+// the bin of the byte they start at, so bins cover equal parts of the file
+// rather than equal numbers of lines.
+void OverviewRuler::runFile(Pass& pass, const CancellationToken& token) {
+    std::error_code ec;
+    const std::uint64_t size = std::filesystem::file_size(pass.path, ec);
+    std::ifstream in(pass.path, std::ios::binary);
+    const std::size_t bin_count = (ec || !in) ? 0 : static_cast<std::size_t>(std::min<std::uint64_t>(size, MAX_BINS));
+    std::vector<Bin> bins(bin_count);
+
+    std::uint64_t offset = 0, line_start = 0;
+    std::size_t lines = 0, density = 0;
+    std::string text;   // only kept for the search term
+    auto endLine = [&]() {
+        Bin& bin = bins[line_start * bin_count / size];
+        ++bin.lines;
+        bin.chars += static_cast<std::uint32_t>(std::min<std::size_t>(density, UINT8_MAX));
+        if (pass.matcher) bin.hits += static_cast<std::uint32_t>(std::min<std::size_t>(pass.matcher->count(text), UINT16_MAX));
+        ++lines;
+        density = 0;
+        text.clear();
+    };
+
+    std::vector<char> block(FILE_BLOCK_BYTES);
+    while (bin_count > 0 && offset < size) {
+        if (token.cancelled()) return;
+        in.read(block.data(), static_cast<std::streamsize>(std::min<std::uint64_t>(block.size(), size - offset)));
+        const std::size_t got = static_cast<std::size_t>(in.gcount());
+        if (got == 0) break;   // truncated meanwhile
+        std::size_t from = 0;
+        for (std::size_t i = 0; i < got; ++i) {
+            const unsigned char c = static_cast<unsigned char>(block[i]);
+            if (c == '\n') {
+                if (pass.matcher) text.append(block.data() + from, i - from);
+                endLine();
+                from = i + 1;
+                line_start = offset + i + 1;
+            } else if (!std::isspace(c)) {
+                ++density;
+            }
+        }
+        if (pass.matcher) text.append(block.data() + from, got - from);
+        offset += got;
+    }
+    if (bin_count > 0 && offset > line_start) endLine();
+
+    pass.bins = std::move(bins);
+    pass.line_count = lines;
+    pass.done = true;
+}
+
+void OverviewRuler::adoptPass() {
+    std::shared_ptr<Pass> pass = std::move(m_pass);
+    m_version = pass->version;
+    m_changed = !pass->saved;
+    m_from_file = !pass->snapshot;
+    m_matcher = pass->matcher;
+    m_summaries = pass->summaries;
+    if (pass->new_baseline) m_baseline = pass->new_baseline;
+    m_bins = std::move(pass->bins);
+    m_bin_first_line.resize(m_bins.size());
+    std::size_t lines = 0;
+    for (std::size_t b = 0; b < m_bins.size(); ++b) {
+        m_bin_first_line[b] = lines;
+        lines += m_bins[b].lines;
+    }
+    m_line_count = pass->line_count;
+    m_track_height = -1;
+}
+
+const std::vector<OverviewRuler::Row>& OverviewRuler::track(int height) {
+    if (height == m_track_height) return m_track;
+    m_track_height = height;
+    m_track.assign(std::max(height, 0), Row{});
+    const std::size_t bin_count = m_bins.size();
+    if (bin_count == 0 || height <= 0) return m_track;
+
+    const std::size_t h = static_cast<std::size_t>(height);
+    for (std::size_t r = 0; r < h; ++r) {
+        std::size_t lo = r * bin_count / h;
+        std::size_t hi = std::max((r + 1) * bin_count / h, lo + 1);
+        Bin sum;
+        for (std::size_t b = lo; b < hi && b < bin_count; ++b) {
+            sum.lines += m_bins[b].lines;
+            sum.chars += m_bins[b].chars;
+            sum.hits += m_bins[b].hits;
+            sum.changed = sum.changed || m_bins[b].changed;
+        }
+        Row& row = m_track[r];
+        row.density = static_cast<std::uint8_t>(sum.lines ? std::min<std::uint32_t>(sum.chars / sum.lines, UINT8_MAX) : 0);
+        row.mark = sum.hits ? Mark::Hit : sum.changed ? Mark::Change : Mark::None;
+    }
+    return m_track;
+}
+
+int OverviewRuler::rowOfLine(int line_num, int height) const {
+    const std::size_t bin_count = m_bins.size();
+    if (bin_count == 0 || height <= 0) return 0;
+    std::size_t line = std::min<std::size_t>(std::max(line_num - 1, 0), m_line_count - 1);
+    // The last bin starting at or before the line; bins without a line of
+    // their own (inside one long line) start where the next one does
+    std::size_t bin = static_cast<std::size_t>(
+        std::upper_bound(m_bin_first_line.begin(), m_bin_first_line.end(), line) - m_bin_first_line.begin()) - 1;
+    const std::size_t h = static_cast<std::size_t>(height);
+    // With fewer bins than rows a bin spans several rows: take its first.
+    // Otherwise take the row whose range of bins holds it, as in track().
+    std::size_t row = bin_count < h ? (bin * h + bin_count - 1) / bin_count
+                                     : ((bin + 1) * h + bin_count - 1) / bin_count - 1;
+    return static_cast<int>(std::min(row, h - 1));
+}
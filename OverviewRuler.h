@@ -0,0 +1,126 @@
+#ifndef OVERVIEWRULER_H
+#define OVERVIEWRULER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "EditorBuffer.h"
+#include "SearchEngine.h"
+#include "TaskScheduler.h"
+
+// Summary of a whole buffer for the overview column next to the text: how
+// much code each part of the file holds, where the search term occurs and
+// which lines differ from the file on disk.
+//
+// A background pass reads a BufferSnapshot chunk by chunk and keeps the
+// per-line results of every chunk; the next pass reuses them for chunks the
+// new snapshot shares with the old one, so an edit only costs the chunks it
+// touched.  The lines are then folded into at most MAX_BINS bins, and a
+// track of any height is built from the bins, never from the text.
+//
+// Buffers whose mode does not allow per-line work (BufferPolicy) are never
+// snapshotted: their pass reads the file on disk instead, in bins of equal
+// byte ranges, and shows no change marks.
+class OverviewRuler {
+public:
+    static constexpr std::size_t MAX_BINS = 2048;
+    // Each pass reads the whole text, so one starts at most this often
+    static constexpr std::chrono::milliseconds TEXT_PASS_INTERVAL{250};
+    static constexpr std::chrono::milliseconds FILE_PASS_INTERVAL{2000};
+
+    // In order of precedence when several fall on one row.
+    enum class Mark : std::uint8_t { None, Change, Hit, Warning, Error };
+
+    struct Row {
+        std::uint8_t density = 0;   // average non-blank characters per line, capped
+        Mark mark = Mark::None;
+    };
+
+    OverviewRuler() = default;
+    ~OverviewRuler();
+    OverviewRuler(const OverviewRuler&) = delete;
+    OverviewRuler& operator=(const OverviewRuler&) = delete;
+
+    // Takes the result of a finished pass and starts the next one if the
+    // text, its saved state or the search term changed.  Only one pass runs
+    // at a time, and not more often than the interval of its kind, so a
+    // buffer that changes continuously (a followed log) costs a bounded
+    // share of the UI thread.  UI thread only.
+    void sync(EditorBuffer& buffer, std::shared_ptr<const LineMatcher> matcher);
+
+    // One Row per cell of a track `height` cells high, the summarized lines
+    // spread evenly over it.  Cached until the next result or height change.
+    const std::vector<Row>& track(int height);
+    // Track row of 1-based line `line_num`.
+    int rowOfLine(int line_num, int height) const;
+
+    bool ready() const { return m_line_count > 0; }
+
+private:
+    struct ChunkSummary {
+        std::shared_ptr<const BufferSnapshot::Chunk> chunk;
+        std::shared_ptr<const LineMatcher> matcher;   // what `hits` were counted for
+        std::vector<std::uint8_t> density;
+        std::vector<std::uint32_t> hash;
+        std::vector<std::uint16_t> hits;
+    };
+    using Summaries = std::unordered_map<const BufferSnapshot::Chunk*, std::shared_ptr<const ChunkSummary>>;
+
+    // The text as last loaded or saved, for the change marks.
+    struct Baseline {
+        BufferSnapshotPtr snapshot;
+        std::unordered_set<const BufferSnapshot::Chunk*> chunks;   // of `snapshot`
+        std::vector<std::uint32_t> sorted_hashes;
+    };
+
+    struct Bin {
+        std::uint32_t lines = 0;
+        std::uint32_t chars = 0;
+        std::uint32_t hits = 0;
+        bool changed = false;
+    };
+
+    // Shared between the background pass and the UI thread.
+    struct Pass {
+        CancellationToken token;
+        std::uint64_t version = 0;
+        BufferSnapshotPtr snapshot;
+        std::string path;           // read instead of a snapshot
+        std::shared_ptr<const LineMatcher> matcher;
+        std::shared_ptr<const Summaries> previous;
+        std::shared_ptr<const Baseline> baseline;
+        bool saved = false;         // no unsaved edits: the text becomes the baseline
+        std::shared_ptr<const Summaries> summaries;
+        std::shared_ptr<const Baseline> new_baseline;
+        std::vector<Bin> bins;
+        std::size_t line_count = 0;
+        std::atomic<bool> done{false};
+    };
+
+    static void run(Pass& pass, const CancellationToken& token);
+    static void runFile(Pass& pass, const CancellationToken& token);
+    void startPass(EditorBuffer& buffer, std::shared_ptr<const LineMatcher> matcher);
+    void adoptPass();
+
+    std::uint64_t m_version = 0;
+    bool m_changed = false;
+    bool m_from_file = false;
+    std::shared_ptr<const LineMatcher> m_matcher;
+    std::shared_ptr<const Summaries> m_summaries;
+    std::shared_ptr<const Baseline> m_baseline;
+    std::vector<Bin> m_bins;
+    std::vector<std::size_t> m_bin_first_line;   // lines before each bin
+    std::size_t m_line_count = 0;
+    std::shared_ptr<Pass> m_pass;
+    std::chrono::steady_clock::time_point m_pass_started;
+
+    int m_track_height = -1;
+    std::vector<Row> m_track;
+};
+
+#endif // OVERVIEWRULER_H
@@ -0,0 +1,125 @@
+#include "PathRegistry.h"
+
+#include <filesystem>
+#include <mutex>
+
+namespace fs = std::filesystem;
+
+PathRegistry& PathRegistry::instance() {
+    static PathRegistry registry;
+    return registry;
+}
+
+std::string PathRegistry::absoluteSpelling(const std::string& path) {
+    std::string trimmed = path;
+    trimmed.erase(0, trimmed.find_first_not_of(" \t\n\r\f\v"));
+    trimmed.erase(trimmed.find_last_not_of(" \t\n\r\f\v") + 1);
+
+    fs::path p(trimmed);
+    if (!p.is_absolute()) {
+        std::error_code ec;
+        p = fs::absolute(p, ec);
+    }
+    return p.lexically_normal().string();
+}
+
+PathRegistry::Entry PathRegistry::resolve(const std::string& absolute) {
+    Entry e;
+    std::error_code ec;
+    fs::path canonical = fs::canonical(absolute, ec);
+    if (!ec) {
+        e.canonical = canonical.string();
+        e.resolved  = true;
+    } else {
+        e.canonical = absolute;
+    }
+    return e;
+}
+
+FileId PathRegistry::intern(const std::string& path) {
+    if (path.empty()) return INVALID_FILE_ID;
+    std::string spelling = absoluteSpelling(path);
+
+    {
+        std::shared_lock lock(m_mutex);
+        auto it = m_by_spelling.find(spelling);
+        if (it != m_by_spelling.end() && !m_entries[it->second].stale) return it->second;
+    }
+
+    // Resolve outside the lock: canonical() does the lstat/readlink work.
+    Entry resolved = resolve(spelling);
+
+    std::unique_lock lock(m_mutex);
+    auto sp = m_by_spelling.find(spelling);
+    if (sp != m_by_spelling.end()) {
+        refreshLocked(sp->second);
+        return sp->second;
+    }
+    auto it = m_by_canonical.find(resolved.canonical);
+    if (it != m_by_canonical.end()) {
+        m_by_spelling[spelling] = it->second;
+        return it->second;
+    }
+    FileId id = static_cast<FileId>(m_entries.size());
+    m_entries.push_back(resolved);
+    m_by_canonical[resolved.canonical] = id;
+    m_by_spelling[spelling] = id;
+    return id;
+}
+
+void PathRegistry::refreshLocked(FileId id) const {
+    Entry& e = m_entries[id];
+    if (!e.stale) return;
+    Entry fresh = resolve(e.canonical);
+    if (fresh.canonical != e.canonical) {
+        m_by_canonical.erase(e.canonical);
+        m_by_canonical[fresh.canonical] = id;
+    }
+    e = fresh;
+}
+
+std::string PathRegistry::path(FileId id) const {
+    {
+        std::shared_lock lock(m_mutex);
+        if (id == INVALID_FILE_ID || id >= m_entries.size()) return "";
+        if (!m_entries[id].stale) return m_entries[id].canonical;
+    }
+    std::unique_lock lock(m_mutex);
+    refreshLocked(id);
+    return m_entries[id].canonical;
+}
+
+std::string PathRegistry::filename(FileId id) const {
+    return fs::path(path(id)).filename().string();
+}
+
+bool PathRegistry::exists(FileId id) const {
+    path(id); // refresh if stale
+    std::shared_lock lock(m_mutex);
+    return id != INVALID_FILE_ID && id < m_entries.size() && m_entries[id].resolved;
+}
+
+void PathRegistry::invalidate(FileId id) {
+    std::unique_lock lock(m_mutex);
+    if (id == INVALID_FILE_ID || id >= m_entries.size()) return;
+    m_entries[id].stale = true;
+}
+
+void PathRegistry::rename(FileId id, const std::string& new_path) {
+    std::string spelling = absoluteSpelling(new_path);
+    Entry resolved = resolve(spelling);
+
+    std::unique_lock lock(m_mutex);
+    if (id == INVALID_FILE_ID || id >= m_entries.size()) return;
+
+    // Aliases of the old location no longer name this file
+    for (auto it = m_by_spelling.begin(); it != m_by_spelling.end();) {
+        if (it->second == id) it = m_by_spelling.erase(it);
+        else ++it;
+    }
+    m_by_canonical.erase(m_entries[id].canonical);
+
+    m_entries[id] = resolved;
+    m_by_canonical[resolved.canonical] = id;
+    m_by_spelling[spelling] = id;
+}
@@ -0,0 +1,70 @@
+#ifndef PATHREGISTRY_H
+#define PATHREGISTRY_H
+
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+// Stable handle for a file path.  Two spellings of the same file ("./a.cpp",
+// "/home/u/proj/a.cpp", "src/../a.cpp") intern to the same FileId, so path
+// comparisons anywhere in the editor are integer compares.
+using FileId = std::uint32_t;
+constexpr FileId INVALID_FILE_ID = 0;
+
+// Process-wide path interning service.
+//
+// The canonical path of each file is resolved once (fs::canonical) when it is
+// first interned and then served from the cache; repaint and lookups never
+// touch the filesystem.  An entry is only re-resolved after invalidate() (the
+// file appeared, disappeared or was moved behind our back) or rename().
+//
+// All methods are thread-safe.
+class PathRegistry {
+public:
+    static PathRegistry& instance();
+
+    // Returns the id for `path`, creating an entry on first sight.
+    // Relative paths are resolved against the current working directory.
+    FileId intern(const std::string& path);
+
+    // Canonical absolute path of `id`.  For files that do not exist (yet) this
+    // is the lexically normalised absolute path.
+    std::string path(FileId id) const;
+
+    // Last path component of the canonical path.
+    std::string filename(FileId id) const;
+
+    // True if the canonical path could be resolved on disk.
+    bool exists(FileId id) const;
+
+    // Drops the cached resolution; the entry is re-canonicalised on the next
+    // intern()/path() call.  Use after a file has been created or removed.
+    void invalidate(FileId id);
+
+    // The file behind `id` now lives at `new_path` (explicit rename or a move
+    // reported by a file watch).  Keeps the id stable.
+    void rename(FileId id, const std::string& new_path);
+
+private:
+    PathRegistry() = default;
+
+    struct Entry {
+        std::string canonical;
+        bool resolved = false;
+        bool stale    = false;
+    };
+
+    static std::string absoluteSpelling(const std::string& path);
+    static Entry resolve(const std::string& absolute);
+    void refreshLocked(FileId id) const;
+
+    mutable std::shared_mutex m_mutex;
+    // Index 0 is reserved for INVALID_FILE_ID.
+    mutable std::deque<Entry> m_entries{Entry{}};
+    std::unordered_map<std::string, FileId> m_by_spelling;
+    mutable std::unordered_map<std::string, FileId> m_by_canonical;
+};
+
+#endif // PATHREGISTRY_H
@@ -0,0 +1,50 @@
+#include "ProgressDialog.h"
+#include "utils.h"
+#include <ncurses.h>
+#include <algorithm>
+
+bool ProgressDialog::show(Renderer& renderer, const std::string& title, const std::string& label,
+                          const std::function<bool()>& finished,
+                          const std::function<std::pair<std::size_t, std::size_t>()>& progress,
+                          const std::function<void()>& cancel) {
+    const int w = 50, h = 8;
+    int starty = (renderer.getHeight() - h) / 2;
+    int startx = (renderer.getWidth() - w) / 2;
+
+    WINDOW* behind = newwin(h + 1, w + 1, starty, startx);
+    copywin(stdscr, behind, starty, startx, 0, 0, h, w, FALSE);
+
+    renderer.drawShadow(startx, starty, w, h);
+    renderer.drawBoxWithTitle(startx, starty, w, h, Renderer::CP_DIALOG, Renderer::DOUBLE, " " + title + " ", Renderer::CP_DIALOG_TITLE, A_BOLD);
+    renderer.hideCursor();
+
+    bool cancelled = false;
+    timeout(50);
+    while (!finished()) {
+        auto [done, total] = progress();
+        std::string status = cancelled ? "Cancelling..." : label + " " + formatCount(done) + " of " + formatCount(total);
+        renderer.drawText(startx + 2, starty + 2, std::string(w - 4, ' '), Renderer::CP_DIALOG);
+        renderer.drawText(startx + 2, starty + 2, status.substr(0, w - 4), Renderer::CP_DIALOG);
+
+        const int bar_w = w - 4;
+        int filled = total ? (int)((double)done / total * bar_w) : 0;
+        renderer.drawText(startx + 2, starty + 3, std::string(bar_w, ' '), Renderer::CP_LIST_BOX);
+        renderer.drawText(startx + 2, starty + 3, std::string(std::min(filled, bar_w), ' '), Renderer::CP_MENU_SELECTED);
+
+        renderer.drawButton(startx + (w - 10) / 2, starty + h - 3, " &Cancel ", true, cancelled);
+        renderer.refresh();
+
+        wint_t ch = renderer.getChar();
+        if (!cancelled && (ch == 27 || ch == KEY_ENTER || ch == 10 || ch == 13 || tolower(ch) == 'c')) {
+            cancelled = true;
+            cancel();
+        }
+    }
+    timeout(-1);
+
+    copywin(behind, stdscr, 0, 0, starty, startx, h, w, FALSE);
+    delwin(behind);
+    nodelay(stdscr, TRUE);
+    renderer.showCursor();
+    return !cancelled;
+}
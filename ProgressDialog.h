@@ -0,0 +1,21 @@
+#ifndef PROGRESSDIALOG_H
+#define PROGRESSDIALOG_H
+
+#include "Renderer.h"
+#include <cstddef>
+#include <functional>
+#include <string>
+
+// Modal box with a progress bar for work running on the TaskScheduler.
+// Polls `progress` until `finished` returns true; Esc or the Cancel button
+// calls `cancel` and keeps waiting until the work has wound down.  Returns
+// false if the user cancelled.
+class ProgressDialog {
+public:
+    static bool show(Renderer& renderer, const std::string& title, const std::string& label,
+                     const std::function<bool()>& finished,
+                     const std::function<std::pair<std::size_t, std::size_t>()>& progress,
+                     const std::function<void()>& cancel);
+};
+
+#endif // PROGRESSDIALOG_H
@@ -0,0 +1,323 @@
+#include "ProjectReplace.h"
+#include "BufferPolicy.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Bytes looked at to tell a binary file from text
+constexpr std::size_t BINARY_PROBE = 8192;
+
+bool readFile(const std::string& path, std::string& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return !in.bad();
+}
+
+bool looksBinary(const std::string& content) {
+    return std::memchr(content.data(), '\0', std::min(content.size(), BINARY_PROBE)) != nullptr;
+}
+
+// Calls fn(line_num, text) for every line of `content`; the '\r' of a CRLF
+// ending stays with the line.
+template <typename Fn>
+void forEachLine(const std::string& content, Fn fn) {
+    std::size_t start = 0;
+    for (int line_num = 1; start < content.size(); ++line_num) {
+        std::size_t end = content.find('\n', start);
+        if (end == std::string::npos) end = content.size();
+        fn(line_num, std::string_view(content).substr(start, end - start));
+        start = end + 1;
+    }
+}
+
+// Occurrences in one line, non-overlapping, left to right.
+void collectHits(const LineMatcher& matcher, int line_num, std::string_view text, std::vector<ReplaceHit>& hits) {
+    for (std::size_t from = 0; ; ) {
+        auto [pos, len] = matcher.find(text, from);
+        if (pos == std::string_view::npos) break;
+        std::string_view shown = text;
+        if (!shown.empty() && shown.back() == '\r') shown.remove_suffix(1);
+        hits.push_back({line_num, pos, std::string(shown), true});
+        from = pos + std::max<std::size_t>(len, 1);
+    }
+}
+
+bool skippedDirectory(const fs::path& dir) {
+    std::string name = dir.filename().string();
+    return (!name.empty() && name[0] == '.') || name == "build" || name.rfind("cmake-build", 0) == 0;
+}
+
+} // namespace
+
+ProjectReplace::ProjectReplace(std::string term, std::string replacement)
+    : m_term(std::move(term)), m_replacement(std::move(replacement)),
+      m_matcher(std::make_shared<const LineMatcher>(m_term, false)) {}
+
+ProjectReplace::~ProjectReplace() {
+    cancel();
+}
+
+void ProjectReplace::cancel() {
+    if (m_job) m_job->token.cancel();
+}
+
+std::vector<std::string> ProjectReplace::projectFiles(const GediProject& project) {
+    std::set<std::string> seen;
+    std::vector<std::string> files;
+    auto add = [&](const std::string& rel) {
+        std::string path = (fs::path(project.root) / rel).lexically_normal().string();
+        if (seen.insert(path).second) files.push_back(path);
+    };
+    for (const auto& target : project.targets)
+        for (const auto& src : target.sources) add(src);
+    for (const auto& src : project.sources) add(src);
+    return files;
+}
+
+std::vector<std::string> ProjectReplace::directoryFiles(const std::string& dir) {
+    std::vector<std::string> files;
+    std::error_code ec;
+    fs::recursive_directory_iterator it(dir, fs::directory_options::skip_permission_denied, ec), end;
+    for (; !ec && it != end; it.increment(ec)) {
+        if (it->is_directory(ec)) {
+            if (skippedDirectory(it->path())) it.disable_recursion_pending();
+        } else if (it->is_regular_file(ec)) {
+            files.push_back(it->path().lexically_normal().string());
+        }
+    }
+    return files;
+}
+
+void ProjectReplace::find(const std::vector<std::string>& paths, BufferManager& buffers) {
+    cancel();
+    auto job = std::make_shared<Job>();
+    job->items = paths.size();
+    job->files.resize(paths.size());
+    job->snapshots.resize(paths.size());
+    for (std::size_t i = 0; i < paths.size(); ++i) {
+        ReplaceFile& file = job->files[i];
+        file.path = paths[i];
+        file.file_id = PathRegistry::instance().intern(paths[i]);
+        int idx = buffers.findByFileId(file.file_id);
+        if (idx >= 0 && !buffers.getBuffer(idx).hex_view) {
+            file.in_buffer = true;
+            job->snapshots[i] = buffers.getBuffer(idx).snapshot();
+            file.version = job->snapshots[i]->version();
+        }
+    }
+    m_writing = false;
+    m_collected = false;
+    m_files.clear();
+    start(std::move(job), false);
+}
+
+void ProjectReplace::adopt(std::vector<ReplaceFile> files) {
+    cancel();
+    m_job.reset();
+    m_writing = false;
+    m_collected = true;
+    m_files = std::move(files);
+}
+
+void ProjectReplace::write() {
+    cancel();
+    auto job = std::make_shared<Job>();
+    for (const ReplaceFile& file : m_files) {
+        if (file.in_buffer) continue;
+        if (std::none_of(file.hits.begin(), file.hits.end(), [](const ReplaceHit& h) { return h.accepted; })) continue;
+        job->files.push_back(file);
+    }
+    job->items = job->files.size();
+    job->errors.resize(job->items);
+    m_writing = true;
+    start(std::move(job), true);
+}
+
+void ProjectReplace::start(std::shared_ptr<Job> job, bool writing) {
+    m_job = job;
+    const std::size_t batches = (job->items + BATCH_FILES - 1) / BATCH_FILES;
+    job->batches_left = batches;
+    // The tasks get no token: a cancelled batch still runs, skips its files
+    // and counts itself off, so finished() becomes true either way
+    for (std::size_t b = 0; b < batches; ++b) {
+        TaskScheduler::instance().submit(TaskLane::Background,
+            [job, b, writing, matcher = m_matcher, term_len = m_term.size(), replacement = m_replacement]
+            (const CancellationToken&) {
+                const std::size_t end = std::min(job->items, (b + 1) * BATCH_FILES);
+                for (std::size_t i = b * BATCH_FILES; i < end && !job->token.cancelled(); ++i) {
+                    if (writing) rewrite(*job, *matcher, term_len, replacement, i);
+                    else findIn(*job, *matcher, i);
+                    ++job->done;
+                }
+                --job->batches_left;
+            });
+    }
+}
+
+void ProjectReplace::findIn(Job& job, const LineMatcher& matcher, std::size_t idx) {
+    ReplaceFile& file = job.files[idx];
+    if (const BufferSnapshotPtr& snap = job.snapshots[idx]) {
+        for (std::size_t i = 0; i < snap->lineCount(); ++i)
+            collectHits(matcher, static_cast<int>(i) + 1, snap->line(i), file.hits);
+        return;
+    }
+
+    struct stat st;
+    if (::stat(file.path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) return;
+    if ((std::uintmax_t)st.st_size >= BufferPolicy::LARGE_BYTES) return;
+    std::string content;
+    if (!readFile(file.path, content) || looksBinary(content)) return;
+    file.size = st.st_size;
+    file.mtime = st.st_mtim;
+    forEachLine(content, [&](int line_num, std::string_view text) { collectHits(matcher, line_num, text, file.hits); });
+}
+
+void ProjectReplace::rewrite(Job& job, const LineMatcher& matcher, std::size_t term_len,
+                             const std::string& replacement, std::size_t idx) {
+    const ReplaceFile& file = job.files[idx];
+    std::string& error = job.errors[idx];
+
+    // The rename replaces whatever has the name, so a symlink would turn
+    // into a copy of its target: write next to the target instead
+    std::error_code ec;
+    const std::string target = fs::canonical(file.path, ec).string();
+    if (ec) {
+        error = ec.message();
+        return;
+    }
+    struct stat st;
+    std::string content;
+    if (::stat(target.c_str(), &st) != 0 || !readFile(target, content)) {
+        error = std::strerror(errno);
+        return;
+    }
+    // Nanoseconds: a second write within the same second still counts
+    if (st.st_size != file.size || st.st_mtim.tv_sec != file.mtime.tv_sec ||
+        st.st_mtim.tv_nsec != file.mtime.tv_nsec) {
+        error = "changed on disk since it was searched";
+        return;
+    }
+
+    // Rebuild the file, replacing the accepted hits that still match
+    std::string out;
+    out.reserve(content.size());
+    std::size_t count = 0;
+    auto hit = file.hits.begin();
+    std::size_t start = 0;
+    for (int line_num = 1; start <= content.size(); ++line_num) {
+        std::size_t end = content.find('\n', start);
+        const bool last = end == std::string::npos;
+        if (last) end = content.size();
+        std::string_view text = std::string_view(content).substr(start, end - start);
+        std::size_t copied = 0;
+        for (; hit != file.hits.end() && hit->line == line_num; ++hit) {
+            if (!hit->accepted || hit->col < copied || matcher.find(text, hit->col).first != hit->col) continue;
+            out.append(text.substr(copied, hit->col - copied));
+            out.append(replacement);
+            copied = hit->col + term_len;
+            ++count;
+        }
+        out.append(text.substr(copied));
+        if (last) break;
+        out.push_back('\n');
+        start = end + 1;
+    }
+    if (count == 0) return;
+
+    // Same directory, so the rename cannot cross file systems
+    std::string tmp = target + ".gedi-XXXXXX";
+    int fd = ::mkstemp(tmp.data());
+    if (fd < 0) {
+        error = std::strerror(errno);
+        return;
+    }
+    // The new file belongs to us; give it the old one's owner and group
+    // (before the mode, as chown clears set-id bits) or leave the file be
+    struct stat made;
+    bool ok = ::fstat(fd, &made) == 0;
+    if (ok && (made.st_uid != st.st_uid || made.st_gid != st.st_gid)) ok = ::fchown(fd, st.st_uid, st.st_gid) == 0;
+    ok = ok && ::fchmod(fd, st.st_mode & 07777) == 0;
+    for (std::size_t off = 0; ok && off < out.size(); ) {
+        ssize_t n = ::write(fd, out.data() + off, out.size() - off);
+        if (n < 0 && errno == EINTR) continue;
+        ok = n > 0;
+        if (ok) off += static_cast<std::size_t>(n);
+    }
+    // On disk before the rename can be: otherwise a crash may leave the
+    // name pointing at an empty or partial file
+    ok = ok && ::fsync(fd) == 0;
+    if (!ok) error = std::strerror(errno);
+    if (::close(fd) != 0 && ok) {
+        ok = false;
+        error = std::strerror(errno);
+    }
+    if (ok && ::rename(tmp.c_str(), target.c_str()) != 0) {
+        ok = false;
+        error = std::strerror(errno);
+    }
+    if (!ok) {
+        ::unlink(tmp.c_str());
+        return;
+    }
+    // And the rename itself; the file is rewritten even if this fails
+    int dir = ::open(fs::path(target).parent_path().c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir >= 0) {
+        ::fsync(dir);
+        ::close(dir);
+    }
+    job.replaced += count;
+    ++job.written;
+}
+
+int ProjectReplace::applyToBuffer(EditorBuffer& buffer, const ReplaceFile& file) const {
+    // Lines and columns are those of the searched text
+    if (buffer.version != file.version) return -1;
+    int count = 0;
+    auto hit = file.hits.rbegin();
+    int line_num = buffer.total_lines;
+    Line* p = buffer.document_head;
+    while (p && p->next) p = p->next;
+    // Bottom up, so the columns of the hits still to come stay valid
+    for (; p && hit != file.hits.rend(); p = p->prev, --line_num) {
+        for (; hit != file.hits.rend() && hit->line >= line_num; ++hit) {
+            if (hit->line != line_num || !hit->accepted) continue;
+            if (m_matcher->find(p->text, hit->col).first != hit->col) continue;
+            p->text.replace(hit->col, m_term.size(), m_replacement);
+            ++count;
+        }
+    }
+    if (count > 0) buffer.touch();
+    return count;
+}
+
+std::vector<ReplaceFile>& ProjectReplace::files() {
+    if (!m_writing && !m_collected && finished()) {
+        for (ReplaceFile& file : m_job->files) {
+            if (!file.hits.empty()) m_files.push_back(std::move(file));
+        }
+        m_collected = true;
+    }
+    return m_files;
+}
+
+std::vector<std::string> ProjectReplace::failures() const {
+    std::vector<std::string> out;
+    if (!m_writing || !m_job) return out;
+    for (std::size_t i = 0; i < m_job->items; ++i) {
+        if (!m_job->errors[i].empty()) out.push_back(m_job->files[i].path + ": " + m_job->errors[i]);
+    }
+    return out;
+}
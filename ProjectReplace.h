@@ -0,0 +1,118 @@
+#ifndef PROJECTREPLACE_H
+#define PROJECTREPLACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include "BufferManager.h"
+#include "GediProject.h"
+#include "SearchEngine.h"
+#include "TaskScheduler.h"
+
+// One occurrence of the search term.
+struct ReplaceHit {
+    int line = 0;              // 1-based
+    std::size_t col = 0;       // 0-based byte offset
+    std::string text;          // the whole line, for the preview
+    bool accepted = true;
+};
+
+// The occurrences in one file.  Files open in a buffer are searched and
+// edited there; the others on disk.
+struct ReplaceFile {
+    std::string path;
+    FileId file_id = INVALID_FILE_ID;
+    bool in_buffer = false;
+    std::uint64_t version = 0; // in_buffer: the buffer's version when searched
+    off_t size = 0;            // on-disk state when searched, to detect
+    timespec mtime{};          // a change before the file is rewritten
+    std::vector<ReplaceHit> hits;
+};
+
+// Search and replace across many files.
+//
+// find() searches the files in batches on the TaskScheduler's Background
+// lane; write() rewrites the accepted hits of files that are not open in a
+// buffer the same way, each through a temporary file renamed over the
+// original, so a file is either fully rewritten or untouched.  A symlink is
+// followed and its target replaced, with the target's mode and owner.  Both report
+// progress through done()/total(); cancel() stops them between files, and
+// finished() turns true once the files in progress are done.
+// Matching is case-insensitive, like SearchEngine::replaceAll().
+class ProjectReplace {
+public:
+    ProjectReplace(std::string term, std::string replacement);
+    ~ProjectReplace();
+    ProjectReplace(const ProjectReplace&) = delete;
+    ProjectReplace& operator=(const ProjectReplace&) = delete;
+
+    // Source files of every target of `project` (and its legacy source
+    // list), as absolute paths.
+    static std::vector<std::string> projectFiles(const GediProject& project);
+    // Regular files below `dir`, skipping hidden and build directories.
+    static std::vector<std::string> directoryFiles(const std::string& dir);
+
+    // Starts searching `paths`.  Files open in `buffers` are read from a
+    // snapshot of the buffer.  UI thread only.
+    void find(const std::vector<std::string>& paths, BufferManager& buffers);
+    // Takes hits found some other way (see SymbolRename) in place of
+    // find().  Files not in a buffer need the size and mtime they were
+    // searched at.
+    void adopt(std::vector<ReplaceFile> files);
+    // Starts rewriting the files with accepted hits that are not in a buffer.
+    void write();
+    // Replaces the accepted hits of `file` in `buffer`, right to left within
+    // each line.  Returns the number of replacements, or -1 without
+    // touching the buffer if it was edited since it was searched.  UI
+    // thread only.
+    int applyToBuffer(EditorBuffer& buffer, const ReplaceFile& file) const;
+
+    bool finished() const { return m_job && m_job->batches_left == 0; }
+    std::size_t done() const { return m_job ? m_job->done.load() : 0; }
+    std::size_t total() const { return m_job ? m_job->items : 0; }
+    void cancel();
+
+    // Files with at least one hit, in the order given to find().  Valid once
+    // find() has finished.
+    std::vector<ReplaceFile>& files();
+    std::size_t replaced() const { return m_job ? m_job->replaced.load() : 0; }
+    std::size_t filesWritten() const { return m_job ? m_job->written.load() : 0; }
+    // "path: reason" for every file write() could not rewrite.  Only once
+    // write() has finished.
+    std::vector<std::string> failures() const;
+
+private:
+    static constexpr std::size_t BATCH_FILES = 16;
+
+    // State shared with the tasks of one find() or write() pass.
+    struct Job {
+        CancellationToken token;
+        std::size_t items = 0;
+        std::atomic<std::size_t> done{0};
+        std::atomic<std::size_t> batches_left{0};
+        std::atomic<std::size_t> replaced{0};
+        std::atomic<std::size_t> written{0};
+        std::vector<ReplaceFile> files;           // one slot per item
+        std::vector<BufferSnapshotPtr> snapshots; // find(): set for files in a buffer
+        std::vector<std::string> errors;          // write(): one slot per item
+    };
+
+    static void findIn(Job& job, const LineMatcher& matcher, std::size_t idx);
+    static void rewrite(Job& job, const LineMatcher& matcher, std::size_t term_len,
+                        const std::string& replacement, std::size_t idx);
+    void start(std::shared_ptr<Job> job, bool writing);
+
+    std::string m_term;
+    std::string m_replacement;
+    std::shared_ptr<const LineMatcher> m_matcher;
+    std::shared_ptr<Job> m_job;
+    bool m_writing = false;
+    bool m_collected = false;
+    std::vector<ReplaceFile> m_files;
+};
+
+#endif // PROJECTREPLACE_H
@@ -0,0 +1,177 @@
+#include "PtyProcess.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <unistd.h>
+
+PtyProcess::~PtyProcess() {
+    if (m_pid > 0 && !m_reaped) {
+        if (::kill(-m_pid, SIGKILL) != 0) ::kill(m_pid, SIGKILL);
+        ::waitpid(m_pid, nullptr, 0);
+    }
+    if (m_fd >= 0) ::close(m_fd);
+}
+
+bool PtyProcess::start(const std::vector<std::string>& argv, const std::string& dir, int rows, int cols,
+                       const std::vector<std::string>& env) {
+    if (started() || argv.empty()) return false;
+
+    int fd = ::posix_openpt(O_RDWR | O_NOCTTY);
+    char slave_name[128];
+    if (fd < 0) return false;
+    if (::grantpt(fd) != 0 || ::unlockpt(fd) != 0 || ::ptsname_r(fd, slave_name, sizeof(slave_name)) != 0) {
+        ::close(fd);
+        return false;
+    }
+    ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+    struct winsize ws{};
+    ws.ws_row = static_cast<unsigned short>(rows);
+    ws.ws_col = static_cast<unsigned short>(cols);
+    ::ioctl(fd, TIOCSWINSZ, &ws);
+
+    // Everything the child needs is built before fork()
+    std::vector<char*> args;
+    for (const std::string& arg : argv) args.push_back(const_cast<char*>(arg.c_str()));
+    args.push_back(nullptr);
+    std::vector<char*> envp;
+    for (const std::string& var : env) envp.push_back(const_cast<char*>(var.c_str()));
+    for (char** var = environ; *var; ++var) {
+        const char* eq = std::strchr(*var, '=');
+        const std::size_t name_len = eq ? static_cast<std::size_t>(eq - *var) + 1 : std::strlen(*var);
+        bool overridden = std::any_of(env.begin(), env.end(),
+            [&](const std::string& e) { return e.compare(0, name_len, *var, name_len) == 0; });
+        if (!overridden) envp.push_back(*var);
+    }
+    envp.push_back(nullptr);
+
+    pid_t pid = ::fork();
+    if (pid < 0) {
+        ::close(fd);
+        return false;
+    }
+    if (pid == 0) {
+        // A session of its own, with the slave as its controlling terminal
+        ::setsid();
+        int slave = ::open(slave_name, O_RDWR);
+        if (slave < 0) ::_exit(127);
+        ::ioctl(slave, TIOCSCTTY, 0);
+        ::dup2(slave, STDIN_FILENO);
+        ::dup2(slave, STDOUT_FILENO);
+        ::dup2(slave, STDERR_FILENO);
+        if (slave > STDERR_FILENO) ::close(slave);
+        for (int sig : {SIGINT, SIGQUIT, SIGPIPE, SIGTSTP, SIGCHLD, SIGWINCH}) ::signal(sig, SIG_DFL);
+        if (!dir.empty() && ::chdir(dir.c_str()) != 0) ::_exit(127);
+        ::execvpe(args[0], args.data(), envp.data());
+        ::_exit(127);
+    }
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    m_pid = pid;
+    m_fd = fd;
+    m_started = std::chrono::steady_clock::now();
+    return true;
+}
+
+std::size_t PtyProcess::read(std::string& out, std::size_t max_bytes) {
+    if (m_fd < 0) return 0;
+    reap();
+    const bool exited = m_reaped;
+    flush();
+
+    char buf[16384];
+    std::size_t got = 0;
+    bool drained = false;
+    while (got < max_bytes && !m_eof) {
+        ssize_t n = ::read(m_fd, buf, std::min(sizeof(buf), max_bytes - got));
+        if (n > 0) {
+            out.append(buf, static_cast<std::size_t>(n));
+            got += static_cast<std::size_t>(n);
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            drained = true;
+            break;
+        } else {
+            m_eof = true;   // EIO once no process has the slave open any more
+        }
+    }
+
+    if (!m_reaped && m_kill_at != std::chrono::steady_clock::time_point{} &&
+        std::chrono::steady_clock::now() >= m_kill_at) {
+        ::kill(-m_pid, SIGKILL);
+        m_kill_at = {};
+    }
+    // Something the child started may still hold the terminal open; it is
+    // not waited for once the child itself is gone and the output is read
+    if (exited && (m_eof || drained)) {
+        m_finished = true;
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    return got;
+}
+
+void PtyProcess::write(std::string_view bytes) {
+    if (m_fd < 0) return;
+    m_pending.append(bytes);
+    flush();
+}
+
+void PtyProcess::flush() {
+    while (!m_pending.empty()) {
+        ssize_t n = ::write(m_fd, m_pending.data(), m_pending.size());
+        if (n > 0) {
+            m_pending.erase(0, static_cast<std::size_t>(n));
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) m_pending.clear();   // nobody is reading
+            break;
+        }
+    }
+}
+
+void PtyProcess::resize(int rows, int cols) {
+    if (m_fd < 0 || rows <= 0 || cols <= 0) return;
+    struct winsize ws{};
+    ws.ws_row = static_cast<unsigned short>(rows);
+    ws.ws_col = static_cast<unsigned short>(cols);
+    ::ioctl(m_fd, TIOCSWINSZ, &ws);
+}
+
+void PtyProcess::terminate() {
+    if (m_pid <= 0 || m_reaped) return;
+    // Just after start() the child may not have made its session yet
+    if (::kill(-m_pid, SIGTERM) != 0) ::kill(m_pid, SIGTERM);
+    m_kill_at = std::chrono::steady_clock::now() + KILL_GRACE;
+}
+
+void PtyProcess::reap() {
+    if (m_pid <= 0 || m_reaped) return;
+    if (::waitpid(m_pid, &m_status, WNOHANG) == m_pid) {
+        m_reaped = true;
+        m_ended = std::chrono::steady_clock::now();
+    }
+}
+
+std::string PtyProcess::exitDescription() const {
+    if (!m_finished) return {};
+    if (WIFEXITED(m_status)) return "exited with status " + std::to_string(WEXITSTATUS(m_status));
+    if (WIFSIGNALED(m_status)) {
+        const char* name = ::strsignal(WTERMSIG(m_status));
+        return "killed by signal " + std::to_string(WTERMSIG(m_status)) + (name ? " (" + std::string(name) + ")" : "");
+    }
+    return "ended";
+}
+
+std::chrono::steady_clock::duration PtyProcess::elapsed() const {
+    if (m_pid <= 0) return {};
+    return (m_reaped ? m_ended : std::chrono::steady_clock::now()) - m_started;
+}
@@ -0,0 +1,72 @@
+#ifndef PTYPROCESS_H
+#define PTYPROCESS_H
+
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+#include <vector>
+
+// A child process whose stdin, stdout and stderr are the slave side of a
+// pseudo-terminal, so it sees a terminal: line editing, Ctrl+C turning into
+// SIGINT, output that is line buffered rather than held back until exit.
+//
+// Nothing blocks.  The owner calls read() once per main loop iteration to
+// collect a bounded amount of output and write() to send keys; the child is
+// reaped there too.  It runs in a session of its own, so terminate()
+// reaches everything it started.
+class PtyProcess {
+public:
+    PtyProcess() = default;
+    ~PtyProcess();
+    PtyProcess(const PtyProcess&) = delete;
+    PtyProcess& operator=(const PtyProcess&) = delete;
+
+    // Runs `argv` (argv[0] looked up in PATH) in `dir`, on a terminal of
+    // `rows` x `cols`.  `env` entries ("NAME=value") are added to the
+    // editor's environment.  Returns false if no pseudo-terminal or process
+    // could be created; a program that cannot be executed exits with 127.
+    bool start(const std::vector<std::string>& argv, const std::string& dir, int rows, int cols,
+               const std::vector<std::string>& env = {});
+
+    // Appends at most `max_bytes` of output to `out` and returns how much.
+    // Once the child has exited and its output is drained, finished() turns
+    // true.
+    std::size_t read(std::string& out, std::size_t max_bytes);
+    // Queues bytes for the child's input; what the terminal cannot take yet
+    // is written by later calls to read() or write().
+    void write(std::string_view bytes);
+    void resize(int rows, int cols);
+
+    // Sends SIGTERM to the child's session, and SIGKILL if it is still
+    // there KILL_GRACE later.
+    void terminate();
+
+    bool started() const { return m_pid > 0; }
+    bool finished() const { return m_finished; }
+    // "exited with status 1", "killed by signal 9 (Killed)"; empty until
+    // finished().
+    std::string exitDescription() const;
+    int exitStatus() const { return m_status; }   // as from waitpid()
+    // Time since start(), frozen once finished.
+    std::chrono::steady_clock::duration elapsed() const;
+
+private:
+    static constexpr std::chrono::seconds KILL_GRACE{2};
+
+    void flush();
+    void reap();
+
+    pid_t m_pid = -1;
+    int m_fd = -1;                 // master side
+    bool m_reaped = false;
+    bool m_eof = false;            // the master reported end of output
+    bool m_finished = false;
+    int m_status = 0;
+    std::string m_pending;         // input not yet written
+    std::chrono::steady_clock::time_point m_started;
+    std::chrono::steady_clock::time_point m_ended;
+    std::chrono::steady_clock::time_point m_kill_at{};   // set by terminate()
+};
+
+#endif // PTYPROCESS_H
@@ -0,0 +1,66 @@
+#include "RenameDialog.h"
+
+RenameDialog::RenameDialog(const std::string& current_name)
+    : DialogBase("Rename Symbol", /*w=*/50, /*h=*/10)
+    , current_name_(current_name)
+    , name_buf_    (current_name)
+{}
+
+std::string RenameDialog::show(Renderer& renderer, const std::string& current_name)
+{
+    RenameDialog dlg(current_name);
+    DialogResult r = dlg.run(renderer);
+    if (r.cancelled()) return "";
+    return r["name"];
+}
+
+void RenameDialog::onInit()
+{
+    setFocusCount(static_cast<int>(Focus::_count));
+    setFocus(static_cast<int>(Focus::INPUTFIELD));
+    setButtonRowFocusIndex(static_cast<int>(Focus::BTN_ROW));
+
+    // ── Input field ───────────────────────────────────────────────────────────
+    addInput({
+        .focus_index  = static_cast<int>(Focus::INPUTFIELD),
+        .field_x = 3, .field_y = 4, .field_w = 44,
+        .label   = "",   // drawn dynamically in onDraw
+        .label_x = 0, .label_y = 0,
+        .buffer  = name_buf_,
+    });
+
+    // ── Button row ────────────────────────────────────────────────────────────
+    addButtons(ButtonRow{
+        .buttons = {
+            Button{
+                .label = " &Rename ",
+                .x = 11, .y = 7,
+                .on_activate = [this]() -> HandleResult {
+                    result().accept();
+                    result().set("name", name_buf_);
+                    return HandleResult::CLOSE;
+                }
+            },
+            Button{
+                .label = " &Cancel ",
+                .x = 27, .y = 7,
+                .on_activate = [this]() -> HandleResult {
+                    result().cancel();
+                    return HandleResult::CLOSE;
+                }
+            },
+        }
+    });
+
+    // ── Arrow-key navigation ──────────────────────────────────────────────────
+    nav_.link(Direction::DOWN,  Focus::INPUTFIELD, Focus::BTN_ROW)
+        .link(Direction::UP,    Focus::BTN_ROW,    Focus::INPUTFIELD);
+    setNavigation(nav_);
+}
+
+void RenameDialog::onDraw(Renderer& renderer, int startx, int starty)
+{
+    std::string label = "Rename '" + current_name_ + "' to:";
+    if ((int)label.size() > 44) label = "New name:";
+    renderer.drawText(startx + 3, starty + 2, label, Renderer::CP_DIALOG);
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include "DialogBase.h"
+#include "Renderer.h"
+#include <string>
+
+class RenameDialog : private DialogBase {
+public:
+    // Returns the new name, or "" if cancelled.
+    static std::string show(Renderer& renderer, const std::string& current_name);
+
+private:
+    explicit RenameDialog(const std::string& current_name);
+
+    void onInit() override;
+    void onDraw(Renderer& renderer, int startx, int starty) override;
+
+    // INPUTFIELD + BTN_ROW (the whole button row is one tab stop)
+    DeclareCyclicEnum(Focus, INPUTFIELD, BTN_ROW);
+
+    std::string current_name_;
+    std::string name_buf_;
+    NavigationGraph<Focus> nav_;
+};
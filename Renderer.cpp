@@ -37,12 +37,15 @@ Renderer::Renderer() {
         {"keyword", CP_SYNTAX_KEYWORD}, {"comment", CP_SYNTAX_COMMENT},
         {"string", CP_SYNTAX_STRING}, {"number", CP_SYNTAX_NUMBER}, {"preprocessor", CP_SYNTAX_PREPROCESSOR},
         {"register_variable", CP_SYNTAX_REGISTER_VAR},
+        {"type", CP_SYNTAX_TYPE}, {"member", CP_SYNTAX_MEMBER},
+        {"macro", CP_SYNTAX_MACRO}, {"enum_constant", CP_SYNTAX_ENUM_CONSTANT},
         // Add new mappings for gutter and buttons
         {"gutter_bg", CP_GUTTER_BG}, {"gutter_fg", CP_GUTTER_FG},
         {"button_bg", CP_BUTTON_BG}, {"button_text", CP_BUTTON_TEXT},
         {"button_hotkey", CP_BUTTON_HOTKEY}, {"button_selected_bg", CP_BUTTON_SELECTED_BG},
         {"button_selected_text", CP_BUTTON_SELECTED_TEXT}, {"button_selected_hotkey", CP_BUTTON_SELECTED_HOTKEY},
-        {"button_shadow", CP_BUTTON_SHADOW}
+        {"button_shadow", CP_BUTTON_SHADOW}, {"search_match", CP_SEARCH_MATCH},
+        {"bracket_match", CP_BRACKET_MATCH}
     };
 }
 
@@ -58,7 +61,9 @@ void Renderer::drawText(int x, int y, const std::string &text, int colorId, int
     wattron(stdscr, COLOR_PAIR(colorId));
     if (flags & A_BOLD) wattron(stdscr, A_BOLD);
     if (flags & A_UNDERLINE) wattron(stdscr, A_UNDERLINE);
+    if (flags & A_REVERSE) wattron(stdscr, A_REVERSE);
     mvwaddstr(stdscr, y, x, text.c_str());
+    if (flags & A_REVERSE) wattroff(stdscr, A_REVERSE);
     if (flags & A_UNDERLINE) wattroff(stdscr, A_UNDERLINE);
     if (flags & A_BOLD) wattroff(stdscr, A_BOLD);
     wattroff(stdscr, COLOR_PAIR(colorId));
@@ -177,8 +182,25 @@ int Renderer::getStyleFlags(ColorPairID id) const {
     return 0;
 }
 
+int Renderer::terminalPair(int fg, int bg) {
+    const int key = (fg + 1) * 17 + bg + 1;
+    auto it = m_terminal_pairs.find(key);
+    if (it != m_terminal_pairs.end()) return it->second;
+
+    const int pair = TERMINAL_PAIR_BASE + (int)m_terminal_pairs.size();
+    if (pair >= COLOR_PAIRS) return CP_DEFAULT_TEXT;
+    short default_fg, default_bg;
+    pair_content(CP_DEFAULT_TEXT, &default_fg, &default_bg);
+    // Bright colours fall back to the normal ones on 8-colour terminals
+    auto color = [](int c, short fallback) { return c < 0 ? fallback : (short)(c < COLORS ? c : c % 8); };
+    init_pair(pair, color(fg, default_fg), color(bg, default_bg));
+    m_terminal_pairs[key] = pair;
+    return pair;
+}
+
 void Renderer::loadColors(const json &theme_data) {
     m_style_attributes.clear();
+    m_terminal_pairs.clear();   // the default colours may change
 
     auto init_colors_from_json = [&](const json& j) {
         for (auto const& [key, val] : j.items()) {
@@ -205,6 +227,27 @@ void Renderer::loadColors(const json &theme_data) {
     init_pair(CP_COMPILE_ERROR, COLOR_RED, dialog_bg);
     init_pair(CP_COMPILE_WARNING, COLOR_YELLOW, dialog_bg);
     init_pair(CP_DEFAULT_ON_SELECTION, default_fg, sel_bg);
+    // Other matches of the search term, for themes that don't define them
+    if (!theme_data.contains("ui") || !theme_data["ui"].contains("search_match")) {
+        init_pair(CP_SEARCH_MATCH, COLOR_BLACK, COLOR_YELLOW);
+    }
+    // The bracket at the cursor and its partner
+    if (!theme_data.contains("ui") || !theme_data["ui"].contains("bracket_match")) {
+        init_pair(CP_BRACKET_MATCH, COLOR_BLACK, COLOR_CYAN);
+    }
+    // Semantic colours: macros and enum constants look like the preprocessor
+    // and numbers, types and members get a colour of their own
+    auto syntax_default = [&](const char* key, ColorPairID id, ColorPairID like, short fg) {
+        if (theme_data.contains("syntax") && theme_data["syntax"].contains(key)) return;
+        short like_fg, like_bg;
+        pair_content(like, &like_fg, &like_bg);
+        init_pair(id, fg < 0 ? like_fg : fg, like_bg);
+        if (m_style_attributes.count(like) && fg < 0) m_style_attributes[id] = m_style_attributes[like];
+    };
+    syntax_default("type", CP_SYNTAX_TYPE, CP_DEFAULT_TEXT, COLOR_GREEN);
+    syntax_default("member", CP_SYNTAX_MEMBER, CP_DEFAULT_TEXT, COLOR_CYAN);
+    syntax_default("macro", CP_SYNTAX_MACRO, CP_SYNTAX_PREPROCESSOR, -1);
+    syntax_default("enum_constant", CP_SYNTAX_ENUM_CONSTANT, CP_SYNTAX_NUMBER, -1);
 
     // Ensure shadows blend correctly with their respective backgrounds
     short shadow_fg, shadow_bg;
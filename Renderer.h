@@ -41,7 +41,13 @@ public:
         CP_GUTTER_BG,
         CP_GUTTER_FG,
         CP_BUTTON_BG,
-        CP_BUTTON_SELECTED_BG
+        CP_BUTTON_SELECTED_BG,
+        CP_SEARCH_MATCH,
+        CP_BRACKET_MATCH,
+        CP_SYNTAX_TYPE,
+        CP_SYNTAX_MEMBER,
+        CP_SYNTAX_MACRO,
+        CP_SYNTAX_ENUM_CONSTANT
     };
 
     enum BoxStyle { SINGLE, DOUBLE };
@@ -65,6 +71,10 @@ public:
     int getHeight() const;
     void setCursor(int x, int y);
     int getStyleFlags(ColorPairID id) const;
+    // Colour pair for a terminal cell: `fg` and `bg` are ANSI colours 0-15
+    // or -1 for the editor's default text colours.  Pairs are made on first
+    // use; CP_DEFAULT_TEXT once the terminal has no more.
+    int terminalPair(int fg, int bg);
     void loadColors();
     void loadColors(const json& theme_data);
     void createDefaultColorsFile();
@@ -74,6 +84,8 @@ private:
     std::map<std::string, int> m_color_map;
     std::map<std::string, int> m_color_pair_map;
     std::map<Renderer::ColorPairID, int> m_style_attributes;
+    static constexpr int TERMINAL_PAIR_BASE = 64;   // after the ColorPairIDs
+    std::map<int, int> m_terminal_pairs;            // (fg + 1) * 17 + bg + 1 -> pair
 
 };
 
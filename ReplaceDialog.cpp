@@ -2,7 +2,7 @@
 
 ReplaceDialog::ReplaceDialog(const std::string& initial_find,
                              const std::string& initial_replace)
-    : DialogBase("Replace", /*w=*/55, /*h=*/10)
+    : DialogBase("Replace", /*w=*/62, /*h=*/10)
     , find_buf_   (initial_find)
     , replace_buf_(initial_replace)
 {}
@@ -24,25 +24,25 @@ void ReplaceDialog::onInit()
     // ── Inputs ────────────────────────────────────────────────────────────────
     addInput({
         .focus_index = static_cast<int>(Focus::FIND),
-        .field_x = 17, .field_y = 2, .field_w = 35,
+        .field_x = 17, .field_y = 2, .field_w = 42,
         .label   = "Find what:",
         .label_x = 3, .label_y = 2,
         .buffer  = find_buf_,
     });
     addInput({
         .focus_index = static_cast<int>(Focus::REPLACE),
-        .field_x = 17, .field_y = 4, .field_w = 35,
+        .field_x = 17, .field_y = 4, .field_w = 42,
         .label   = "Replace with:",
         .label_x = 3, .label_y = 4,
         .buffer  = replace_buf_,
     });
 
-    // ── Button row (all three buttons share one Tab stop) ─────────────────────
+    // ── Button row (all four buttons share one Tab stop) ─────────────────────
     addButtons(ButtonRow{
         .buttons = {
             Button{
                 .label = " &Replace ",
-                .x = 4, .y = 7,
+                .x = 3, .y = 7,
                 .on_activate = [this]() -> HandleResult {
                     result().accept();
                     result().set("action",  "replace");
@@ -53,7 +53,7 @@ void ReplaceDialog::onInit()
             },
             Button{
                 .label = " Replace &All ",
-                .x = 18, .y = 7,
+                .x = 16, .y = 7,
                 .on_activate = [this]() -> HandleResult {
                     result().accept();
                     result().set("action",  "replace_all");
@@ -62,9 +62,20 @@ void ReplaceDialog::onInit()
                     return HandleResult::CLOSE;
                 }
             },
+            Button{
+                .label = " In &Files ",
+                .x = 33, .y = 7,
+                .on_activate = [this]() -> HandleResult {
+                    result().accept();
+                    result().set("action",  "replace_files");
+                    result().set("find",    find_buf_);
+                    result().set("replace", replace_buf_);
+                    return HandleResult::CLOSE;
+                }
+            },
             Button{
                 .label = " &Cancel ",
-                .x = 41, .y = 7,
+                .x = 48, .y = 7,
                 .on_activate = [this]() -> HandleResult {
                     result().cancel();
                     return HandleResult::CLOSE;
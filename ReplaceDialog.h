@@ -15,7 +15,7 @@ private:
     void onInit() override;
     void onDraw(Renderer& renderer, int startx, int starty) override;
 
-    // FIND + REPLACE inputs + BTN_ROW (all three buttons are one tab stop)
+    // FIND + REPLACE inputs + BTN_ROW (all four buttons are one tab stop)
     DeclareCyclicEnum(Focus, FIND, REPLACE, BTN_ROW);
 
     std::string find_buf_;
@@ -0,0 +1,125 @@
+#include "ReplacePreviewDialog.h"
+#include "utils.h"
+#include <algorithm>
+
+// ── helpers ───────────────────────────────────────────────────────────────────
+
+// Cuts `s` to at most `width` bytes without splitting a UTF-8 sequence.
+static std::string clip(const std::string& s, int width)
+{
+    if ((int)s.size() <= width) return s;
+    int end = std::max(width, 0);
+    while (end > 0 && (static_cast<unsigned char>(s[end]) & 0xC0) == 0x80) --end;
+    return s.substr(0, end);
+}
+
+// "  42: text of the line", indentation dropped and tabs shown as spaces.
+static std::string hitLabel(const ReplaceHit& hit, int width)
+{
+    std::string text = hit.text;
+    std::replace(text.begin(), text.end(), '\t', ' ');
+    std::size_t first = text.find_first_not_of(' ');
+    text.erase(0, first == std::string::npos ? text.size() : first);
+    std::string num = std::to_string(hit.line);
+    if (num.size() < 5) num.insert(0, 5 - num.size(), ' ');
+    return clip(num + ": " + text, width);
+}
+
+// The tail of a long path, which is the part that tells files apart.
+static std::string fileLabel(const ReplaceFile& file, int width)
+{
+    std::string tag = file.in_buffer ? "  [open]" : "";
+    int room = width - (int)tag.size();
+    std::string path = file.path;
+    if ((int)path.size() > room && room > 3) {
+        std::size_t from = path.size() - (room - 3);
+        while (from < path.size() && (static_cast<unsigned char>(path[from]) & 0xC0) == 0x80) ++from;
+        path = "..." + path.substr(from);
+    }
+    return path + tag;
+}
+
+// ── Constructor / factory ─────────────────────────────────────────────────────
+
+ReplacePreviewDialog::ReplacePreviewDialog(const std::string& title, std::vector<ReplaceFile>& files,
+                                           int w, int h)
+    : DialogBase(title, w, h)
+    , files_ (files)
+    , width_ (w)
+    , height_(h)
+{
+    for (const ReplaceFile& f : files_) hit_count_ += f.hits.size();
+}
+
+bool ReplacePreviewDialog::show(Renderer& renderer, const std::string& title, std::vector<ReplaceFile>& files)
+{
+    int w = std::min(renderer.getWidth() - 4, 100);
+    int h = std::max(renderer.getHeight() - 4, 12);
+    ReplacePreviewDialog dlg(title, files, w, h);
+    return dlg.run(renderer).accepted();
+}
+
+// ── onInit ────────────────────────────────────────────────────────────────────
+
+void ReplacePreviewDialog::onInit()
+{
+    {
+        FocusGroup g;
+        g.title = ""; g.hotkey = '\0';
+        g.box_w = 0; g.box_h = 0; g.box_x = 0; g.box_y = 0;
+        OptionList ol;
+        ol.x = 2; ol.y = LIST_Y;
+        ol.visible_rows = height_ - LIST_Y - 4;
+        const int label_w = width_ - 10;
+        for (ReplaceFile& file : files_) {
+            std::string group = fileLabel(file, width_ - 8);
+            for (ReplaceHit& hit : file.hits)
+                ol.options.push_back({ hitLabel(hit, label_w), group, false, 0, &hit.accepted, nullptr });
+        }
+        g.optionlists.push_back(std::move(ol));
+        addGroup(std::move(g));
+    }
+
+    const int btn_y = height_ - 3;
+    addButtons(ButtonRow{
+        .buttons = {
+            Button{
+                .label = " &Replace ",
+                .x = width_/2 - 12, .y = btn_y,
+                .on_activate = [this]() -> HandleResult {
+                    result().accept();
+                    return HandleResult::CLOSE;
+                }
+            },
+            Button{
+                .label = " &Cancel ",
+                .x = width_/2 + 2, .y = btn_y,
+                .on_activate = [this]() -> HandleResult {
+                    result().cancel();
+                    return HandleResult::CLOSE;
+                }
+            },
+        }
+    });
+
+    setGroupFocus(0);
+    setGroupBtnFocus(0);
+}
+
+// ── onDraw ────────────────────────────────────────────────────────────────────
+
+void ReplacePreviewDialog::onDraw(Renderer& renderer, int startx, int starty)
+{
+    std::size_t accepted = 0, in_files = 0;
+    for (const ReplaceFile& f : files_) {
+        std::size_t n = std::count_if(f.hits.begin(), f.hits.end(),
+                                      [](const ReplaceHit& h) { return h.accepted; });
+        accepted += n;
+        if (n) ++in_files;
+    }
+    std::string summary = "Replace " + formatCount(accepted) + " of " + formatCount(hit_count_) +
+                          " matches in " + formatCount(in_files) + (in_files == 1 ? " file" : " files") +
+                          "   (Space toggles)";
+    renderer.drawText(startx + 2, starty + 1, std::string(width_ - 4, ' '), Renderer::CP_DIALOG);
+    renderer.drawText(startx + 2, starty + 1, clip(summary, width_ - 4), Renderer::CP_DIALOG);
+}
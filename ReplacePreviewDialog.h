@@ -0,0 +1,32 @@
+#pragma once
+#include "DialogBase.h"
+#include "ProjectReplace.h"
+#include "Renderer.h"
+#include <string>
+#include <vector>
+
+// ═══════════════════════════════════════════════════════════════════════════════
+// ReplacePreviewDialog
+//
+// Lists every hit of a project-wide replace or rename, grouped by file, each with a
+// checkbox.  Unticking a hit clears its `accepted` flag in place; Replace
+// accepts the dialog, Cancel or Esc leaves the files alone.
+// ═══════════════════════════════════════════════════════════════════════════════
+
+class ReplacePreviewDialog : private DialogBase {
+public:
+    static bool show(Renderer& renderer, const std::string& title, std::vector<ReplaceFile>& files);
+
+private:
+    ReplacePreviewDialog(const std::string& title, std::vector<ReplaceFile>& files, int w, int h);
+
+    void onInit() override;
+    void onDraw(Renderer& renderer, int startx, int starty) override;
+
+    static constexpr int LIST_Y = 3;
+
+    std::vector<ReplaceFile>& files_;
+    int width_;
+    int height_;
+    std::size_t hit_count_ = 0;
+};
@@ -0,0 +1,83 @@
+#include "Scrollback.h"
+
+#include <algorithm>
+
+Scrollback::Scrollback(std::size_t capacity) : m_lines(std::max<std::size_t>(capacity, 1)) {}
+
+void Scrollback::clear() {
+    for (std::string& l : m_lines) l.clear();
+    m_head = 0;
+    m_count = 1;
+    m_dropped = 0;
+    m_col = 0;
+    m_escape = Escape::NONE;
+}
+
+const std::string& Scrollback::line(std::uint64_t num) const {
+    static const std::string none;
+    if (num < first() || num >= end()) return none;
+    return m_lines[(m_head + (num - m_dropped)) % m_lines.size()];
+}
+
+void Scrollback::newLine() {
+    if (m_count < m_lines.size()) {
+        ++m_count;
+    } else {
+        m_head = (m_head + 1) % m_lines.size();
+        ++m_dropped;
+    }
+    last().clear();
+    m_col = 0;
+}
+
+void Scrollback::append(std::string_view bytes) {
+    for (char c : bytes) {
+        // Escape sequences: CSI ends at a final byte in @..~, OSC (window
+        // titles) at BEL or ESC \, anything else after ESC is one byte
+        switch (m_escape) {
+        case Escape::NONE:
+            break;
+        case Escape::ESC:
+            m_escape = c == '[' ? Escape::CSI : c == ']' ? Escape::OSC : Escape::NONE;
+            continue;
+        case Escape::CSI:
+            if (c >= '@' && c <= '~') m_escape = Escape::NONE;
+            continue;
+        case Escape::OSC:
+            if (c == '\a') m_escape = Escape::NONE;
+            else if (c == '\033') m_escape = Escape::OSC_ESC;
+            continue;
+        case Escape::OSC_ESC:
+            m_escape = c == '\\' ? Escape::NONE : Escape::OSC;
+            continue;
+        }
+
+        std::string& text = last();
+        switch (c) {
+        case '\033': m_escape = Escape::ESC; break;
+        case '\n': newLine(); break;
+        case '\r': m_col = 0; break;
+        case '\b': if (m_col > 0) --m_col; break;
+        case '\t': {
+            std::size_t stop = (m_col / 8 + 1) * 8;
+            while (m_col < stop) {
+                if (m_col < text.size()) text[m_col] = ' ';
+                else text.push_back(' ');
+                ++m_col;
+            }
+            break;
+        }
+        default:
+            if (static_cast<unsigned char>(c) < 0x20 || c == 0x7f) break;   // bell and other controls
+            if (m_col >= MAX_LINE_BYTES) {
+                newLine();
+                last().push_back(c);
+                m_col = 1;
+                break;
+            }
+            if (m_col < text.size()) text[m_col] = c;
+            else text.push_back(c);
+            ++m_col;
+        }
+    }
+}
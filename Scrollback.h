@@ -0,0 +1,49 @@
+#ifndef SCROLLBACK_H
+#define SCROLLBACK_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The last `capacity` lines of a program's terminal output.
+//
+// Lines live in a ring: once it is full, each new line takes the slot (and
+// the string's allocation) of the oldest, so memory stays bounded however
+// long the program runs.  Lines are numbered from the start of the output;
+// the ones that fell off the top keep their numbers, which lets a view or a
+// search result stay put while more output arrives.
+//
+// append() acts like a plain teletype: '\r' returns to the start of the
+// line, so progress bars overwrite themselves, '\b' steps back, tabs are
+// expanded and escape sequences (colours, cursor movement) are dropped.
+class Scrollback {
+public:
+    static constexpr std::size_t MAX_LINE_BYTES = 4096;   // longer lines are broken
+
+    explicit Scrollback(std::size_t capacity = 10000);
+
+    void append(std::string_view bytes);
+    void clear();
+
+    // Numbers of the oldest line still kept and one past the newest.  There
+    // is always at least one line (the one being written).
+    std::uint64_t first() const { return m_dropped; }
+    std::uint64_t end() const { return m_dropped + m_count; }
+    const std::string& line(std::uint64_t num) const;
+
+private:
+    enum class Escape { NONE, ESC, CSI, OSC, OSC_ESC };
+
+    std::string& last() { return m_lines[(m_head + m_count - 1) % m_lines.size()]; }
+    void newLine();
+
+    std::vector<std::string> m_lines;
+    std::size_t m_head = 0;        // slot of the oldest line
+    std::size_t m_count = 1;
+    std::uint64_t m_dropped = 0;
+    std::size_t m_col = 0;         // write position in the last line
+    Escape m_escape = Escape::NONE;
+};
+
+#endif // SCROLLBACK_H
@@ -1,6 +1,56 @@
 #include "SearchEngine.h"
 #include <algorithm>
 
+namespace {
+
+inline char foldCase(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+} // namespace
+
+std::size_t LineMatcher::FoldHash::operator()(char c) const {
+    return static_cast<unsigned char>(foldCase(c));
+}
+
+bool LineMatcher::FoldEqual::operator()(char a, char b) const {
+    return foldCase(a) == foldCase(b);
+}
+
+LineMatcher::LineMatcher(const std::string& term, bool regex) : m_term(term) {
+    if (regex) {
+        m_regex.emplace(m_term, std::regex::ECMAScript | std::regex::icase | std::regex::optimize);
+    } else {
+        m_searcher.emplace(m_term.cbegin(), m_term.cend());
+    }
+}
+
+std::pair<std::size_t, std::size_t> LineMatcher::find(std::string_view text, std::size_t from) const {
+    const auto none = std::make_pair(std::string_view::npos, std::size_t{0});
+    if (from > text.size()) return none;
+
+    if (m_regex) {
+        std::cmatch m;
+        auto flags = from > 0 ? std::regex_constants::match_prev_avail : std::regex_constants::match_default;
+        if (!std::regex_search(text.data() + from, text.data() + text.size(), m, *m_regex, flags)) return none;
+        return { from + static_cast<std::size_t>(m.position(0)), static_cast<std::size_t>(m.length(0)) };
+    }
+
+    if (m_term.empty()) return none;
+    auto [first, last] = (*m_searcher)(text.begin() + from, text.end());
+    if (first == text.end()) return none;
+    return { static_cast<std::size_t>(first - text.begin()), m_term.size() };
+}
+
+std::size_t LineMatcher::count(std::string_view text, std::size_t end) const {
+    std::size_t n = 0;
+    for (std::size_t from = 0; ; ++n) {
+        auto [pos, len] = find(text, from);
+        if (pos == std::string_view::npos || pos >= end) return n;
+        from = pos + std::max<std::size_t>(len, 1);
+    }
+}
+
 SearchResult SearchEngine::search(EditorBuffer& buffer, const std::string& term, Line* startLine, int startLineNum, int startCol, bool forward) {
     SearchResult result;
     if (term.empty()) return result;
@@ -61,6 +111,89 @@ SearchResult SearchEngine::search(EditorBuffer& buffer, const std::string& term,
     return result;
 }
 
+SearchResult IncrementalSearch::find(EditorBuffer& buffer, const std::string& term, Line* start_line, int start_line_num, int start_col) {
+    if (term.empty()) return {};
+    // Every occurrence of an extension is an occurrence of the term, so
+    // after a term overflowed its extensions are not collected either
+    const bool extends = term.compare(0, m_term.size(), m_term) == 0;
+    if (m_overflowed && m_buffer == &buffer && m_version == buffer.version && extends) {
+        return SearchEngine::search(buffer, term, start_line, start_line_num, start_col, true);
+    }
+    const bool same_text = m_valid && m_buffer == &buffer && m_version == buffer.version;
+    if (same_text && term.size() > m_term.size() && term.compare(0, m_term.size(), m_term) == 0) {
+        refine(term);
+    } else if (!same_text || term != m_term) {
+        scan(buffer, term);
+    }
+    if (!m_valid) return SearchEngine::search(buffer, term, start_line, start_line_num, start_col, true);
+    if (m_candidates.empty()) return {};
+
+    // First candidate at or after the start, wrapping round to the top
+    auto it = std::lower_bound(m_candidates.begin(), m_candidates.end(), std::make_pair(start_line_num, start_col),
+        [](const Candidate& c, const std::pair<int, int>& pos) {
+            return c.line_num < pos.first || (c.line_num == pos.first && c.col < pos.second);
+        });
+    const Candidate& hit = it != m_candidates.end() ? *it : m_candidates.front();
+    SearchResult result;
+    result.line = hit.line;
+    result.line_num = hit.line_num;
+    result.col = hit.col + 1;
+    result.found = true;
+    return result;
+}
+
+void IncrementalSearch::reset() {
+    m_buffer = nullptr;
+    m_valid = false;
+    m_overflowed = false;
+    m_term.clear();
+    m_candidates.clear();
+    m_candidates.shrink_to_fit();
+}
+
+void IncrementalSearch::scan(EditorBuffer& buffer, const std::string& term) {
+    m_buffer = &buffer;
+    m_version = buffer.version;
+    m_term = term;
+    m_valid = true;
+    m_overflowed = false;
+    m_candidates.clear();
+
+    const LineMatcher matcher(term, false);
+    int line_num = 1;
+    for (Line* p = buffer.document_head; p; p = p->next, ++line_num) {
+        // Overlapping occurrences too: "aa" in "aaa" is a candidate for "aaa"
+        for (std::size_t from = 0; ; ) {
+            std::size_t pos = matcher.find(p->text, from).first;
+            if (pos == std::string_view::npos) break;
+            if (m_candidates.size() == MAX_CANDIDATES) {
+                m_valid = false;
+                m_overflowed = true;
+                m_candidates.clear();
+                m_candidates.shrink_to_fit();
+                return;
+            }
+            m_candidates.push_back({p, line_num, static_cast<int>(pos)});
+            from = pos + 1;
+        }
+    }
+}
+
+void IncrementalSearch::refine(const std::string& term) {
+    // Every match of `term` starts where its prefix m_term matched
+    const std::size_t known = m_term.size();
+    auto gone = [&](const Candidate& c) {
+        const std::string& text = c.line->text;
+        if (c.col + term.size() > text.size()) return true;
+        for (std::size_t i = known; i < term.size(); ++i) {
+            if (foldCase(text[c.col + i]) != foldCase(term[i])) return true;
+        }
+        return false;
+    };
+    m_candidates.erase(std::remove_if(m_candidates.begin(), m_candidates.end(), gone), m_candidates.end());
+    m_term = term;
+}
+
 int SearchEngine::replaceAll(EditorBuffer& buffer, const std::string& searchTerm, const std::string& replaceTerm) {
     if (searchTerm.empty()) return 0;
 
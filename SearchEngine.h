@@ -1,7 +1,13 @@
 #ifndef SEARCHENGINE_H
 #define SEARCHENGINE_H
 
+#include <functional>
+#include <optional>
+#include <regex>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 #include "EditorBuffer.h"
 
 struct SearchResult {
@@ -11,6 +17,68 @@ struct SearchResult {
     bool found = false;
 };
 
+// A compiled search term: a case-insensitive substring (Boyer-Moore-Horspool)
+// or an ECMAScript regex, also case-insensitive.  Compiled once and then only
+// read, so one matcher can be shared by any number of worker threads.  The
+// searcher points into m_term, hence no copies.
+class LineMatcher {
+public:
+    // Throws std::regex_error for an invalid pattern.
+    LineMatcher(const std::string& term, bool regex);
+    LineMatcher(const LineMatcher&) = delete;
+    LineMatcher& operator=(const LineMatcher&) = delete;
+
+    // Offset and length of the first match starting at or after `from`;
+    // offset is npos when there is none.
+    std::pair<std::size_t, std::size_t> find(std::string_view text, std::size_t from = 0) const;
+    bool matches(std::string_view text) const { return find(text).first != std::string_view::npos; }
+    // Non-overlapping matches starting before offset `end`, left to right.
+    std::size_t count(std::string_view text, std::size_t end = std::string_view::npos) const;
+
+private:
+    struct FoldHash  { std::size_t operator()(char c) const; };
+    struct FoldEqual { bool operator()(char a, char b) const; };
+    using Searcher = std::boyer_moore_horspool_searcher<std::string::const_iterator, FoldHash, FoldEqual>;
+
+    std::string m_term;
+    std::optional<Searcher> m_searcher;
+    std::optional<std::regex> m_regex;
+};
+
+// Search-as-you-type over one buffer.  The first search collects every
+// position where the term occurs; when the next term extends it ("vec" ->
+// "vect"), only those positions are checked again instead of the whole
+// buffer.  Any other term, or an edit of the buffer, starts from a full scan.
+// A term found too often to collect is remembered, and it and its
+// extensions are searched plainly until the text or the term changes.
+class IncrementalSearch {
+public:
+    // Same result as SearchEngine::search(buffer, term, start_line,
+    // start_line_num, start_col, true).
+    SearchResult find(EditorBuffer& buffer, const std::string& term, Line* start_line, int start_line_num, int start_col);
+    void reset();
+
+private:
+    // Beyond this many candidates a plain search is cheaper than keeping them
+    static constexpr std::size_t MAX_CANDIDATES = 1u << 20;
+
+    struct Candidate {
+        Line* line;
+        int line_num;
+        int col;        // 0-based
+    };
+
+    void scan(EditorBuffer& buffer, const std::string& term);
+    void refine(const std::string& term);
+
+    const EditorBuffer* m_buffer = nullptr;
+    std::uint64_t m_version = 0;
+    std::string m_term;
+    bool m_valid = false;
+    bool m_overflowed = false;             // m_term had more than MAX_CANDIDATES
+    std::vector<Candidate> m_candidates;   // in document order
+};
+
 class SearchEngine {
 public:
     static SearchResult search(EditorBuffer& buffer, const std::string& term, Line* startLine, int startLineNum, int startCol, bool forward = true);
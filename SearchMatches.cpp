@@ -0,0 +1,123 @@
+#include "SearchMatches.h"
+
+#include <algorithm>
+#include <functional>
+#include <string_view>
+
+namespace {
+
+std::uint32_t lineHash(const std::string& text) {
+    return static_cast<std::uint32_t>(std::hash<std::string_view>{}(text));
+}
+
+} // namespace
+
+SearchMatches::~SearchMatches() {
+    if (m_count) m_count->token.cancel();
+}
+
+void SearchMatches::sync(EditorBuffer& buffer, std::shared_ptr<const LineMatcher> matcher, int line_num, int col) {
+    if (matcher != m_matcher) {
+        if (m_count) { m_count->token.cancel(); m_count.reset(); }
+        m_matcher = std::move(matcher);
+        m_lines.clear();
+        m_chunks.reset();
+        m_counted = false;
+        m_total = m_before = 0;
+    }
+    m_version = buffer.version;
+    if (!m_matcher) return;
+
+    if (m_count && m_count->done) adoptCount();
+    if (m_count) return;
+    if (m_counted && m_counted_version == buffer.version && m_counted_line == line_num && m_counted_col == col) return;
+
+    auto count = std::make_shared<Count>();
+    count->snapshot = buffer.snapshot();
+    count->matcher = m_matcher;
+    count->line = static_cast<std::size_t>(std::max(line_num - 1, 0));
+    count->col = static_cast<std::size_t>(std::max(col - 1, 0));
+    count->previous = m_chunks;
+    m_count = count;
+    m_counted_version = buffer.version;
+    m_counted_line = line_num;
+    m_counted_col = col;
+
+    TaskScheduler::instance().submit(TaskLane::Background,
+        [count](const CancellationToken& token) { run(*count, token); }, count->token);
+}
+
+void SearchMatches::run(Count& count, const CancellationToken& token) {
+    const BufferSnapshot& snap = *count.snapshot;
+    const LineMatcher& matcher = *count.matcher;
+    auto chunks = std::make_shared<ChunkCounts>();
+    chunks->reserve(snap.chunkCount());
+
+    std::size_t first = 0;   // index of the chunk's first line
+    for (std::size_t c = 0; c < snap.chunkCount(); ++c) {
+        if (token.cancelled()) return;
+        const auto& chunk = snap.chunk(c);
+        const bool holds_position = count.line >= first && count.line < first + chunk->size();
+
+        std::size_t matches = 0;
+        auto cached = count.previous ? count.previous->find(chunk.get()) : ChunkCounts::const_iterator{};
+        if (count.previous && cached != count.previous->end() && !holds_position) {
+            matches = cached->second.matches;
+        } else {
+            for (std::size_t i = 0; i < chunk->size(); ++i) {
+                const std::string& text = (*chunk)[i];
+                std::size_t n = matcher.count(text);
+                if (holds_position && first + i < count.line) count.before += n;
+                else if (holds_position && first + i == count.line) count.before += matcher.count(text, count.col);
+                matches += n;
+            }
+        }
+        if (first + chunk->size() <= count.line) count.before += matches;
+
+        (*chunks)[chunk.get()] = ChunkCount{chunk, matches};
+        count.total += matches;
+        first += chunk->size();
+    }
+
+    count.chunks = std::move(chunks);
+    count.done = true;
+}
+
+void SearchMatches::adoptCount() {
+    std::shared_ptr<Count> count = std::move(m_count);
+    m_chunks = count->chunks;
+    m_total = count->total;
+    m_before = count->before;
+    m_counted = true;
+}
+
+const std::vector<SearchMatches::Span>& SearchMatches::inLine(const Line* line) {
+    static const std::vector<Span> none;
+    if (!m_matcher || !line) return none;
+
+    auto it = m_lines.find(line);
+    if (it != m_lines.end() && it->second.version == m_version) return it->second.spans;
+    const std::uint32_t hash = lineHash(line->text);
+    if (it != m_lines.end() && it->second.hash == hash) {
+        it->second.version = m_version;
+        return it->second.spans;
+    }
+
+    if (it == m_lines.end()) {
+        // Only lines that were on screen are cached; start over rather than
+        // track which of them scrolled away
+        if (m_lines.size() >= MAX_CACHED_LINES) m_lines.clear();
+        it = m_lines.emplace(line, CachedLine{}).first;
+    }
+    CachedLine& cached = it->second;
+    cached.version = m_version;
+    cached.hash = hash;
+    cached.spans.clear();
+    for (std::size_t from = 0; ; ) {
+        auto [pos, len] = m_matcher->find(line->text, from);
+        if (pos == std::string_view::npos) break;
+        cached.spans.emplace_back(pos, len);
+        from = pos + std::max<std::size_t>(len, 1);
+    }
+    return cached.spans;
+}
@@ -0,0 +1,93 @@
+#ifndef SEARCHMATCHES_H
+#define SEARCHMATCHES_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "EditorBuffer.h"
+#include "SearchEngine.h"
+#include "TaskScheduler.h"
+
+// Every match of the incremental search term in one buffer.
+//
+// Lines on screen get their match positions from a cache keyed by the Line
+// node.  After an edit each cached line is checked against a hash of its
+// text and searched again only if that changed, so a repaint costs a lookup
+// per line.  The number of matches in the whole buffer, and how many come
+// before the current one, is counted in the background on a
+// BufferSnapshot; per-chunk counts are kept, so counting again after an
+// edit or a jump to the next match only searches the chunks that need it.
+class SearchMatches {
+public:
+    using Span = std::pair<std::size_t, std::size_t>;   // offset, length
+
+    SearchMatches() = default;
+    ~SearchMatches();
+    SearchMatches(const SearchMatches&) = delete;
+    SearchMatches& operator=(const SearchMatches&) = delete;
+
+    // Follows the buffer and the term (nullptr: no search).  A new term
+    // cancels the count in progress; otherwise a stale count is finished and
+    // then redone.  line_num/col is the current match, counted as the
+    // first match at or after it.  UI thread only.
+    void sync(EditorBuffer& buffer, std::shared_ptr<const LineMatcher> matcher, int line_num, int col);
+
+    // Matches in `line`, left to right.
+    const std::vector<Span>& inLine(const Line* line);
+
+    // True once a count for the current term has finished; it may lag the
+    // text or the position by one pass.
+    bool counted() const { return m_counted; }
+    std::size_t total() const { return m_total; }
+    std::size_t before() const { return m_before; }
+
+private:
+    static constexpr std::size_t MAX_CACHED_LINES = 1024;
+
+    struct CachedLine {
+        std::uint64_t version = 0;   // buffer version the hash was checked at
+        std::uint32_t hash = 0;
+        std::vector<Span> spans;
+    };
+
+    struct ChunkCount {
+        std::shared_ptr<const BufferSnapshot::Chunk> chunk;
+        std::size_t matches = 0;
+    };
+    using ChunkCounts = std::unordered_map<const BufferSnapshot::Chunk*, ChunkCount>;
+
+    // Shared between the background count and the UI thread.
+    struct Count {
+        CancellationToken token;
+        BufferSnapshotPtr snapshot;
+        std::shared_ptr<const LineMatcher> matcher;
+        std::size_t line = 0;       // 0-based
+        std::size_t col = 0;        // 0-based
+        std::shared_ptr<const ChunkCounts> previous;
+        std::shared_ptr<const ChunkCounts> chunks;
+        std::size_t total = 0;
+        std::size_t before = 0;
+        std::atomic<bool> done{false};
+    };
+
+    static void run(Count& count, const CancellationToken& token);
+    void adoptCount();
+
+    std::shared_ptr<const LineMatcher> m_matcher;
+    std::uint64_t m_version = 0;
+    std::unordered_map<const Line*, CachedLine> m_lines;
+
+    std::shared_ptr<Count> m_count;
+    std::shared_ptr<const ChunkCounts> m_chunks;
+    bool m_counted = false;
+    std::uint64_t m_counted_version = 0;
+    int m_counted_line = 0;
+    int m_counted_col = 0;
+    std::size_t m_total = 0;
+    std::size_t m_before = 0;
+};
+
+#endif // SEARCHMATCHES_H
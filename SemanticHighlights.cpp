@@ -0,0 +1,166 @@
+#include "SemanticHighlights.h"
+
+#include <algorithm>
+
+namespace {
+
+// Colour for an identifier token annotated with cursor `c`, or 0 to leave
+// it to the lexer.
+int colorOf(CXCursor c) {
+    CXCursorKind kind = clang_getCursorKind(c);
+    if (kind == CXCursor_DeclRefExpr || kind == CXCursor_MemberRefExpr) {
+        CXCursor ref = clang_getCursorReferenced(c);
+        if (clang_Cursor_isNull(ref)) return 0;
+        kind = clang_getCursorKind(ref);
+    }
+    switch (kind) {
+    case CXCursor_StructDecl:
+    case CXCursor_UnionDecl:
+    case CXCursor_ClassDecl:
+    case CXCursor_EnumDecl:
+    case CXCursor_TypedefDecl:
+    case CXCursor_TypeAliasDecl:
+    case CXCursor_ClassTemplate:
+    case CXCursor_TemplateTypeParameter:
+    case CXCursor_TypeRef:
+    case CXCursor_TemplateRef:
+        return Renderer::CP_SYNTAX_TYPE;
+    case CXCursor_FieldDecl:
+    case CXCursor_MemberRef:
+        return Renderer::CP_SYNTAX_MEMBER;
+    case CXCursor_EnumConstantDecl:
+        return Renderer::CP_SYNTAX_ENUM_CONSTANT;
+    case CXCursor_MacroDefinition:
+    case CXCursor_MacroExpansion:
+        return Renderer::CP_SYNTAX_MACRO;
+    default:
+        return 0;
+    }
+}
+
+// Keeps the spans of a line that lie wholly before or after the part that
+// differs between `before` and `after`, shifting the later ones.
+void trim(std::vector<SemanticHighlights::Span>& spans, const std::string& before, const std::string& after) {
+    const std::size_t shorter = std::min(before.size(), after.size());
+    std::size_t prefix = 0;
+    while (prefix < shorter && before[prefix] == after[prefix]) ++prefix;
+    std::size_t suffix = 0;
+    while (suffix < shorter - prefix && before[before.size() - 1 - suffix] == after[after.size() - 1 - suffix]) ++suffix;
+
+    const std::size_t old_tail = before.size() - suffix;
+    const std::int64_t shift = static_cast<std::int64_t>(after.size()) - static_cast<std::int64_t>(before.size());
+    std::vector<SemanticHighlights::Span> kept;
+    for (const auto& span : spans) {
+        if (span.col + span.len <= prefix) kept.push_back(span);
+        else if (span.col >= old_tail) kept.push_back({static_cast<std::uint32_t>(span.col + shift), span.len, span.color});
+    }
+    spans = std::move(kept);
+}
+
+} // namespace
+
+SemanticHighlights::~SemanticHighlights() {
+    if (m_job) m_job->token.cancel();
+}
+
+void SemanticHighlights::sync(const EditorBuffer& buffer) {
+    if (m_job && m_job->done) {
+        std::shared_ptr<Job> job = std::move(m_job);
+        if (job->parsed) {
+            m_snapshot = job->snapshot;
+            m_lines = std::move(job->lines);
+            m_lines.resize(m_snapshot->lineCount());
+        }
+    }
+    if (buffer.version != m_seen_version) {
+        m_seen_version = buffer.version;
+        m_seen_at = std::chrono::steady_clock::now();
+    }
+    if (m_snapshot && m_snapshot->version() != buffer.version) carry(buffer.snapshot());
+}
+
+bool SemanticHighlights::due(const EditorBuffer& buffer) const {
+    return !m_job && m_parsed_version != buffer.version &&
+           std::chrono::steady_clock::now() - m_seen_at >= IDLE_DELAY;
+}
+
+void SemanticHighlights::parse(const EditorBuffer& buffer, std::shared_ptr<TranslationUnitCache> cache,
+                               std::string path, std::vector<std::string> args,
+                               std::shared_ptr<UnsavedBuffers> unsaved) {
+    auto job = std::make_shared<Job>();
+    job->snapshot = buffer.snapshot();
+    job->cache = std::move(cache);
+    job->path = std::move(path);
+    job->args = std::move(args);
+    job->unsaved = std::move(unsaved);
+    m_job = job;
+    m_parsed_version = buffer.version;
+
+    TaskScheduler::instance().submit(TaskLane::Background,
+        [job](const CancellationToken&) { run(*job); job->done = true; }, job->token);
+}
+
+void SemanticHighlights::run(Job& job) {
+    job.parsed = job.cache->use(job.path, job.args, job.unsaved->files, [&](CXTranslationUnit tu) {
+        CXFile file = clang_getFile(tu, job.path.c_str());
+        if (!file || job.token.cancelled()) return;
+        const std::string& text = job.snapshot->text();
+        CXSourceRange range = clang_getRange(clang_getLocationForOffset(tu, file, 0),
+                                             clang_getLocationForOffset(tu, file, text.size()));
+        CXToken* tokens = nullptr;
+        unsigned count = 0;
+        clang_tokenize(tu, range, &tokens, &count);
+        std::vector<CXCursor> cursors(count);
+        if (count > 0) clang_annotateTokens(tu, tokens, count, cursors.data());
+
+        job.lines.resize(job.snapshot->lineCount());
+        for (unsigned i = 0; i < count && !job.token.cancelled(); ++i) {
+            if (clang_getTokenKind(tokens[i]) != CXToken_Identifier) continue;
+            int color = colorOf(cursors[i]);
+            if (!color) continue;
+            CXSourceRange extent = clang_getTokenExtent(tu, tokens[i]);
+            unsigned line = 0, col = 0, start = 0, end = 0;
+            clang_getSpellingLocation(clang_getRangeStart(extent), nullptr, &line, &col, &start);
+            clang_getSpellingLocation(clang_getRangeEnd(extent), nullptr, nullptr, nullptr, &end);
+            if (line == 0 || line > job.lines.size() || end <= start) continue;
+            job.lines[line - 1].push_back({col - 1, end - start, color});
+        }
+        clang_disposeTokens(tu, tokens, count);
+    });
+}
+
+// Maps the spans from m_snapshot to `now`, a later snapshot of the same
+// buffer.
+void SemanticHighlights::carry(const BufferSnapshotPtr& now) {
+    const auto [head, tail] = BufferSnapshot::diff(*m_snapshot, *now);
+    const std::size_t old_end = m_snapshot->lineCount() - tail;
+    const std::size_t new_end = now->lineCount() - tail;
+    if (old_end - head == new_end - head) {
+        for (std::size_t i = head; i < old_end; ++i) trim(m_lines[i], m_snapshot->line(i), now->line(i));
+    } else {
+        m_lines.erase(m_lines.begin() + head, m_lines.begin() + old_end);
+        m_lines.insert(m_lines.begin() + head, new_end - head, {});
+    }
+    m_snapshot = now;
+}
+
+const std::vector<SemanticHighlights::Span>& SemanticHighlights::inLine(std::size_t idx) const {
+    static const std::vector<Span> none;
+    return idx < m_lines.size() ? m_lines[idx] : none;
+}
+
+void SemanticHighlights::overlay(std::vector<SyntaxToken>& tokens, const std::vector<Span>& spans,
+                                 const Renderer& renderer) {
+    auto span = spans.begin();
+    std::size_t offset = 0;
+    for (SyntaxToken& token : tokens) {
+        while (span != spans.end() && span->col < offset) ++span;
+        if (span == spans.end()) break;
+        if (span->col == offset && span->len == token.text.size() &&
+            token.colorId == Renderer::CP_DEFAULT_TEXT && token.flags == 0) {
+            token.colorId = span->color;
+            token.flags = renderer.getStyleFlags(static_cast<Renderer::ColorPairID>(span->color));
+        }
+        offset += token.text.size();
+    }
+}
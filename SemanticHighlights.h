@@ -0,0 +1,86 @@
+#ifndef SEMANTICHIGHLIGHTS_H
+#define SEMANTICHIGHLIGHTS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "EditorBuffer.h"
+#include "Renderer.h"
+#include "SyntaxHighlighter.h"
+#include "TaskScheduler.h"
+#include "TranslationUnitCache.h"
+
+// Colours the lexer cannot give: which identifiers of a C/C++ buffer name
+// types, member fields, macros and enum constants, as libclang sees them.
+//
+// Once the buffer has been left unchanged for IDLE_DELAY, parse() brings
+// the file's unit in the TranslationUnitCache up to date on the
+// TaskScheduler's Background lane, tokenizes the file and annotates the
+// tokens with their cursors.  The outcome is a list of spans per line of
+// the snapshot that was parsed.  Until the next parse lands, sync() carries
+// the spans through every edit: lines outside the changed range keep theirs
+// (shifted), and a changed line keeps those left of and right of the part
+// that differs.  Drawing only looks the spans up, so nothing here ever
+// waits for libclang on the UI thread.
+class SemanticHighlights {
+public:
+    struct Span {
+        std::uint32_t col;   // 0-based byte offset
+        std::uint32_t len;
+        int color;
+    };
+
+    SemanticHighlights() = default;
+    ~SemanticHighlights();
+    SemanticHighlights(const SemanticHighlights&) = delete;
+    SemanticHighlights& operator=(const SemanticHighlights&) = delete;
+
+    // Adopts a finished parse and maps the spans to the buffer's current
+    // text.  UI thread only.
+    void sync(const EditorBuffer& buffer);
+    // The buffer changed since the last parse was started, has rested for
+    // IDLE_DELAY since, and no parse is running.
+    bool due(const EditorBuffer& buffer) const;
+    // Parses `path` as of the buffer's current snapshot, which must be the
+    // one `unsaved` holds for it.
+    void parse(const EditorBuffer& buffer, std::shared_ptr<TranslationUnitCache> cache, std::string path,
+               std::vector<std::string> args, std::shared_ptr<UnsavedBuffers> unsaved);
+
+    // Spans of 0-based line `idx`, left to right.
+    const std::vector<Span>& inLine(std::size_t idx) const;
+
+    // Gives the identifier tokens of a line that a span covers exactly the
+    // span's colour.
+    static void overlay(std::vector<SyntaxToken>& tokens, const std::vector<Span>& spans, const Renderer& renderer);
+
+private:
+    static constexpr std::chrono::milliseconds IDLE_DELAY{400};
+
+    // Shared between the background parse and the UI thread.
+    struct Job {
+        CancellationToken token;
+        BufferSnapshotPtr snapshot;
+        std::shared_ptr<TranslationUnitCache> cache;
+        std::string path;
+        std::vector<std::string> args;
+        std::shared_ptr<UnsavedBuffers> unsaved;
+        bool parsed = false;
+        std::vector<std::vector<Span>> lines;
+        std::atomic<bool> done{false};
+    };
+
+    static void run(Job& job);
+    void carry(const BufferSnapshotPtr& now);
+
+    BufferSnapshotPtr m_snapshot;                 // text the spans belong to
+    std::vector<std::vector<Span>> m_lines;
+    std::shared_ptr<Job> m_job;
+    std::uint64_t m_parsed_version = UINT64_MAX;  // version of the last parse started
+    std::uint64_t m_seen_version = UINT64_MAX;
+    std::chrono::steady_clock::time_point m_seen_at;
+};
+
+#endif // SEMANTICHIGHLIGHTS_H
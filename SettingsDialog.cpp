@@ -8,9 +8,9 @@ static constexpr int INNER_W      = W - 4;
 static constexpr int INDENT_BOX_Y = 2;
 static constexpr int INDENT_BOX_H = 4;
 static constexpr int VIEW_BOX_Y   = 7;
-static constexpr int VIEW_BOX_H   = 3;
-static constexpr int COLOR_BOX_Y  = 11;
-static constexpr int COLOR_BOX_H  = H - 15;
+static constexpr int VIEW_BOX_H   = 6;
+static constexpr int COLOR_BOX_Y  = 14;
+static constexpr int COLOR_BOX_H  = H - 18;
 static constexpr int LIST_ROWS    = COLOR_BOX_H - 2;
 static constexpr int BTN_Y        = H - 3;
 
@@ -23,6 +23,9 @@ SettingsDialog::SettingsDialog(Renderer& renderer, Config& config,
     , temp_smart_indent_    (config.smart_indentation)
     , temp_indent_width_    (config.indentation_width)
     , m_temp_show_line_numbers(config.show_line_numbers)
+    , m_temp_soft_wrap       (config.soft_wrap)
+    , m_temp_tidy_on_save    (config.tidy_on_save)
+    , m_temp_semantic        (config.semantic_highlighting)
     , m_temp_theme_selected  (0)
     , m_temp_theme_cursor    (0)
 {
@@ -67,6 +70,12 @@ void SettingsDialog::onInit()
         g.box_w  = INNER_W;  g.box_h = VIEW_BOX_H;
         g.checkboxes.push_back({ "Show Line Numbers", m_temp_show_line_numbers,
                                 4, VIEW_BOX_Y + 1 });
+        g.checkboxes.push_back({ "Soft Wrap", m_temp_soft_wrap,
+                                4, VIEW_BOX_Y + 2 });
+        g.checkboxes.push_back({ "Run clang-tidy on Save", m_temp_tidy_on_save,
+                                4, VIEW_BOX_Y + 3 });
+        g.checkboxes.push_back({ "Semantic Highlighting", m_temp_semantic,
+                                4, VIEW_BOX_Y + 4 });
         addGroup(std::move(g));
     }
 
@@ -132,6 +141,9 @@ void SettingsDialog::applySettings()
     config_.smart_indentation = temp_smart_indent_;
     config_.indentation_width = temp_indent_width_;
     config_.show_line_numbers  = m_temp_show_line_numbers;
+    config_.soft_wrap          = m_temp_soft_wrap;
+    config_.tidy_on_save       = m_temp_tidy_on_save;
+    config_.semantic_highlighting = m_temp_semantic;
     config_.color_scheme_name  = themes_[m_temp_theme_selected];
     renderer_.loadColors(configManager_.loadThemes()[config_.color_scheme_name]);
 }
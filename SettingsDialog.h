@@ -26,6 +26,9 @@ private:
     bool temp_smart_indent_;
     int temp_indent_width_;
     bool m_temp_show_line_numbers;
+    bool m_temp_soft_wrap;
+    bool m_temp_tidy_on_save;
+    bool m_temp_semantic;
     int m_temp_theme_selected;
     int m_temp_theme_cursor;
 };
@@ -0,0 +1,131 @@
+#include "StreamSource.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+const char* tempDir() {
+    const char* tmpdir = std::getenv("TMPDIR");
+    return tmpdir && *tmpdir ? tmpdir : "/tmp";
+}
+
+// Creates an empty file with a fresh gedi-stdin-XXXXXX name in the temp
+// directory.  Returns its fd and sets `path`, or -1.
+int makeNamed(std::string& path) {
+    std::string templ = std::string(tempDir()) + "/gedi-stdin-XXXXXX";
+    std::vector<char> name(templ.begin(), templ.end());
+    name.push_back('\0');
+    int fd = mkstemp(name.data());
+    if (fd >= 0) path = name.data();
+    return fd;
+}
+
+} // namespace
+
+std::unique_ptr<StreamSource> StreamSource::fromStdin(bool spill_to_file) {
+    if (isatty(STDIN_FILENO)) return nullptr;
+
+    int tty = open("/dev/tty", O_RDONLY);
+    if (tty < 0) return nullptr;
+
+    int fd = dup(STDIN_FILENO);
+    if (fd < 0) { close(tty); return nullptr; }
+    dup2(tty, STDIN_FILENO);
+    close(tty);
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+#ifdef F_SETPIPE_SZ
+    // The pipe is drained once per main loop tick; a bigger pipe keeps a
+    // fast producer from stalling between ticks.
+    fcntl(fd, F_SETPIPE_SZ, 1024 * 1024);
+#endif
+
+    std::unique_ptr<StreamSource> source(new StreamSource(fd));
+    if (spill_to_file) {
+        // Unnamed, so nothing is left behind if the editor is killed; only
+        // a file system without O_TMPFILE gets a named file instead
+        int spill = -1;
+#ifdef O_TMPFILE
+        spill = open(tempDir(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+#endif
+        if (spill < 0) spill = makeNamed(source->m_spill_path);
+        source->m_spill_fd = spill;
+    }
+    return source;
+}
+
+StreamSource::~StreamSource() {
+    if (m_fd >= 0) close(m_fd);
+    if (m_spill_fd >= 0) close(m_spill_fd);
+    if (!m_spill_path.empty() && !m_keep_spill) unlink(m_spill_path.c_str());
+}
+
+std::string StreamSource::keepSpill() {
+    if (m_spill_fd < 0) return "";
+    if (!m_spill_path.empty()) {
+        m_keep_spill = true;
+        return m_spill_path;
+    }
+    // Reserve a fresh name, then link the unnamed file in beside it and
+    // move it over the reservation
+    std::string path;
+    int reserved = makeNamed(path);
+    if (reserved < 0) return "";
+    close(reserved);
+    const std::string fd_path = "/proc/self/fd/" + std::to_string(m_spill_fd);
+    const std::string part = path + ".part";
+    if (linkat(AT_FDCWD, fd_path.c_str(), AT_FDCWD, part.c_str(), AT_SYMLINK_FOLLOW) != 0 ||
+        std::rename(part.c_str(), path.c_str()) != 0) {
+        unlink(part.c_str());
+        unlink(path.c_str());
+        return "";
+    }
+    m_spill_path = path;
+    m_keep_spill = true;
+    return path;
+}
+
+LineChunk StreamSource::poll(std::size_t max_bytes) {
+    LineChunk result;
+    if (m_finished) return result;
+
+    // A pipe hands out at most its buffer size per read(); keep reading until
+    // it runs dry or the budget is used up.
+    std::vector<char>& data = m_read_buf;
+    data.resize(max_bytes);
+    std::size_t got = 0;
+    bool eof = false;
+    while (got < data.size()) {
+        ssize_t n = read(m_fd, data.data() + got, data.size() - got);
+        if (n > 0) { got += n; continue; }
+        if (n < 0 && errno == EINTR) continue;
+        // n == 0 is end of stream; read errors are treated the same way
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) eof = true;
+        break;
+    }
+
+    if (got > 0) {
+        m_bytes_read += got;
+        if (m_spill_fd >= 0 && write(m_spill_fd, data.data(), got) != (ssize_t)got) {
+            // Disk full or similar: keep streaming, just stop spilling
+            close(m_spill_fd);
+            m_spill_fd = -1;
+            if (!m_spill_path.empty()) unlink(m_spill_path.c_str());
+            m_spill_path.clear();
+        }
+    }
+    if (got == 0 && !eof) return result;
+    result = FileLoader::splitChunk(data.data(), got, m_carry, eof);
+    if (eof) {
+        m_finished = true;
+        close(m_fd);
+        m_fd = -1;
+    }
+    return result;
+}
@@ -0,0 +1,57 @@
+#ifndef STREAMSOURCE_H
+#define STREAMSOURCE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "FileLoader.h"
+
+// Incremental reader for data piped into the editor (`make | gedi -`).
+//
+// The pipe is read non-blocking from the main loop, a bounded amount per
+// iteration, so a slow or endless producer never stalls the UI.  Optionally
+// everything read is also copied to a temporary spill file, so the complete
+// stream survives even when the editor drops old lines to bound memory.
+// The spill file has no name unless keepSpill() gives it one; otherwise it
+// goes away with the StreamSource, however the editor is left.
+class StreamSource {
+public:
+    // Takes over the data on stdin and re-opens /dev/tty as fd 0 so ncurses
+    // still gets keyboard input.  Must run before the Renderer is created.
+    // Returns nullptr if stdin is a terminal or /dev/tty is unavailable.
+    static std::unique_ptr<StreamSource> fromStdin(bool spill_to_file);
+
+    ~StreamSource();
+    StreamSource(const StreamSource&) = delete;
+    StreamSource& operator=(const StreamSource&) = delete;
+
+    // Reads at most `max_bytes` that are available right now and returns the
+    // complete lines among them.  Never blocks.
+    LineChunk poll(std::size_t max_bytes);
+
+    // The writer closed the pipe and every byte has been returned by poll().
+    bool finished() const { return m_finished; }
+
+    std::uintmax_t bytesRead() const { return m_bytes_read; }
+
+    // Makes the spill file outlive the StreamSource and returns its path,
+    // or an empty string when there is none or it cannot be named.
+    std::string keepSpill();
+
+private:
+    explicit StreamSource(int fd) : m_fd(fd) {}
+
+    int m_fd = -1;
+    int m_spill_fd = -1;
+    // Set only where the file could not be opened unnamed; it is removed
+    // again unless kept
+    std::string m_spill_path;
+    bool m_keep_spill = false;
+    std::string m_carry;
+    std::vector<char> m_read_buf;
+    std::uintmax_t m_bytes_read = 0;
+    bool m_finished = false;
+};
+
+#endif // STREAMSOURCE_H
@@ -0,0 +1,267 @@
+#include "SymbolRename.h"
+#include "BufferPolicy.h"
+#include "PathRegistry.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <set>
+#include <sys/stat.h>
+#include <tuple>
+
+namespace {
+
+std::string takeString(CXString s) {
+    const char* c = clang_getCString(s);
+    std::string out = c ? c : "";
+    clang_disposeString(s);
+    return out;
+}
+
+bool isIdentChar(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+// True if `name` occurs in `text` as a whole identifier.
+bool containsWord(const std::string& text, const std::string& name) {
+    for (std::size_t pos = text.find(name); pos != std::string::npos; pos = text.find(name, pos + 1)) {
+        if ((pos == 0 || !isIdentChar(text[pos - 1])) &&
+            (pos + name.size() == text.size() || !isIdentChar(text[pos + name.size()]))) return true;
+    }
+    return false;
+}
+
+bool parseable(const std::string& path) {
+    static const std::set<std::string> exts = {
+        ".c", ".cc", ".cpp", ".cxx", ".c++", ".C", ".h", ".hh", ".hpp", ".hxx", ".h++", ".inl", ".ipp", ".tpp"
+    };
+    std::size_t dot = path.rfind('.');
+    return dot != std::string::npos && path.find('/', dot) == std::string::npos && exts.count(path.substr(dot));
+}
+
+bool isClass(CXCursorKind kind) {
+    return kind == CXCursor_ClassDecl || kind == CXCursor_StructDecl || kind == CXCursor_ClassTemplate;
+}
+
+// A cursor whose location is the spelling of the name it refers to.
+bool namesSomething(CXCursorKind kind) {
+    return clang_isDeclaration(kind) || clang_isReference(kind) ||
+           kind == CXCursor_DeclRefExpr || kind == CXCursor_MemberRefExpr;
+}
+
+// The declaration `c` names, seen from the rename: a constructor or
+// destructor stands for its class when a class is renamed.
+CXCursor declarationOf(CXCursor c, bool is_type) {
+    CXCursor ref = clang_isDeclaration(clang_getCursorKind(c)) ? c : clang_getCursorReferenced(c);
+    if (clang_Cursor_isNull(ref)) return ref;
+    CXCursorKind kind = clang_getCursorKind(ref);
+    if (is_type && (kind == CXCursor_Constructor || kind == CXCursor_Destructor))
+        ref = clang_getCursorSemanticParent(ref);
+    return ref;
+}
+
+struct Visit {
+    const RenameTarget& target;
+    const std::unordered_set<FileId>& editable;
+    std::unordered_map<CXFile, FileId> file_ids;   // INVALID_FILE_ID: not editable
+    std::vector<std::tuple<FileId, int, std::size_t>>& out;
+
+    FileId editableId(CXFile file) {
+        if (!file) return INVALID_FILE_ID;
+        auto it = file_ids.find(file);
+        if (it != file_ids.end()) return it->second;
+        FileId id = PathRegistry::instance().intern(takeString(clang_getFileName(file)));
+        if (!editable.count(id)) id = INVALID_FILE_ID;
+        file_ids.emplace(file, id);
+        return id;
+    }
+};
+
+CXChildVisitResult visitCursor(CXCursor c, CXCursor, CXClientData data) {
+    Visit& v = *static_cast<Visit*>(data);
+    CXSourceLocation loc = clang_getCursorLocation(c);
+    CXFile file;
+    unsigned line, col, offset;
+    // Code outside the files being renamed is skipped whole: system headers
+    // and third-party code make up most of a unit
+    clang_getExpansionLocation(loc, &file, &line, &col, &offset);
+    if (v.editableId(file) == INVALID_FILE_ID) return CXChildVisit_Continue;
+
+    CXCursorKind kind = clang_getCursorKind(c);
+    if (namesSomething(kind)) {
+        CXCursor decl = declarationOf(c, v.target.is_type);
+        if (!clang_Cursor_isNull(decl) && takeString(clang_getCursorSpelling(decl)) == v.target.name &&
+            takeString(clang_getCursorUSR(decl)) == v.target.usr) {
+            clang_getSpellingLocation(loc, &file, &line, &col, &offset);
+            FileId id = v.editableId(file);
+            if (id != INVALID_FILE_ID && col > 0) v.out.emplace_back(id, static_cast<int>(line), col - 1);
+        }
+    }
+    return CXChildVisit_Recurse;
+}
+
+} // namespace
+
+SymbolRename::~SymbolRename() {
+    cancel();
+}
+
+void SymbolRename::cancel() {
+    if (m_job) m_job->token.cancel();
+}
+
+bool SymbolRename::resolve(TranslationUnitCache& cache, const std::string& path,
+                           const std::vector<std::string>& args, UnsavedBuffers& unsaved,
+                           int line, int col, RenameTarget& target, std::string& error) {
+    error = "No symbol under the cursor.";
+    bool parsed = cache.use(path, args, unsaved.files, [&](CXTranslationUnit tu) {
+        CXFile file = clang_getFile(tu, path.c_str());
+        if (!file) return;
+        CXCursor cursor = clang_getCursor(tu, clang_getLocation(tu, file, line, col));
+        CXCursor decl = declarationOf(cursor, true);
+        // Just past the end of a name: try the character before
+        if ((clang_Cursor_isNull(decl) || clang_getCursorKind(cursor) == CXCursor_TranslationUnit) && col > 1) {
+            cursor = clang_getCursor(tu, clang_getLocation(tu, file, line, col - 1));
+            decl = declarationOf(cursor, true);
+        }
+        if (clang_Cursor_isNull(decl) || clang_isInvalid(clang_getCursorKind(decl))) return;
+
+        CXCursorKind kind = clang_getCursorKind(decl);
+        if (kind == CXCursor_MacroDefinition || kind == CXCursor_MacroExpansion) {
+            error = "Macros cannot be renamed.";
+            return;
+        }
+        if (kind == CXCursor_TranslationUnit || !clang_isDeclaration(kind)) return;
+
+        std::string name = takeString(clang_getCursorSpelling(decl));
+        std::string usr = takeString(clang_getCursorUSR(decl));
+        if (name.empty() || usr.empty() || !isIdentChar(name[0])) {
+            error = "This symbol cannot be renamed.";
+            return;
+        }
+        if (clang_Location_isInSystemHeader(clang_getCursorLocation(decl))) {
+            error = "'" + name + "' is declared in a system header.";
+            return;
+        }
+        target = RenameTarget{usr, name, isClass(kind)};
+        error.clear();
+    });
+    if (!parsed) error = "Failed to parse file for rename.";
+    return error.empty();
+}
+
+void SymbolRename::find(const RenameTarget& target, const std::vector<std::string>& paths,
+                        const std::vector<std::string>& args, std::shared_ptr<UnsavedBuffers> unsaved) {
+    cancel();
+    auto job = std::make_shared<Job>();
+    job->target = target;
+    job->args = args;
+    std::unordered_map<FileId, std::size_t> open;
+    for (std::size_t i = 0; i < unsaved->snapshots.size(); ++i) open.emplace(unsaved->snapshots[i]->fileId(), i);
+    for (const std::string& path : paths) {
+        Item item;
+        item.file_id = PathRegistry::instance().intern(path);
+        if (!job->editable.insert(item.file_id).second) continue;
+        item.path = PathRegistry::instance().path(item.file_id);
+        auto it = open.find(item.file_id);
+        if (it != open.end()) item.snapshot = unsaved->snapshots[it->second];
+        job->files.push_back(std::move(item));
+    }
+    job->unsaved = std::move(unsaved);
+    job->items = job->files.size();
+    m_job = job;
+
+    const std::size_t batches = (job->items + BATCH_FILES - 1) / BATCH_FILES;
+    job->batches_left = batches;
+    // No token, as in ProjectReplace: a cancelled batch still counts itself off
+    for (std::size_t b = 0; b < batches; ++b) {
+        TaskScheduler::instance().submit(TaskLane::Background,
+            [job, b, cache = m_cache](const CancellationToken&) {
+                const std::size_t end = std::min(job->items, (b + 1) * BATCH_FILES);
+                for (std::size_t i = b * BATCH_FILES; i < end && !job->token.cancelled(); ++i) {
+                    search(*job, *cache, job->files[i]);
+                    ++job->done;
+                }
+                --job->batches_left;
+            });
+    }
+}
+
+void SymbolRename::search(Job& job, TranslationUnitCache& cache, Item& item) {
+    if (item.snapshot) {
+        if (!containsWord(item.snapshot->text(), job.target.name)) return;
+    } else {
+        struct stat st;
+        if (::stat(item.path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) return;
+        if ((std::uintmax_t)st.st_size >= BufferPolicy::LARGE_BYTES) return;
+        std::ifstream in(item.path, std::ios::binary);
+        std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        if (!containsWord(content, job.target.name)) return;
+        item.content = std::move(content);
+        item.size = st.st_size;
+        item.mtime = st.st_mtim;
+    }
+    if (!parseable(item.path)) return;
+
+    // The unit reads the other files' references too; they are kept and
+    // merged, since a header may be included by no file that mentions it
+    std::vector<CXUnsavedFile> unsaved = job.unsaved->files;
+    std::vector<std::tuple<FileId, int, std::size_t>> found;
+    cache.use(item.path, job.args, unsaved, [&](CXTranslationUnit tu) {
+        Visit visit{job.target, job.editable, {}, found};
+        clang_visitChildren(clang_getTranslationUnitCursor(tu), visitCursor, &visit);
+    });
+    for (const auto& [file, line, col] : found) item.refs.push_back(Ref{file, line, col});
+}
+
+std::vector<ReplaceFile> SymbolRename::files() const {
+    std::vector<ReplaceFile> out;
+    if (!finished()) return out;
+
+    std::map<FileId, std::set<std::pair<int, std::size_t>>> refs;
+    for (const Item& item : m_job->files) {
+        for (const Ref& ref : item.refs) refs[ref.file].emplace(ref.line, ref.col);
+    }
+
+    const std::string& name = m_job->target.name;
+    for (const Item& item : m_job->files) {
+        auto it = refs.find(item.file_id);
+        if (it == refs.end()) continue;
+        // Lines come from the same text the units were parsed from
+        const std::string& text = item.snapshot ? item.snapshot->text() : item.content;
+        ReplaceFile file;
+        file.path = item.path;
+        file.file_id = item.file_id;
+        file.in_buffer = item.snapshot != nullptr;
+        if (item.snapshot) file.version = item.snapshot->version();
+        file.size = item.size;
+        file.mtime = item.mtime;
+
+        std::size_t line_start = 0;
+        int line_num = 1;
+        for (auto [line, col] : it->second) {
+            for (; line_num < line && line_start < text.size(); ++line_num) {
+                std::size_t nl = text.find('\n', line_start);
+                line_start = nl == std::string::npos ? text.size() : nl + 1;
+            }
+            if (line_num != line) break;
+            std::size_t nl = text.find('\n', line_start);
+            std::string line_text = text.substr(line_start, (nl == std::string::npos ? text.size() : nl) - line_start);
+            if (!line_text.empty() && line_text.back() == '\r') line_text.pop_back();
+            // A destructor is located at its '~'
+            if (col < line_text.size() && line_text[col] == '~') ++col;
+            if (col >= line_text.size()) continue;
+            // Only exact, whole-identifier spellings: not macro bodies or
+            // token pastes that merely expand to the name
+            if (line_text.compare(col, name.size(), name) != 0) continue;
+            if ((col > 0 && isIdentChar(line_text[col - 1])) ||
+                (col + name.size() < line_text.size() && isIdentChar(line_text[col + name.size()]))) continue;
+            if (!file.hits.empty() && file.hits.back().line == line && file.hits.back().col == col) continue;
+            file.hits.push_back({line, col, std::move(line_text), true});
+        }
+        if (!file.hits.empty()) out.push_back(std::move(file));
+    }
+    return out;
+}
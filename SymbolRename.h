@@ -0,0 +1,98 @@
+#ifndef SYMBOLRENAME_H
+#define SYMBOLRENAME_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <sys/types.h>
+#include "BufferManager.h"
+#include "ProjectReplace.h"
+#include "TaskScheduler.h"
+#include "TranslationUnitCache.h"
+
+// The declaration a rename applies to.
+struct RenameTarget {
+    std::string usr;        // libclang's unified symbol resolution
+    std::string name;
+    bool is_type = false;   // class or struct: its constructors and destructor are renamed too
+};
+
+// Finds every reference to one declaration across a set of files.
+//
+// Each file is first searched for the name as a whole word; only files that
+// contain it are parsed, as their own translation unit, and their cursors
+// compared by USR, so a rename parses the few files that mention the name
+// rather than the whole project.  Files are handled in batches on the
+// TaskScheduler's Background lane and parsed through the shared
+// TranslationUnitCache, so a unit already parsed for another lookup is only
+// reparsed.  References are kept only in the files given to find().
+class SymbolRename {
+public:
+    explicit SymbolRename(std::shared_ptr<TranslationUnitCache> cache) : m_cache(std::move(cache)) {}
+    ~SymbolRename();
+    SymbolRename(const SymbolRename&) = delete;
+    SymbolRename& operator=(const SymbolRename&) = delete;
+
+    // The declaration referenced at line/col (1-based) of `path`.  On failure
+    // returns false and sets `error`.  UI thread only.
+    static bool resolve(TranslationUnitCache& cache, const std::string& path,
+                        const std::vector<std::string>& args, UnsavedBuffers& unsaved,
+                        int line, int col, RenameTarget& target, std::string& error);
+
+    // Starts looking for references to `target` in `paths`.  Open buffers
+    // are read from `unsaved`.  UI thread only.
+    void find(const RenameTarget& target, const std::vector<std::string>& paths,
+              const std::vector<std::string>& args, std::shared_ptr<UnsavedBuffers> unsaved);
+
+    bool finished() const { return m_job && m_job->batches_left == 0; }
+    std::size_t done() const { return m_job ? m_job->done.load() : 0; }
+    std::size_t total() const { return m_job ? m_job->items : 0; }
+    void cancel();
+
+    // The references grouped by file, in the shape ProjectReplace::adopt()
+    // takes.  Valid once find() has finished.
+    std::vector<ReplaceFile> files() const;
+
+private:
+    static constexpr std::size_t BATCH_FILES = 8;
+
+    struct Ref {
+        FileId file;
+        int line;           // 1-based
+        std::size_t col;    // 0-based byte offset
+    };
+
+    // One file given to find().
+    struct Item {
+        std::string path;
+        FileId file_id = INVALID_FILE_ID;
+        BufferSnapshotPtr snapshot;   // set if the file is open in a buffer
+        std::string content;          // read from disk if it mentions the name
+        off_t size = 0;
+        timespec mtime{};
+        std::vector<Ref> refs;
+    };
+
+    // State shared with the tasks of one find() pass.
+    struct Job {
+        CancellationToken token;
+        RenameTarget target;
+        std::vector<std::string> args;
+        std::shared_ptr<UnsavedBuffers> unsaved;
+        std::unordered_set<FileId> editable;
+        std::vector<Item> files;      // one per path
+        std::size_t items = 0;
+        std::atomic<std::size_t> done{0};
+        std::atomic<std::size_t> batches_left{0};
+    };
+
+    static void search(Job& job, TranslationUnitCache& cache, Item& item);
+
+    std::shared_ptr<TranslationUnitCache> m_cache;
+    std::shared_ptr<Job> m_job;
+};
+
+#endif // SYMBOLRENAME_H
@@ -2,6 +2,7 @@
 #include "utils.h"
 #include <algorithm>
 #include <cctype>
+#include <cstring>
 
 void SyntaxHighlighter::setSyntaxType(EditorBuffer& buffer) {
     buffer.syntax_type = EditorBuffer::ST_NONE;
@@ -95,147 +96,256 @@ void SyntaxHighlighter::loadKeywords(EditorBuffer& buffer) {
     }
 }
 
-std::vector<SyntaxToken> SyntaxHighlighter::parseLine(EditorBuffer& buffer, const std::string& line, const Renderer& renderer) {
-    std::vector<SyntaxToken> tokens;
-    if (line.empty()) {
-        return tokens;
+namespace {
+
+constexpr std::size_t npos = std::string::npos;
+
+// What a piece of a line is, besides its colour
+enum class Span { Plain, Keyword, Bracket };
+
+bool isWordChar(unsigned char c) { return std::isalnum(c) || c == '_'; }
+
+// One past the closing quote of a literal whose body starts at `from`, or
+// npos if the line ends first.
+std::size_t quoteEnd(const std::string& line, std::size_t from, char quote) {
+    for (std::size_t i = from; i < line.size(); ++i) {
+        if (line[i] == '\\') { ++i; continue; }
+        if (line[i] == quote) return i + 1;
+    }
+    return npos;
+}
+
+// If a raw string literal (R"delim(, optionally prefixed u8, u, U or L)
+// starts at `i`, returns the offset of its body and sets `raw_end` to the
+// )delim" that closes it; npos otherwise.
+std::size_t rawStringBody(const std::string& line, std::size_t i, std::string& raw_end) {
+    if (i > 0 && isWordChar(line[i - 1])) return npos;
+    std::size_t j = i;
+    if (line.compare(j, 2, "u8") == 0) j += 2;
+    else if (line[j] == 'u' || line[j] == 'U' || line[j] == 'L') ++j;
+    if (line.compare(j, 2, "R\"") != 0) return npos;
+    j += 2;
+    std::size_t paren = line.find('(', j);
+    if (paren == npos || paren - j > 16) return npos;   // at most 16 delimiter characters
+    for (std::size_t k = j; k < paren; ++k) {
+        if (std::isspace(static_cast<unsigned char>(line[k])) || line[k] == ')' || line[k] == '\\') return npos;
     }
+    raw_end = ")" + line.substr(j, paren - j) + "\"";
+    return paren + 1;
+}
 
-    size_t i = 0;
+// The lexer behind parseLine() and scanLine().  Calls emit(start, length,
+// colour, span) for consecutive pieces of `line`, which starts in `state`,
+// and leaves `state` at what the line leaves open.  Continuations (a
+// backslash at the end of a directive, comment or string) and raw strings
+// are C/C++ only.  Without `keywords` identifiers are not looked up.
+template <typename Emit>
+void lex(EditorBuffer::SyntaxType type, const std::map<std::string, int>* keywords,
+         const std::string& line, LexState& state, Emit emit) {
+    const std::size_t n = line.size();
+    const bool c_like = type == EditorBuffer::ST_C_CPP || type == EditorBuffer::ST_GLSL;
+    const bool hash_comments = type == EditorBuffer::PRIMAL || type == EditorBuffer::ST_CMAKE;
+    const bool continued = c_like && n > 0 && line.back() == '\\';
+    auto put = [&](std::size_t start, std::size_t len, int color, Span span = Span::Plain) {
+        if (len > 0) emit(start, len, color, span);
+    };
 
-    // If the previous line started a multiline comment, handle that first.
-    if (buffer.in_multiline_comment) {
-        size_t end_comment = line.find("*/");
-        if (end_comment != std::string::npos) {
-            tokens.push_back({line.substr(0, end_comment + 2), Renderer::CP_SYNTAX_COMMENT});
-            buffer.in_multiline_comment = false;
-            i = end_comment + 2;
-        } else {
-            tokens.push_back({line, Renderer::CP_SYNTAX_COMMENT});
-            return tokens;
+    // Finish what the previous line left open
+    std::size_t i = 0;
+    switch (state.kind) {
+    case LexState::CODE:
+        break;
+    case LexState::BLOCK_COMMENT: {
+        std::size_t end = line.find("*/");
+        if (end == npos) { put(0, n, Renderer::CP_SYNTAX_COMMENT); return; }
+        i = end + 2;
+        put(0, i, Renderer::CP_SYNTAX_COMMENT);
+        state = LexState();
+        break;
+    }
+    case LexState::LINE_COMMENT:
+        put(0, n, Renderer::CP_SYNTAX_COMMENT);
+        if (!continued) state = LexState();
+        return;
+    case LexState::DIRECTIVE:
+        put(0, n, Renderer::CP_DEFAULT_TEXT);
+        if (!continued) state = LexState();
+        return;
+    case LexState::STRING: {
+        std::size_t end = quoteEnd(line, 0, '"');
+        if (end == npos) {
+            put(0, n, Renderer::CP_SYNTAX_STRING);
+            if (!continued) state = LexState();
+            return;
         }
+        i = end;
+        put(0, i, Renderer::CP_SYNTAX_STRING);
+        state = LexState();
+        break;
+    }
+    case LexState::RAW_STRING: {
+        std::size_t end = line.find(state.raw_end);
+        if (end == npos) { put(0, n, Renderer::CP_SYNTAX_STRING); return; }
+        i = end + state.raw_end.size();
+        put(0, i, Renderer::CP_SYNTAX_STRING);
+        state = LexState();
+        break;
+    }
     }
 
-    // Check for preprocessor directives or comments (lines starting with #)
+    // Preprocessor directives (or comments, in assembly and Makefiles)
     size_t first_char_pos = line.find_first_not_of(" \t");
-    if (buffer.syntax_type != EditorBuffer::PRIMAL && buffer.syntax_type != EditorBuffer::ST_CMAKE && first_char_pos != std::string::npos && line[first_char_pos] == '#') {
+    if (i == 0 && !hash_comments && first_char_pos != npos && line[first_char_pos] == '#') {
+        put(0, first_char_pos, Renderer::CP_DEFAULT_TEXT); // Leading whitespace
         i = first_char_pos;
-        tokens.push_back({line.substr(0, i), Renderer::CP_DEFAULT_TEXT}); // Add leading whitespace
 
         size_t directive_end = i;
-        while (directive_end < line.length() && !isspace(line[directive_end])) {
+        while (directive_end < n && !isspace(line[directive_end])) {
             directive_end++;
         }
-        std::string directive = line.substr(i, directive_end - i);
-        tokens.push_back({directive, Renderer::CP_SYNTAX_PREPROCESSOR});
+        put(i, directive_end - i, Renderer::CP_SYNTAX_PREPROCESSOR);
+        const bool include = line.compare(i, directive_end - i, "#include") == 0;
         i = directive_end;
 
         // Special handling for <header.h> or "header.h" in #include
-        if (directive == "#include") {
+        if (include) {
             size_t header_start = line.find_first_of("<\"", i);
-            if (header_start != std::string::npos) {
-                tokens.push_back({line.substr(i, header_start - i), Renderer::CP_DEFAULT_TEXT}); // Whitespace
+            if (header_start != npos) {
                 size_t header_end = line.find_first_of(">\"", header_start + 1);
-                if (header_end != std::string::npos) {
-                    tokens.push_back({line.substr(header_start, header_end - header_start + 1), Renderer::CP_SYNTAX_STRING});
+                if (header_end != npos) {
+                    put(i, header_start - i, Renderer::CP_DEFAULT_TEXT); // Whitespace
+                    put(header_start, header_end - header_start + 1, Renderer::CP_SYNTAX_STRING);
                     i = header_end + 1;
                 }
             }
         }
 
-        // Add the rest of the line as default text
-        if (i < line.length()) {
-            tokens.push_back({line.substr(i), Renderer::CP_DEFAULT_TEXT});
-        }
-        return tokens;
+        // The rest of the line, and of any continuation lines, is default text
+        put(i, n - i, Renderer::CP_DEFAULT_TEXT);
+        if (continued) state.kind = LexState::DIRECTIVE;
+        return;
     }
 
     // Main tokenizer loop
-    while (i < line.length()) {
-        // Check for single-line comments
-        if (line.substr(i, 2) == "//") {
-            tokens.push_back({line.substr(i), Renderer::CP_SYNTAX_COMMENT});
-            break; // Rest of the line is a comment
+    while (i < n) {
+        // Single-line comments
+        if (line.compare(i, 2, "//") == 0) {
+            put(i, n - i, Renderer::CP_SYNTAX_COMMENT);
+            if (continued) state.kind = LexState::LINE_COMMENT;
+            return;
         }
-
-        if(buffer.syntax_type == EditorBuffer::PRIMAL || buffer.syntax_type == EditorBuffer::ST_CMAKE) {
-            if (line.substr(i, 1) == "#") {
-                tokens.push_back({line.substr(i), Renderer::CP_SYNTAX_COMMENT});
-                break; // Rest of the line is a comment
-            }
+        if (hash_comments && line[i] == '#') {
+            put(i, n - i, Renderer::CP_SYNTAX_COMMENT);
+            return;
         }
 
-        // Check for multi-line comments
-        if (line.substr(i, 2) == "/*") {
+        // Multi-line comments
+        if (line.compare(i, 2, "/*") == 0) {
             size_t end_comment = line.find("*/", i + 2);
-            if (end_comment != std::string::npos) {
-                tokens.push_back({line.substr(i, end_comment + 2 - i), Renderer::CP_SYNTAX_COMMENT});
-                i = end_comment + 2;
-            } else {
+            if (end_comment == npos) {
                 // Comment extends to the end of the line and beyond
-                tokens.push_back({line.substr(i), Renderer::CP_SYNTAX_COMMENT});
-                buffer.in_multiline_comment = true;
-                break;
+                put(i, n - i, Renderer::CP_SYNTAX_COMMENT);
+                state.kind = LexState::BLOCK_COMMENT;
+                return;
             }
+            put(i, end_comment + 2 - i, Renderer::CP_SYNTAX_COMMENT);
+            i = end_comment + 2;
             continue;
         }
 
-        // Check for strings
+        // Raw strings, which may span lines and hold quotes and backslashes
+        if (c_like) {
+            std::string raw_end;
+            std::size_t body = rawStringBody(line, i, raw_end);
+            if (body != npos) {
+                std::size_t end = line.find(raw_end, body);
+                if (end == npos) {
+                    put(i, n - i, Renderer::CP_SYNTAX_STRING);
+                    state.kind = LexState::RAW_STRING;
+                    state.raw_end = std::move(raw_end);
+                    return;
+                }
+                end += raw_end.size();
+                put(i, end - i, Renderer::CP_SYNTAX_STRING);
+                i = end;
+                continue;
+            }
+        }
+
+        // Strings and character literals
         if (line[i] == '"' || line[i] == '\'') {
-            char quote = line[i];
-            size_t start = i;
-            size_t end = start + 1;
-            while (end < line.length() && (line[end] != quote || line[end - 1] == '\\')) {
-                end++;
+            std::size_t end = quoteEnd(line, i + 1, line[i]);
+            if (end == npos) {
+                put(i, n - i, Renderer::CP_SYNTAX_STRING);
+                if (continued && line[i] == '"') state.kind = LexState::STRING;
+                return;
             }
-            if (end < line.length()) end++;
-            tokens.push_back({line.substr(start, end - start), Renderer::CP_SYNTAX_STRING});
+            put(i, end - i, Renderer::CP_SYNTAX_STRING);
             i = end;
             continue;
         }
 
-        // Check for numbers (decimal, hex, binary)
-        if (isdigit(line[i]) || (line[i] == '.' && i + 1 < line.length() && isdigit(line[i+1]))) {
+        // Numbers (decimal, hex, binary); C++14 digit separators
+        if (isdigit(line[i]) || (line[i] == '.' && i + 1 < n && isdigit(line[i+1]))) {
             size_t start = i;
-            if (i + 1 < line.length() && line[i] == '0' && (line[i+1] == 'x' || line[i+1] == 'X')) { // Hex
+            auto separator = [&](std::size_t k) {
+                return c_like && line[k] == '\'' && k + 1 < n && isxdigit(line[k + 1]);
+            };
+            if (i + 1 < n && line[i] == '0' && (line[i+1] == 'x' || line[i+1] == 'X')) { // Hex
                 i += 2;
-                while (i < line.length() && isxdigit(line[i])) i++;
-            } else if (i + 1 < line.length() && line[i] == '0' && (line[i+1] == 'b' || line[i+1] == 'B')) { // Binary
+                while (i < n && (isxdigit(line[i]) || separator(i))) i++;
+            } else if (i + 1 < n && line[i] == '0' && (line[i+1] == 'b' || line[i+1] == 'B')) { // Binary
                 i += 2;
-                while (i < line.length() && (line[i] == '0' || line[i] == '1')) i++;
+                while (i < n && (line[i] == '0' || line[i] == '1' || separator(i))) i++;
             } else { // Decimal or float
-                while (i < line.length() && (isdigit(line[i]) || line[i] == '.')) i++;
+                while (i < n && (isdigit(line[i]) || line[i] == '.' || separator(i))) i++;
             }
-            // Check for number suffixes like f, u, l
-            while (i < line.length() && (tolower(line[i]) == 'u' || tolower(line[i]) == 'l' || tolower(line[i]) == 'f')) i++;
-            tokens.push_back({line.substr(start, i - start), Renderer::CP_SYNTAX_NUMBER});
+            // Number suffixes like f, u, l
+            while (i < n && (tolower(line[i]) == 'u' || tolower(line[i]) == 'l' || tolower(line[i]) == 'f')) i++;
+            put(start, i - start, Renderer::CP_SYNTAX_NUMBER);
             continue;
         }
 
-        // Check for keywords or identifiers
+        // Keywords or identifiers
         if (isalpha(line[i]) || line[i] == '_') {
             size_t start = i;
-            while (i < line.length() && (isalnum(line[i]) || line[i] == '_')) i++;
-            std::string word = line.substr(start, i - start);
-            
-            std::string lookup_word = word;
-            if (buffer.syntax_type == EditorBuffer::ST_CMAKE) {
-                std::transform(lookup_word.begin(), lookup_word.end(), lookup_word.begin(), ::tolower);
+            while (i < n && isWordChar(line[i])) i++;
+            if (!keywords) {
+                put(start, i - start, Renderer::CP_DEFAULT_TEXT);
+                continue;
             }
-
-            if (buffer.keywords.count(lookup_word)) {
-                int color = buffer.keywords.at(lookup_word);
-                int flags = renderer.getStyleFlags(static_cast<Renderer::ColorPairID>(color));
-                tokens.push_back({word, color, flags});
-            } else {
-                tokens.push_back({word, Renderer::CP_DEFAULT_TEXT});
+            std::string lookup_word = line.substr(start, i - start);
+            if (type == EditorBuffer::ST_CMAKE) {
+                std::transform(lookup_word.begin(), lookup_word.end(), lookup_word.begin(), ::tolower);
             }
+            auto kw = keywords->find(lookup_word);
+            if (kw != keywords->end()) put(start, i - start, kw->second, Span::Keyword);
+            else put(start, i - start, Renderer::CP_DEFAULT_TEXT);
             continue;
         }
 
-        // Fallback for any other character (operators, punctuation, etc.)
-        tokens.push_back({line.substr(i, 1), Renderer::CP_DEFAULT_TEXT});
+        // Any other character (operators, punctuation, brackets)
+        const bool bracket = std::strchr("(){}[]", line[i]) != nullptr;
+        put(i, 1, Renderer::CP_DEFAULT_TEXT, bracket ? Span::Bracket : Span::Plain);
         i++;
     }
+}
+
+} // namespace
+
+std::vector<SyntaxToken> SyntaxHighlighter::parseLine(const EditorBuffer& buffer, const std::string& line,
+                                                      const Renderer& renderer, LexState& state) {
+    std::vector<SyntaxToken> tokens;
+    lex(buffer.syntax_type, &buffer.keywords, line, state, [&](std::size_t start, std::size_t len, int color, Span span) {
+        int flags = span == Span::Keyword ? renderer.getStyleFlags(static_cast<Renderer::ColorPairID>(color)) : 0;
+        tokens.push_back({line.substr(start, len), color, flags});
+    });
     return tokens;
 }
+
+void SyntaxHighlighter::scanLine(EditorBuffer::SyntaxType type, const std::string& line, LexState& state,
+                                 std::vector<SyntaxBracket>& brackets) {
+    lex(type, nullptr, line, state, [&](std::size_t start, std::size_t, int, Span span) {
+        if (span == Span::Bracket) brackets.push_back({static_cast<std::uint32_t>(start), line[start]});
+    });
+}
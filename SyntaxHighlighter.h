@@ -3,6 +3,7 @@
 
 #include "EditorBuffer.h"
 #include "Renderer.h"
+#include <cstdint>
 #include <vector>
 #include <string>
 
@@ -12,11 +13,41 @@ struct SyntaxToken {
     int flags = 0;
 };
 
+// Construct a line leaves open for the next one.
+struct LexState {
+    enum Kind : std::uint8_t {
+        CODE,
+        BLOCK_COMMENT,   // /* without */
+        LINE_COMMENT,    // // comment ending in a backslash
+        STRING,          // string literal ending in a backslash
+        RAW_STRING,      // R"delim( without )delim"
+        DIRECTIVE        // preprocessor line ending in a backslash
+    };
+    Kind kind = CODE;
+    std::string raw_end;     // RAW_STRING: the )delim" that closes it
+
+    bool operator==(const LexState& o) const { return kind == o.kind && raw_end == o.raw_end; }
+    bool operator!=(const LexState& o) const { return !(*this == o); }
+};
+
+// A bracket in code, outside comments, strings and directives.
+struct SyntaxBracket {
+    std::uint32_t col;   // 0-based byte offset
+    char ch;
+};
+
 class SyntaxHighlighter {
 public:
     static void setSyntaxType(EditorBuffer& buffer);
     static void loadKeywords(EditorBuffer& buffer);
-    static std::vector<SyntaxToken> parseLine(EditorBuffer& buffer, const std::string& line, const Renderer& renderer);
+    // Tokens of `line`, which starts in `state`; `state` is advanced to the
+    // start of the next line.
+    static std::vector<SyntaxToken> parseLine(const EditorBuffer& buffer, const std::string& line,
+                                              const Renderer& renderer, LexState& state);
+    // The same lexer without building tokens: appends the brackets of
+    // `line` to `brackets` and advances `state`.
+    static void scanLine(EditorBuffer::SyntaxType type, const std::string& line, LexState& state,
+                         std::vector<SyntaxBracket>& brackets);
 };
 
 #endif
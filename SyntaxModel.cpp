@@ -0,0 +1,145 @@
+#include "SyntaxModel.h"
+
+#include <algorithm>
+
+namespace {
+
+char partnerOf(char ch) {
+    switch (ch) {
+    case '(': return ')';
+    case ')': return '(';
+    case '[': return ']';
+    case ']': return '[';
+    case '{': return '}';
+    case '}': return '{';
+    }
+    return 0;
+}
+
+bool isOpener(char ch) { return ch == '(' || ch == '[' || ch == '{'; }
+
+} // namespace
+
+void SyntaxModel::sync(const EditorBuffer& buffer) {
+    if (m_snapshot && m_snapshot->version() == buffer.version && m_syntax_type == buffer.syntax_type) return;
+
+    BufferSnapshotPtr now = buffer.snapshot();
+    const std::size_t lines = now->lineCount();
+    if (!m_snapshot || m_syntax_type != buffer.syntax_type || m_snapshot->fileId() != now->fileId()) {
+        m_syntax_type = buffer.syntax_type;
+        m_start.assign(lines + 1, LexState());
+        m_brackets.assign(lines, {});
+        m_valid = 0;
+        m_reuse_from = 1;
+        m_reuse_to = 0;
+        m_match_line = SIZE_MAX;
+        m_snapshot = std::move(now);
+        return;
+    }
+
+    // Lines [head, old_end) became [head, new_end).  The state at the start
+    // of `head` still holds; from the first line past both the edit and
+    // `head` on, the old states are kept as tentative, shifted by `delta`.
+    // The new snapshot copied only the chunks the edit marked, and diff()
+    // looks at no other lines, so none of this reads the rest of the file.
+    const auto [head, tail] = BufferSnapshot::diff(*m_snapshot, *now);
+    const std::size_t old_lines = m_snapshot->lineCount();
+    const std::ptrdiff_t delta = static_cast<std::ptrdiff_t>(lines) - static_cast<std::ptrdiff_t>(old_lines);
+    const std::size_t old_end = old_lines - tail;
+    std::size_t first_old = std::max(old_end, head + 1);
+    if (static_cast<std::ptrdiff_t>(head + 1) - delta > static_cast<std::ptrdiff_t>(first_old))
+        first_old = head + 1 - delta;
+    const std::size_t first_new = first_old + delta;
+
+    m_start.erase(m_start.begin() + head + 1, m_start.begin() + first_old);
+    m_start.insert(m_start.begin() + head + 1, first_new - head - 1, LexState());
+    m_brackets.erase(m_brackets.begin() + head, m_brackets.begin() + std::min(first_old, old_lines));
+    m_brackets.insert(m_brackets.begin() + head, lines - m_brackets.size(), {});
+
+    if (m_valid >= first_old) {
+        m_reuse_from = first_new;
+        m_reuse_to = m_valid + delta;
+    } else {
+        m_reuse_from = 1;
+        m_reuse_to = 0;
+    }
+    m_valid = std::min(m_valid, head);
+    m_snapshot = std::move(now);
+}
+
+void SyntaxModel::ensure(std::size_t idx) {
+    idx = std::min(idx, m_snapshot ? m_snapshot->lineCount() : 0);
+    while (m_valid < idx) {
+        LexState state = m_start[m_valid];
+        std::vector<SyntaxBracket>& brackets = m_brackets[m_valid];
+        brackets.clear();
+        SyntaxHighlighter::scanLine(m_syntax_type, m_snapshot->line(m_valid), state, brackets);
+        ++m_valid;
+        if (m_valid >= m_reuse_from && m_valid <= m_reuse_to && state == m_start[m_valid]) {
+            // Back in step with the text before the edit
+            m_valid = m_reuse_to;
+            m_reuse_from = 1;
+            m_reuse_to = 0;
+            continue;
+        }
+        m_start[m_valid] = std::move(state);
+    }
+}
+
+const LexState& SyntaxModel::stateAt(std::size_t idx) {
+    ensure(idx);
+    return m_start[std::min(idx, m_valid)];
+}
+
+std::optional<std::pair<SyntaxModel::Position, SyntaxModel::Position>>
+SyntaxModel::matchBracket(std::size_t line, std::size_t col) {
+    if (!m_snapshot) return std::nullopt;
+    if (m_match_version == m_snapshot->version() && m_match_line == line && m_match_col == col) return m_match;
+    m_match_version = m_snapshot->version();
+    m_match_line = line;
+    m_match_col = col;
+    m_match.reset();
+
+    ensure(line + 1);
+    if (line >= m_valid) return m_match;
+    const std::vector<SyntaxBracket>& brackets = m_brackets[line];
+    auto at = [&](std::size_t c) {
+        return std::find_if(brackets.begin(), brackets.end(), [c](const SyntaxBracket& b) { return b.col == c; });
+    };
+    auto it = at(col);
+    if (it == brackets.end() && col > 0) it = at(col - 1);
+    if (it == brackets.end()) return m_match;
+
+    Position from{line, it->col};
+    if (auto other = partner(from, it->ch)) m_match = std::make_pair(from, *other);
+    return m_match;
+}
+
+// Walks away from the bracket `ch` at `at`, counting the nesting of its kind
+// of bracket, to the one that closes (or opens) it.
+std::optional<SyntaxModel::Position> SyntaxModel::partner(Position at, char ch) {
+    const char other = partnerOf(ch);
+    int depth = 0;
+    if (isOpener(ch)) {
+        const std::size_t last = std::min(m_snapshot->lineCount(), at.line + MAX_MATCH_LINES);
+        for (std::size_t line = at.line; line < last; ++line) {
+            ensure(line + 1);
+            for (const SyntaxBracket& b : m_brackets[line]) {
+                if (line == at.line && b.col <= at.col) continue;
+                if (b.ch == ch) ++depth;
+                else if (b.ch == other && depth-- == 0) return Position{line, b.col};
+            }
+        }
+    } else {
+        const std::size_t first = at.line >= MAX_MATCH_LINES ? at.line - MAX_MATCH_LINES : 0;
+        for (std::size_t line = at.line + 1; line-- > first; ) {
+            const auto& brackets = m_brackets[line];
+            for (auto b = brackets.rbegin(); b != brackets.rend(); ++b) {
+                if (line == at.line && b->col >= at.col) continue;
+                if (b->ch == ch) ++depth;
+                else if (b->ch == other && depth-- == 0) return Position{line, b->col};
+            }
+        }
+    }
+    return std::nullopt;
+}
@@ -0,0 +1,63 @@
+#ifndef SYNTAXMODEL_H
+#define SYNTAXMODEL_H
+
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+#include "EditorBuffer.h"
+#include "SyntaxHighlighter.h"
+
+// Lexer state at the start of every line of one buffer, and the brackets
+// of every line, for highlighting and bracket matching.
+//
+// Lines are lexed lazily, top down, only as far as a query needs.  After an
+// edit the states before the changed lines are kept, and the old states
+// after them are kept as tentative: relexing from the edit stops at the
+// first line whose start state comes out the same as before, so typing in
+// a function body relexes a line or two however large the file is, while
+// opening a block comment relexes as far as it reaches.
+class SyntaxModel {
+public:
+    struct Position {
+        std::size_t line;   // 0-based
+        std::size_t col;    // 0-based byte offset
+    };
+
+    // Follows the buffer's text and syntax type.  UI thread only.
+    void sync(const EditorBuffer& buffer);
+
+    // State at the start of 0-based line `idx`.
+    const LexState& stateAt(std::size_t idx);
+
+    // The bracket at `col` of `line`, or else the one just before it, and
+    // the bracket it pairs with.  Nothing if neither is a bracket or the
+    // partner is unbalanced or more than MAX_MATCH_LINES away.
+    std::optional<std::pair<Position, Position>> matchBracket(std::size_t line, std::size_t col);
+
+private:
+    static constexpr std::size_t MAX_MATCH_LINES = 5000;
+
+    // Lexes until the first `idx` lines are known.
+    void ensure(std::size_t idx);
+    std::optional<Position> partner(Position at, char ch);
+
+    BufferSnapshotPtr m_snapshot;
+    EditorBuffer::SyntaxType m_syntax_type = EditorBuffer::ST_NONE;
+    std::vector<LexState> m_start;                     // one per line, plus the end
+    std::vector<std::vector<SyntaxBracket>> m_brackets;
+    // m_start[0..m_valid] and m_brackets[0..m_valid) are up to date
+    std::size_t m_valid = 0;
+    // Tentative lines from before the last edit: m_start[m_reuse_from..m_reuse_to]
+    // and m_brackets[m_reuse_from..m_reuse_to) hold if m_start[m_reuse_from] does
+    std::size_t m_reuse_from = 1;
+    std::size_t m_reuse_to = 0;
+
+    // Last matchBracket() query and its answer
+    std::uint64_t m_match_version = 0;
+    std::size_t m_match_line = SIZE_MAX;
+    std::size_t m_match_col = SIZE_MAX;
+    std::optional<std::pair<Position, Position>> m_match;
+};
+
+#endif // SYNTAXMODEL_H
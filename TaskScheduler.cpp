@@ -0,0 +1,158 @@
+#include "TaskScheduler.h"
+
+#include <algorithm>
+
+namespace {
+
+std::int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// The first worker is kept free for Interactive and Visible work so a long
+// background job can never delay go-to-definition.
+constexpr std::size_t RESERVED_WORKER = 0;
+
+} // namespace
+
+TaskScheduler& TaskScheduler::instance() {
+    static TaskScheduler scheduler;
+    return scheduler;
+}
+
+TaskScheduler::~TaskScheduler() {
+    shutdown();
+}
+
+void TaskScheduler::start() {
+    std::size_t count = std::max(2u, std::thread::hardware_concurrency());
+    m_workers.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) m_workers.push_back(std::make_unique<Worker>());
+    for (std::size_t i = 0; i < count; ++i) {
+        m_workers[i]->thread = std::thread(&TaskScheduler::workerLoop, this, i);
+    }
+}
+
+CancellationToken TaskScheduler::submit(TaskLane lane, Task task) {
+    return submit(lane, std::move(task), CancellationToken());
+}
+
+CancellationToken TaskScheduler::submit(TaskLane lane, Task task, CancellationToken token) {
+    if (m_stopping) { token.cancel(); return token; }
+    std::call_once(m_started, &TaskScheduler::start, this);
+
+    // Spread submissions; Background/Idle never land on the reserved worker.
+    std::size_t n = m_workers.size();
+    std::size_t idx = m_next_worker.fetch_add(1, std::memory_order_relaxed) % n;
+    if (idx == RESERVED_WORKER && lane >= TaskLane::Background) idx = 1 + idx % (n - 1);
+
+    {
+        Worker& w = *m_workers[idx];
+        std::lock_guard<std::mutex> lock(w.mutex);
+        w.lanes[static_cast<int>(lane)].push_back(Job{std::move(task), token});
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_wake_mutex);
+        ++m_generation;
+    }
+    m_wake.notify_all();
+    return token;
+}
+
+bool TaskScheduler::idleAllowed() const {
+    return nowMs() - m_last_activity_ms.load(std::memory_order_relaxed) >= IDLE_DELAY.count();
+}
+
+bool TaskScheduler::takeJob(std::size_t self, Job& out) {
+    const std::size_t n = m_workers.size();
+    int lowest = static_cast<int>(TaskLane::COUNT) - 1;
+    if (self == RESERVED_WORKER) lowest = static_cast<int>(TaskLane::Visible);
+    else if (!idleAllowed()) lowest = static_cast<int>(TaskLane::Background);
+
+    for (int lane = 0; lane <= lowest; ++lane) {
+        // Own queue first (front), then steal from the others (back).
+        for (std::size_t k = 0; k < n; ++k) {
+            Worker& w = *m_workers[(self + k) % n];
+            std::lock_guard<std::mutex> lock(w.mutex);
+            auto& q = w.lanes[lane];
+            while (!q.empty()) {
+                Job job;
+                if (k == 0) { job = std::move(q.front()); q.pop_front(); }
+                else        { job = std::move(q.back());  q.pop_back();  }
+                if (job.token.cancelled()) continue;
+                out = std::move(job);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void TaskScheduler::workerLoop(std::size_t self) {
+    while (!m_stopping) {
+        std::uint64_t seen;
+        {
+            std::lock_guard<std::mutex> lock(m_wake_mutex);
+            seen = m_generation;
+        }
+
+        Job job;
+        if (takeJob(self, job)) {
+            Worker& w = *m_workers[self];
+            {
+                std::lock_guard<std::mutex> lock(w.mutex);
+                w.running = job.token;
+            }
+            // shutdown() may have missed the job between takeJob and here
+            if (m_stopping) job.token.cancel();
+            job.fn(job.token);
+            std::lock_guard<std::mutex> lock(w.mutex);
+            w.running.reset();
+            continue;
+        }
+
+        // Nothing runnable: sleep until something is submitted.  The timeout
+        // lets held-back Idle work start once the user goes quiet.
+        std::unique_lock<std::mutex> lock(m_wake_mutex);
+        m_wake.wait_for(lock, IDLE_DELAY, [&] { return m_stopping || m_generation != seen; });
+    }
+}
+
+void TaskScheduler::post(std::function<void()> fn) {
+    std::lock_guard<std::mutex> lock(m_posted_mutex);
+    m_posted.push_back(std::move(fn));
+}
+
+bool TaskScheduler::runPosted() {
+    std::vector<std::function<void()>> ready;
+    {
+        std::lock_guard<std::mutex> lock(m_posted_mutex);
+        ready.swap(m_posted);
+    }
+    for (auto& fn : ready) fn();
+    return !ready.empty();
+}
+
+void TaskScheduler::noteUserActivity() {
+    m_last_activity_ms.store(nowMs(), std::memory_order_relaxed);
+}
+
+void TaskScheduler::shutdown() {
+    if (m_stopping.exchange(true)) return;
+    for (auto& w : m_workers) {
+        std::lock_guard<std::mutex> lock(w->mutex);
+        for (auto& q : w->lanes) {
+            for (auto& job : q) job.token.cancel();
+            q.clear();
+        }
+        if (w->running) w->running->cancel();
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_wake_mutex);
+        ++m_generation;
+    }
+    m_wake.notify_all();
+    for (auto& w : m_workers) {
+        if (w->thread.joinable()) w->thread.join();
+    }
+}
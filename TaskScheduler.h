@@ -0,0 +1,141 @@
+#ifndef TASKSCHEDULER_H
+#define TASKSCHEDULER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Priority lanes, highest first.  A worker always drains a higher lane
+// (its own queue, then stealing from its siblings) before looking at a
+// lower one.
+enum class TaskLane {
+    Interactive,   // the user is waiting: go-to-definition, completion
+    Visible,       // affects what is on screen: viewport highlighting, dir listing
+    Background,    // indexing, diagnostics, library scan
+    Idle,          // only runs after the user has stopped typing for a while
+    COUNT
+};
+
+// Shared cancellation flag.  Copies observe the same state; cancelling any
+// copy cancels the task.  Queued tasks whose token is cancelled are dropped
+// without running, running tasks are expected to poll cancelled().
+class CancellationToken {
+public:
+    CancellationToken() : m_flag(std::make_shared<std::atomic<bool>>(false)) {}
+    void cancel() const { m_flag->store(true, std::memory_order_relaxed); }
+    bool cancelled() const { return m_flag->load(std::memory_order_relaxed); }
+private:
+    std::shared_ptr<std::atomic<bool>> m_flag;
+};
+
+// Process-wide work-stealing thread pool shared by every asynchronous
+// feature.  Results are handed back to the UI thread through post(); the
+// main loop calls runPosted() once per iteration, so completion callbacks
+// may touch editor state without locking.
+class TaskScheduler {
+public:
+    using Task = std::function<void(const CancellationToken&)>;
+
+    static TaskScheduler& instance();
+
+    ~TaskScheduler();
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    // Queues `task` on `lane`.  The returned token cancels it.
+    CancellationToken submit(TaskLane lane, Task task);
+    CancellationToken submit(TaskLane lane, Task task, CancellationToken token);
+
+    // Runs `work` on a worker and then `on_done(result)` on the UI thread.
+    // `on_done` is skipped if the token was cancelled meanwhile or if
+    // `still_valid` (evaluated on the UI thread) returns false -- pass a
+    // check of the buffer version the work was started from.
+    template <typename Work, typename Done>
+    CancellationToken submitWithResult(TaskLane lane, Work work, Done on_done,
+                                       std::function<bool()> still_valid = {}) {
+        using Result = std::invoke_result_t<Work, const CancellationToken&>;
+        return submit(lane, [this, work = std::move(work), on_done = std::move(on_done),
+                             still_valid = std::move(still_valid)](const CancellationToken& token) mutable {
+            auto result = std::make_shared<Result>(work(token));
+            if (token.cancelled()) return;
+            post([token, result, on_done = std::move(on_done), still_valid = std::move(still_valid)]() mutable {
+                if (token.cancelled()) return;
+                if (still_valid && !still_valid()) return;
+                on_done(std::move(*result));
+            });
+        });
+    }
+
+    // std::async replacement running on the pool.
+    template <typename Fn>
+    auto async(TaskLane lane, Fn fn) -> std::future<std::invoke_result_t<Fn>> {
+        using Result = std::invoke_result_t<Fn>;
+        auto job = std::make_shared<std::packaged_task<Result()>>(std::move(fn));
+        auto fut = job->get_future();
+        submit(lane, [job](const CancellationToken&) { (*job)(); });
+        return fut;
+    }
+
+    // Queues `fn` for the UI thread.  Safe to call from any thread.
+    void post(std::function<void()> fn);
+
+    // Runs everything queued by post().  UI thread only; returns true if at
+    // least one callback ran (the screen probably needs a redraw).
+    bool runPosted();
+
+    // Called by the main loop on every key press; holds back the Idle lane.
+    void noteUserActivity();
+
+    // Cancels everything still queued or running and joins the workers.
+    void shutdown();
+
+private:
+    TaskScheduler() = default;
+
+    struct Job {
+        Task fn;
+        CancellationToken token;
+    };
+
+    // One set of lane queues per worker.  The owner pops from the front,
+    // thieves take from the back.
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Job> lanes[static_cast<int>(TaskLane::COUNT)];
+        std::optional<CancellationToken> running;   // token of the job being run
+        std::thread thread;
+    };
+
+    void start();
+    void workerLoop(std::size_t self);
+    bool takeJob(std::size_t self, Job& out);
+    bool idleAllowed() const;
+
+    static constexpr std::chrono::milliseconds IDLE_DELAY{750};
+
+    std::once_flag m_started;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::atomic<std::size_t> m_next_worker{0};
+    std::atomic<bool> m_stopping{false};
+
+    std::mutex m_wake_mutex;
+    std::condition_variable m_wake;
+    std::uint64_t m_generation = 0;   // bumped per submit, guarded by m_wake_mutex
+
+    std::atomic<std::int64_t> m_last_activity_ms{0};
+
+    std::mutex m_posted_mutex;
+    std::vector<std::function<void()>> m_posted;
+};
+
+#endif // TASKSCHEDULER_H
@@ -0,0 +1,619 @@
+#include "Terminal.h"
+
+#include <algorithm>
+#include <cwchar>
+
+namespace {
+
+// DEC special graphics for '`' to '~', selected with ESC ( 0
+const char32_t LINE_DRAWING[] = {
+    U'◆', U'▒', U'␉', U'␌', U'␍', U'␊', U'°', U'±', U'␤', U'␋', U'┘', U'┐', U'┌', U'└', U'┼', U'⎺',
+    U'⎻', U'─', U'⎼', U'⎽', U'├', U'┤', U'┴', U'┬', U'│', U'≤', U'≥', U'π', U'≠', U'£', U'·'
+};
+
+// The 16 ANSI colours as xterm shows them
+const int PALETTE[16][3] = {
+    {0, 0, 0}, {205, 0, 0}, {0, 205, 0}, {205, 205, 0}, {0, 0, 238}, {205, 0, 205}, {0, 205, 205}, {229, 229, 229},
+    {127, 127, 127}, {255, 0, 0}, {0, 255, 0}, {255, 255, 0}, {92, 92, 255}, {255, 0, 255}, {0, 255, 255}, {255, 255, 255}
+};
+
+std::uint8_t nearestColor(int r, int g, int b) {
+    int best = 0;
+    long best_dist = -1;
+    for (int i = 0; i < 16; ++i) {
+        long dr = r - PALETTE[i][0], dg = g - PALETTE[i][1], db = b - PALETTE[i][2];
+        long dist = dr * dr + dg * dg + db * db;
+        if (best_dist < 0 || dist < best_dist) { best = i; best_dist = dist; }
+    }
+    return static_cast<std::uint8_t>(best);
+}
+
+// Index into xterm's 256 colours: the 16 ANSI colours, a 6x6x6 cube and
+// a grey ramp
+std::uint8_t nearestColor(int index) {
+    if (index < 16) return static_cast<std::uint8_t>(std::max(index, 0));
+    if (index < 232) {
+        static const int LEVELS[6] = {0, 95, 135, 175, 215, 255};
+        index -= 16;
+        return nearestColor(LEVELS[index / 36], LEVELS[index / 6 % 6], LEVELS[index % 6]);
+    }
+    int grey = 8 + 10 * (std::min(index, 255) - 232);
+    return nearestColor(grey, grey, grey);
+}
+
+} // namespace
+
+Terminal::Terminal(int rows, int cols)
+    : m_rows(std::max(rows, 1)), m_cols(std::max(cols, 1)),
+      m_main(m_rows, std::vector<TermCell>(m_cols)), m_alt(m_rows, std::vector<TermCell>(m_cols)),
+      m_bottom(m_rows - 1) {}
+
+std::string Terminal::takeReplies() {
+    std::string replies;
+    replies.swap(m_replies);
+    return replies;
+}
+
+void Terminal::feed(std::string_view bytes) {
+    for (unsigned char c : bytes) {
+        if (m_utf8_left > 0) {
+            if ((c & 0xc0) == 0x80) {
+                m_utf8 = (m_utf8 << 6) | (c & 0x3f);
+                if (--m_utf8_left == 0) print(m_utf8);
+                continue;
+            }
+            m_utf8_left = 0;
+            print(U'\uFFFD');   // truncated sequence; `c` is looked at on its own
+        }
+
+        switch (m_state) {
+        case State::GROUND:
+            if (c < 0x20 || c == 0x7f) control(c);
+            else if (c < 0x80) print(c);
+            else if ((c & 0xe0) == 0xc0) { m_utf8 = c & 0x1f; m_utf8_left = 1; }
+            else if ((c & 0xf0) == 0xe0) { m_utf8 = c & 0x0f; m_utf8_left = 2; }
+            else if ((c & 0xf8) == 0xf0) { m_utf8 = c & 0x07; m_utf8_left = 3; }
+            else print(U'\uFFFD');
+            break;
+        case State::ESCAPE:
+            if (c < 0x20) control(c);
+            else escape(c);
+            break;
+        case State::ESCAPE_INTERMEDIATE:
+            if (c < 0x20) {
+                control(c);
+            } else if (c >= 0x30) {
+                // Character set designation; ESC # and ESC % sequences are ignored
+                if (m_intermediate == '(') m_charsets[0] = static_cast<char>(c);
+                else if (m_intermediate == ')') m_charsets[1] = static_cast<char>(c);
+                m_state = State::GROUND;
+            }
+            break;
+        case State::CSI:
+            if (c < 0x20) {
+                control(c);   // controls inside a sequence act immediately
+            } else if (c >= '0' && c <= '9') {
+                if (m_param_count == 0) m_param_count = 1;
+                int& p = m_params[m_param_count - 1];
+                p = std::min(p * 10 + (c - '0'), 99999);
+            } else if (c == ';' || c == ':') {
+                if (m_param_count == 0) m_param_count = 1;
+                if (m_param_count < MAX_PARAMS) m_params[m_param_count++] = 0;
+            } else if (c >= 0x3c && c <= 0x3f) {
+                m_private = static_cast<char>(c);
+            } else if (c >= 0x20 && c <= 0x2f) {
+                m_intermediate = static_cast<char>(c);
+            } else if (c >= 0x40 && c <= 0x7e) {
+                m_state = State::GROUND;
+                csi(c);
+            }
+            break;
+        case State::STRING:
+            if (c == 0x07) {
+                if (m_intermediate == ']') osc();
+                m_state = State::GROUND;
+            } else if (c == 0x1b) {
+                m_state = State::STRING_ESC;
+            } else if (c == 0x18 || c == 0x1a) {
+                m_state = State::GROUND;
+            } else if (m_intermediate == ']' && m_osc.size() < MAX_OSC) {
+                m_osc.push_back(static_cast<char>(c));
+            }
+            break;
+        case State::STRING_ESC:
+            if (m_intermediate == ']') osc();
+            // ESC \ ends the string; anything else starts a new sequence
+            m_state = State::GROUND;
+            if (c != '\\') {
+                control(0x1b);
+                if (c < 0x20) control(c);
+                else escape(c);
+            }
+            break;
+        }
+    }
+}
+
+void Terminal::control(unsigned char c) {
+    switch (c) {
+    case 0x08: // BS
+        if (m_x > 0) --m_x;
+        m_wrap_pending = false;
+        break;
+    case 0x09: // HT
+        m_x = std::min((m_x / 8 + 1) * 8, m_cols - 1);
+        m_wrap_pending = false;
+        break;
+    case 0x0a: case 0x0b: case 0x0c: // LF, VT, FF
+        lineFeed();
+        break;
+    case 0x0d: // CR
+        m_x = 0;
+        m_wrap_pending = false;
+        break;
+    case 0x0e: m_gl = 1; break; // SO
+    case 0x0f: m_gl = 0; break; // SI
+    case 0x18: case 0x1a: // CAN, SUB
+        m_state = State::GROUND;
+        break;
+    case 0x1b:
+        m_state = State::ESCAPE;
+        m_params.fill(0);
+        m_param_count = 0;
+        m_private = 0;
+        m_intermediate = 0;
+        break;
+    default: // BEL and the rest
+        break;
+    }
+}
+
+void Terminal::escape(unsigned char c) {
+    m_state = State::GROUND;
+    switch (c) {
+    case '[': m_state = State::CSI; break;
+    case ']':
+        m_state = State::STRING;
+        m_intermediate = ']';
+        m_osc.clear();
+        break;
+    case 'P': case 'X': case '^': case '_':
+        m_state = State::STRING;
+        m_intermediate = static_cast<char>(c);
+        break;
+    case '7': saveCursor(); break;
+    case '8': restoreCursor(); break;
+    case 'D': lineFeed(); break;
+    case 'E': m_x = 0; lineFeed(); break;
+    case 'M': reverseIndex(); break;
+    case 'c': reset(); break;
+    default:
+        if (c >= 0x20 && c <= 0x2f) {
+            m_intermediate = static_cast<char>(c);
+            m_state = State::ESCAPE_INTERMEDIATE;
+        }
+        break;   // keypad modes, ST and the rest
+    }
+}
+
+int Terminal::param(int index, int fallback) const {
+    if (index >= m_param_count || m_params[index] == 0) return fallback;
+    return m_params[index];
+}
+
+TermCell Terminal::blank() const {
+    TermCell cell;
+    cell.bg = m_pen.bg;
+    return cell;
+}
+
+void Terminal::csi(unsigned char final_byte) {
+    if (m_intermediate == '!' && final_byte == 'p') {   // soft reset
+        m_pen = TermCell{};
+        m_insert = m_origin = m_app_cursor = false;
+        m_autowrap = m_cursor_visible = true;
+        m_top = 0;
+        m_bottom = m_rows - 1;
+        return;
+    }
+    if (m_intermediate != 0) return;   // cursor style and the like
+    if (m_private == '>' || m_private == '=') {
+        if (final_byte == 'c') m_replies += "\033[>0;10;1c";
+        return;
+    }
+    if (m_private == '?') {
+        if (final_byte == 'h' || final_byte == 'l') setMode(final_byte == 'h');
+        return;
+    }
+    if (m_private != 0) return;
+
+    Screen& scr = screen();
+    int n = param(0, 1);
+    switch (final_byte) {
+    case '@': { // ICH
+        std::vector<TermCell>& line = scr[m_y];
+        n = std::min(n, m_cols - m_x);
+        std::copy_backward(line.begin() + m_x, line.end() - n, line.end());
+        std::fill(line.begin() + m_x, line.begin() + m_x + n, blank());
+        m_wrap_pending = false;
+        break;
+    }
+    case 'A': case 'F': // CUU, CPL
+        m_y = std::max(m_y - n, m_y >= m_top ? m_top : 0);
+        if (final_byte == 'F') m_x = 0;
+        m_wrap_pending = false;
+        break;
+    case 'B': case 'e': case 'E': // CUD, VPR, CNL
+        m_y = std::min(m_y + n, m_y <= m_bottom ? m_bottom : m_rows - 1);
+        if (final_byte == 'E') m_x = 0;
+        m_wrap_pending = false;
+        break;
+    case 'C': case 'a': // CUF, HPR
+        m_x = std::min(m_x + n, m_cols - 1);
+        m_wrap_pending = false;
+        break;
+    case 'D': // CUB
+        m_x = std::max(m_x - n, 0);
+        m_wrap_pending = false;
+        break;
+    case 'G': case '`': // CHA, HPA
+        m_x = std::clamp(n - 1, 0, m_cols - 1);
+        m_wrap_pending = false;
+        break;
+    case 'H': case 'f': // CUP
+        moveTo(param(1, 1) - 1, n - 1);
+        break;
+    case 'd': // VPA
+        moveTo(m_x, n - 1);
+        break;
+    case 'I': // CHT
+        while (n-- > 0 && m_x < m_cols - 1) m_x = std::min((m_x / 8 + 1) * 8, m_cols - 1);
+        m_wrap_pending = false;
+        break;
+    case 'Z': // CBT
+        while (n-- > 0 && m_x > 0) m_x = (m_x - 1) / 8 * 8;
+        m_wrap_pending = false;
+        break;
+    case 'J': // ED
+        switch (param(0, 0)) {
+        case 0: eraseCells(m_y, m_x, m_cols); eraseRows(m_y + 1, m_rows); break;
+        case 1: eraseRows(0, m_y); eraseCells(m_y, 0, m_x + 1); break;
+        case 2: eraseRows(0, m_rows); break;
+        case 3: m_history.clear(); break;
+        }
+        break;
+    case 'K': // EL
+        switch (param(0, 0)) {
+        case 0: eraseCells(m_y, m_x, m_cols); break;
+        case 1: eraseCells(m_y, 0, m_x + 1); break;
+        case 2: eraseCells(m_y, 0, m_cols); break;
+        }
+        break;
+    case 'L': // IL
+        if (m_y >= m_top && m_y <= m_bottom) {
+            scrollDown(m_y, m_bottom, n);
+            m_x = 0;
+            m_wrap_pending = false;
+        }
+        break;
+    case 'M': // DL
+        if (m_y >= m_top && m_y <= m_bottom) {
+            scrollUp(m_y, m_bottom, n);
+            m_x = 0;
+            m_wrap_pending = false;
+        }
+        break;
+    case 'P': { // DCH
+        std::vector<TermCell>& line = scr[m_y];
+        n = std::min(n, m_cols - m_x);
+        std::copy(line.begin() + m_x + n, line.end(), line.begin() + m_x);
+        std::fill(line.end() - n, line.end(), blank());
+        m_wrap_pending = false;
+        break;
+    }
+    case 'X': // ECH
+        eraseCells(m_y, m_x, std::min(m_cols, m_x + n));
+        break;
+    case 'S': // SU
+        scrollUp(m_top, m_bottom, n, true);
+        break;
+    case 'T': // SD; with more parameters it is a mouse tracking request
+        if (m_param_count <= 1) scrollDown(m_top, m_bottom, n);
+        break;
+    case 'b': // REP
+        for (n = std::min(n, m_rows * m_cols); n > 0; --n) print(m_last_char);
+        break;
+    case 'c': // DA: a VT100 with advanced video
+        if (param(0, 0) == 0) m_replies += "\033[?1;2c";
+        break;
+    case 'h': case 'l':
+        setMode(final_byte == 'h');
+        break;
+    case 'm':
+        sgr();
+        break;
+    case 'n': // DSR
+        if (param(0, 0) == 5) {
+            m_replies += "\033[0n";
+        } else if (param(0, 0) == 6) {
+            m_replies += "\033[" + std::to_string(m_y + 1 - (m_origin ? m_top : 0)) + ";" +
+                         std::to_string(m_x + 1) + "R";
+        }
+        break;
+    case 'r': { // DECSTBM
+        int top = param(0, 1) - 1, bottom = param(1, m_rows) - 1;
+        if (top < bottom && bottom < m_rows) {
+            m_top = top;
+            m_bottom = bottom;
+        }
+        moveTo(0, 0);
+        break;
+    }
+    case 's': saveCursor(); break;
+    case 'u': restoreCursor(); break;
+    default: break;
+    }
+}
+
+void Terminal::setMode(bool on) {
+    for (int i = 0; i < std::max(m_param_count, 1); ++i) {
+        const int mode = m_params[i];
+        if (m_private != '?') {
+            if (mode == 4) m_insert = on;
+            continue;
+        }
+        switch (mode) {
+        case 1: m_app_cursor = on; break;
+        case 6: m_origin = on; moveTo(0, 0); break;
+        case 7: m_autowrap = on; break;
+        case 25: m_cursor_visible = on; break;
+        case 47: case 1047: setAltScreen(on, false); break;
+        case 1048: if (on) saveCursor(); else restoreCursor(); break;
+        case 1049: setAltScreen(on, true); break;
+        default: break;   // mouse reporting, bracketed paste and the rest
+        }
+    }
+}
+
+void Terminal::sgr() {
+    if (m_param_count == 0) {
+        m_pen = TermCell{};
+        return;
+    }
+    for (int i = 0; i < m_param_count; ++i) {
+        const int p = m_params[i];
+        if (p == 0) {
+            m_pen = TermCell{};
+        } else if (p == 1) {
+            m_pen.attr |= TermCell::BOLD;
+        } else if (p == 4) {
+            m_pen.attr |= TermCell::UNDERLINE;
+        } else if (p == 7) {
+            m_pen.attr |= TermCell::REVERSE;
+        } else if (p == 22) {
+            m_pen.attr &= ~TermCell::BOLD;
+        } else if (p == 24) {
+            m_pen.attr &= ~TermCell::UNDERLINE;
+        } else if (p == 27) {
+            m_pen.attr &= ~TermCell::REVERSE;
+        } else if (p >= 30 && p <= 37) {
+            m_pen.fg = static_cast<std::uint8_t>(p - 30);
+        } else if (p == 39) {
+            m_pen.fg = TermCell::DEFAULT_COLOR;
+        } else if (p >= 40 && p <= 47) {
+            m_pen.bg = static_cast<std::uint8_t>(p - 40);
+        } else if (p == 49) {
+            m_pen.bg = TermCell::DEFAULT_COLOR;
+        } else if (p >= 90 && p <= 97) {
+            m_pen.fg = static_cast<std::uint8_t>(p - 90 + 8);
+        } else if (p >= 100 && p <= 107) {
+            m_pen.bg = static_cast<std::uint8_t>(p - 100 + 8);
+        } else if (p == 38 || p == 48) {
+            std::uint8_t& color = p == 38 ? m_pen.fg : m_pen.bg;
+            if (i + 2 < m_param_count && m_params[i + 1] == 5) {
+                color = nearestColor(m_params[i + 2]);
+                i += 2;
+            } else if (i + 4 < m_param_count && m_params[i + 1] == 2) {
+                color = nearestColor(m_params[i + 2], m_params[i + 3], m_params[i + 4]);
+                i += 4;
+            }
+        }
+    }
+}
+
+void Terminal::osc() {
+    // 0 sets icon name and title, 2 the title; colour queries go unanswered
+    const std::size_t semi = m_osc.find(';');
+    if (semi == std::string::npos) return;
+    const std::string kind = m_osc.substr(0, semi);
+    if (kind == "0" || kind == "2") m_title = m_osc.substr(semi + 1);
+}
+
+void Terminal::print(char32_t ch) {
+    if (m_charsets[m_gl] == '0' && ch >= 0x60 && ch <= 0x7e) ch = LINE_DRAWING[ch - 0x60];
+    int width = 1;
+    if (ch >= 0x300) {
+        const int w = ::wcwidth(static_cast<wchar_t>(ch));
+        if (w == 0) return;   // combining marks are dropped
+        if (w == 2) width = 2;
+    }
+    m_last_char = ch;
+
+    if (m_wrap_pending) {
+        m_x = 0;
+        lineFeed();
+    }
+    if (width == 2 && m_x == m_cols - 1) {
+        if (!m_autowrap || m_cols < 2) return;
+        screen()[m_y][m_x] = blank();
+        m_x = 0;
+        lineFeed();
+    }
+
+    std::vector<TermCell>& line = screen()[m_y];
+    if (m_insert) {
+        std::copy_backward(line.begin() + m_x, line.end() - width, line.end());
+        if (line.back().ch == 0) line.back().ch = U' ';
+    }
+    // Overwriting half of a double-width character blanks the other half
+    if (line[m_x].ch == 0 && m_x > 0) line[m_x - 1].ch = U' ';
+    if (m_x + width < m_cols && line[m_x + width].ch == 0) line[m_x + width].ch = U' ';
+
+    TermCell cell = m_pen;
+    cell.ch = ch;
+    line[m_x] = cell;
+    if (width == 2) {
+        cell.ch = 0;
+        line[m_x + 1] = cell;
+    }
+    m_x += width;
+    if (m_x >= m_cols) {
+        m_x = m_cols - 1;
+        m_wrap_pending = m_autowrap;
+    }
+}
+
+void Terminal::clampCursor() {
+    m_x = std::clamp(m_x, 0, m_cols - 1);
+    m_y = std::clamp(m_y, 0, m_rows - 1);
+    m_wrap_pending = false;
+}
+
+void Terminal::moveTo(int x, int y) {
+    m_x = std::clamp(x, 0, m_cols - 1);
+    m_y = m_origin ? std::clamp(y + m_top, m_top, m_bottom) : std::clamp(y, 0, m_rows - 1);
+    m_wrap_pending = false;
+}
+
+void Terminal::lineFeed() {
+    m_wrap_pending = false;
+    if (m_y == m_bottom) scrollUp(m_top, m_bottom, 1, true);
+    else if (m_y < m_rows - 1) ++m_y;
+}
+
+void Terminal::reverseIndex() {
+    m_wrap_pending = false;
+    if (m_y == m_top) scrollDown(m_top, m_bottom, 1);
+    else if (m_y > 0) --m_y;
+}
+
+// Lines leaving a region that starts at the top of the main screen are
+// kept in the history when `keep` is set, that is when output scrolls
+// rather than when a line is deleted.
+void Terminal::scrollUp(int top, int bottom, int n, bool keep) {
+    n = std::min(n, bottom - top + 1);
+    if (n <= 0) return;
+    Screen& scr = screen();
+    if (keep && top == 0 && !m_alt_active) {
+        for (int y = 0; y < n; ++y) m_history.push(scr[y].data(), scr[y].size());
+    }
+    std::rotate(scr.begin() + top, scr.begin() + top + n, scr.begin() + bottom + 1);
+    eraseRows(bottom - n + 1, bottom + 1);
+}
+
+void Terminal::scrollDown(int top, int bottom, int n) {
+    n = std::min(n, bottom - top + 1);
+    if (n <= 0) return;
+    Screen& scr = screen();
+    std::rotate(scr.begin() + top, scr.begin() + bottom + 1 - n, scr.begin() + bottom + 1);
+    eraseRows(top, top + n);
+}
+
+void Terminal::eraseCells(int y, int from, int to) {
+    if (from >= to) return;
+    std::vector<TermCell>& line = screen()[y];
+    if (from > 0 && line[from].ch == 0) line[from - 1].ch = U' ';
+    if (to < m_cols && line[to].ch == 0) line[to].ch = U' ';
+    std::fill(line.begin() + from, line.begin() + to, blank());
+}
+
+void Terminal::eraseRows(int from, int to) {
+    Screen& scr = screen();
+    for (int y = std::max(from, 0); y < std::min(to, m_rows); ++y) std::fill(scr[y].begin(), scr[y].end(), blank());
+}
+
+void Terminal::saveCursor() {
+    SavedCursor& saved = m_alt_active ? m_alt_saved : m_saved;
+    saved = SavedCursor{m_x, m_y, m_pen, m_origin, m_charsets, m_gl};
+}
+
+void Terminal::restoreCursor() {
+    const SavedCursor& saved = m_alt_active ? m_alt_saved : m_saved;
+    m_x = saved.x;
+    m_y = saved.y;
+    m_pen = saved.pen;
+    m_origin = saved.origin;
+    m_charsets = saved.charsets;
+    m_gl = saved.gl;
+    clampCursor();
+}
+
+void Terminal::setAltScreen(bool on, bool save_cursor) {
+    if (on == m_alt_active) return;
+    if (on) {
+        if (save_cursor) saveCursor();
+        m_alt_active = true;
+        eraseRows(0, m_rows);
+    } else {
+        m_alt_active = false;
+        if (save_cursor) restoreCursor();
+    }
+    m_wrap_pending = false;
+}
+
+void Terminal::reset() {
+    m_alt_active = false;
+    m_pen = TermCell{};
+    for (Screen* scr : {&m_main, &m_alt}) {
+        for (std::vector<TermCell>& line : *scr) std::fill(line.begin(), line.end(), TermCell{});
+    }
+    m_history.clear();
+    m_x = m_y = 0;
+    m_wrap_pending = false;
+    m_top = 0;
+    m_bottom = m_rows - 1;
+    m_origin = m_insert = m_app_cursor = false;
+    m_autowrap = m_cursor_visible = true;
+    m_charsets = {'B', 'B'};
+    m_gl = 0;
+    m_saved = m_alt_saved = SavedCursor{};
+    m_title.clear();
+}
+
+// Lines above the cursor that no longer fit go to the history, so the
+// line being typed on stays in view; blank lines below it are dropped.
+void Terminal::resize(int rows, int cols) {
+    rows = std::max(rows, 1);
+    cols = std::max(cols, 1);
+    if (rows == m_rows && cols == m_cols) return;
+
+    auto fit = [&](Screen& scr, int& cursor_y, bool keep) {
+        for (std::vector<TermCell>& line : scr) {
+            if (cols < m_cols && line[cols].ch == 0) line[cols - 1].ch = U' ';
+            line.resize(cols);
+        }
+        const int drop = std::max(0, cursor_y + 1 - rows);
+        for (int y = 0; y < drop; ++y) {
+            if (keep) m_history.push(scr[y].data(), scr[y].size());
+        }
+        scr.erase(scr.begin(), scr.begin() + std::min<int>(drop, scr.size()));
+        cursor_y -= drop;
+        scr.resize(rows, std::vector<TermCell>(cols));
+    };
+    int alt_y = m_alt_active ? m_y : m_alt_saved.y;
+    int main_y = m_alt_active ? m_saved.y : m_y;
+    fit(m_main, main_y, true);
+    fit(m_alt, alt_y, false);
+    if (m_alt_active) { m_y = alt_y; m_saved.y = main_y; }
+    else { m_y = main_y; m_alt_saved.y = alt_y; }
+
+    m_rows = rows;
+    m_cols = cols;
+    m_top = 0;
+    m_bottom = rows - 1;
+    clampCursor();
+    m_saved.x = std::min(m_saved.x, cols - 1);
+    m_saved.y = std::clamp(m_saved.y, 0, rows - 1);
+    m_alt_saved.x = std::min(m_alt_saved.x, cols - 1);
+    m_alt_saved.y = std::clamp(m_alt_saved.y, 0, rows - 1);
+}
@@ -0,0 +1,116 @@
+#ifndef TERMINAL_H
+#define TERMINAL_H
+
+#include "TerminalHistory.h"
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The screen of a VT100/xterm-like terminal, fed with a program's output.
+//
+// feed() runs the bytes through a state machine (UTF-8, C0 controls, ESC,
+// CSI, OSC and the other string sequences) that updates a grid of cells:
+// cursor movement, erasing, insert/delete, scroll regions, SGR colours,
+// the alternate screen and DEC line drawing, which covers shells, less, vi
+// and the like.  Unknown sequences are consumed and ignored.  A sequence
+// split between two feed() calls is continued by the second.
+//
+// Lines scrolled off the top of the main screen go to history().  Answers
+// to queries (cursor position, device attributes) are collected for the
+// owner to write back with takeReplies().
+class Terminal {
+public:
+    Terminal(int rows, int cols);
+
+    void feed(std::string_view bytes);
+    std::string takeReplies();
+    void resize(int rows, int cols);
+
+    int rows() const { return m_rows; }
+    int cols() const { return m_cols; }
+    const TermCell* row(int y) const { return screen()[y].data(); }
+    const TerminalHistory& history() const { return m_history; }
+
+    int cursorX() const { return m_x; }
+    int cursorY() const { return m_y; }
+    bool cursorVisible() const { return m_cursor_visible; }
+    bool appCursorKeys() const { return m_app_cursor; }   // arrows send ESC O A rather than ESC [ A
+    bool altScreen() const { return m_alt_active; }
+    const std::string& title() const { return m_title; }
+
+private:
+    // STRING covers OSC (m_intermediate is ']') and the DCS, SOS, PM and
+    // APC strings, which are skipped
+    enum class State { GROUND, ESCAPE, ESCAPE_INTERMEDIATE, CSI, STRING, STRING_ESC };
+    static constexpr int MAX_PARAMS = 16;
+    static constexpr std::size_t MAX_OSC = 4096;
+
+    struct SavedCursor {
+        int x = 0, y = 0;
+        TermCell pen;
+        bool origin = false;
+        std::array<char, 2> charsets{'B', 'B'};
+        int gl = 0;
+    };
+
+    using Screen = std::vector<std::vector<TermCell>>;
+    Screen& screen() { return m_alt_active ? m_alt : m_main; }
+    const Screen& screen() const { return m_alt_active ? m_alt : m_main; }
+
+    void control(unsigned char c);
+    void escape(unsigned char c);
+    void csi(unsigned char final_byte);
+    void osc();
+    void sgr();
+    void setMode(bool on);
+    void print(char32_t ch);
+
+    int param(int index, int fallback) const;
+    TermCell blank() const;
+    void clampCursor();
+    void moveTo(int x, int y);
+    void lineFeed();
+    void reverseIndex();
+    void scrollUp(int top, int bottom, int n, bool keep = false);
+    void scrollDown(int top, int bottom, int n);
+    void eraseCells(int y, int from, int to);
+    void eraseRows(int from, int to);
+    void saveCursor();
+    void restoreCursor();
+    void setAltScreen(bool on, bool save_cursor);
+    void reset();
+
+    int m_rows, m_cols;
+    Screen m_main, m_alt;
+    bool m_alt_active = false;
+    TerminalHistory m_history;
+
+    int m_x = 0, m_y = 0;
+    bool m_wrap_pending = false;   // the last column was written; wrap before the next character
+    TermCell m_pen;
+    int m_top = 0, m_bottom = 0;   // scroll region, inclusive
+    bool m_origin = false;
+    bool m_autowrap = true;
+    bool m_cursor_visible = true;
+    bool m_app_cursor = false;
+    bool m_insert = false;
+    std::array<char, 2> m_charsets{'B', 'B'};   // G0 and G1; '0' is DEC line drawing
+    int m_gl = 0;                               // which of them is in use
+    SavedCursor m_saved, m_alt_saved;
+    char32_t m_last_char = U' ';                // for REP
+
+    State m_state = State::GROUND;
+    char32_t m_utf8 = 0;
+    int m_utf8_left = 0;
+    std::array<int, MAX_PARAMS> m_params{};
+    int m_param_count = 0;
+    char m_private = 0;            // '?', '>' or '=' after CSI
+    char m_intermediate = 0;
+    std::string m_osc;
+    std::string m_replies;
+    std::string m_title;
+};
+
+#endif // TERMINAL_H
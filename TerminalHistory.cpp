@@ -0,0 +1,54 @@
+#include "TerminalHistory.h"
+
+#include <algorithm>
+
+TerminalHistory::TerminalHistory(std::size_t max_lines, std::size_t max_cells)
+    : m_cells(std::max<std::size_t>(max_cells, 1)), m_rows(std::max<std::size_t>(max_lines, 1)) {}
+
+void TerminalHistory::clear() {
+    m_head = 0;
+    m_count = 0;
+}
+
+void TerminalHistory::dropOldest() {
+    m_head = (m_head + 1) % m_rows.size();
+    --m_count;
+}
+
+void TerminalHistory::push(const TermCell* cells, std::size_t width) {
+    Row r;
+    std::size_t len = width;
+    if (len > 0 && cells[len - 1].ch == U' ' && !(cells[len - 1].attr & (TermCell::UNDERLINE | TermCell::REVERSE))) {
+        r.fill = cells[len - 1];
+        while (len > 0 && cells[len - 1] == r.fill) --len;
+        r.fill_count = static_cast<std::uint32_t>(width - len);
+    }
+    len = std::min(len, m_cells.size());
+    r.len = static_cast<std::uint32_t>(len);
+    r.start = m_write;
+
+    const std::size_t cap = m_cells.size();
+    const std::size_t at = m_write % cap, first = std::min(len, cap - at);
+    std::copy(cells, cells + first, m_cells.begin() + at);
+    std::copy(cells + first, cells + len, m_cells.begin());
+    m_write += len;
+
+    // Lines whose cells were just overwritten go, as does the oldest line
+    // when there is no slot for this one
+    while (m_count > 0 && row(0).start + cap < m_write) dropOldest();
+    if (m_count == m_rows.size()) dropOldest();
+    m_rows[(m_head + m_count) % m_rows.size()] = r;
+    ++m_count;
+}
+
+void TerminalHistory::line(std::size_t index, std::vector<TermCell>& out) const {
+    out.clear();
+    if (index >= m_count) return;
+    const Row& r = row(index);
+    const std::size_t cap = m_cells.size();
+    out.reserve(r.len + r.fill_count);
+    const std::size_t at = r.start % cap, first = std::min<std::size_t>(r.len, cap - at);
+    out.insert(out.end(), m_cells.begin() + at, m_cells.begin() + at + first);
+    out.insert(out.end(), m_cells.begin(), m_cells.begin() + (r.len - first));
+    out.insert(out.end(), r.fill_count, r.fill);
+}
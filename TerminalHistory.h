@@ -0,0 +1,60 @@
+#ifndef TERMINALHISTORY_H
+#define TERMINALHISTORY_H
+
+#include <cstdint>
+#include <vector>
+
+// One character cell of a terminal screen, 8 bytes.  Colours are the 16
+// ANSI colours or DEFAULT_COLOR; 256-colour and true-colour requests are
+// mapped to the nearest of them when they are parsed.
+struct TermCell {
+    enum : std::uint8_t { BOLD = 1, UNDERLINE = 2, REVERSE = 4 };
+    static constexpr std::uint8_t DEFAULT_COLOR = 0xff;
+
+    char32_t ch = U' ';     // 0 in the cell right of a double-width character
+    std::uint8_t fg = DEFAULT_COLOR;
+    std::uint8_t bg = DEFAULT_COLOR;
+    std::uint8_t attr = 0;
+
+    bool sameStyle(const TermCell& o) const { return fg == o.fg && bg == o.bg && attr == o.attr; }
+    bool operator==(const TermCell& o) const { return ch == o.ch && sameStyle(o); }
+};
+
+// Lines that scrolled off the top of a terminal screen.
+//
+// Cells of all lines share one arena used as a ring, so the history costs a
+// fixed amount of memory however much output goes by.  A line's trailing
+// run of identical blank cells is not stored: it is kept as a count and one
+// cell, which makes a screenful of short lines take little more than their
+// text.  The oldest lines go when either the arena or the line limit is
+// full.
+class TerminalHistory {
+public:
+    explicit TerminalHistory(std::size_t max_lines = 10000, std::size_t max_cells = 1u << 20);
+
+    void push(const TermCell* cells, std::size_t width);
+    void clear();
+
+    std::size_t size() const { return m_count; }
+    // Line `index` (0 is the oldest) with its blank tail expanded.
+    void line(std::size_t index, std::vector<TermCell>& out) const;
+
+private:
+    struct Row {
+        std::uint64_t start = 0;     // arena position, counted from the first cell ever stored
+        std::uint32_t len = 0;       // stored cells
+        std::uint32_t fill_count = 0;
+        TermCell fill;               // the blank tail
+    };
+
+    const Row& row(std::size_t index) const { return m_rows[(m_head + index) % m_rows.size()]; }
+    void dropOldest();
+
+    std::vector<TermCell> m_cells;
+    std::uint64_t m_write = 0;
+    std::vector<Row> m_rows;
+    std::size_t m_head = 0;
+    std::size_t m_count = 0;
+};
+
+#endif // TERMINALHISTORY_H
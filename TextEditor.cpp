@@ -2,7 +2,16 @@
 #include "SyntaxHighlighter.h"
 #include "FileBrowser.h"
 #include "PickTargetDialog.h"
+#include "FileLoader.h"
+#include "StreamSource.h"
 #include "utils.h"
+#include "ProjectReplace.h"
+#include "ProgressDialog.h"
+#include "ReplacePreviewDialog.h"
+#include "RenameDialog.h"
+#include "BenchmarkDialog.h"
+#include "GoogleBenchmarkDialog.h"
+#include "SymbolRename.h"
 
 #include <ncurses.h>
 #include <clang-c/Index.h>
@@ -12,12 +21,13 @@
 #include <thread>
 #include <chrono>
 #include <iostream>
-#include <termios.h>
 #include <unistd.h>
 #include <cstdio>
 #include <regex>
 #include <algorithm>
+#include <climits>
 #include <sstream>
+#include <optional>
 
 
 // --- Key Code Defines ---
@@ -36,12 +46,11 @@
 void TextEditor::OpenFileBrowser() {
     std::string filename = FileBrowser::open(*m_renderer);
     if (!filename.empty()) {
-        for(size_t i = 0; i < m_bufferManager->bufferCount(); ++i) {
-            if (m_bufferManager->getBuffer(i).filename == filename) {
-                SwitchToBuffer(i);
-                handleResize();
-                return;
-            }
+        int open_idx = m_bufferManager->findByFileId(PathRegistry::instance().intern(filename));
+        if (open_idx != -1) {
+            SwitchToBuffer(open_idx);
+            handleResize();
+            return;
         }
         DoNew();
         currentBuffer().filename = filename;
@@ -56,6 +65,7 @@ void TextEditor::SaveFileBrowser() {
     std::string filename = FileBrowser::save(*m_renderer, buffer.filename);
     if (!filename.empty()) {
         buffer.filename = filename;
+        buffer.file_id = PathRegistry::instance().intern(filename);
         write_file(buffer);
         SyntaxHighlighter::setSyntaxType(buffer);
         handleResize();
@@ -68,8 +78,6 @@ void TextEditor::selectfile() {
 
 
 void TextEditor::run(int argc, char* argv[]) {
-    m_renderer = std::make_unique<Renderer>();
-    
     std::string configPath = "config.json";
     std::string colorsPath = "colors.json";
     
@@ -83,7 +91,30 @@ void TextEditor::run(int argc, char* argv[]) {
     m_keyBindings = std::make_unique<KeyBindings>();
     m_keyBindings->loadFromConfig(m_config.keybindings);
 
+    // "-" (or no arguments with a pipe on stdin) reads stdin.  The pipe has
+    // to be taken over before ncurses grabs fd 0.
+    std::vector<FileArgument> files;
+    bool want_stdin = (argc < 2);
+    bool follow_next = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-") { want_stdin = true; continue; }
+        if (arg == "-f" || arg == "--follow") { follow_next = true; continue; }
+        files.push_back(FileLoader::parseArgument(arg));
+        files.back().follow = follow_next;
+        follow_next = false;
+    }
+    if (want_stdin) m_stdin_stream = StreamSource::fromStdin(m_config.stream_spill_to_file);
+
+    m_renderer = std::make_unique<Renderer>();
+
     m_buildSystem = std::make_unique<BuildSystem>(m_config);
+    m_tidy = std::make_unique<TidyRunner>();
+    m_tidy->onResult([this](TidyRunner::Result result) { adoptTidyResult(std::move(result)); });
+    m_bench = std::make_unique<BenchmarkRunner>();
+    m_lsp = std::make_unique<LspClient>();
+    m_lsp->onNotification("textDocument/publishDiagnostics",
+                          [this](const LspClient::json& params) { adoptLspDiagnostics(params); });
     m_helpProvider = std::make_unique<HelpProvider>();
     m_bufferManager = std::make_unique<BufferManager>();
 
@@ -104,94 +135,465 @@ void TextEditor::run(int argc, char* argv[]) {
     m_text_area_end_x = m_renderer->getWidth() - 3;
     m_text_area_end_y = m_renderer->getHeight() - 4;
 
-    if (argc < 2) {
-        DoNew();
+    if (files.empty()) {
+        if (m_stdin_stream) openStdinBuffer();
+        else DoNew();
     } else {
-        std::string input = argv[1];
-        int jump_line = -1;
-        
-        size_t last_colon = input.find_last_of(':');
-        if (last_colon != std::string::npos && last_colon > 0) {
-            std::string line_part = input.substr(last_colon + 1);
-            bool is_numeric = !line_part.empty();
-            for (char c : line_part) if (!std::isdigit(static_cast<unsigned char>(c))) { is_numeric = false; break; }
-
-            if (is_numeric) {
-                try {
-                    jump_line = std::stoi(line_part);
-                    input = input.substr(0, last_colon);
-                } catch (...) {
-                    jump_line = -1;
-                }
-            }
+        // Everything after the first file loads on the worker pool while the
+        // first one is read here, so first paint does not wait for the rest.
+        if (files.size() > 1) {
+            openFilesInBackground(std::vector<FileArgument>(files.begin() + 1, files.end()));
         }
 
         m_bufferManager->addBuffer();
-        currentBuffer().filename = input;
+        currentBuffer().filename = files[0].path;
         read_file(currentBuffer());
 
-        if (jump_line > 0) {
-            if (jump_line > currentBuffer().total_lines) jump_line = currentBuffer().total_lines;
-            currentBuffer().current_line_num = jump_line;
-            // Recalculate pointers
-            currentBuffer().current_line = currentBuffer().document_head;
-            for (int i = 1; i < jump_line; ++i) {
-                if (currentBuffer().current_line->next) {
-                    currentBuffer().current_line = currentBuffer().current_line->next;
-                } else break;
-            }
+        if (files[0].line > 0) {
+            FileLoader::jumpToLine(currentBuffer(), files[0].line);
             update_cursor_and_scroll();
         }
+        if (m_stdin_stream) {
+            int first = currentBufferIdx();
+            openStdinBuffer();
+            SwitchToBuffer(first);
+        }
+        for (const auto& f : files) {
+            if (f.follow) m_follower.follow(PathRegistry::instance().intern(f.path));
+        }
     }
 
     // Scan available libraries in the background so New Project opens instantly
-    m_lib_future = std::async(std::launch::async, &NewProjectDialog::loadLibraries);
+    m_lib_future = TaskScheduler::instance().async(TaskLane::Background, &NewProjectDialog::loadLibraries);
 
     main_loop();
+    TaskScheduler::instance().shutdown();
 }
 
 void TextEditor::read_file(EditorBuffer& buffer) {
-    Line* p = buffer.document_head;
-    while (p != nullptr) { Line* q = p; p = p->next; delete q; }
-    buffer.document_head = nullptr;
-    buffer.total_lines = 0;
-
-    std::ifstream f(buffer.filename);
-    Line* current = nullptr;
-    std::string line_str;
-    if (!f.is_open()) {
-        buffer.document_head = new Line();
-        buffer.total_lines = 1;
-    } else {
-        buffer.is_new_file = false;
-        while (getline(f, line_str)) {
-            buffer.total_lines++;
-            if (!line_str.empty() && line_str.back() == '\r') { line_str.pop_back(); }
-            Line* new_line = new Line();
-            new_line->text = line_str;
-            if (buffer.document_head == nullptr) { buffer.document_head = current = new_line; }
-            else { current->next = new_line; new_line->prev = current; current = new_line; }
-        }
-        f.close();
-    }
-    if (buffer.document_head == nullptr) {
-        buffer.document_head = new Line();
-        buffer.total_lines = 1;
-    }
-    buffer.current_line = buffer.first_visible_line = buffer.document_head;
-    buffer.current_line_num = 1; buffer.cursor_col = 1; buffer.cursor_screen_y = m_text_area_start_y; buffer.changed = false;
-    
-    // Check if it's a system file
-    if (buffer.filename.rfind("/usr/include", 0) == 0 || buffer.filename.rfind("/usr/local/include", 0) == 0) {
-        buffer.read_only = true;
+    if (FileLoader::isProgressive(buffer.filename) && !FileLoader::isBinary(buffer.filename)) {
+        std::uintmax_t resume = FileLoader::loadPrefix(buffer);
+        streamRemainder(buffer, resume);
     } else {
+        FileLoader::load(buffer);
+    }
+    buffer.cursor_screen_y = m_text_area_start_y;
+}
+
+// Switches follow mode ("tail -f") for the current buffer.
+void TextEditor::ToggleFollow() {
+    if (currentBufferIdx() == -1) return;
+    EditorBuffer& buffer = currentBuffer();
+    if (m_follower.isFollowing(buffer.file_id)) {
+        m_follower.unfollow(buffer.file_id, *m_bufferManager);
+        return;
+    }
+    if (buffer.file_id == INVALID_FILE_ID || buffer.is_new_file || buffer.hex_view) {
+        msgwin("Only text files on disk can be followed.");
+        return;
+    }
+    if (buffer.changed) {
+        msgwin("Save the file before following it.");
+        return;
+    }
+    m_follower.follow(buffer.file_id);
+}
+
+// Asks for include/exclude terms and shows only the matching lines of the
+// current buffer.  Empty terms switch the filter off.
+void TextEditor::FilterLines() {
+    if (currentBufferIdx() == -1) return;
+    EditorBuffer& buffer = currentBuffer();
+    if (buffer.hex_view) { msgwin("Binary files cannot be filtered."); return; }
+    const FilterSpec& previous = buffer.filter_view ? buffer.filter_view->spec() : m_filter_spec;
+    DialogResult r = FilterDialog::show(*m_renderer, previous.include, previous.exclude);
+    if (r.cancelled()) return;
+
+    FilterSpec spec{r["include"], r["exclude"], r["regex"] == "1"};
+    if (spec.empty()) { buffer.filter_view.reset(); return; }
+    std::string error;
+    auto filter = LineFilter::compile(spec, error);
+    if (!filter) { msgwin(error); return; }
+
+    m_filter_spec = spec;
+    if (!buffer.filter_view) buffer.filter_view = std::make_shared<FilteredView>();
+    buffer.filter_view->refilter(buffer, std::move(spec), std::move(filter));
+}
+
+// Steps the current buffer through automatic, Full, Large and Huge mode.
+// The choice holds until the file is reloaded.
+void TextEditor::CycleBufferMode() {
+    if (currentBufferIdx() == -1) return;
+    EditorBuffer& buffer = currentBuffer();
+    if (buffer.hex_view) return;
+    if (!buffer.mode_pinned) BufferPolicy::pin(buffer, BufferMode::Full);
+    else if (buffer.mode == BufferMode::Full) BufferPolicy::pin(buffer, BufferMode::Large);
+    else if (buffer.mode == BufferMode::Large) BufferPolicy::pin(buffer, BufferMode::Huge);
+    else BufferPolicy::unpin(buffer);
+}
+
+FilteredView* TextEditor::activeFilteredView() {
+    if (currentBufferIdx() == -1) return nullptr;
+    return currentBuffer().filter_view.get();
+}
+
+// Leaves the filtered view, optionally moving the cursor to the line of the
+// selected row.
+void TextEditor::closeFilteredView(bool jump_to_row) {
+    EditorBuffer& buffer = currentBuffer();
+    FilteredView& view = *buffer.filter_view;
+    if (jump_to_row && !view.rows().empty()) {
+        const FilteredView::Row& row = view.rows()[view.cursor];
+        buffer.current_line = row.line;
+        buffer.current_line_num = row.line_num;
+        buffer.cursor_col = 1;
+        buffer.first_visible_line = row.line;
+        ClearSelection();
+    }
+    buffer.filter_view.reset();
+    update_cursor_and_scroll();
+}
+
+void TextEditor::handleFilteredViewKey(wint_t ch) {
+    FilteredView& view = *currentBuffer().filter_view;
+    const int last = std::max(0, (int)view.rows().size() - 1);
+    const int page = std::max(1, m_text_area_end_y - m_text_area_start_y + 1);
+
+    switch (ch) {
+    case KEY_UP:    view.cursor = std::max(0, view.cursor - 1); return;
+    case KEY_DOWN:  view.cursor = std::min(last, view.cursor + 1); return;
+    case KEY_PPAGE: view.cursor = std::max(0, view.cursor - page); view.top = std::max(0, view.top - page); return;
+    case KEY_NPAGE: view.cursor = std::min(last, view.cursor + page); view.top = std::min(last, view.top + page); return;
+    case KEY_HOME:  view.cursor = 0; view.horizontal_scroll_offset = 1; return;
+    case KEY_END:   view.cursor = last; return;
+    case KEY_LEFT:  view.horizontal_scroll_offset = std::max(1, view.horizontal_scroll_offset - 1); return;
+    case KEY_RIGHT: view.horizontal_scroll_offset++; return;
+    case KEY_ENTER: case 10: case 13:
+        closeFilteredView(true);
+        return;
+    case 27: { // ESC, or the start of an Alt key
+        nodelay(stdscr, FALSE);
+        timeout(50);
+        wint_t next_ch = m_renderer->getChar();
+        timeout(-1);
+        nodelay(stdscr, TRUE);
+        if (next_ch != ERR) HandleAltKey(next_ch);
+        else closeFilteredView(false);
+        return;
+    }
+    }
+
+    // The document is hidden: editing commands would act on an invisible
+    // cursor.  Searching refines the filter instead.
+    switch (m_keyBindings->getAction(ch)) {
+    case ACT_FIND: case ACT_FILTER:
+        FilterLines();
+        return;
+    case ACT_UNDO: case ACT_REDO: case ACT_CUT: case ACT_PASTE: case ACT_DELETE:
+    case ACT_REPLACE: case ACT_TOGGLE_COMMENT: case ACT_GOTO_LINE: case ACT_GO_TO_DEFINITION:
+    case ACT_RENAME_SYMBOL: case ACT_FIND_REFERENCES:
+        return;
+    case ACT_UNKNOWN:
+        if (ch == KEY_F(10)) process_key(ch);
+        return;
+    default:
+        process_key(ch);
+        return;
+    }
+}
+
+HexView* TextEditor::activeHexView() {
+    if (currentBufferIdx() == -1) return nullptr;
+    return currentBuffer().hex_view.get();
+}
+
+std::string TextEditor::hexPromptLabel() const {
+    switch (m_hex_prompt) {
+    case HexPrompt::OFFSET:    return "Go to offset: ";
+    case HexPrompt::FIND_TEXT: return "Find text (Tab: hex): ";
+    case HexPrompt::FIND_HEX:  return "Find hex (Tab: text): ";
+    default:                   return "";
+    }
+}
+
+// Searches the mapping on a worker so a multi-gigabyte scan never blocks
+// the UI; the cursor moves to the hit when it comes back.
+void TextEditor::startHexSearch(const std::string& needle) {
+    HexView& view = *currentBuffer().hex_view;
+    view.search_token.cancel();
+    if (needle.empty()) return;
+    m_hex_needle = needle;
+    view.searching = true;
+
+    std::weak_ptr<HexView> weak = currentBuffer().hex_view;
+    std::uint64_t from = view.cursor + (view.match_len > 0 ? 1 : 0);
+    view.search_token = TaskScheduler::instance().submitWithResult(TaskLane::Interactive,
+        [file = view.file(), needle, from](const CancellationToken& token) {
+            return HexView::find(*file, needle, from, token);
+        },
+        [this, weak, len = needle.size()](std::uint64_t hit) {
+            auto view = weak.lock();
+            if (!view) return;
+            view->searching = false;
+            if (hit == HexView::NOT_FOUND) { view->match_len = 0; msgwin("Not found."); return; }
+            view->cursor = hit;
+            view->match_len = len;
+        });
+}
+
+void TextEditor::handleHexPromptKey(HexView& view, wint_t ch) {
+    switch (ch) {
+    case KEY_ENTER: case 10: case 13: {
+        HexPrompt prompt = m_hex_prompt;
+        std::string text = m_hex_prompt_text;
+        m_hex_prompt = HexPrompt::NONE;
+        if (prompt == HexPrompt::OFFSET) {
+            std::uint64_t offset;
+            if (!HexView::parseOffset(text, offset) || offset >= std::max<std::uint64_t>(1, view.size())) {
+                msgwin("Invalid offset.");
+                return;
+            }
+            view.cursor = offset;
+            view.match_len = 0;
+        } else if (prompt == HexPrompt::FIND_HEX) {
+            std::string bytes;
+            if (!HexView::parseHex(text, bytes)) { msgwin("Expected pairs of hex digits."); return; }
+            view.match_len = 0;
+            startHexSearch(bytes);
+        } else {
+            view.match_len = 0;
+            startHexSearch(text);
+        }
+        return;
+    }
+    case 27:
+        m_hex_prompt = HexPrompt::NONE;
+        return;
+    case '\t':
+        if (m_hex_prompt == HexPrompt::FIND_TEXT) m_hex_prompt = HexPrompt::FIND_HEX;
+        else if (m_hex_prompt == HexPrompt::FIND_HEX) m_hex_prompt = HexPrompt::FIND_TEXT;
+        return;
+    case KEY_BACKSPACE: case 127: case 8:
+        if (!m_hex_prompt_text.empty()) m_hex_prompt_text.pop_back();
+        return;
+    default:
+        if (ch >= 32 && ch < 127) m_hex_prompt_text += (char)ch;
+        return;
+    }
+}
+
+void TextEditor::handleHexViewKey(wint_t ch) {
+    HexView& view = *currentBuffer().hex_view;
+    if (m_hex_prompt != HexPrompt::NONE) { handleHexPromptKey(view, ch); return; }
+
+    const std::uint64_t last = view.size() > 0 ? view.size() - 1 : 0;
+    const std::uint64_t row_bytes = HexView::BYTES_PER_ROW;
+    const std::uint64_t page = row_bytes * std::max(1, m_text_area_end_y - m_text_area_start_y + 1);
+    const std::uint64_t row_start = view.cursor - view.cursor % row_bytes;
+
+    switch (ch) {
+    case KEY_LEFT:  if (view.cursor > 0) view.cursor--; break;
+    case KEY_RIGHT: view.cursor = std::min(last, view.cursor + 1); break;
+    case KEY_UP:    if (view.cursor >= row_bytes) view.cursor -= row_bytes; break;
+    case KEY_DOWN:  if (last - view.cursor >= row_bytes) view.cursor += row_bytes; break;
+    case KEY_PPAGE: view.cursor = view.cursor >= page ? view.cursor - page : view.cursor % row_bytes; break;
+    case KEY_NPAGE: if (last - view.cursor >= page) view.cursor += page; else view.cursor = last; break;
+    case KEY_HOME:  view.cursor = row_start; break;
+    case KEY_END:   view.cursor = std::min(last, row_start + row_bytes - 1); break;
+    case 'n':
+        if (!m_hex_needle.empty()) startHexSearch(m_hex_needle);
+        return;
+    case 27: { // ESC, or the start of an Alt key
+        nodelay(stdscr, FALSE);
+        timeout(50);
+        wint_t next_ch = m_renderer->getChar();
+        timeout(-1);
+        nodelay(stdscr, TRUE);
+        if (next_ch != ERR) HandleAltKey(next_ch);
+        return;
+    }
+    default:
+        // The file is read-only: find and go-to act on bytes, anything that
+        // would edit text is ignored.
+        switch (m_keyBindings->getAction(ch)) {
+        case ACT_FIND:      ActivateSearch(); return;
+        case ACT_GOTO_LINE: GoToLineDialog(); return;
+        case ACT_UNDO: case ACT_REDO: case ACT_CUT: case ACT_PASTE: case ACT_DELETE:
+        case ACT_REPLACE: case ACT_TOGGLE_COMMENT: case ACT_GO_TO_DEFINITION: case ACT_FILTER:
+        case ACT_RENAME_SYMBOL: case ACT_FIND_REFERENCES:
+            return;
+        case ACT_UNKNOWN:
+            if (ch == KEY_F(10)) process_key(ch);
+            return;
+        default:
+            process_key(ch);
+            return;
+        }
+    }
+    view.match_len = 0;
+}
+
+int TextEditor::findLoadingBuffer(std::uint64_t load_id) const {
+    if (load_id == 0) return -1;
+    for (size_t i = 0; i < m_bufferManager->bufferCount(); ++i) {
+        if (m_bufferManager->getBuffer(i).load_id == load_id) return (int)i;
+    }
+    return -1;
+}
+
+// Adds the read-only buffer that receives piped stdin and makes it current.
+void TextEditor::openStdinBuffer() {
+    m_bufferManager->addBuffer();
+    EditorBuffer& buffer = currentBuffer();
+    buffer.filename = "<stdin>";
+    buffer.read_only = true;
+    buffer.load_id = FileLoader::nextLoadId();
+    buffer.cursor_screen_y = m_text_area_start_y;
+    m_stdin_load_id = buffer.load_id;
+    m_stdin_bytes_held = 0;
+    m_stdin_trimmed = false;
+}
+
+// Called once per main loop iteration: moves whatever the pipe has ready into
+// the stdin buffer.  The view follows new output while the cursor sits on
+// the last line; old lines are dropped once the configured limit is hit.
+void TextEditor::pumpStdin() {
+    if (!m_stdin_stream) return;
+
+    int idx = findLoadingBuffer(m_stdin_load_id);
+    if (idx == -1) { m_stdin_stream.reset(); return; }   // buffer was closed; takes the spill file along
+    EditorBuffer& buffer = m_bufferManager->getBuffer(idx);
+
+    LineChunk chunk = m_stdin_stream->poll(STDIN_POLL_BYTES);
+    if (chunk.count > 0) {
+        Line* last = buffer.load_tail ? buffer.load_tail : buffer.document_head;
+        bool follow = (buffer.current_line == last);
+        m_stdin_bytes_held += chunk.bytes;
+        FileLoader::appendChunk(buffer, chunk);
+        if (follow) {
+            buffer.current_line = buffer.load_tail;
+            buffer.current_line_num = buffer.total_lines;
+            buffer.cursor_col = 1;
+        }
+
+        std::size_t limit = (std::size_t)std::max(0, m_config.stream_memory_limit_mb) * 1024 * 1024;
+        if (limit > 0 && m_stdin_bytes_held > limit) {
+            m_stdin_bytes_held -= FileLoader::dropHeadLines(buffer, m_stdin_bytes_held - limit);
+            m_stdin_trimmed = true;
+        }
+    }
+
+    if (m_stdin_stream->finished()) {
+        buffer.load_id = 0;
+        buffer.load_tail = nullptr;
         buffer.read_only = false;
+        // The spill file is kept only as the copy of the dropped lines
+        std::string spill = m_stdin_trimmed ? m_stdin_stream->keepSpill() : "";
+        m_stdin_stream.reset();
+        if (!spill.empty()) msgwin("Older input was dropped from memory. Full stream: " + spill);
     }
+}
 
-    SyntaxHighlighter::setSyntaxType(buffer);
+// Reads the rest of a progressively loaded file on a worker.  Each block is
+// split into lines off the UI thread and spliced onto the buffer by a posted
+// callback; the buffer stays read-only until the last block has arrived.
+// Closing or reloading the buffer changes its load_id and stops the stream.
+// Huge files are split straight out of a read-only mapping instead of being
+// copied through a stream buffer first.
+void TextEditor::streamRemainder(EditorBuffer& buffer, std::uintmax_t offset) {
+    const std::uint64_t load_id = buffer.load_id;
+    const std::string path = buffer.filename;
+    const bool mapped = BufferPolicy::mappedReadOnly(buffer.mode);
+
+    TaskScheduler::instance().submit(TaskLane::Background,
+        [this, load_id, path, offset, mapped](const CancellationToken& token) {
+            std::shared_ptr<const MappedFile> map = mapped ? MappedFile::open(path) : nullptr;
+            if (map && map->size() < offset) map.reset();   // truncated meanwhile
+            std::ifstream f;
+            std::vector<char> data;
+            if (!map) {
+                f.open(path, std::ios::binary);
+                f.seekg(offset);
+                data.resize(FileLoader::STREAM_CHUNK_BYTES);
+            }
+            std::string carry;
+            std::uintmax_t done = offset;
+            bool eof = false;
+            while (!eof && !token.cancelled()) {
+                const char* block;
+                std::size_t got;
+                if (map) {
+                    block = reinterpret_cast<const char*>(map->data()) + done;
+                    got = static_cast<std::size_t>(std::min<std::uint64_t>(FileLoader::STREAM_CHUNK_BYTES, map->size() - done));
+                    eof = done + got >= map->size();
+                } else {
+                    f.read(data.data(), data.size());
+                    block = data.data();
+                    got = static_cast<std::size_t>(f.gcount());
+                    eof = got < data.size();
+                }
+                done += got;
+                // Shared only to make the posted callback copyable
+                auto chunk = std::make_shared<LineChunk>(FileLoader::splitChunk(block, got, carry, eof));
+
+                TaskScheduler::instance().post([this, load_id, chunk, done, eof, token]() mutable {
+                    int idx = findLoadingBuffer(load_id);
+                    if (idx == -1) {
+                        FileLoader::freeChunk(*chunk);
+                        token.cancel();
+                        return;
+                    }
+                    EditorBuffer& b = m_bufferManager->getBuffer(idx);
+                    FileLoader::appendChunk(b, *chunk);
+                    b.load_bytes_done = done;
+                    if (eof) {
+                        b.load_id = 0;
+                        b.load_tail = nullptr;
+                        b.read_only = BufferPolicy::readOnlyAfterLoad(b);
+                    }
+                });
+            }
+        });
+}
+
+// Loads `files` on the task scheduler.  Finished buffers are appended to the
+// buffer list in command line order; the current buffer is left alone.
+void TextEditor::openFilesInBackground(std::vector<FileArgument> files) {
+    struct PendingOpens {
+        std::vector<std::optional<EditorBuffer>> loaded;
+        size_t next = 0;
+    };
+    auto pending = std::make_shared<PendingOpens>();
+    pending->loaded.resize(files.size());
+
+    for (size_t i = 0; i < files.size(); ++i) {
+        FileArgument arg = files[i];
+        TaskScheduler::instance().submitWithResult(TaskLane::Visible,
+            [arg](const CancellationToken&) {
+                EditorBuffer buffer(-1);
+                buffer.filename = arg.path;
+                FileLoader::load(buffer);
+                FileLoader::jumpToLine(buffer, arg.line);
+                return buffer;
+            },
+            [this, pending, i](EditorBuffer buffer) {
+                pending->loaded[i] = std::move(buffer);
+                while (pending->next < pending->loaded.size() && pending->loaded[pending->next]) {
+                    EditorBuffer& ready = *pending->loaded[pending->next];
+                    ready.cursor_screen_y = m_text_area_start_y;
+                    if (m_bufferManager->findByFileId(ready.file_id) == -1) {
+                        m_bufferManager->adoptBuffer(std::move(ready));
+                    }
+                    pending->loaded[pending->next].reset();
+                    pending->next++;
+                }
+            });
+    }
 }
 
 void TextEditor::write_file(EditorBuffer& buffer) {
+    if (buffer.load_id != 0) { msgwin("File is still loading."); return; }
+    if (buffer.hex_view) { msgwin("Binary files are opened read-only."); return; }
     std::ofstream f(buffer.filename);
     if (!f.is_open()) { msgwin("Error: Cannot write to file " + buffer.filename); return; }
     for (Line* p = buffer.document_head; p != nullptr; p = p->next) { f << p->text << std::endl; }
@@ -199,8 +601,15 @@ void TextEditor::write_file(EditorBuffer& buffer) {
     buffer.changed = false;
     buffer.is_new_file = false;
 
+    // A file written for the first time now resolves to a real canonical path
+    if (!PathRegistry::instance().exists(buffer.file_id)) {
+        PathRegistry::instance().invalidate(buffer.file_id);
+    }
+
     // Invalidate the compile command cache for this file, as its content has changed.
     m_buildSystem->invalidateCache(buffer.filename);
+
+    if (m_config.tidy_on_save) RunTidy(PathRegistry::instance().path(buffer.file_id));
 }
 
 void TextEditor::TryExit() {
@@ -223,21 +632,30 @@ void TextEditor::TryExit() {
             }
         }
     }
+    // Nothing may keep the scheduler's shutdown waiting on a program
+    m_bench->cancel();
+    m_gbench.reset();
     main_loop_running = false;
 }
 
 void TextEditor::insert_line_after(EditorBuffer& buffer, Line* current_p, const std::string& s) {
     if (!current_p) return;
-    Line* p = new Line();
-    p->text = s;
+    Line* p = buffer.line_pool.create(s, current_p);
     p->next = current_p->next;
-    p->prev = current_p;
     if (current_p->next) { current_p->next->prev = p; }
     current_p->next = p;
-    buffer.changed = true;
+    // Goes with its neighbour's snapshot chunk until the next capture
+    p->snapshot_chunk = current_p->snapshot_chunk;
+    buffer.touch(current_p);
     buffer.total_lines++;
 }
 
+// Name shown for a buffer: the cached canonical path, or the buffer's own
+// name when it has no file behind it (piped stdin, unsaved new files).
+static std::string displayPath(const EditorBuffer& buffer) {
+    return buffer.file_id != INVALID_FILE_ID ? PathRegistry::instance().path(buffer.file_id) : buffer.filename;
+}
+
 void TextEditor::drawMainUI() {
     wbkgd(stdscr, COLOR_PAIR(Renderer::CP_DEFAULT_TEXT));
 
@@ -261,8 +679,9 @@ void TextEditor::drawMainUI() {
     }
 
     if (currentBufferIdx() != -1) {
-        std::string filename_part = " " + currentBuffer().filename + " ";
-        filename_part = get_full_path(filename_part);
+        // Cached canonical path: no filesystem work on repaint
+        const std::string full_path = displayPath(currentBuffer());
+        std::string filename_part = " " + full_path + " ";
         std::string indicator_part = "* ";
         std::string bufferNr = "[" + std::to_string(currentBuffer().bufferNr) + "]";
 
@@ -270,7 +689,7 @@ void TextEditor::drawMainUI() {
         std::string proj_badge;
         if (!m_project.name.empty() && !m_project.root.empty() &&
             !currentBuffer().is_new_file) {
-            auto rel = std::filesystem::path(currentBuffer().filename)
+            auto rel = std::filesystem::path(full_path)
                            .lexically_relative(m_project.root);
             if (!rel.empty() && rel.native().substr(0, 2) != "..")
                 proj_badge = " · " + m_project.name;   // " · ProjectName"
@@ -295,29 +714,57 @@ void TextEditor::drawMainUI() {
     }
 }
 
+namespace {
+// Search matches to highlight in `p`, if the buffer is being searched.
+const std::vector<SearchMatches::Span>& matchesIn(EditorBuffer& buffer, const Line* p) {
+    static const std::vector<SearchMatches::Span> none;
+    return buffer.search_matches ? buffer.search_matches->inLine(p) : none;
+}
+
+// The buffer's lexer states, in step with its text.
+SyntaxModel& syntaxModel(EditorBuffer& buffer) {
+    if (!buffer.syntax_model) buffer.syntax_model = std::make_shared<SyntaxModel>();
+    buffer.syntax_model->sync(buffer);
+    return *buffer.syntax_model;
+}
+
+using BracketMatch = std::optional<std::pair<SyntaxModel::Position, SyntaxModel::Position>>;
+
+// The bracket at the cursor and its partner, if the cursor is at one.
+BracketMatch cursorBrackets(EditorBuffer& buffer, SyntaxModel* model) {
+    if (!model || buffer.selecting) return std::nullopt;
+    return model->matchBracket(buffer.current_line_num - 1, buffer.cursor_col - 1);
+}
+
+// Columns of `match` on 0-based line `idx`.
+std::vector<std::size_t> bracketsIn(const BracketMatch& match, std::size_t idx) {
+    std::vector<std::size_t> cols;
+    if (match && match->first.line == idx) cols.push_back(match->first.col);
+    if (match && match->second.line == idx) cols.push_back(match->second.col);
+    return cols;
+}
+}
+
 void TextEditor::drawTextArea() {
     if (currentBufferIdx() == -1) return;
     EditorBuffer& buffer = currentBuffer();
+    if (buffer.filter_view) { drawFilteredView(*buffer.filter_view); return; }
+    if (buffer.hex_view) { drawHexView(*buffer.hex_view); return; }
 
-    buffer.in_multiline_comment = false;
-    Line* p_find_comment = buffer.document_head;
-    for (int i=1; i < buffer.current_line_num && p_find_comment != buffer.first_visible_line; ++i) {
-        SyntaxHighlighter::parseLine(buffer, p_find_comment->text, *m_renderer);
-        if (p_find_comment->next) p_find_comment = p_find_comment->next;
-        else break;
-    }
+    // Plain rendering keeps no lexer states at all
+    const bool highlight = buffer.syntax_type != EditorBuffer::ST_NONE && BufferPolicy::syntaxHighlighting(buffer.mode);
+    SyntaxModel* model = highlight ? &syntaxModel(buffer) : nullptr;
+
+    if (softWrap(buffer)) { drawWrappedText(buffer, model); return; }
 
     Line* p = buffer.first_visible_line;
     int text_area_height = m_text_area_end_y - m_text_area_start_y + 1;
     int text_area_width = m_text_area_end_x - m_text_area_start_x + 1 - m_gutter_width;
     if (text_area_height <= 0 || text_area_width <= 0) return;
 
-    int current_doc_line = 0;
-    Line* temp = buffer.document_head;
-    while(temp && temp != buffer.first_visible_line) {
-        current_doc_line++;
-        temp = temp->next;
-    }
+    int current_doc_line = firstVisibleLineNum(buffer) - 1;
+    LexState state = model ? model->stateAt(current_doc_line) : LexState();
+    const BracketMatch brackets = cursorBrackets(buffer, model);
 
     for(int i = 0; i < text_area_height; ++i) {
         int current_screen_y = m_text_area_start_y + i;
@@ -333,46 +780,202 @@ void TextEditor::drawTextArea() {
             if (m_gutter_width > 0) {
                 std::string line_num_str = std::to_string(current_doc_line + i + 1);
                 m_renderer->drawText(m_text_area_start_x + m_gutter_width - line_num_str.length() - 1, current_screen_y, line_num_str, Renderer::CP_GUTTER_FG);
+                if (int mark = gutterMark(buffer.file_id, current_doc_line + i + 1))
+                    m_renderer->drawText(m_text_area_start_x, current_screen_y, "●", mark);
             }
 
             std::vector<SyntaxToken> tokens;
-            if (buffer.syntax_type != EditorBuffer::ST_NONE) {
-                tokens = SyntaxHighlighter::parseLine(buffer, p->text, *m_renderer);
+            if (highlight) {
+                tokens = SyntaxHighlighter::parseLine(buffer, p->text, *m_renderer, state);
+                if (buffer.semantic)
+                    SemanticHighlights::overlay(tokens, buffer.semantic->inLine(current_doc_line + i), *m_renderer);
             }
 
-            int screen_x = m_text_area_start_x + m_gutter_width;
-            int token_idx = 0;
-            size_t token_char_offset = 0;
+            const auto& matches = matchesIn(buffer, p);
+            std::size_t from = buffer.horizontal_scroll_offset - 1;
+            drawLineSegment(p, tokens, highlight, matches, bracketsIn(brackets, current_doc_line + i),
+                            from, from + text_area_width, current_screen_y);
+            p = p->next;
+        }
+    }
+}
+
+// Draws characters [from, to) of `p` on row `screen_y`, starting at the left
+// edge of the text area.  `matches` are search hits and `brackets` the
+// columns of a matched bracket pair to highlight.
+void TextEditor::drawLineSegment(const Line* p, const std::vector<SyntaxToken>& tokens, bool highlight,
+                                 const std::vector<SearchMatches::Span>& matches, const std::vector<std::size_t>& brackets,
+                                 std::size_t from, std::size_t to, int screen_y) {
+    int screen_x = m_text_area_start_x + m_gutter_width;
+    std::size_t token_idx = 0;
+    std::size_t token_char_offset = 0;
+    std::size_t match_idx = 0;
+    to = std::min(to, p->text.length());
+
+    for (std::size_t char_idx = from; char_idx < to; ++char_idx) {
+        int current_col = char_idx + 1;
+        bool is_char_selected = p->selected && (current_col >= p->selection_start_col && current_col < p->selection_end_col);
+
+        int color = Renderer::CP_DEFAULT_TEXT;
+        int flags = 0;
+
+        while (match_idx < matches.size() && matches[match_idx].first + matches[match_idx].second <= char_idx) {
+            match_idx++;
+        }
+        bool is_char_match = match_idx < matches.size() && matches[match_idx].first <= char_idx;
+
+        if (is_char_selected) {
+            color = Renderer::CP_SELECTION;
+        } else if (is_char_match) {
+            color = Renderer::CP_SEARCH_MATCH;
+        } else if (std::find(brackets.begin(), brackets.end(), char_idx) != brackets.end()) {
+            color = Renderer::CP_BRACKET_MATCH;
+        } else {
+            if (highlight) {
+                while (token_idx < tokens.size() && token_char_offset + tokens[token_idx].text.length() <= char_idx) {
+                    token_char_offset += tokens[token_idx].text.length();
+                    token_idx++;
+                }
+                if (token_idx < tokens.size()) {
+                    color = tokens[token_idx].colorId;
+                    flags = tokens[token_idx].flags;
+                }
+            }
+        }
+        m_renderer->drawText(screen_x, screen_y, std::string(1, p->text[char_idx]), color, flags);
+        screen_x++;
+    }
+}
+
+// Soft-wrapped counterpart of the line loop in drawTextArea(): every line
+// takes as many rows as WrapLayout::rowStarts() gives it, and only its first
+// row gets a line number.  The row counts seen here are fed back into the
+// layout, which may only have estimated them.
+void TextEditor::drawWrappedText(EditorBuffer& buffer, SyntaxModel* model) {
+    int text_area_height = m_text_area_end_y - m_text_area_start_y + 1;
+    int text_area_width = m_text_area_end_x - m_text_area_start_x + 1 - m_gutter_width;
+    if (text_area_height <= 0 || text_area_width <= 0) return;
 
-            for (size_t char_idx = 0; char_idx < p->text.length(); ++char_idx) {
-                int current_col = char_idx + 1;
-                if (current_col >= buffer.horizontal_scroll_offset) {
-                    if (screen_x > m_text_area_end_x) break;
+    WrapLayout* layout = buffer.wrap_layout.get();
+    Line* p = buffer.first_visible_line;
+    int line_num = firstVisibleLineNum(buffer);
+    int skip = buffer.wrap_top_row;
+    LexState state = model ? model->stateAt(line_num - 1) : LexState();
+    const BracketMatch brackets = cursorBrackets(buffer, model);
 
-                    bool is_char_selected = p->selected && (current_col >= p->selection_start_col && current_col < p->selection_end_col);
+    auto clearRow = [&](int y) {
+        m_renderer->drawText(m_text_area_start_x, y, std::string(m_gutter_width + text_area_width, ' '), Renderer::CP_DEFAULT_TEXT);
+        if (m_gutter_width > 0) {
+            m_renderer->drawText(m_text_area_start_x, y, std::string(m_gutter_width, ' '), Renderer::CP_GUTTER_BG);
+            m_renderer->drawText(m_text_area_start_x + m_gutter_width - 1, y, "│", Renderer::CP_DIALOG_TITLE);
+        }
+    };
 
-                    int color = Renderer::CP_DEFAULT_TEXT;
-                    int flags = 0;
+    for (int i = 0; i < text_area_height; ) {
+        if (p == nullptr) { clearRow(m_text_area_start_y + i); ++i; continue; }
 
-                    if (is_char_selected) {
-                        color = Renderer::CP_SELECTION;
-                    } else {
-                        if (buffer.syntax_type != EditorBuffer::ST_NONE) {
-                            while (token_idx < tokens.size() && token_char_offset + tokens[token_idx].text.length() <= char_idx) {
-                                token_char_offset += tokens[token_idx].text.length();
-                                token_idx++;
-                            }
-                            if (token_idx < tokens.size()) {
-                                color = tokens[token_idx].colorId;
-                                flags = tokens[token_idx].flags;
-                            }
-                        }
-                    }
-                    m_renderer->drawText(screen_x, current_screen_y, std::string(1, p->text[char_idx]), color, flags);
-                    screen_x++;
-                }
+        std::vector<SyntaxToken> tokens;
+        if (model) {
+            tokens = SyntaxHighlighter::parseLine(buffer, p->text, *m_renderer, state);
+            if (buffer.semantic) SemanticHighlights::overlay(tokens, buffer.semantic->inLine(line_num - 1), *m_renderer);
+        }
+        const std::vector<std::size_t> bracket_cols = bracketsIn(brackets, line_num - 1);
+        std::vector<std::size_t> starts = WrapLayout::rowStarts(p->text, text_area_width);
+        if (layout) layout->setRows(line_num, (int)starts.size());
+        const auto& matches = matchesIn(buffer, p);
+
+        for (std::size_t r = std::min<std::size_t>(skip, starts.size() - 1); r < starts.size() && i < text_area_height; ++r, ++i) {
+            int current_screen_y = m_text_area_start_y + i;
+            clearRow(current_screen_y);
+            if (r == 0 && m_gutter_width > 0) {
+                std::string line_num_str = std::to_string(line_num);
+                m_renderer->drawText(m_text_area_start_x + m_gutter_width - line_num_str.length() - 1, current_screen_y, line_num_str, Renderer::CP_GUTTER_FG);
+                if (int mark = gutterMark(buffer.file_id, line_num))
+                    m_renderer->drawText(m_text_area_start_x, current_screen_y, "●", mark);
             }
-            p = p->next;
+            std::size_t to = (r + 1 < starts.size()) ? starts[r + 1] : p->text.length();
+            drawLineSegment(p, tokens, model != nullptr, matches, bracket_cols, starts[r], to, current_screen_y);
+        }
+        skip = 0;
+        p = p->next;
+        ++line_num;
+    }
+}
+
+// Draws the rows of a filtered view in place of the document.  The gutter
+// keeps the original line numbers.
+void TextEditor::drawFilteredView(FilteredView& view) {
+    int text_area_height = m_text_area_end_y - m_text_area_start_y + 1;
+    int text_area_width = m_text_area_end_x - m_text_area_start_x + 1 - m_gutter_width;
+    if (text_area_height <= 0 || text_area_width <= 0) return;
+
+    const auto& rows = view.rows();
+    if (view.cursor < view.top) view.top = view.cursor;
+    else if (view.cursor >= view.top + text_area_height) view.top = view.cursor - text_area_height + 1;
+
+    for (int i = 0; i < text_area_height; ++i) {
+        int current_screen_y = m_text_area_start_y + i;
+
+        m_renderer->drawText(m_text_area_start_x, current_screen_y, std::string(m_gutter_width + text_area_width, ' '), Renderer::CP_DEFAULT_TEXT);
+
+        if (m_gutter_width > 0) {
+            m_renderer->drawText(m_text_area_start_x, current_screen_y, std::string(m_gutter_width, ' '), Renderer::CP_GUTTER_BG);
+            m_renderer->drawText(m_text_area_start_x + m_gutter_width - 1, current_screen_y, "│", Renderer::CP_DIALOG_TITLE);
+        }
+
+        size_t idx = view.top + i;
+        if (idx >= rows.size()) {
+            if (i == 0 && !view.scanning())
+                m_renderer->drawText(m_text_area_start_x + m_gutter_width, current_screen_y, "-- no matching lines --", Renderer::CP_GUTTER_FG);
+            continue;
+        }
+
+        const FilteredView::Row& row = rows[idx];
+        if (m_gutter_width > 0) {
+            std::string line_num_str = std::to_string(row.line_num);
+            m_renderer->drawText(m_text_area_start_x + m_gutter_width - line_num_str.length() - 1, current_screen_y, line_num_str, Renderer::CP_GUTTER_FG);
+        }
+
+        const std::string& text = row.line->text;
+        size_t from = view.horizontal_scroll_offset - 1;
+        if (from < text.length()) {
+            int color = ((int)idx == view.cursor) ? Renderer::CP_HIGHLIGHT : Renderer::CP_DEFAULT_TEXT;
+            m_renderer->drawText(m_text_area_start_x + m_gutter_width, current_screen_y, text.substr(from, text_area_width), color);
+        }
+    }
+}
+
+// Formats only the rows on screen, straight from the mapping.  The cursor
+// byte and the last search hit are highlighted in both columns.
+void TextEditor::drawHexView(HexView& view) {
+    int text_area_height = m_text_area_end_y - m_text_area_start_y + 1;
+    int text_area_width = m_text_area_end_x - m_text_area_start_x + 1;
+    if (text_area_height <= 0 || text_area_width <= 0) return;
+
+    const std::uint64_t row_bytes = HexView::BYTES_PER_ROW;
+    std::uint64_t cursor_row = view.cursor / row_bytes;
+    if (cursor_row < view.top_row) view.top_row = cursor_row;
+    else if (cursor_row >= view.top_row + text_area_height) view.top_row = cursor_row - text_area_height + 1;
+
+    std::uint64_t mark_end = view.cursor + std::max<std::size_t>(1, view.match_len);
+    for (int i = 0; i < text_area_height; ++i) {
+        int current_screen_y = m_text_area_start_y + i;
+        m_renderer->drawText(m_text_area_start_x, current_screen_y, std::string(text_area_width, ' '), Renderer::CP_DEFAULT_TEXT);
+
+        std::uint64_t row = view.top_row + i;
+        if (row >= view.rowCount()) continue;
+        std::string text = view.formatRow(row);
+        m_renderer->drawText(m_text_area_start_x, current_screen_y, text.substr(0, text_area_width), Renderer::CP_DEFAULT_TEXT);
+
+        for (int b = 0; b < HexView::BYTES_PER_ROW; ++b) {
+            std::uint64_t offset = row * row_bytes + b;
+            if (offset < view.cursor || offset >= mark_end || offset >= view.size()) continue;
+            int hx = view.hexColumn(b), ax = view.asciiColumn(b);
+            if (ax >= (int)text.size()) break;   // a row the file was truncated under
+            if (hx + 2 <= text_area_width)
+                m_renderer->drawText(m_text_area_start_x + hx, current_screen_y, text.substr(hx, 2), Renderer::CP_SELECTION);
+            if (ax < text_area_width)
+                m_renderer->drawText(m_text_area_start_x + ax, current_screen_y, text.substr(ax, 1), Renderer::CP_SELECTION);
         }
     }
 }
@@ -409,6 +1012,20 @@ void TextEditor::drawStatusBar() {
     if (m_search_mode) {
         std::string search_prompt = "Search: " + m_search_term;
         m_renderer->drawText(1, h - 1, search_prompt, Renderer::CP_STATUS_BAR);
+        if (currentBufferIdx() != -1 && currentBuffer().search_matches) {
+            const SearchMatches& matches = *currentBuffer().search_matches;
+            std::string info;
+            if (!matches.counted()) info = "Counting...";
+            else if (matches.total() == 0) info = "No matches";
+            else if (currentBuffer().selecting) info = "Match " + formatCount(matches.before() + 1) + " of " + formatCount(matches.total());
+            else info = formatCount(matches.total()) + " matches";
+            int x = w - (int)info.length() - 2;
+            if (x > (int)search_prompt.length() + 2) m_renderer->drawText(x, h - 1, info, Renderer::CP_STATUS_BAR);
+        }
+        return;
+    }
+    if (m_hex_prompt != HexPrompt::NONE && activeHexView()) {
+        m_renderer->drawText(1, h - 1, hexPromptLabel() + m_hex_prompt_text, Renderer::CP_STATUS_BAR);
         return;
     }
 
@@ -434,16 +1051,174 @@ void TextEditor::drawStatusBar() {
             m_renderer->drawText(mx, h - 1, lib_msg, Renderer::CP_STATUS_BAR_HIGHLIGHT);
     }
 
+    // Progress of a file or pipe that is still streaming in
+    if (currentBufferIdx() != -1 && currentBuffer().load_id != 0) {
+        const EditorBuffer& buffer = currentBuffer();
+        std::string load_msg;
+        if (buffer.load_id == m_stdin_load_id) {
+            load_msg = " Reading stdin... " + std::to_string(buffer.total_lines) + " lines ";
+        } else if (buffer.load_bytes_total > 0 && !m_follower.isFollowing(buffer.file_id)) {
+            int pct = (int)(buffer.load_bytes_done * 100 / buffer.load_bytes_total);
+            load_msg = " Loading... " + std::to_string(pct) + "% ";
+        }
+        int mx = (w - (int)load_msg.size()) / 2;
+        if (mx > 50)
+            m_renderer->drawText(mx, h - 1, load_msg, Renderer::CP_STATUS_BAR_HIGHLIGHT);
+    } else if (HexView* view = activeHexView(); view && view->searching) {
+        const std::string find_msg = " Searching... ";
+        int mx = (w - (int)find_msg.size()) / 2;
+        if (mx > 50)
+            m_renderer->drawText(mx, h - 1, find_msg, Renderer::CP_STATUS_BAR_HIGHLIGHT);
+    } else if (FilteredView* view = activeFilteredView()) {
+        std::string filter_msg = view->scanning()
+            ? " Filtering... " + std::to_string(view->scanPercent()) + "% "
+            : " " + std::to_string(view->rows().size()) + " matching lines ";
+        int mx = (w - (int)filter_msg.size()) / 2;
+        if (mx > 50)
+            m_renderer->drawText(mx, h - 1, filter_msg, Renderer::CP_STATUS_BAR_HIGHLIGHT);
+    } else if (m_run && !m_run_reported) {
+        const std::string run_msg = " " + m_run_name + " running (F5) ";
+        int mx = (w - (int)run_msg.size()) / 2;
+        if (mx > 50)
+            m_renderer->drawText(mx, h - 1, run_msg, Renderer::CP_STATUS_BAR_HIGHLIGHT);
+    } else if (!m_lsp_status.empty() || !m_lsp->progress().empty()) {
+        const std::string lsp_msg = " " + (m_lsp_status.empty() ? m_lsp->progress() : m_lsp_status) + " ";
+        int mx = (w - (int)lsp_msg.size()) / 2;
+        if (mx > 50)
+            m_renderer->drawText(mx, h - 1, lsp_msg, Renderer::CP_STATUS_BAR_HIGHLIGHT);
+    } else if (m_gbench) {
+        std::string bench_msg = " Google Benchmark: " + std::to_string(m_gbench_progress.finished()) + " done";
+        if (!m_gbench_progress.last().empty()) bench_msg += ", last " + m_gbench_progress.last();
+        bench_msg += " ";
+        int mx = (w - (int)bench_msg.size()) / 2;
+        if (mx > 50)
+            m_renderer->drawText(mx, h - 1, bench_msg, Renderer::CP_STATUS_BAR_HIGHLIGHT);
+    } else if (m_bench->running()) {
+        const std::string bench_msg = " Benchmark: " + std::to_string(m_bench->completed()) + "/" +
+                                      std::to_string(m_bench->total()) + " runs ";
+        int mx = (w - (int)bench_msg.size()) / 2;
+        if (mx > 50)
+            m_renderer->drawText(mx, h - 1, bench_msg, Renderer::CP_STATUS_BAR_HIGHLIGHT);
+    } else if (m_tidy->pending() > 0 || !m_tidy_error.empty()) {
+        const std::string tidy_msg = m_tidy->pending() > 0
+            ? " clang-tidy: " + formatCount(m_tidy->pending()) + " file(s)... "
+            : " " + m_tidy_error + " ";
+        int mx = (w - (int)tidy_msg.size()) / 2;
+        if (mx > 50)
+            m_renderer->drawText(mx, h - 1, tidy_msg, Renderer::CP_STATUS_BAR_HIGHLIGHT);
+    }
+
     if (currentBufferIdx() != -1) {
         EditorBuffer& buffer = currentBuffer();
         char status_buf[120];
-        snprintf(status_buf, sizeof(status_buf), "%s Line: %-5d Col: %-5d %s", (buffer.read_only ? "[RO]" : ""), buffer.current_line_num, buffer.cursor_col, (buffer.insert_mode ? "INS" : "OVR"));
+        std::string mode_tag = m_follower.isFollowing(buffer.file_id) ? "[TAIL]" : (buffer.read_only ? "[RO]" : "");
+        // Degraded or manually chosen feature level; '*' marks an override
+        if (buffer.mode != BufferMode::Full || buffer.mode_pinned)
+            mode_tag = "[" + std::string(BufferPolicy::name(buffer.mode)) + (buffer.mode_pinned ? "*] " : "] ") + mode_tag;
+        int line_num = buffer.current_line_num;
+        if (FilteredView* view = activeFilteredView()) {
+            mode_tag = "[FILTER]";
+            line_num = view->rows().empty() ? 0 : view->rows()[view->cursor].line_num;
+        }
+        if (HexView* view = activeHexView()) {
+            snprintf(status_buf, sizeof(status_buf), "[HEX] Offset: 0x%llx / %llu", (unsigned long long)view->cursor, (unsigned long long)view->size());
+        } else {
+            snprintf(status_buf, sizeof(status_buf), "%s Line: %-5d Col: %-5d %s", mode_tag.c_str(), line_num, buffer.cursor_col, (buffer.insert_mode ? "INS" : "OVR"));
+        }
         if (w > 50 + (int)strlen(status_buf)) {
             m_renderer->drawText(w - strlen(status_buf) - 2, h - 1, status_buf, Renderer::CP_STATUS_BAR);
         }
     }
 }
 
+// Keeps the buffer's overview summary in step with its text and the
+// current search term.  A progressive load changes the text with every
+// block, so the summary waits until it is all there; a followed file never
+// stops loading and is summarized at the ruler's own pace.
+void TextEditor::syncOverview(EditorBuffer& buffer) {
+    if (buffer.hex_view) return;
+    if (buffer.load_id != 0 && !m_follower.isFollowing(buffer.file_id)) return;
+    if (!buffer.overview) buffer.overview = std::make_shared<OverviewRuler>();
+    buffer.overview->sync(buffer, searchMatcher());
+}
+
+// The incremental search term, compiled; null when not searching or while
+// the term is too short to search for.
+const std::shared_ptr<const LineMatcher>& TextEditor::searchMatcher() {
+    std::string term = (m_search_mode && m_search_term.length() > 2) ? m_search_term : std::string();
+    if (term != m_search_matcher_term) {
+        m_search_matcher_term = term;
+        m_search_matcher = term.empty() ? nullptr : std::make_shared<const LineMatcher>(term, false);
+    }
+    return m_search_matcher;
+}
+
+// Keeps the highlighted matches and their count in step with the search.
+// The current match is the selection PerformSearch() made, if any.
+void TextEditor::syncSearchMatches(EditorBuffer& buffer) {
+    if (buffer.hex_view) return;
+    const auto& matcher = searchMatcher();
+    if (!matcher && !buffer.search_matches) return;
+    if (!buffer.search_matches) buffer.search_matches = std::make_shared<SearchMatches>();
+    if (buffer.selecting) {
+        buffer.search_matches->sync(buffer, matcher, buffer.selection_anchor_linenum, buffer.selection_anchor_col);
+    } else {
+        buffer.search_matches->sync(buffer, matcher, buffer.current_line_num, buffer.cursor_col);
+    }
+    if (!matcher) buffer.search_matches.reset();
+}
+
+// Keeps libclang's colours for a C/C++ buffer in step with its text, and
+// parses again once it has been left alone for a moment.
+void TextEditor::syncSemanticHighlights(EditorBuffer& buffer) {
+    const bool wanted = m_config.semantic_highlighting && !buffer.hex_view && buffer.file_id != INVALID_FILE_ID &&
+                        buffer.syntax_type == EditorBuffer::ST_C_CPP && BufferPolicy::syntaxHighlighting(buffer.mode);
+    if (!wanted) { buffer.semantic.reset(); return; }
+    if (!buffer.semantic) buffer.semantic = std::make_shared<SemanticHighlights>();
+    buffer.semantic->sync(buffer);
+    if (!buffer.semantic->due(buffer)) return;
+
+    std::vector<std::string> args = m_buildSystem->getClangArguments(buffer);
+    if (!m_project.name.empty()) args.push_back("-I" + m_project.root);
+    buffer.semantic->parse(buffer, m_tu_cache, PathRegistry::instance().path(buffer.file_id), std::move(args),
+                           std::make_shared<UnsavedBuffers>(*m_bufferManager));
+}
+
+// Draws the overview column in place of the vertical scrollbar track: code
+// density, search hits, changed lines and compiler diagnostics for the whole
+// file, with the visible lines first_line .. last_line highlighted.
+void TextEditor::drawOverviewRuler(EditorBuffer& buffer, int bar_x, int first_line, int last_line) {
+    int height = m_text_area_end_y - m_text_area_start_y + 1;
+    if (height <= 0) return;
+    OverviewRuler& ruler = *buffer.overview;
+    std::vector<OverviewRuler::Row> rows = ruler.track(height);
+
+    forEachDiagnostic(buffer.file_id, [&](const CompileMessage& msg) {
+        OverviewRuler::Mark mark = msg.type == CompileMessage::CMSG_ERROR   ? OverviewRuler::Mark::Error
+                                 : msg.type == CompileMessage::CMSG_WARNING ? OverviewRuler::Mark::Warning
+                                                                            : OverviewRuler::Mark::None;
+        OverviewRuler::Row& row = rows[ruler.rowOfLine(msg.line, height)];
+        row.mark = std::max(row.mark, mark);
+    });
+
+    int view_top = ruler.rowOfLine(first_line, height);
+    int view_bottom = ruler.rowOfLine(last_line, height);
+    for (int i = 0; i < height; ++i) {
+        const OverviewRuler::Row& row = rows[i];
+        bool in_view = i >= view_top && i <= view_bottom;
+        const char* glyph = row.density == 0 ? " " : row.density < 16 ? "░" : row.density < 40 ? "▒" : "▓";
+        int color = in_view ? Renderer::CP_MENU_SELECTED : Renderer::CP_HIGHLIGHT;
+        switch (row.mark) {
+        case OverviewRuler::Mark::Error:   glyph = "■"; color = Renderer::CP_COMPILE_ERROR; break;
+        case OverviewRuler::Mark::Warning: glyph = "■"; color = Renderer::CP_COMPILE_WARNING; break;
+        case OverviewRuler::Mark::Hit:     glyph = "■"; color = Renderer::CP_SELECTION; break;
+        case OverviewRuler::Mark::Change:  glyph = "▌"; color = Renderer::CP_CHANGED_INDICATOR; break;
+        case OverviewRuler::Mark::None:    break;
+        }
+        m_renderer->drawText(bar_x, m_text_area_start_y + i, glyph, color, in_view ? A_BOLD : 0);
+    }
+}
+
 void TextEditor::drawScrollbars() {
     if (m_renderer->getWidth() < 5 || m_renderer->getHeight() < 5 || currentBufferIdx() == -1) return;
     EditorBuffer& buffer = currentBuffer();
@@ -453,18 +1228,50 @@ void TextEditor::drawScrollbars() {
     int bar_y = m_text_area_end_y + 2;
 
     int first_visible_linenum = 1;
-    Line* p = buffer.document_head;
-    while(p && p != buffer.first_visible_line) { first_visible_linenum++; p = p->next; }
+    int total_lines = buffer.total_lines;
+    if (buffer.hex_view) {
+        // Row counts of huge files overflow int; scale to a per-mille range
+        const HexView& view = *buffer.hex_view;
+        std::uint64_t rows = view.rowCount();
+        total_lines = rows > (std::uint64_t)page_height ? page_height + 1000 : (int)rows;
+        if (rows > (std::uint64_t)page_height)
+            first_visible_linenum = 1 + (int)((double)view.top_row / (rows - page_height) * 1000);
+    } else if (buffer.filter_view) {
+        first_visible_linenum = buffer.filter_view->top + 1;
+        total_lines = (int)buffer.filter_view->rows().size();
+    } else if (buffer.overview && buffer.overview->ready()) {
+        // The text itself gets the overview column; its position comes from
+        // the cursor row, not from a walk of the list
+        int first_line, last_line;
+        if (softWrap(buffer) && buffer.wrap_layout) {
+            const WrapLayout& layout = *buffer.wrap_layout;
+            first_line = firstVisibleLineNum(buffer);
+            int sub = 0;
+            last_line = layout.lineOfRow(layout.rowOfLine(first_line) + buffer.wrap_top_row + page_height - 1, sub);
+        } else {
+            first_line = std::max(1, buffer.current_line_num - (buffer.cursor_screen_y - m_text_area_start_y));
+            last_line = std::min(buffer.total_lines, first_line + page_height - 1);
+        }
+        drawOverviewRuler(buffer, bar_x, first_line, last_line);
+        total_lines = 0;   // no thumb on top of it
+    } else if (softWrap(buffer) && buffer.wrap_layout) {
+        const WrapLayout& layout = *buffer.wrap_layout;
+        total_lines = (int)std::min<std::uint64_t>(layout.totalRows(), INT_MAX);
+        std::uint64_t top = layout.rowOfLine(firstVisibleLineNum(buffer)) + buffer.wrap_top_row;
+        first_visible_linenum = (int)std::min<std::uint64_t>(top + 1, INT_MAX);
+    } else {
+        first_visible_linenum = std::max(1, buffer.current_line_num - (buffer.cursor_screen_y - m_text_area_start_y));
+    }
 
     attron(COLOR_PAIR(Renderer::CP_HIGHLIGHT));
     mvaddch(m_text_area_start_y - 1, bar_x, ACS_UARROW);
     mvaddch(m_text_area_end_y + 1, bar_x, ACS_DARROW);
 
-    int track_height = page_height;
+    int track_height = total_lines > 0 ? page_height : 0;
     if (track_height > 0) {
         for(int i = 0; i < track_height; ++i) { mvaddch(m_text_area_start_y + i, bar_x, ACS_CKBOARD); }
-        if (buffer.total_lines > page_height) {
-            float proportion_scrolled = (buffer.total_lines > 1) ? (float)(first_visible_linenum - 1) / (buffer.total_lines - page_height) : 0.0f;
+        if (total_lines > page_height) {
+            float proportion_scrolled = (total_lines > 1) ? (float)(first_visible_linenum - 1) / (total_lines - page_height) : 0.0f;
             if (proportion_scrolled > 1.0) proportion_scrolled = 1.0;
             int thumb_y = m_text_area_start_y + (int)((track_height - 1) * proportion_scrolled);
             mvaddch(thumb_y, bar_x, ACS_BLOCK);
@@ -473,7 +1280,7 @@ void TextEditor::drawScrollbars() {
     attroff(COLOR_PAIR(Renderer::CP_HIGHLIGHT));
 
     int page_width = m_text_area_end_x - m_text_area_start_x + 1;
-    int line_width = buffer.current_line ? buffer.current_line->text.length() : 0;
+    int line_width = (buffer.current_line && !softWrap(buffer)) ? buffer.current_line->text.length() : 0;
 
     attron(COLOR_PAIR(Renderer::CP_HIGHLIGHT));
     mvaddch(bar_y, m_text_area_start_x - 1, ACS_LARROW);
@@ -501,6 +1308,7 @@ void TextEditor::drawEditorState(int active_menu_id) {
     drawMenuBar(active_menu_id);
     drawStatusBar();
     drawScrollbars();
+    if (m_terminal_open && m_terminal) drawTerminalPane();
 
     if (m_compile_output_visible) {
         drawCompileOutputWindow();
@@ -516,9 +1324,14 @@ void TextEditor::handleResize() {
     m_renderer->updateDimensions();
     m_text_area_start_x = m_project_panel_open ? PANEL_W : 1;
     m_text_area_end_x = m_renderer->getWidth() - 3;
-    m_text_area_end_y = m_renderer->getHeight() - 4;
+    m_text_area_end_y = m_renderer->getHeight() - 4 - terminalPaneHeight();
     if (m_text_area_end_x <= m_text_area_start_x) { m_text_area_end_x = m_text_area_start_x + 1; }
     if (m_text_area_end_y <= m_text_area_start_y) { m_text_area_end_y = m_text_area_start_y + 1; }
+    if (m_terminal_open && m_terminal) {
+        const int rows = terminalPaneHeight() - 2, cols = m_renderer->getWidth() - 2;
+        m_terminal->resize(rows, cols);
+        m_shell->resize(m_terminal->rows(), m_terminal->cols());
+    }
     update_cursor_and_scroll();
 }
 
@@ -541,6 +1354,7 @@ void TextEditor::updateMenuLabels() {
         " -------------- ",
         formatMenuItem("&Save", ACT_SAVE),
         formatMenuItem("Save &As...", ACT_SAVE_AS),
+        formatMenuItem("&Follow File", ACT_FOLLOW),
         " -------------- ",
         formatMenuItem("E&xit", ACT_EXIT)
     };
@@ -572,25 +1386,37 @@ void TextEditor::updateMenuLabels() {
         " Find &Next",
         " Find Pre&vious",
         formatMenuItem("&Replace...", ACT_REPLACE),
+        formatMenuItem("Rena&me Symbol...", ACT_RENAME_SYMBOL),
+        formatMenuItem("Find Re&ferences", ACT_FIND_REFERENCES),
         " -------------- ",
-        formatMenuItem("&Go To Line...", ACT_GOTO_LINE)
+        formatMenuItem("&Go To Line...", ACT_GOTO_LINE),
+        formatMenuItem("Fi&lter Lines...", ACT_FILTER)
     };
 
     m_submenu_build = {
         formatMenuItem("&Run", ACT_RUN),
+        formatMenuItem("&Benchmark...", ACT_BENCHMARK),
         formatMenuItem("&Compile", ACT_COMPILE),
-        formatMenuItem("Compile &Options...", ACT_COMPILE_OPTIONS)
+        formatMenuItem("Compile &Options...", ACT_COMPILE_OPTIONS),
+        " -------------- ",
+        formatMenuItem("Clang-&Tidy Project", ACT_TIDY_PROJECT),
+        formatMenuItem("Tidy &Findings", ACT_TIDY_FINDINGS)
     };
 
     m_submenu_window = {
         formatMenuItem("&Output Screen", ACT_TOGGLE_OUTPUT),
+        formatMenuItem("&Terminal", ACT_TOGGLE_TERMINAL),
         " -------------- ",
         formatMenuItem("&Next Window", ACT_NEXT_BUFFER),
         formatMenuItem("&Previous Window", ACT_PREV_BUFFER),
         formatMenuItem("&Close Window", ACT_CLOSE_BUFFER)
     };
 
-    m_submenu_options = { formatMenuItem("Editor &Settings...", ACT_SETTINGS) };
+    m_submenu_options = {
+        formatMenuItem("Editor &Settings...", ACT_SETTINGS),
+        formatMenuItem("&Buffer Mode", ACT_BUFFER_MODE),
+        formatMenuItem("&Word Wrap", ACT_SOFT_WRAP)
+    };
 
     m_submenu_help = {
         formatMenuItem("&View Help...", ACT_HELP),
@@ -601,29 +1427,61 @@ void TextEditor::updateMenuLabels() {
 void TextEditor::main_loop() {
     main_loop_running = true;
     while (main_loop_running) {
-        if (m_output_screen_visible) {
-            ShowOutputScreen();
-            continue;
-        }
-
         // Calculate gutter width at the start of the loop
-        if (m_config.show_line_numbers && currentBufferIdx() != -1) {
+        if (m_config.show_line_numbers && currentBufferIdx() != -1 && !currentBuffer().hex_view) {
             m_gutter_width = std::to_string(currentBuffer().total_lines).length() + 2;
         } else {
             m_gutter_width = 0;
         }
 
+        // Completion callbacks of background tasks run here, on the UI thread
+        TaskScheduler::instance().runPosted();
+        pumpStdin();
+        syncLanguageServer();
+        syncProgram();
+        syncGoogleBenchmark();
+        syncTerminal();
+        m_follower.tick(*m_bufferManager);
+        if (FilteredView* view = activeFilteredView()) view->sync(currentBuffer());
+        if (currentBufferIdx() != -1) {
+            syncOverview(currentBuffer());
+            syncSearchMatches(currentBuffer());
+            syncSemanticHighlights(currentBuffer());
+        }
+        if (m_output_screen_visible) {
+            outputScreenFrame();
+            continue;
+        }
+
         update_cursor_and_scroll();
         drawEditorState();
-        if (m_project_panel_focused) {
+        if (m_terminal_focused && !m_compile_output_visible) {
+            if (m_terminal_scroll == 0 && m_terminal->cursorVisible()) {
+                m_renderer->showCursor();
+                m_renderer->setCursor(1 + m_terminal->cursorX(), m_text_area_end_y + 4 + m_terminal->cursorY());
+            } else {
+                m_renderer->hideCursor();
+            }
+        } else if (m_project_panel_focused) {
             m_renderer->hideCursor();
         } else if (currentBufferIdx() != -1) {
             if (m_search_mode) {
                 m_renderer->setCursor(1 + strlen("Search: ") + m_search_term.length(), m_renderer->getHeight() - 1);
+            } else if (HexView* hex = activeHexView(); hex && !m_compile_output_visible) {
+                if (m_hex_prompt != HexPrompt::NONE) {
+                    m_renderer->setCursor(1 + hexPromptLabel().length() + m_hex_prompt_text.length(), m_renderer->getHeight() - 1);
+                } else {
+                    int byte = (int)(hex->cursor % HexView::BYTES_PER_ROW);
+                    int row = (int)(hex->cursor / HexView::BYTES_PER_ROW - hex->top_row);
+                    m_renderer->setCursor(m_text_area_start_x + hex->hexColumn(byte), m_text_area_start_y + row);
+                }
+            } else if (FilteredView* view = activeFilteredView(); view && !m_compile_output_visible) {
+                m_renderer->setCursor(m_text_area_start_x + m_gutter_width, m_text_area_start_y + view->cursor - view->top);
             } else if (!m_compile_output_visible) {
                 EditorBuffer& buffer = currentBuffer();
                 // Adjust cursor position for the gutter
-                m_renderer->setCursor(buffer.cursor_col - buffer.horizontal_scroll_offset + m_text_area_start_x + m_gutter_width, buffer.cursor_screen_y);
+                int x = softWrap(buffer) ? m_wrap_cursor_x : buffer.cursor_col - buffer.horizontal_scroll_offset;
+                m_renderer->setCursor(x + m_text_area_start_x + m_gutter_width, buffer.cursor_screen_y);
             }
         }
         m_renderer->refresh();
@@ -633,7 +1491,10 @@ void TextEditor::main_loop() {
         if (ch == KEY_RESIZE) { handleResize(); continue; }
 
         if (ch != ERR) {
-            if (m_project_panel_focused && !m_compile_output_visible) {
+            TaskScheduler::instance().noteUserActivity();
+            if (m_terminal_focused && !m_compile_output_visible) {
+                handleTerminalKey(ch);
+            } else if (m_project_panel_focused && !m_compile_output_visible) {
                 handleProjectPanelKey(ch);
             } else if (m_compile_output_visible) {
                 switch (ch) {
@@ -678,8 +1539,8 @@ void TextEditor::main_loop() {
                     if (m_compile_output_cursor_pos < (int)m_compile_output_lines.size()) {
                         const auto& msg = m_compile_output_lines[m_compile_output_cursor_pos];
                         if (msg.line != -1) {
-                            if (!msg.filename.empty()) {
-                                openFileAtLine(msg.filename, msg.line, std::max(1, msg.col));
+                            if (msg.file_id != INVALID_FILE_ID) {
+                                openFileAtLine(msg.file_id, msg.line, std::max(1, msg.col));
                             } else if (currentBufferIdx() != -1) {
                                 currentBuffer().current_line_num = msg.line;
                                 currentBuffer().cursor_col = std::max(1, msg.col);
@@ -697,6 +1558,10 @@ void TextEditor::main_loop() {
                     handleResize();
                     break;
                 }
+            } else if (!m_search_mode && activeFilteredView()) {
+                handleFilteredViewKey(ch);
+            } else if (activeHexView()) {
+                handleHexViewKey(ch);
             } else if (ch == 27 || ch == KEY_F(10)) {
                 process_key(ch);
             } else {
@@ -724,12 +1589,11 @@ void TextEditor::update_cursor_and_scroll() {
         buffer.cursor_col = 1;
     }
 
-    int first_visible_linenum = 1;
-    Line* p = buffer.document_head;
-    while (p && p != buffer.first_visible_line) {
-        p = p->next;
-        first_visible_linenum++;
-    }
+    if (softWrap(buffer)) { scrollWrapped(buffer); return; }
+    buffer.wrap_layout.reset();
+    buffer.wrap_top_row = 0;
+
+    int first_visible_linenum = firstVisibleLineNum(buffer);
 
     int page_height = m_text_area_end_y - m_text_area_start_y + 1;
     if (page_height <= 0) return;
@@ -764,6 +1628,92 @@ void TextEditor::update_cursor_and_scroll() {
     }
 }
 
+bool TextEditor::softWrap(const EditorBuffer& buffer) const {
+    return m_config.soft_wrap && BufferPolicy::softWrap(buffer.mode) && !buffer.hex_view;
+}
+
+// The buffer's wrap layout, created if needed and synced to the text and
+// the current width of the text area.
+WrapLayout& TextEditor::syncWrapLayout(EditorBuffer& buffer) {
+    if (!buffer.wrap_layout) buffer.wrap_layout = std::make_shared<WrapLayout>();
+    int width = m_text_area_end_x - m_text_area_start_x + 1 - m_gutter_width;
+    int page_height = m_text_area_end_y - m_text_area_start_y + 1;
+    buffer.wrap_layout->sync(buffer, width, firstVisibleLineNum(buffer), page_height);
+    return *buffer.wrap_layout;
+}
+
+namespace {
+// Index of the visual row holding `offset`, given the row starts of a line.
+int rowIndexOf(const std::vector<std::size_t>& starts, std::size_t offset) {
+    return (int)(std::upper_bound(starts.begin(), starts.end(), offset) - starts.begin()) - 1;
+}
+}
+
+// update_cursor_and_scroll() for soft-wrapped buffers: works in visual rows,
+// keeping the cursor's row on screen.  The view may start in the middle of a
+// line (wrap_top_row), so a line taller than the screen can still be read.
+void TextEditor::scrollWrapped(EditorBuffer& buffer) {
+    int page_height = m_text_area_end_y - m_text_area_start_y + 1;
+    int width = m_text_area_end_x - m_text_area_start_x + 1 - m_gutter_width;
+    if (page_height <= 0 || width <= 0) return;
+
+    WrapLayout& layout = syncWrapLayout(buffer);
+    std::vector<std::size_t> starts = WrapLayout::rowStarts(buffer.current_line->text, width);
+    layout.setRows(buffer.current_line_num, (int)starts.size());
+    int sub = rowIndexOf(starts, buffer.cursor_col - 1);
+    std::uint64_t cursor_row = layout.rowOfLine(buffer.current_line_num) + sub;
+
+    int first_visible_linenum = firstVisibleLineNum(buffer);
+    buffer.wrap_top_row = std::clamp(buffer.wrap_top_row, 0, layout.rowsOf(std::min(first_visible_linenum, buffer.total_lines)) - 1);
+    std::uint64_t top = layout.rowOfLine(first_visible_linenum) + buffer.wrap_top_row;
+    if (cursor_row < top) top = cursor_row;
+    else if (cursor_row >= top + page_height) top = cursor_row - page_height + 1;
+
+    int top_sub = 0;
+    int top_line = layout.lineOfRow(top, top_sub);
+    if (top_line != first_visible_linenum) buffer.first_visible_line = lineAt(buffer, top_line);
+    buffer.wrap_top_row = top_sub;
+
+    buffer.cursor_screen_y = m_text_area_start_y + (int)(cursor_row - top);
+    buffer.horizontal_scroll_offset = 1;
+    m_wrap_cursor_x = buffer.cursor_col - 1 - (int)starts[sub];
+}
+
+// Moves the cursor `rows` visual rows up (negative) or down, keeping its
+// column within the row where possible.  Used for the arrow and page keys
+// while soft-wrapping.
+void TextEditor::moveWrapped(EditorBuffer& buffer, int rows) {
+    int width = m_text_area_end_x - m_text_area_start_x + 1 - m_gutter_width;
+    if (width <= 0) return;
+
+    WrapLayout& layout = syncWrapLayout(buffer);
+    std::vector<std::size_t> starts = WrapLayout::rowStarts(buffer.current_line->text, width);
+    layout.setRows(buffer.current_line_num, (int)starts.size());
+    int sub = rowIndexOf(starts, buffer.cursor_col - 1);
+    std::size_t x = buffer.cursor_col - 1 - starts[sub];
+
+    std::int64_t target = (std::int64_t)layout.rowOfLine(buffer.current_line_num) + sub + rows;
+    target = std::clamp<std::int64_t>(target, 0, (std::int64_t)layout.totalRows() - 1);
+    int target_sub = 0;
+    int target_line = layout.lineOfRow((std::uint64_t)target, target_sub);
+
+    Line* line = lineAt(buffer, target_line);
+    std::vector<std::size_t> target_starts = WrapLayout::rowStarts(line->text, width);
+    layout.setRows(target_line, (int)target_starts.size());
+    target_sub = std::min<int>(target_sub, (int)target_starts.size() - 1);
+    // A row that wraps ends before the next row's first character
+    std::size_t row_end = (target_sub + 1 < (int)target_starts.size()) ? target_starts[target_sub + 1] - 1 : line->text.length();
+
+    buffer.current_line = line;
+    buffer.current_line_num = target_line;
+    buffer.cursor_col = (int)std::min(target_starts[target_sub] + x, row_end) + 1;
+}
+
+void TextEditor::ToggleSoftWrap() {
+    m_config.soft_wrap = !m_config.soft_wrap;
+    update_cursor_and_scroll();
+}
+
 void TextEditor::HandleAltKey(wint_t key) {
     wint_t lookup_key = key;
     if (key >= 'a' && key <= 'z') lookup_key = toupper(key);
@@ -885,16 +1835,16 @@ void TextEditor::DeleteSelection() {
         while(current && current != p_end) {
             Line* to_delete = current;
             current = current->next;
-            delete to_delete;
+            buffer.line_pool.destroy(to_delete);
             lines_deleted_count++;
         }
         p_start->next = p_end->next;
         if (p_end->next) { p_end->next->prev = p_start; }
-        delete p_end;
+        buffer.line_pool.destroy(p_end);
         lines_deleted_count++;
     }
     buffer.total_lines -= lines_deleted_count;
-    buffer.changed = true;
+    buffer.touch();
     ClearSelection();
 }
 
@@ -980,54 +1930,63 @@ void TextEditor::HandlePaste() {
         buffer.cursor_col = buffer.current_line->text.length() - remainder.length() + 1;
         buffer.current_line->text += remainder;
     }
-    buffer.changed = true;
+    buffer.touch(buffer.current_line);
 }
 
-void TextEditor::CreateUndoPoint(EditorBuffer& buffer) {
+// Copies `count` lines starting at `first_line` (1-based), or the whole
+// document if first_line is 0, together with the cursor and view position.
+UndoRecord TextEditor::captureUndoRecord(EditorBuffer& buffer, int first_line, int count) {
     UndoRecord record;
-    for(Line* p = buffer.document_head; p != nullptr; p = p->next) {
-        record.lines.push_back(p->text);
+    record.first_line = first_line;
+    record.total_lines = buffer.total_lines;
+    if (first_line == 0) {
+        for (Line* p = buffer.document_head; p != nullptr; p = p->next) record.lines.push_back(p->text);
+    } else {
+        Line* p = lineAt(buffer, first_line);
+        for (int i = 0; i < count && p; ++i, p = p->next) record.lines.push_back(p->text);
     }
     record.cursor_line_num = buffer.current_line_num;
     record.cursor_col = buffer.cursor_col;
+    record.first_visible_line_num = firstVisibleLineNum(buffer);
+    return record;
+}
 
-    int fv_linenum = 1;
-    Line* p = buffer.document_head;
-    while (p && p != buffer.first_visible_line) {
-        p = p->next;
-        fv_linenum++;
+// Full buffers snapshot the whole document.  The others journal only the
+// lines the coming edit can touch: the selection or the cursor line, plus
+// one line either side for joins by Backspace and Delete.
+void TextEditor::CreateUndoPoint(EditorBuffer& buffer, bool whole_document) {
+    int first = 0, count = 0;
+    if (!whole_document && !BufferPolicy::snapshotUndo(buffer.mode)) {
+        int lo = buffer.current_line_num, hi = lo;
+        if (buffer.selecting) {
+            lo = std::min(lo, buffer.selection_anchor_linenum);
+            hi = std::max(hi, buffer.selection_anchor_linenum);
+        }
+        first = std::max(1, lo - 1);
+        count = std::min(buffer.total_lines, hi + 1) - first + 1;
     }
-    record.first_visible_line_num = fv_linenum;
-
-    buffer.undo_stack.push_back(record);
+    buffer.undo_stack.push_back(captureUndoRecord(buffer, first, count));
     if (buffer.undo_stack.size() > 100) {
         buffer.undo_stack.erase(buffer.undo_stack.begin());
     }
     buffer.redo_stack.clear();
 }
 
+// The record that undoes `record` again: the same range, grown or shrunk
+// by the lines added or removed since it was taken.
+UndoRecord TextEditor::inverseUndoRecord(EditorBuffer& buffer, const UndoRecord& record) {
+    if (record.first_line == 0) return captureUndoRecord(buffer, 0, 0);
+    int count = (int)record.lines.size() + buffer.total_lines - record.total_lines;
+    return captureUndoRecord(buffer, record.first_line, count);
+}
+
 void TextEditor::HandleUndo() {
     if (currentBufferIdx() == -1 || currentBuffer().undo_stack.empty()) return;
 
     EditorBuffer& buffer = currentBuffer();
-
-    UndoRecord redo_record;
-    for(Line* p = buffer.document_head; p != nullptr; p = p->next) {
-        redo_record.lines.push_back(p->text);
-    }
-    redo_record.cursor_line_num = buffer.current_line_num;
-    redo_record.cursor_col = buffer.cursor_col;
-    int fv_linenum = 1;
-    Line* p = buffer.document_head;
-    while (p && p != buffer.first_visible_line) {
-        p = p->next;
-        fv_linenum++;
-    }
-    redo_record.first_visible_line_num = fv_linenum;
-    buffer.redo_stack.push_back(redo_record);
-
-    UndoRecord undo_record = buffer.undo_stack.back();
+    UndoRecord undo_record = std::move(buffer.undo_stack.back());
     buffer.undo_stack.pop_back();
+    buffer.redo_stack.push_back(inverseUndoRecord(buffer, undo_record));
     RestoreStateFromRecord(buffer, undo_record);
 }
 
@@ -1035,65 +1994,104 @@ void TextEditor::HandleRedo() {
     if (currentBufferIdx() == -1 || currentBuffer().redo_stack.empty()) return;
 
     EditorBuffer& buffer = currentBuffer();
-
-    UndoRecord undo_record;
-    for(Line* p = buffer.document_head; p != nullptr; p = p->next) {
-        undo_record.lines.push_back(p->text);
-    }
-    undo_record.cursor_line_num = buffer.current_line_num;
-    undo_record.cursor_col = buffer.cursor_col;
-    int fv_linenum = 1;
-    Line* p = buffer.document_head;
-    while (p && p != buffer.first_visible_line) {
-        p = p->next;
-        fv_linenum++;
-    }
-    undo_record.first_visible_line_num = fv_linenum;
-    buffer.undo_stack.push_back(undo_record);
-
-    UndoRecord redo_record = buffer.redo_stack.back();
+    UndoRecord redo_record = std::move(buffer.redo_stack.back());
     buffer.redo_stack.pop_back();
+    buffer.undo_stack.push_back(inverseUndoRecord(buffer, redo_record));
     RestoreStateFromRecord(buffer, redo_record);
 }
 
 void TextEditor::RestoreStateFromRecord(EditorBuffer& buffer, const UndoRecord& record) {
-    Line* p = buffer.document_head;
-    while (p != nullptr) { Line* q = p; p = p->next; delete q; }
-    buffer.document_head = nullptr;
-
-    Line* current = nullptr;
-    for(const auto& line_str : record.lines) {
-        Line* new_line = new Line{line_str};
-        if (buffer.document_head == nullptr) { buffer.document_head = current = new_line; }
-        else { current->next = new_line; new_line->prev = current; current = new_line; }
-    }
-    if (buffer.document_head == nullptr) {
-        buffer.document_head = new Line();
+    // A line that survives the restore and its number, to find the cursor
+    // and view from
+    Line* anchor = nullptr;
+    int anchor_num = 1;
+
+    // The whole document or the journalled range is replaced by the recorded
+    // lines.  Existing nodes are overwritten in place (their strings keep
+    // their capacity); only the difference in line count is created or
+    // destroyed.
+    const bool whole = (record.first_line == 0);
+    int count = whole ? INT_MAX : (int)record.lines.size() + buffer.total_lines - record.total_lines;
+    Line* before = !whole && record.first_line > 1 ? lineAt(buffer, record.first_line - 1) : nullptr;
+    Line* p = before ? before->next : buffer.document_head;
+    Line* current = before;
+    std::size_t i = 0;
+    for (; i < record.lines.size() && count > 0 && p; ++i, --count) {
+        p->text = record.lines[i];
+        p->selected = false;
+        current = p;
+        p = p->next;
     }
-    buffer.total_lines = record.lines.size();
+    while (count > 0 && p) { Line* q = p; p = p->next; buffer.line_pool.destroy(q); --count; }
+    for (; i < record.lines.size(); ++i) {
+        Line* new_line = buffer.line_pool.create(record.lines[i], current);
+        if (current) current->next = new_line; else buffer.document_head = new_line;
+        current = new_line;
+    }
+    if (current) current->next = p; else buffer.document_head = p;
+    if (p) p->prev = current;
+    if (!buffer.document_head) buffer.document_head = buffer.line_pool.create();
+
+    buffer.total_lines = whole ? (int)record.lines.size() : record.total_lines;
+    if (before) { anchor = before; anchor_num = record.first_line - 1; }
+    buffer.markAllChanged();
+    ++buffer.version;
+    ++buffer.generation;
+    if (!anchor) anchor = buffer.document_head;
+
+    auto seek = [&](int num) {
+        Line* p = anchor;
+        int at = anchor_num;
+        while (at < num && p->next) { p = p->next; at++; }
+        while (at > num && p->prev) { p = p->prev; at--; }
+        return p;
+    };
 
     buffer.current_line_num = record.cursor_line_num;
     buffer.cursor_col = record.cursor_col;
-
-    buffer.current_line = buffer.document_head;
-    for (int i = 1; i < buffer.current_line_num; ++i) {
-        if (buffer.current_line && buffer.current_line->next) {
-            buffer.current_line = buffer.current_line->next;
-        }
-    }
-
-    buffer.first_visible_line = buffer.document_head;
-    for (int i = 1; i < record.first_visible_line_num; ++i) {
-        if (buffer.first_visible_line && buffer.first_visible_line->next) {
-            buffer.first_visible_line = buffer.first_visible_line->next;
-        }
-    }
+    buffer.current_line = seek(buffer.current_line_num);
+    buffer.first_visible_line = seek(record.first_visible_line_num);
 
     buffer.cursor_screen_y = m_text_area_start_y + (record.cursor_line_num - record.first_visible_line_num);
 
     update_cursor_and_scroll();
 }
 
+// Line number of buffer.first_visible_line.  Full buffers count from the
+// head; the others search outwards from the cursor line, whose number is
+// always known, so the cost is the distance between cursor and view -- at
+// most a screen, except right after a jump.
+int TextEditor::firstVisibleLineNum(const EditorBuffer& buffer) const {
+    if (BufferPolicy::walkFromHead(buffer.mode) || !buffer.current_line) {
+        int num = 1;
+        for (const Line* p = buffer.document_head; p && p != buffer.first_visible_line; p = p->next) num++;
+        return num;
+    }
+    const Line* up = buffer.current_line;
+    const Line* down = buffer.current_line;
+    for (int d = 0; up || down; ++d) {
+        if (up == buffer.first_visible_line) return buffer.current_line_num - d;
+        if (down == buffer.first_visible_line) return buffer.current_line_num + d;
+        if (up) up = up->prev;
+        if (down) down = down->next;
+    }
+    return buffer.total_lines + 1;   // not in the list: same as the walk from the head
+}
+
+// Line `num` (1-based), reached from the head or the cursor line, whichever
+// is closer.
+Line* TextEditor::lineAt(EditorBuffer& buffer, int num) {
+    Line* p = buffer.document_head;
+    int at = 1;
+    if (buffer.current_line && std::abs(buffer.current_line_num - num) < num - 1) {
+        p = buffer.current_line;
+        at = buffer.current_line_num;
+    }
+    while (p && at < num && p->next) { p = p->next; at++; }
+    while (p && at > num && p->prev) { p = p->prev; at--; }
+    return p;
+}
+
 void TextEditor::GoToDefinition() {
     if (currentBufferIdx() == -1) return;
     EditorBuffer& buffer = currentBuffer();
@@ -1116,6 +2114,13 @@ void TextEditor::GoToDefinition() {
         }
     }
 
+    // The language server answers from its warm index without blocking;
+    // libclang below parses the file on the spot
+    if (lspDocument(buffer)) {
+        lspGoToDefinition(symbol_name);
+        return;
+    }
+
     auto show_status = [&](const std::string& msg, const std::string& bold_part, char spinner_char) {
         int w = m_renderer->getWidth();
         int h = m_renderer->getHeight();
@@ -1140,25 +2145,24 @@ void TextEditor::GoToDefinition() {
     show_status("Looking for definition of", symbol_name, spinner[spinner_idx]);
 
     // 1. Gather all open buffers as "unsaved files" for libclang
+    //    Snapshots are cached per buffer version, so unchanged buffers are not
+    //    re-joined on every lookup.
     std::vector<CXUnsavedFile> unsavedFiles;
-    std::vector<std::string> bufferContents;
+    std::vector<BufferSnapshotPtr> bufferSnapshots;
     std::vector<std::string> bufferPaths; // Keep absolute paths alive
-    
+
     for (size_t i = 0; i < m_bufferManager->bufferCount(); ++i) {
         EditorBuffer& b = m_bufferManager->getBuffer(i);
-        std::string content;
-        for (Line* l = b.document_head; l != nullptr; l = l->next) {
-            content += l->text + "\n";
-        }
-        bufferContents.push_back(std::move(content));
-        bufferPaths.push_back(get_full_path(b.filename));
+        if (b.file_id == INVALID_FILE_ID) continue;   // stdin has no file name
+        bufferSnapshots.push_back(b.snapshot());
+        bufferPaths.push_back(PathRegistry::instance().path(b.file_id));
     }
 
-    for (size_t i = 0; i < m_bufferManager->bufferCount(); ++i) {
+    for (size_t i = 0; i < bufferSnapshots.size(); ++i) {
         CXUnsavedFile uf;
         uf.Filename = bufferPaths[i].c_str();
-        uf.Contents = bufferContents[i].c_str();
-        uf.Length = bufferContents[i].length();
+        uf.Contents = bufferSnapshots[i]->text().c_str();
+        uf.Length = bufferSnapshots[i]->text().length();
         unsavedFiles.push_back(uf);
     }
 
@@ -1172,7 +2176,7 @@ void TextEditor::GoToDefinition() {
     for (const auto& s : argsStr) args.push_back(s.c_str());
     
     // 3. Parse current file (use absolute path)
-    std::string absoluteCurrentFile = get_full_path(buffer.filename);
+    std::string absoluteCurrentFile = PathRegistry::instance().path(buffer.file_id);
     CXIndex index = clang_createIndex(0, 0);
     
     // Update spinner
@@ -1240,18 +2244,10 @@ void TextEditor::GoToDefinition() {
             clang_disposeString(fileNameStr);
 
             // Navigate to the definition
-            bool foundBuffer = false;
-            std::string fullDefPath = get_full_path(defFileName);
-            
-            for (size_t i = 0; i < m_bufferManager->bufferCount(); ++i) {
-                if (get_full_path(m_bufferManager->getBuffer(i).filename) == fullDefPath) {
-                    SwitchToBuffer(i);
-                    foundBuffer = true;
-                    break;
-                }
-            }
-
-            if (!foundBuffer) {
+            int def_idx = m_bufferManager->findByFileId(PathRegistry::instance().intern(defFileName));
+            if (def_idx != -1) {
+                SwitchToBuffer(def_idx);
+            } else {
                 m_bufferManager->addBuffer();
                 currentBuffer().filename = defFileName;
                 read_file(currentBuffer());
@@ -1426,7 +2422,7 @@ void TextEditor::handleSmartBlockClose(wint_t closing_char) {
                             buffer.current_line->text.insert(buffer.cursor_col - 1, wchar_to_utf8(closing_char));
                             buffer.cursor_col++;
                         }
-                        buffer.changed = true;
+                        buffer.touch(buffer.current_line);
                         return;
                     }
                 }
@@ -1441,7 +2437,7 @@ void TextEditor::handleSmartBlockClose(wint_t closing_char) {
     // No matching brace found, just insert the character normally
     buffer.current_line->text.insert(buffer.cursor_col - 1, wchar_to_utf8(closing_char));
     buffer.cursor_col++;
-    buffer.changed = true;
+    buffer.touch(buffer.current_line);
 }
 
 
@@ -1456,6 +2452,10 @@ void TextEditor::process_key(wint_t ch) {
                 case ACT_OPEN:         selectfile(); return;
                 case ACT_SAVE: if (currentBuffer().is_new_file) SaveFileBrowser(); else write_file(currentBuffer()); return;
                 case ACT_SAVE_AS: SaveFileBrowser(); return;
+                case ACT_FOLLOW: ToggleFollow(); return;
+                case ACT_FILTER: FilterLines(); return;
+                case ACT_BUFFER_MODE: CycleBufferMode(); return;
+                case ACT_SOFT_WRAP: ToggleSoftWrap(); return;
                 case ACT_EXIT: TryExit(); return;
                 case ACT_UNDO: if (currentBuffer().read_only) { msgwin("Buffer is Read-Only."); return; } HandleUndo(); return;
                 case ACT_REDO: if (currentBuffer().read_only) { msgwin("Buffer is Read-Only."); return; } HandleRedo(); return;
@@ -1466,9 +2466,15 @@ void TextEditor::process_key(wint_t ch) {
                 case ACT_REPLACE: if (currentBuffer().read_only) { msgwin("Buffer is Read-Only."); return; } ActivateReplace(); return;
                 case ACT_GOTO_LINE: GoToLineDialog(); return;
                 case ACT_GO_TO_DEFINITION: GoToDefinition(); return;
+                case ACT_RENAME_SYMBOL: RenameSymbol(); return;
+                case ACT_FIND_REFERENCES: FindReferences(); return;
+                case ACT_TIDY_PROJECT: RunTidyOnProject(); return;
+                case ACT_TIDY_FINDINGS: ShowTidyFindings(); return;
                 case ACT_COMPILE: compileOnly(); return;
                 case ACT_RUN: compileAndRun(); return;
-                case ACT_TOGGLE_OUTPUT: ShowOutputScreen(); return;
+                case ACT_BENCHMARK: BenchmarkProgram(); return;
+                case ACT_TOGGLE_OUTPUT: m_output_screen_visible = true; return;
+                case ACT_TOGGLE_TERMINAL: ToggleTerminalFocus(); return;
                 case ACT_NEXT_BUFFER: NextWindow(); return;
                 case ACT_PREV_BUFFER: PreviousWindow(); return;
                 case ACT_CLOSE_BUFFER: CloseWindow(); return;
@@ -1580,6 +2586,26 @@ void TextEditor::process_key(wint_t ch) {
     }
     if(should_delete_selection) DeleteSelection();
 
+    // Vertical movement goes by screen rows while soft-wrapping
+    if (softWrap(buffer)) {
+        int page = m_text_area_end_y - m_text_area_start_y + 1;
+        int rows = 0;
+        switch (ch) {
+        case KEY_UP: case KEY_SR: rows = -1; break;
+        case KEY_DOWN: case KEY_SF: rows = 1; break;
+        case KEY_PPAGE: case KEY_SPREVIOUS: rows = -page; break;
+        case KEY_NPAGE: case KEY_SNEXT: rows = page; break;
+        }
+        if (rows != 0) {
+            bool shifted = (ch == KEY_SR || ch == KEY_SF || ch == KEY_SPREVIOUS || ch == KEY_SNEXT);
+            if (shifted && !buffer.selecting) { buffer.selecting = true; buffer.selection_anchor_line = buffer.current_line; buffer.selection_anchor_col = buffer.cursor_col; buffer.selection_anchor_linenum = buffer.current_line_num; }
+            moveWrapped(buffer, rows);
+            if (shifted) UpdateSelection();
+            update_cursor_and_scroll();
+            return;
+        }
+    }
+
     switch(ch) {
     case KEY_F(2): if (buffer.is_new_file) { SaveFileBrowser(); } else { write_file(buffer); } break;
     case KEY_F(3): selectfile(); break;
@@ -1632,7 +2658,7 @@ void TextEditor::process_key(wint_t ch) {
 
             buffer.current_line->text.insert(cursor_idx, spaces_to_insert);
             buffer.cursor_col += m_config.indentation_width;
-            buffer.changed = true;
+            buffer.touch(buffer.current_line);
         }
         break;
     }
@@ -1645,7 +2671,7 @@ void TextEditor::process_key(wint_t ch) {
 
         std::string indent_str;
 
-        if (m_config.smart_indentation) {
+        if (m_config.smart_indentation && BufferPolicy::smartIndent(buffer.mode)) {
             const std::string& prev_line_text = buffer.current_line->text;
 
             size_t indent_end_pos = prev_line_text.find_first_not_of(" \t");
@@ -1681,23 +2707,25 @@ void TextEditor::process_key(wint_t ch) {
     }
 
     case KEY_BACKSPACE: case 127: case 8:
-        if (buffer.cursor_col > 1) { buffer.current_line->text.erase(buffer.cursor_col - 2, 1); buffer.cursor_col--; buffer.changed = true; }
+        if (buffer.cursor_col > 1) { buffer.current_line->text.erase(buffer.cursor_col - 2, 1); buffer.cursor_col--; buffer.touch(buffer.current_line); }
         else if (buffer.current_line->prev) {
             Line* to_delete = buffer.current_line; buffer.cursor_col = buffer.current_line->prev->text.length() + 1;
             buffer.current_line->prev->text += buffer.current_line->text; buffer.cursor_screen_y--; buffer.current_line = buffer.current_line->prev; buffer.current_line_num--;
             buffer.current_line->next = to_delete->next; if (to_delete->next) to_delete->next->prev = buffer.current_line;
-            delete to_delete; buffer.changed = true;
+            buffer.markChanged(to_delete);
+            buffer.line_pool.destroy(to_delete); buffer.total_lines--; buffer.touch(buffer.current_line);
         }
         break;
     case KEY_DC:
         if (buffer.selecting) {
             DeleteSelection();
         } else if (buffer.cursor_col <= (int)buffer.current_line->text.length()) {
-            buffer.current_line->text.erase(buffer.cursor_col - 1, 1); buffer.changed = true;
+            buffer.current_line->text.erase(buffer.cursor_col - 1, 1); buffer.touch(buffer.current_line);
         } else if (buffer.current_line->next) {
             Line* to_delete = buffer.current_line->next; buffer.current_line->text += to_delete->text;
             buffer.current_line->next = to_delete->next; if(to_delete->next) to_delete->next->prev = buffer.current_line;
-            delete to_delete; buffer.changed = true;
+            buffer.markChanged(to_delete);
+            buffer.line_pool.destroy(to_delete); buffer.total_lines--; buffer.touch(buffer.current_line);
         }
         break;
     case KEY_IC: buffer.insert_mode = !buffer.insert_mode; break;
@@ -1707,8 +2735,9 @@ void TextEditor::process_key(wint_t ch) {
             if (buffer.selecting) {
                 DeleteSelection();
             }
-            // Check for smart brace closing
-            if (ch == ')' || ch == ']' || ch == '}') {
+            // Check for smart brace closing; its backwards scan for the
+            // opening brace is skipped in large buffers
+            if ((ch == ')' || ch == ']' || ch == '}') && BufferPolicy::smartIndent(buffer.mode)) {
                 handleSmartBlockClose(ch);
             } else {
                 // Standard character insertion
@@ -1723,7 +2752,7 @@ void TextEditor::process_key(wint_t ch) {
                     }
                 }
                 currentBuffer().cursor_col++;
-                currentBuffer().changed = true;
+                currentBuffer().touch(currentBuffer().current_line);
             }
         }
         break;
@@ -2336,12 +3365,7 @@ void TextEditor::AddFileToProject()
         (void)target_name;
 
         // Reload the build file in the editor if it is currently open
-        if (!build_file.empty()) {
-            for (int i = 0; i < (int)m_bufferManager->bufferCount(); ++i) {
-                auto& buf = m_bufferManager->getBuffer(i);
-                if (buf.filename == build_file) { read_file(buf); break; }
-            }
-        }
+        if (!build_file.empty()) reloadOpenBuffer(build_file);
 
         // Open the new file in the editor
         m_bufferManager->addBuffer();
@@ -2438,7 +3462,8 @@ MenuAction TextEditor::CallSubMenu(const std::vector<std::string>& menuItems, in
         finalMenuItems.push_back(" ----------------- ");
         for(size_t i = 0; i < m_bufferManager->bufferCount() && i < 10; ++i) {
             std::string hotkey_num = (i < 9) ? std::to_string(i + 1) : "0";
-            std::string filename_to_display = get_filename_from_path(get_full_path(m_bufferManager->getBuffer(i).filename));
+            const EditorBuffer& listed = m_bufferManager->getBuffer(i);
+            std::string filename_to_display = get_filename_from_path(displayPath(listed));
             std::string text_part = " &" + hotkey_num + " " + filename_to_display;
             std::string hotkey_part = "Alt+" + hotkey_num;
             const int total_width = 28;
@@ -2526,7 +3551,8 @@ MenuAction TextEditor::CallSubMenu(const std::vector<std::string>& menuItems, in
                 else if (selection == 2) selectfile();
                 else if (selection == 4) { if (currentBuffer().is_new_file) SaveFileBrowser(); else write_file(currentBuffer()); }
                 else if (selection == 5) SaveFileBrowser();
-                else if (selection == 7) TryExit();
+                else if (selection == 6) ToggleFollow();
+                else if (selection == 8) TryExit();
                 else NotImplemented();
                 break;
             case 2: // Edit
@@ -2543,12 +3569,18 @@ MenuAction TextEditor::CallSubMenu(const std::vector<std::string>& menuItems, in
             case 3: // Search
                 if (selection == 1) ActivateSearch();
                 else if (selection == 4) ActivateReplace();
-                else if (selection == 6) GoToLineDialog();
+                else if (selection == 5) RenameSymbol();
+                else if (selection == 6) FindReferences();
+                else if (selection == 8) GoToLineDialog();
+                else if (selection == 9) FilterLines();
                 break;
             case 4: // Build
                 if (selection == 1) compileAndRun();
-                else if (selection == 2) compileOnly();
-                else if (selection == 3) CompileOptionsDialog();
+                else if (selection == 2) BenchmarkProgram();
+                else if (selection == 3) compileOnly();
+                else if (selection == 4) CompileOptionsDialog();
+                else if (selection == 6) RunTidyOnProject();
+                else if (selection == 7) ShowTidyFindings();
                 break;
             case 5: // Project
                 if (selection == 1) CreateNewProject();
@@ -2562,16 +3594,20 @@ MenuAction TextEditor::CallSubMenu(const std::vector<std::string>& menuItems, in
                     m_output_screen_visible = !m_output_screen_visible;
                     if (!m_output_screen_visible) handleResize();
                 }
-                else if (selection == 3) NextWindow();
-                else if (selection == 4) PreviousWindow();
-                else if (selection == 5) CloseWindow();
+                else if (selection == 2) ShowTerminal(!m_terminal_open);
+                else if (selection == 4) NextWindow();
+                else if (selection == 5) PreviousWindow();
+                else if (selection == 6) CloseWindow();
                 else if (selection > 6) {
                     int buffer_idx = selection - 7;
                     if (buffer_idx < (int)m_bufferManager->bufferCount()) SwitchToBuffer(buffer_idx);
                 }
                 break;
             case 7: // Options
-                EditorSettingsDialog(); break;
+                if (selection == 1) EditorSettingsDialog();
+                else if (selection == 2) CycleBufferMode();
+                else if (selection == 3) ToggleSoftWrap();
+                break;
             case 8: // Help
                 if (selection == 1) showHelpDialog();
                 else if (selection == 2) AboutBox();
@@ -2641,18 +3677,20 @@ void TextEditor::SwitchToBuffer(int index) {
     m_bufferManager->setCurrentBufferIndex(index);
 }
 
-void TextEditor::openFileAtLine(const std::string& abs_path, int line, int col) {
-    bool found = false;
-    for (size_t i = 0; i < m_bufferManager->bufferCount(); ++i) {
-        if (m_bufferManager->getBuffer(i).filename == abs_path) {
-            SwitchToBuffer(static_cast<int>(i));
-            found = true;
-            break;
-        }
-    }
-    if (!found) {
+// Re-reads `path` from disk if it is open in a buffer (e.g. a build file we
+// just rewrote).
+void TextEditor::reloadOpenBuffer(const std::string& path) {
+    int idx = m_bufferManager->findByFileId(PathRegistry::instance().intern(path));
+    if (idx != -1) read_file(m_bufferManager->getBuffer(idx));
+}
+
+void TextEditor::openFileAtLine(FileId file_id, int line, int col) {
+    int open_idx = m_bufferManager->findByFileId(file_id);
+    if (open_idx != -1) {
+        SwitchToBuffer(open_idx);
+    } else {
         m_bufferManager->addBuffer();
-        currentBuffer().filename = abs_path;
+        currentBuffer().filename = PathRegistry::instance().path(file_id);
         read_file(currentBuffer());
     }
     if (line > 0) {
@@ -2670,10 +3708,16 @@ void TextEditor::openFileAtLine(const std::string& abs_path, int line, int col)
 
 void TextEditor::ActivateSearch() {
     if (currentBufferIdx() == -1) return;
+    if (currentBuffer().hex_view) {
+        m_hex_prompt = HexPrompt::FIND_TEXT;
+        m_hex_prompt_text.clear();
+        return;
+    }
 
     ClearSelection();
     m_search_mode = true;
     m_search_term.clear();
+    m_incremental_search.reset();
 
     EditorBuffer& buffer = currentBuffer();
     m_search_origin.line_num = buffer.current_line_num;
@@ -2699,70 +3743,427 @@ void TextEditor::DeactivateSearch() {
         buffer.cursor_col = buffer.selection_anchor_col;
     }
 
-    m_search_mode = false;
-    m_search_term.clear();
-    ClearSelection();
-
-    update_cursor_and_scroll();
+    m_search_mode = false;
+    m_search_term.clear();
+    m_incremental_search.reset();
+    ClearSelection();
+
+    update_cursor_and_scroll();
+}
+
+void TextEditor::PerformSearch(bool next) {
+    if (m_search_term.empty() || currentBufferIdx() == -1) return;
+
+    EditorBuffer& buffer = currentBuffer();
+    SearchResult res = m_incremental_search.find(buffer, m_search_term, buffer.current_line, buffer.current_line_num, next ? buffer.cursor_col : 0);
+
+    if (res.found) {
+        buffer.current_line = res.line;
+        buffer.current_line_num = res.line_num;
+        buffer.cursor_col = res.col;
+
+        buffer.selecting = true;
+        buffer.selection_anchor_line = res.line;
+        buffer.selection_anchor_linenum = res.line_num;
+        buffer.selection_anchor_col = res.col;
+        buffer.cursor_col += m_search_term.length();
+        UpdateSelection();
+
+        update_cursor_and_scroll();
+    }
+}
+
+// Config management is now handled by ConfigManager
+
+void TextEditor::EditorSettingsDialog() {
+    std::vector<std::string> themes;
+    for (auto const& [key, val] : m_themes_data.items()) {
+        themes.push_back(key);
+    }
+    std::sort(themes.begin(), themes.end());
+    SettingsDialog::show(*m_renderer, m_config, *m_configManager, themes);
+}
+
+// Build command generation is now handled by BuildSystem
+
+namespace {
+
+// First line of the scrollback shown when following the output: the last
+// `rows` lines, or from the top while there are fewer.
+std::uint64_t runFollowTop(const Scrollback& output, int rows) {
+    const std::uint64_t end = output.end();
+    return std::max(output.first(), end > (std::uint64_t)rows ? end - rows : 0);
+}
+
+// What a terminal sends for a key.  `app_cursor` is the mode in which
+// full-screen programs ask for ESC O A rather than ESC [ A for the arrows.
+std::string terminalKeyBytes(wint_t ch, bool app_cursor) {
+    static const char* const FUNCTION_KEYS[12] = {
+        "\033OP", "\033OQ", "\033OR", "\033OS", "\033[15~", "\033[17~",
+        "\033[18~", "\033[19~", "\033[20~", "\033[21~", "\033[23~", "\033[24~"
+    };
+    const std::string cursor = app_cursor ? "\033O" : "\033[";
+    switch (ch) {
+    case KEY_ENTER: case 10: case 13: return "\r";
+    case KEY_BACKSPACE: case 127: return "\x7f";
+    case KEY_UP:    return cursor + "A";
+    case KEY_DOWN:  return cursor + "B";
+    case KEY_RIGHT: return cursor + "C";
+    case KEY_LEFT:  return cursor + "D";
+    case KEY_HOME:  return cursor + "H";
+    case KEY_END:   return cursor + "F";
+    case KEY_IC:    return "\033[2~";
+    case KEY_DC:    return "\033[3~";
+    case KEY_PPAGE: return "\033[5~";
+    case KEY_NPAGE: return "\033[6~";
+    case KEY_BTAB:  return "\033[Z";
+    default:
+        if (ch >= (wint_t)KEY_F(1) && ch <= (wint_t)KEY_F(12)) return FUNCTION_KEYS[ch - KEY_F(1)];
+        if (ch < KEY_MIN) return wchar_to_utf8(ch);   // Ctrl+C and Ctrl+D included
+        return {};
+    }
+}
+
+std::string runSeconds(std::chrono::steady_clock::duration d) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.1fs", std::chrono::duration<double>(d).count());
+    return buf;
+}
+
+} // namespace
+
+// Runs the program Run built on a pseudo-terminal the size of the output
+// screen and shows that screen.  A program still running from the previous
+// Run is killed.
+void TextEditor::startProgram(const std::string& exe) {
+    m_run.reset();
+    m_run_output.clear();
+    m_run_reported = false;
+    m_run_top.reset();
+    m_run_find_prompt = false;
+    m_run_name = get_filename_from_path(exe);
+
+    // Escape sequences are not interpreted, so ask for plain output
+    const std::string path = exe[0] == '/' ? exe : "./" + exe;
+    auto run = std::make_unique<PtyProcess>();
+    if (!run->start({path}, "", std::max(m_renderer->getHeight() - 1, 1), m_renderer->getWidth(), {"TERM=dumb"})) {
+        msgwin("Could not start " + path + ".");
+        return;
+    }
+    m_run = std::move(run);
+    m_output_screen_visible = true;
+}
+
+// Called once per main loop iteration: moves what the program wrote since
+// the last one into the scrollback, a bounded amount at a time so a program
+// printing in a tight loop cannot stall the editor.
+void TextEditor::syncProgram() {
+    if (!m_run || m_run_reported) return;
+    std::string out;
+    m_run->read(out, RUN_POLL_BYTES);
+    m_run_output.append(out);
+    if (m_run->finished()) {
+        const std::string& last = m_run_output.line(m_run_output.end() - 1);
+        m_run_output.append((last.empty() ? "" : "\n") + std::string("[Process ") + m_run->exitDescription() +
+                            " after " + runSeconds(m_run->elapsed()) + "]\n");
+        m_run_reported = true;
+    }
+}
+
+// One main loop iteration while the output screen is shown: the program's
+// scrollback above a status line, then at most one key.
+void TextEditor::outputScreenFrame() {
+    const int w = m_renderer->getWidth(), h = m_renderer->getHeight();
+    const int rows = std::max(h - 1, 1);
+    const std::uint64_t follow = runFollowTop(m_run_output, rows);
+    // Lines the ring dropped take a scrolled-back view down with them
+    if (m_run_top) m_run_top = std::clamp(*m_run_top, m_run_output.first(), follow);
+    const std::uint64_t top = m_run_top.value_or(follow);
+
+    std::optional<LineMatcher> matcher;
+    if (!m_run_find_term.empty()) matcher.emplace(m_run_find_term, false);
+    m_renderer->clear();
+    for (int row = 0; row < rows && top + row < m_run_output.end(); ++row) {
+        const std::string text = m_run_output.line(top + row).substr(0, w);
+        m_renderer->drawText(0, row, text, Renderer::CP_DEFAULT_TEXT);
+        if (!matcher) continue;
+        for (auto [pos, len] = matcher->find(text); pos != std::string::npos && len > 0;
+             std::tie(pos, len) = matcher->find(text, pos + len)) {
+            m_renderer->drawText((int)pos, row, text.substr(pos, len), Renderer::CP_SEARCH_MATCH);
+        }
+    }
+
+    const bool running = m_run && !m_run_reported;
+    std::string status;
+    if (m_run_find_prompt) {
+        status = " Find: " + m_run_find_term;
+    } else {
+        status = " " + (m_run ? m_run_name + ": " + (running ? "running " + runSeconds(m_run->elapsed())
+                                                             : m_run->exitDescription())
+                              : std::string("No program has been run"));
+        status += running ? " | PgUp/PgDn Scroll  Ctrl+F Find  Ctrl+K Kill  Esc Editor "
+                          : " | PgUp/PgDn Scroll  Ctrl+F Find  Any other key: Editor ";
+    }
+    status.resize(std::max(w, 0), ' ');
+    m_renderer->drawText(0, h - 1, status, Renderer::CP_STATUS_BAR);
+
+    if (m_run_find_prompt) {
+        m_renderer->showCursor();
+        m_renderer->setCursor(std::min((int)(strlen(" Find: ") + m_run_find_term.length()), w - 1), h - 1);
+    } else if (running && !m_run_top) {
+        const std::uint64_t last = m_run_output.end() - 1;
+        m_renderer->showCursor();
+        m_renderer->setCursor(std::min((int)m_run_output.line(last).size(), w - 1), (int)(last - top));
+    } else {
+        m_renderer->hideCursor();
+    }
+    m_renderer->refresh();
+
+    wint_t ch = m_renderer->getChar();
+    if (ch == KEY_RESIZE) {
+        handleResize();
+        if (m_run) m_run->resize(std::max(m_renderer->getHeight() - 1, 1), m_renderer->getWidth());
+    } else if (ch != ERR) {
+        TaskScheduler::instance().noteUserActivity();
+        handleOutputScreenKey(ch);
+    } else {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+void TextEditor::handleOutputScreenKey(wint_t ch) {
+    const int rows = std::max(m_renderer->getHeight() - 1, 1);
+    const std::uint64_t follow = runFollowTop(m_run_output, rows);
+    const std::uint64_t top = m_run_top.value_or(follow);
+    const bool running = m_run && !m_run_reported;
+
+    if (m_run_find_prompt) {
+        switch (ch) {
+        case 27:
+            m_run_find_prompt = false;
+            m_run_find_term.clear();
+            break;
+        case KEY_ENTER: case 10: case 13:
+            findInRunOutput();
+            break;
+        case KEY_BACKSPACE: case 127: case 8:
+            if (!m_run_find_term.empty()) m_run_find_term.pop_back();
+            break;
+        default:
+            if (ch > 31 && ch < KEY_MIN) m_run_find_term += wchar_to_utf8(ch);
+            break;
+        }
+        return;
+    }
+
+    switch (ch) {
+    case KEY_PPAGE:
+        m_run_top = top > m_run_output.first() + rows ? top - rows : m_run_output.first();
+        return;
+    case KEY_NPAGE:
+        if (top + rows >= follow) m_run_top.reset();
+        else m_run_top = top + rows;
+        return;
+    case KEY_CTRL_F:
+        m_run_find_prompt = true;
+        m_run_find_term.clear();
+        m_run_find_line = top + rows;   // search upwards from the bottom of the view
+        return;
+    case 11: // Ctrl+K
+        if (running) m_run->terminate();
+        return;
+    }
+    if (ch == 27 || ch == KEY_F(5) || m_keyBindings->getAction(ch) == ACT_TOGGLE_OUTPUT || !running) {
+        m_output_screen_visible = false;
+        m_renderer->showCursor();
+        handleResize();
+        return;
+    }
+
+    // Keys go to the program as a terminal would send them
+    const std::string bytes = terminalKeyBytes(ch, false);
+    if (!bytes.empty()) {
+        m_run->write(bytes);
+        m_run_top.reset();
+    }
 }
 
-void TextEditor::PerformSearch(bool next) {
-    if (m_search_term.empty() || currentBufferIdx() == -1) return;
-
-    EditorBuffer& buffer = currentBuffer();
-    SearchResult res = SearchEngine::search(buffer, m_search_term, buffer.current_line, buffer.current_line_num, next ? buffer.cursor_col : 0, true);
-
-    if (res.found) {
-        buffer.current_line = res.line;
-        buffer.current_line_num = res.line_num;
-        buffer.cursor_col = res.col;
-
-        buffer.selecting = true;
-        buffer.selection_anchor_line = res.line;
-        buffer.selection_anchor_linenum = res.line_num;
-        buffer.selection_anchor_col = res.col;
-        buffer.cursor_col += m_search_term.length();
-        UpdateSelection();
-
-        update_cursor_and_scroll();
+// Steps to the previous line of the program's output containing the find
+// term and scrolls it to the middle of the screen.
+void TextEditor::findInRunOutput() {
+    if (m_run_find_term.empty()) return;
+    const int rows = std::max(m_renderer->getHeight() - 1, 1);
+    const LineMatcher matcher(m_run_find_term, false);
+    std::uint64_t line = std::min(m_run_find_line, m_run_output.end());
+    while (line > m_run_output.first()) {
+        --line;
+        if (!matcher.matches(m_run_output.line(line))) continue;
+        m_run_find_line = line;
+        const std::uint64_t top = line > m_run_output.first() + rows / 2 ? line - rows / 2 : m_run_output.first();
+        m_run_top = std::min(top, runFollowTop(m_run_output, rows));
+        return;
     }
+    beep();
 }
 
-// Config management is now handled by ConfigManager
-
-void TextEditor::EditorSettingsDialog() {
-    std::vector<std::string> themes;
-    for (auto const& [key, val] : m_themes_data.items()) {
-        themes.push_back(key);
+namespace {
+
+// Draws terminal cells, one drawText() per run of cells in the same colours
+void drawTerminalCells(Renderer& renderer, int x, int y, const TermCell* cells, int count) {
+    std::string run;
+    for (int i = 0; i < count; ) {
+        const TermCell& style = cells[i];
+        int j = i;
+        run.clear();
+        for (; j < count && cells[j].sameStyle(style); ++j) {
+            if (cells[j].ch != 0) run += wchar_to_utf8(static_cast<wchar_t>(cells[j].ch));
+        }
+        const int fg = style.fg == TermCell::DEFAULT_COLOR ? -1 : style.fg;
+        const int bg = style.bg == TermCell::DEFAULT_COLOR ? -1 : style.bg;
+        const int flags = (style.attr & TermCell::BOLD ? A_BOLD : 0) |
+                          (style.attr & TermCell::UNDERLINE ? A_UNDERLINE : 0) |
+                          (style.attr & TermCell::REVERSE ? A_REVERSE : 0);
+        renderer.drawText(x + i, y, run, renderer.terminalPair(fg, bg), flags);
+        i = j;
     }
-    std::sort(themes.begin(), themes.end());
-    SettingsDialog::show(*m_renderer, m_config, *m_configManager, themes);
 }
 
-// Build command generation is now handled by BuildSystem
-
-void TextEditor::ShowOutputScreen() {
-    def_prog_mode();
-    endwin();
+} // namespace
 
-    std::cout << "\033[2J\033[H" << m_output_content << std::flush;
+// Alt+T: opens the terminal pane, or moves the keyboard between it and the
+// editor.
+void TextEditor::ToggleTerminalFocus() {
+    if (!m_terminal_open) {
+        ShowTerminal(true);
+        return;
+    }
+    m_terminal_focused = !m_terminal_focused;
+    m_renderer->showCursor();
+}
 
-    struct termios old_tio, new_tio;
-    tcgetattr(STDIN_FILENO, &old_tio);
-    new_tio = old_tio;
-    new_tio.c_lflag &= ~(ICANON | ECHO);
-    tcsetattr(STDIN_FILENO, TCSANOW, &new_tio);
+// Shows or hides the terminal pane, starting a shell the first time.  A
+// hidden shell keeps running; when it exits, the pane closes.
+void TextEditor::ShowTerminal(bool show) {
+    if (show == m_terminal_open) return;
+    m_terminal_open = show;
+    m_terminal_focused = show;
+    m_terminal_scroll = 0;
+    m_renderer->showCursor();
+    handleResize();
+    if (!show || m_shell) return;
+
+    const int rows = terminalPaneHeight() - 2, cols = m_renderer->getWidth() - 2;
+    const char* shell = std::getenv("SHELL");
+    const std::string dir = m_project.name.empty() ? std::filesystem::current_path().string() : m_project.root;
+    auto pty = std::make_unique<PtyProcess>();
+    if (!pty->start({shell && *shell ? shell : "/bin/sh"}, dir, rows, cols, {"TERM=xterm-256color"})) {
+        msgwin("Could not start a shell.");
+        ShowTerminal(false);
+        return;
+    }
+    m_shell = std::move(pty);
+    m_terminal = std::make_unique<Terminal>(rows, cols);
+}
 
-    getchar();
+int TextEditor::terminalPaneHeight() const {
+    return m_terminal_open ? std::max(5, m_renderer->getHeight() / 3) : 0;
+}
 
-    tcsetattr(STDIN_FILENO, TCSANOW, &old_tio);
+// Called once per main loop iteration.  Parsing is bounded by
+// TERMINAL_POLL_BYTES: output beyond that stays in the pseudo-terminal, which
+// in time makes the writer wait, and the screen is drawn once per iteration
+// however many lines went by.
+void TextEditor::syncTerminal() {
+    if (!m_shell) return;
+    std::string out;
+    if (m_shell->read(out, TERMINAL_POLL_BYTES) > 0) {
+        const std::size_t kept = m_terminal->history().size();
+        m_terminal->feed(out);
+        // A view scrolled back stays on the same lines
+        if (m_terminal_scroll > 0)
+            m_terminal_scroll = (int)std::min(m_terminal_scroll + m_terminal->history().size() - kept, m_terminal->history().size());
+        const std::string replies = m_terminal->takeReplies();
+        if (!replies.empty()) m_shell->write(replies);
+    }
+    if (m_shell->finished()) {
+        m_shell.reset();
+        m_terminal.reset();
+        m_terminal_open = false;
+        m_terminal_focused = false;
+        m_renderer->showCursor();
+        handleResize();
+    }
+}
 
-    reset_prog_mode();
-    refresh();
+void TextEditor::drawTerminalPane() {
+    const int w = m_renderer->getWidth();
+    const int pane_y = m_text_area_end_y + 3;
+    const int pane_h = terminalPaneHeight();
+
+    // The title comes from the shell; '&' would mark a hotkey
+    std::string title = m_terminal->title().empty() ? "Terminal" : "Terminal: " + m_terminal->title();
+    title.erase(std::remove(title.begin(), title.end(), '&'), title.end());
+    if ((int)title.size() > w - 6) title.resize(std::max(w - 6, 0));
+    if (m_terminal_scroll > 0) title += " [-" + std::to_string(m_terminal_scroll) + "]";
+    m_renderer->drawBoxWithTitle(0, pane_y, w, pane_h, Renderer::CP_DIALOG_TITLE, Renderer::BoxStyle::DOUBLE,
+                                 title, Renderer::CP_DIALOG_TITLE, m_terminal_focused ? A_BOLD : A_NORMAL);
+
+    // Lines scrolled back come from the history, the rest from the screen
+    const Terminal& term = *m_terminal;
+    const int kept = (int)term.history().size();
+    const int first = kept - std::min(m_terminal_scroll, kept);
+    std::vector<TermCell> line;
+    for (int row = 0; row < term.rows() && row < pane_h - 2; ++row) {
+        const int index = first + row;
+        if (index < kept) {
+            term.history().line(index, line);
+            drawTerminalCells(*m_renderer, 1, pane_y + 1 + row, line.data(), std::min((int)line.size(), w - 2));
+        } else {
+            drawTerminalCells(*m_renderer, 1, pane_y + 1 + row, term.row(index - kept), std::min(term.cols(), w - 2));
+        }
+    }
+}
 
-    m_output_screen_visible = false;
+void TextEditor::handleTerminalKey(wint_t ch) {
+    if (m_keyBindings->getAction(ch) == ACT_TOGGLE_TERMINAL) {
+        ToggleTerminalFocus();
+        return;
+    }
+    if (ch == 27) {
+        // Alt+key arrives as ESC and the key; Alt+T goes back to the editor
+        nodelay(stdscr, FALSE);
+        timeout(50);
+        wint_t next_ch = m_renderer->getChar();
+        timeout(-1);
+        nodelay(stdscr, TRUE);
+        if (next_ch == ERR) {
+            m_shell->write("\033");
+            return;
+        }
+        const wint_t lookup_key = (next_ch >= 'a' && next_ch <= 'z') ? toupper(next_ch) : next_ch;
+        if (m_keyBindings->getAction(KEY_ALT(lookup_key)) == ACT_TOGGLE_TERMINAL) {
+            ToggleTerminalFocus();
+            return;
+        }
+        m_shell->write("\033" + terminalKeyBytes(next_ch, m_terminal->appCursorKeys()));
+        m_terminal_scroll = 0;
+        return;
+    }
 
-    handleResize();
+    const int page = std::max(1, m_terminal->rows() / 2);
+    switch (ch) {
+    case KEY_SPREVIOUS:
+        m_terminal_scroll = std::min(m_terminal_scroll + page, (int)m_terminal->history().size());
+        return;
+    case KEY_SNEXT:
+        m_terminal_scroll = std::max(0, m_terminal_scroll - page);
+        return;
+    }
+    const std::string bytes = terminalKeyBytes(ch, m_terminal->appCursorKeys());
+    if (!bytes.empty()) {
+        m_shell->write(bytes);
+        m_terminal_scroll = 0;
+    }
 }
 
 void TextEditor::showScrollableOutputDialog(const std::vector<std::string>& lines) {
@@ -2811,6 +4212,8 @@ CompilationResult TextEditor::runCompilationProcess() {
 
     std::vector<std::string> dummy;
     m_compile_output_lines = m_buildSystem->parseCompilerOutput(full_output, dummy, base_dir);
+    m_compile_output_list = OutputList::Build;
+    ++m_diag_generation;
 
     // Position cursor on the first error (or warning)
     m_compile_output_cursor_pos = 0;
@@ -2825,8 +4228,9 @@ CompilationResult TextEditor::runCompilationProcess() {
     return result;
 }
 
-// --- Modified to show an immediate "Compiling..." message ---
-void TextEditor::compileAndRun() {
+// Compiles with an immediate "Compiling..." message and returns the
+// executable, or "" (with the output list shown) if there is none to run.
+std::string TextEditor::compileForRun() {
     // 1. Immediately show a temporary "Compiling..." dialog
     int h = 5, w = 40;
     int starty = (m_renderer->getHeight() - h) / 2;
@@ -2851,36 +4255,19 @@ void TextEditor::compileAndRun() {
     // 5. Proceed based on the result
     if (result.success) {
         const std::string& exe = result.executable_name;
-        if (exe.empty() || !std::filesystem::exists(exe)) {
-            msgwin("Build succeeded.\nExecutable not found at:\n" +
-                   (exe.empty() ? "(unknown)" : exe) +
-                   "\n\nRun the program manually from a terminal.");
-            m_compile_output_visible = true;
-            m_renderer->hideCursor();
-            return;
-        }
-
-        def_prog_mode();
-        endwin();
-
-        std::string temp_output_file = "tedit_run_output.tmp";
-        std::string run_cmd = (exe[0] == '/') ? "\"" + exe + "\"" : ("./" + exe);
-        run_cmd += " > " + temp_output_file + " 2>&1";
-        system(run_cmd.c_str());
-
-        std::ifstream run_output_stream(temp_output_file);
-        m_output_content = std::string((std::istreambuf_iterator<char>(run_output_stream)), std::istreambuf_iterator<char>());
-        run_output_stream.close();
-        remove(temp_output_file.c_str());
-        m_output_content += "\n\n--- Press any key to return to the editor. ---";
-
-        reset_prog_mode();
-        refresh();
-        m_output_screen_visible = true;
-    } else {
-        m_compile_output_visible = true;
-        m_renderer->hideCursor();
+        if (!exe.empty() && std::filesystem::exists(exe)) return exe;
+        msgwin("Build succeeded.\nExecutable not found at:\n" +
+               (exe.empty() ? "(unknown)" : exe) +
+               "\n\nRun the program manually from a terminal.");
     }
+    m_compile_output_visible = true;
+    m_renderer->hideCursor();
+    return "";
+}
+
+void TextEditor::compileAndRun() {
+    std::string exe = compileForRun();
+    if (!exe.empty()) startProgram(exe);
 }
 
 void TextEditor::compileOnly() {
@@ -2907,6 +4294,473 @@ void TextEditor::compileOnly() {
 }
 
 
+// Compiles, then runs the program a number of times in the background and
+// reports its timings against the previous benchmark with the same label.
+// A Google Benchmark program runs once and does its own timing.
+void TextEditor::BenchmarkProgram() {
+    if (m_bench->running() || m_gbench) {
+        if (msgwin_yesno("A benchmark is running.", "Stop it?") == 1) {
+            m_bench->cancel();
+            m_gbench.reset();
+        }
+        return;
+    }
+    if (currentBufferIdx() == -1 && m_project.name.empty()) {
+        msgwin("No file to compile.");
+        return;
+    }
+
+    const CompilerSettings& cs = m_project.name.empty() ? currentBuffer().compiler_settings
+                                                        : m_project.compiler_settings;
+    std::string history_dir = m_project.root;
+    if (m_project.name.empty()) {
+        const std::string& file = currentBuffer().filename;
+        auto sep = file.rfind('/');
+        history_dir = sep == std::string::npos ? "" : file.substr(0, sep);
+    }
+    if (m_bench_label.empty())
+        m_bench_label = m_project.name.empty() ? get_filename_from_path(currentBuffer().filename) : m_project.name;
+
+    DialogResult r = BenchmarkDialog::show(*m_renderer, m_bench_runs, m_bench_warmup, m_bench_args, m_bench_label);
+    if (r.cancelled()) return;
+    m_bench_runs = r.as_int("runs").value_or(m_bench_runs);
+    m_bench_warmup = r.as_int("warmup").value_or(m_bench_warmup);
+    m_bench_args = r["args"];
+    if (!r["label"].empty()) m_bench_label = r["label"];
+    std::vector<std::string> args;
+    std::stringstream ss(m_bench_args);
+    for (std::string arg; ss >> arg; ) args.push_back(arg);
+
+    std::string flags = "-std=" + (cs.cpp_standard.empty() ? "c++17" : cs.cpp_standard) + " " +
+                        BuildSystem::settingsToFlags(cs);
+    while (!flags.empty() && flags.back() == ' ') flags.pop_back();
+
+    std::string exe = compileForRun();
+    if (exe.empty()) return;
+    exe = exe[0] == '/' ? exe : "./" + exe;
+    if (GoogleBenchmark::hasBenchmarkFlag(args) || GoogleBenchmark::detect(exe)) {
+        startGoogleBenchmark(exe, args, flags, history_dir);
+        return;
+    }
+
+    BenchmarkRunner::Options options;
+    options.exe = exe;
+    options.args = std::move(args);
+    options.label = m_bench_label;
+    options.flags = flags;
+    options.runs = m_bench_runs;
+    options.warmup = m_bench_warmup;
+    const std::string history = BenchmarkRunner::historyPath(history_dir);
+    m_bench->onFinished([this, history](BenchmarkRunner::Summary summary) {
+        adoptBenchmark(std::move(summary), history);
+    });
+    m_bench->start(std::move(options));
+}
+
+// Google Benchmark binaries measure themselves: the program runs once, on a
+// pseudo-terminal so that its JSON report arrives as each benchmark
+// finishes, and syncGoogleBenchmark() follows it.
+void TextEditor::startGoogleBenchmark(const std::string& exe, std::vector<std::string> args,
+                                      const std::string& flags, const std::string& dir) {
+    args.erase(std::remove_if(args.begin(), args.end(),
+                              [](const std::string& a) { return a.rfind("--benchmark_format", 0) == 0; }),
+               args.end());
+    args.insert(args.begin(), {exe, "--benchmark_format=json"});
+    auto run = std::make_unique<PtyProcess>();
+    if (!run->start(args, "", 24, 200, {"TERM=dumb"})) {
+        msgwin("Could not start " + exe + ".");
+        return;
+    }
+    m_gbench = std::move(run);
+    m_gbench_output.clear();
+    m_gbench_progress.reset();
+    m_gbench_flags = flags;
+    m_gbench_baseline = GoogleBenchmark::baselinePath(dir);
+}
+
+// Called once per main loop iteration while a Google Benchmark program
+// runs.  When it ends, its report is compared with the baseline of the
+// label; the first report of a label becomes its baseline.
+void TextEditor::syncGoogleBenchmark() {
+    if (!m_gbench) return;
+    m_gbench->read(m_gbench_output, RUN_POLL_BYTES);
+    m_gbench_progress.scan(m_gbench_output);
+    if (!m_gbench->finished()) return;
+
+    std::unique_ptr<PtyProcess> run = std::move(m_gbench);
+    std::string error;
+    std::optional<GoogleBenchmark::Report> report = GoogleBenchmark::parse(m_gbench_output, error);
+    if (!report) {
+        std::vector<std::string> lines = {"Google Benchmark '" + m_bench_label + "': the program " +
+                                          run->exitDescription() + ".", error, ""};
+        std::stringstream ss(m_gbench_output);
+        for (std::string line; std::getline(ss, line); ) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            lines.push_back(line);
+        }
+        BuildOutputDialog::show(*m_renderer, lines);
+        return;
+    }
+
+    std::string when;
+    std::optional<GoogleBenchmark::Report> base = GoogleBenchmark::baseline(m_gbench_baseline, m_bench_label, &when);
+    std::vector<GoogleBenchmark::Comparison> rows =
+        GoogleBenchmark::compare(*report, base ? &*base : nullptr, m_config.benchmark_regression_pct);
+    bool save = GoogleBenchmarkDialog::show(*m_renderer, m_bench_label, *report, std::move(rows),
+                                            base ? "Against the baseline of " + when : "",
+                                            m_config.benchmark_regression_pct);
+    if ((save || !base) && !GoogleBenchmark::saveBaseline(m_gbench_baseline, m_bench_label, *report, m_gbench_flags))
+        msgwin("Could not write " + m_gbench_baseline + ".");
+}
+
+void TextEditor::adoptBenchmark(BenchmarkRunner::Summary summary, const std::string& history) {
+    if (!summary.error.empty()) {
+        msgwin("Benchmark '" + summary.label + "' stopped:\n" + summary.error);
+        return;
+    }
+    std::vector<std::string> lines = BenchmarkRunner::report(summary, BenchmarkRunner::previous(history, summary.label));
+    if (!BenchmarkRunner::record(history, summary)) lines.push_back("  (could not write " + history + ")");
+    BuildOutputDialog::show(*m_renderer, lines);
+}
+
+
+// Directory of the project's compile_commands.json, empty if it has none.
+std::string TextEditor::compileCommandsDir() const {
+    if (m_project.name.empty()) return "";
+    for (const std::string& dir : {m_project.root + "/build", m_project.root}) {
+        if (std::filesystem::exists(dir + "/compile_commands.json")) return dir;
+    }
+    return "";
+}
+
+// clang-tidy arguments after the file name: the project's compilation
+// database if it has one, else the flags a compile of the file would use.
+std::vector<std::string> TextEditor::tidyArgs(const std::string& path) {
+    if (!m_project.name.empty()) {
+        if (std::string dir = compileCommandsDir(); !dir.empty()) return {"-p", dir};
+        const CompilerSettings& cs = m_project.compiler_settings;
+        std::vector<std::string> args = {"--", "-std=" + (cs.cpp_standard.empty() ? "c++17" : cs.cpp_standard),
+                                         "-I" + m_project.root, "-I" + m_project.root + "/include"};
+        std::stringstream ss(cs.optional_flags);
+        for (std::string flag; ss >> flag; ) {
+            if (flag.rfind("-I", 0) == 0 || flag.rfind("-D", 0) == 0) args.push_back(flag);
+        }
+        return args;
+    }
+    int idx = m_bufferManager->findByFileId(PathRegistry::instance().intern(path));
+    std::vector<std::string> args = {"--"};
+    if (idx >= 0) {
+        std::vector<std::string> flags = m_buildSystem->getClangArguments(m_bufferManager->getBuffer(idx));
+        args.insert(args.end(), flags.begin(), flags.end());
+    }
+    return args;
+}
+
+static bool isCxxFile(const std::string& path, bool headers) {
+    static const std::vector<std::string> sources = {".c", ".cc", ".cpp", ".cxx", ".c++"};
+    static const std::vector<std::string> hdrs = {".h", ".hh", ".hpp", ".hxx"};
+    for (const auto& ext : sources) if (ends_with(path, ext)) return true;
+    if (headers) for (const auto& ext : hdrs) if (ends_with(path, ext)) return true;
+    return false;
+}
+
+// Queues `path` for clang-tidy; the findings arrive in adoptTidyResult().
+void TextEditor::RunTidy(const std::string& path) {
+    if (!isCxxFile(path, true)) return;
+    m_tidy_error.clear();
+    m_tidy->run(path, tidyArgs(path), m_config.tidy_checks);
+}
+
+// Every source file of the project (or every open C/C++ buffer without one).
+// Files unchanged since their last analysis come straight from the cache.
+void TextEditor::RunTidyOnProject() {
+    std::vector<std::string> paths;
+    if (!m_project.name.empty()) {
+        paths = ProjectReplace::projectFiles(m_project);
+    } else {
+        for (size_t i = 0; i < m_bufferManager->bufferCount(); ++i) {
+            const EditorBuffer& b = m_bufferManager->getBuffer(i);
+            if (b.file_id != INVALID_FILE_ID) paths.push_back(PathRegistry::instance().path(b.file_id));
+        }
+    }
+    m_tidy_error.clear();
+    for (const std::string& path : paths) {
+        if (isCxxFile(path, false)) m_tidy->run(path, tidyArgs(path), m_config.tidy_checks);
+    }
+}
+
+void TextEditor::adoptTidyResult(TidyRunner::Result result) {
+    if (result.failed) {
+        m_tidy_error = result.output;
+        return;
+    }
+    std::string base_dir = result.path.substr(0, result.path.rfind('/'));
+    std::vector<std::string> dummy;
+    std::vector<CompileMessage> messages = m_buildSystem->parseCompilerOutput(result.output, dummy, base_dir);
+    bool any = std::any_of(messages.begin(), messages.end(),
+                           [](const CompileMessage& m) { return m.type != CompileMessage::CMSG_NONE; });
+    if (any) m_tidy_findings[result.file_id] = std::move(messages);
+    else m_tidy_findings.erase(result.file_id);
+    ++m_diag_generation;
+    if (m_compile_output_visible && m_compile_output_list == OutputList::Tidy) ShowTidyFindings();
+}
+
+// Puts the findings of every analysed file into the compiler output list,
+// where Enter jumps to them like to build errors.
+void TextEditor::ShowTidyFindings() {
+    if (!m_compile_output_visible && currentBufferIdx() != -1) {
+        m_pre_compile_view_state.line_num = currentBuffer().current_line_num;
+        m_pre_compile_view_state.col      = currentBuffer().cursor_col;
+        m_pre_compile_view_state.first_visible_line_num = 0;
+    }
+    m_compile_output_lines.clear();
+    CompileMessage header;
+    header.full_text = "=== clang-tidy: " + formatCount(m_tidy_findings.size()) + " file(s) with findings ===";
+    m_compile_output_lines.push_back(header);
+    for (const auto& [file, messages] : m_tidy_findings) {
+        m_compile_output_lines.insert(m_compile_output_lines.end(), messages.begin(), messages.end());
+    }
+    if (m_tidy_findings.empty()) {
+        CompileMessage none;
+        none.full_text = m_tidy->pending() > 0 ? "Analysis still running..." : "No findings.";
+        m_compile_output_lines.push_back(none);
+    }
+    m_compile_output_cursor_pos = std::min<int>(m_compile_output_cursor_pos, m_compile_output_lines.size() - 1);
+    if (m_compile_output_list != OutputList::Tidy) {
+        m_compile_output_cursor_pos = 0;
+        m_compile_output_scroll_pos = 0;
+    }
+    m_compile_output_list = OutputList::Tidy;
+    m_compile_output_visible = true;
+    m_renderer->hideCursor();
+}
+
+void TextEditor::forEachDiagnostic(FileId file, const std::function<void(const CompileMessage&)>& fn) const {
+    if (file == INVALID_FILE_ID) return;
+    auto visit = [&](const std::vector<CompileMessage>& messages) {
+        for (const CompileMessage& msg : messages) {
+            if (msg.file_id == file && msg.line >= 1 && msg.type != CompileMessage::CMSG_NONE) fn(msg);
+        }
+    };
+    if (m_compile_output_list == OutputList::Build) visit(m_compile_output_lines);
+    for (const auto& [analysed, messages] : m_tidy_findings) visit(messages);
+    auto it = m_lsp_diagnostics.find(file);
+    if (it != m_lsp_diagnostics.end()) visit(it->second);
+}
+
+// Colour pair of the gutter marker for `line_num`, 0 for none.  The marks
+// of the file on screen are collected once per change of the diagnostics.
+int TextEditor::gutterMark(FileId file, int line_num) {
+    if (m_gutter_marks.file != file || m_gutter_marks.generation != m_diag_generation) {
+        m_gutter_marks.file = file;
+        m_gutter_marks.generation = m_diag_generation;
+        m_gutter_marks.lines.clear();
+        forEachDiagnostic(file, [&](const CompileMessage& msg) {
+            if (msg.type == CompileMessage::CMSG_NOTE) return;
+            auto& type = m_gutter_marks.lines[msg.line];
+            if (type != CompileMessage::CMSG_ERROR) type = msg.type;
+        });
+    }
+    auto it = m_gutter_marks.lines.find(line_num);
+    if (it == m_gutter_marks.lines.end()) return 0;
+    return it->second == CompileMessage::CMSG_ERROR ? Renderer::CP_COMPILE_ERROR : Renderer::CP_COMPILE_WARNING;
+}
+
+// Buffers the language server is told about: C/C++ files in Full mode
+// that have finished loading.
+static bool lspEligible(const EditorBuffer& buffer) {
+    return buffer.file_id != INVALID_FILE_ID && !buffer.hex_view && buffer.load_id == 0 &&
+           BufferPolicy::languageServer(buffer.mode) &&
+           isCxxFile(PathRegistry::instance().path(buffer.file_id), true);
+}
+
+// Called once per main loop iteration: starts the server for the first
+// C/C++ buffer, hands it the edits made since the last iteration, tells it
+// about closed buffers and runs the handlers of whatever it sent.
+void TextEditor::syncLanguageServer() {
+    if (!m_config.lsp_enabled) return;
+    if (!m_lsp_started) {
+        for (size_t i = 0; i < m_bufferManager->bufferCount(); ++i) {
+            EditorBuffer& b = m_bufferManager->getBuffer(i);
+            if (lspEligible(b)) { startLanguageServer(b); break; }
+        }
+        return;
+    }
+    if (!m_lsp->running()) return;
+
+    for (FileId file : m_lsp->openDocuments()) {
+        int idx = m_bufferManager->findByFileId(file);
+        if (idx == -1 || !lspEligible(m_bufferManager->getBuffer(idx))) m_lsp->close(file);
+    }
+    for (size_t i = 0; i < m_bufferManager->bufferCount(); ++i) {
+        EditorBuffer& b = m_bufferManager->getBuffer(i);
+        if (!lspEligible(b)) continue;
+        if (m_lsp->isOpen(b.file_id)) { m_lsp->change(b.snapshot()); continue; }
+
+        const std::string path = PathRegistry::instance().path(b.file_id);
+        const bool is_c = ends_with(path, ".c");
+        if (compileCommandsDir().empty()) {
+            // No compilation database: give clangd the flags the libclang
+            // features use (a clangd extension, ignored by other servers)
+            LspClient::json command = LspClient::json::array({is_c ? "clang" : "clang++"});
+            for (const std::string& arg : m_buildSystem->getClangArguments(b)) command.push_back(arg);
+            command.push_back(path);
+            m_lsp->notify("workspace/didChangeConfiguration", {{"settings", {{"compilationDatabaseChanges", {
+                {path, {{"workingDirectory", path.substr(0, path.rfind('/'))}, {"compilationCommand", command}}}}}}}});
+        }
+        m_lsp->open(b.snapshot(), is_c ? "c" : "cpp");
+    }
+    m_lsp->pump(LSP_POLL_BYTES);
+}
+
+void TextEditor::startLanguageServer(EditorBuffer& buffer) {
+    m_lsp_started = true;
+    std::vector<std::string> command;
+    std::stringstream ss(m_config.lsp_command);
+    for (std::string word; ss >> word; ) command.push_back(word);
+
+    std::string root = m_project.name.empty() ? std::filesystem::current_path().string() : m_project.root;
+    LspClient::json options = LspClient::json::object();
+    if (std::string dir = compileCommandsDir(); !dir.empty()) options["compilationDatabasePath"] = dir;
+    // Used for files no compilation database knows
+    options["fallbackFlags"] = m_buildSystem->getClangArguments(buffer);
+    m_lsp->start(command, root, options);
+}
+
+void TextEditor::adoptLspDiagnostics(const LspClient::json& params) {
+    const std::string path = LspClient::path(params.value("uri", ""));
+    if (path.empty()) return;
+    const FileId file = PathRegistry::instance().intern(path);
+    int idx = m_bufferManager->findByFileId(file);
+    const BufferSnapshotPtr snap = idx == -1 ? nullptr : m_bufferManager->getBuffer(idx).snapshot();
+
+    std::vector<CompileMessage> messages;
+    for (const auto& diag : params.value("diagnostics", LspClient::json::array())) {
+        CompileMessage msg;
+        msg.file_id = file;
+        msg.line = diag["range"]["start"].value("line", 0) + 1;
+        const int character = diag["range"]["start"].value("character", 0);
+        msg.col = static_cast<int>(snap && msg.line <= (int)snap->lineCount()
+                                   ? m_lsp->toByte(snap->line(msg.line - 1), character) : character) + 1;
+        const int severity = diag.value("severity", 1);
+        msg.type = severity == 1 ? CompileMessage::CMSG_ERROR
+                 : severity == 2 ? CompileMessage::CMSG_WARNING : CompileMessage::CMSG_NOTE;
+        const char* label = severity == 1 ? "error" : severity == 2 ? "warning" : "note";
+        std::string text = diag.value("message", "");
+        std::replace(text.begin(), text.end(), '\n', ' ');
+        msg.full_text = path + ":" + std::to_string(msg.line) + ":" + std::to_string(msg.col) + ": " + label + ": " + text;
+        messages.push_back(std::move(msg));
+    }
+    if (messages.empty()) m_lsp_diagnostics.erase(file);
+    else m_lsp_diagnostics[file] = std::move(messages);
+    ++m_diag_generation;
+}
+
+// True if requests about `buffer` can go to the language server; the
+// server is brought up to date with the buffer's text first.
+bool TextEditor::lspDocument(EditorBuffer& buffer) {
+    if (!m_lsp || !m_lsp->running() || !m_lsp->isOpen(buffer.file_id)) return false;
+    m_lsp->change(buffer.snapshot());
+    return true;
+}
+
+LspClient::json TextEditor::lspPosition(const EditorBuffer& buffer) const {
+    const std::string& text = buffer.current_line ? buffer.current_line->text : std::string();
+    return {{"textDocument", {{"uri", LspClient::uri(PathRegistry::instance().path(buffer.file_id))}}},
+            {"position", {{"line", buffer.current_line_num - 1},
+                          {"character", m_lsp->toCharacter(text, std::max(buffer.cursor_col - 1, 0))}}}};
+}
+
+// Asks the server and jumps when the answer arrives, unless the user has
+// moved on in the meantime.  A second lookup withdraws the first.
+void TextEditor::lspGoToDefinition(const std::string& symbol_name) {
+    EditorBuffer& buffer = currentBuffer();
+    if (m_lsp_request) m_lsp->cancel(m_lsp_request);
+    m_lsp_status = "Looking for definition of " + symbol_name + "...";
+    const FileId file = buffer.file_id;
+    const std::uint64_t version = buffer.version;
+    const int line_num = buffer.current_line_num, col = buffer.cursor_col;
+    m_lsp_request = m_lsp->request("textDocument/definition", lspPosition(buffer),
+        [this, file, version, line_num, col](const LspClient::json& result, const std::string& error) {
+            m_lsp_request = 0;
+            m_lsp_status.clear();
+            if (currentBufferIdx() == -1) return;
+            EditorBuffer& now = currentBuffer();
+            if (now.file_id != file || now.version != version || now.current_line_num != line_num || now.cursor_col != col) return;
+            if (!error.empty()) { msgwin("Definition lookup failed: " + error); return; }
+
+            // Location, Location[] or LocationLink[]
+            const LspClient::json& loc = result.is_array() ? (result.empty() ? LspClient::json() : result[0]) : result;
+            if (!loc.is_object()) { msgwin("Definition not found."); return; }
+            const std::string path = LspClient::path(loc.value("uri", loc.value("targetUri", "")));
+            const LspClient::json& range = loc.contains("targetSelectionRange") ? loc["targetSelectionRange"] : loc["range"];
+            if (path.empty() || !range.is_object()) { msgwin("Definition location not found."); return; }
+
+            openFileAtLine(PathRegistry::instance().intern(path), range["start"].value("line", 0) + 1, 1);
+            EditorBuffer& target = currentBuffer();
+            if (target.current_line) {
+                target.cursor_col = static_cast<int>(m_lsp->toByte(target.current_line->text, range["start"].value("character", 0))) + 1;
+            }
+            handleResize();
+        });
+}
+
+// Lists every use of the symbol under the cursor in the output window,
+// where Enter jumps to it.  Needs the language server.
+void TextEditor::FindReferences() {
+    if (currentBufferIdx() == -1) return;
+    EditorBuffer& buffer = currentBuffer();
+    if (!lspDocument(buffer)) {
+        msgwin(m_config.lsp_enabled ? "Find References needs the language server (" + m_config.lsp_command + ")."
+                                    : "Find References needs the language server; enable lsp_enabled in the config.");
+        return;
+    }
+    if (m_lsp_request) m_lsp->cancel(m_lsp_request);
+    m_lsp_status = "Finding references...";
+    LspClient::json params = lspPosition(buffer);
+    params["context"] = {{"includeDeclaration", true}};
+    m_lsp_request = m_lsp->request("textDocument/references", params,
+        [this](const LspClient::json& result, const std::string& error) {
+            m_lsp_request = 0;
+            m_lsp_status.clear();
+            if (!error.empty()) { msgwin("Find References failed: " + error); return; }
+
+            std::vector<CompileMessage> lines;
+            CompileMessage header;
+            header.full_text = "=== " + formatCount(result.is_array() ? result.size() : 0) + " reference(s) ===";
+            lines.push_back(header);
+            for (const auto& loc : result.is_array() ? result : LspClient::json::array()) {
+                const std::string path = LspClient::path(loc.value("uri", ""));
+                if (path.empty()) continue;
+                CompileMessage msg;
+                msg.file_id = PathRegistry::instance().intern(path);
+                msg.type = CompileMessage::CMSG_NOTE;
+                msg.line = loc["range"]["start"].value("line", 0) + 1;
+                std::string text;
+                int idx = m_bufferManager->findByFileId(msg.file_id);
+                if (idx != -1) {
+                    BufferSnapshotPtr snap = m_bufferManager->getBuffer(idx).snapshot();
+                    if (msg.line <= (int)snap->lineCount()) text = snap->line(msg.line - 1);
+                }
+                const int character = loc["range"]["start"].value("character", 0);
+                msg.col = static_cast<int>(text.empty() ? character : m_lsp->toByte(text, character)) + 1;
+                text.erase(0, text.find_first_not_of(" \t"));
+                msg.full_text = path + ":" + std::to_string(msg.line) + ":" + std::to_string(msg.col) + ": " + text;
+                lines.push_back(std::move(msg));
+            }
+            if (!m_compile_output_visible && currentBufferIdx() != -1) {
+                m_pre_compile_view_state.line_num = currentBuffer().current_line_num;
+                m_pre_compile_view_state.col      = currentBuffer().cursor_col;
+                m_pre_compile_view_state.first_visible_line_num = 0;
+            }
+            m_compile_output_lines = std::move(lines);
+            m_compile_output_list = OutputList::References;
+            m_compile_output_cursor_pos = m_compile_output_lines.size() > 1 ? 1 : 0;
+            m_compile_output_scroll_pos = 0;
+            m_compile_output_visible = true;
+            m_renderer->hideCursor();
+        });
+}
 
 void TextEditor::drawCompileOutputWindow() {
     // --- New Layout Calculation ---
@@ -2996,6 +4850,7 @@ void TextEditor::ActivateReplace() {
 
         if      (res["action"] == "replace")     PerformReplace();
         else if (res["action"] == "replace_all") PerformReplaceAll();
+        else if (res["action"] == "replace_files") PerformReplaceInFiles();
     }
 }
 
@@ -3028,7 +4883,7 @@ void TextEditor::PerformReplace() {
             DeleteSelection();
             currentBuffer().current_line->text.insert(currentBuffer().cursor_col - 1, m_replace_term);
             currentBuffer().cursor_col += m_replace_term.length();
-            currentBuffer().changed = true;
+            currentBuffer().touch();
             CreateUndoPoint(currentBuffer());
         }
     }
@@ -3039,18 +4894,163 @@ void TextEditor::PerformReplace() {
 
 void TextEditor::PerformReplaceAll() {
     if (m_search_term.empty()) return;
-    CreateUndoPoint(currentBuffer());
+    CreateUndoPoint(currentBuffer(), true);
 
     int replacements = SearchEngine::replaceAll(currentBuffer(), m_search_term, m_replace_term);
 
     if (replacements > 0) {
-        currentBuffer().changed = true;
+        currentBuffer().touch();
     }
 
     msgwin("Replaced " + std::to_string(replacements) + " occurrence(s).");
     update_cursor_and_scroll();
 }
 
+// Files a project-wide replace or rename looks at: the project's, or those
+// below the working directory when no project is open.
+std::vector<std::string> TextEditor::ProjectScope() {
+    return !m_project.name.empty()
+        ? ProjectReplace::projectFiles(m_project)
+        : ProjectReplace::directoryFiles(std::filesystem::current_path().string());
+}
+
+// Replaces the term in every file of the project scope.
+void TextEditor::PerformReplaceInFiles() {
+    if (m_search_term.empty()) return;
+    std::vector<std::string> paths = ProjectScope();
+
+    ProjectReplace job(m_search_term, m_replace_term);
+    job.find(paths, *m_bufferManager);
+    bool searched = ProgressDialog::show(*m_renderer, "Replace in Files", "Searching " + formatCount(paths.size()) + " files...",
+        [&] { return job.finished(); },
+        [&] { return std::make_pair(job.done(), job.total()); },
+        [&] { job.cancel(); });
+    if (!searched) return;
+
+    if (job.files().empty()) {
+        msgwin("No occurrences of \"" + m_search_term + "\" found.");
+        return;
+    }
+    ApplyReplaceInFiles(job, "Replace in Files");
+}
+
+// Shows the hits of `job` for review and applies the accepted ones.  Files
+// open in a buffer are edited there, one undo step per buffer, and left for
+// the user to save; the rest are rewritten on disk.
+void TextEditor::ApplyReplaceInFiles(ProjectReplace& job, const std::string& title) {
+    std::vector<ReplaceFile>& files = job.files();
+    if (!ReplacePreviewDialog::show(*m_renderer, title, files)) return;
+
+    std::size_t replaced = 0, in_files = 0;
+    std::vector<std::string> failures;
+    for (const ReplaceFile& file : files) {
+        if (!file.in_buffer) continue;
+        int idx = m_bufferManager->findByFileId(file.file_id);
+        if (idx < 0) continue;
+        EditorBuffer& buffer = m_bufferManager->getBuffer(idx);
+        if (buffer.read_only) {
+            failures.push_back(file.path + ": buffer is read-only");
+            continue;
+        }
+        if (buffer.version != file.version) {
+            failures.push_back(file.path + ": buffer was edited since it was searched");
+            continue;
+        }
+        CreateUndoPoint(buffer, true);
+        int n = job.applyToBuffer(buffer, file);
+        if (n <= 0) {
+            buffer.undo_stack.pop_back();
+            continue;
+        }
+        buffer.cursor_col = std::min<int>(buffer.cursor_col, buffer.current_line->text.size() + 1);
+        replaced += n;
+        ++in_files;
+    }
+
+    job.write();
+    ProgressDialog::show(*m_renderer, title, "Writing files...",
+        [&] { return job.finished(); },
+        [&] { return std::make_pair(job.done(), job.total()); },
+        [&] { job.cancel(); });
+    replaced += job.replaced();
+    in_files += job.filesWritten();
+    for (std::string& f : job.failures()) failures.push_back(std::move(f));
+
+    std::string report = "Replaced " + formatCount(replaced) + " occurrence(s) in " + formatCount(in_files) + " file(s).";
+    for (std::size_t i = 0; i < failures.size() && i < 5; ++i) report += "\n" + failures[i];
+    if (failures.size() > 5) report += "\n... and " + formatCount(failures.size() - 5) + " more.";
+    msgwin(report);
+    update_cursor_and_scroll();
+}
+
+// Renames the declaration under the cursor and every reference to it in
+// the project scope and the open buffers, resolved by libclang.
+void TextEditor::RenameSymbol() {
+    if (currentBufferIdx() == -1) return;
+    EditorBuffer& buffer = currentBuffer();
+    if (buffer.file_id == INVALID_FILE_ID || buffer.hex_view || !buffer.current_line) return;
+    if (buffer.read_only) { msgwin("Buffer is Read-Only."); return; }
+
+    // The identifier under (or just before) the cursor
+    const std::string& text = buffer.current_line->text;
+    auto is_ident = [](char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; };
+    int start = std::min(buffer.cursor_col - 1, (int)text.size());
+    if ((start == (int)text.size() || !is_ident(text[start])) && start > 0 && is_ident(text[start - 1])) --start;
+    int end = start;
+    while (start > 0 && is_ident(text[start - 1])) --start;
+    while (end < (int)text.size() && is_ident(text[end])) ++end;
+    std::string word = text.substr(start, end - start);
+    if (word.empty()) {
+        msgwin("No symbol under the cursor.");
+        return;
+    }
+
+    int h = m_renderer->getHeight();
+    m_renderer->drawText(0, h - 1, std::string(m_renderer->getWidth(), ' '), Renderer::CP_STATUS_BAR);
+    m_renderer->drawText(1, h - 1, "Looking up " + word + "...", Renderer::CP_STATUS_BAR);
+    m_renderer->refresh();
+
+    std::vector<std::string> args = m_buildSystem->getClangArguments(buffer);
+    if (!m_project.name.empty()) args.push_back("-I" + m_project.root);
+    auto unsaved = std::make_shared<UnsavedBuffers>(*m_bufferManager);
+    RenameTarget target;
+    std::string error;
+    if (!SymbolRename::resolve(*m_tu_cache, PathRegistry::instance().path(buffer.file_id), args, *unsaved,
+                               buffer.current_line_num, start + 1, target, error)) {
+        msgwin(error);
+        return;
+    }
+    if (target.name != word) {
+        msgwin("No symbol under the cursor.");
+        return;
+    }
+
+    std::string new_name = RenameDialog::show(*m_renderer, target.name);
+    if (new_name.empty() || new_name == target.name) return;
+    if (std::isdigit(static_cast<unsigned char>(new_name[0])) || !std::all_of(new_name.begin(), new_name.end(), is_ident)) {
+        msgwin("'" + new_name + "' is not a valid identifier.");
+        return;
+    }
+
+    std::vector<std::string> paths = ProjectScope();
+    paths.insert(paths.end(), unsaved->paths.begin(), unsaved->paths.end());
+    SymbolRename rename(m_tu_cache);
+    rename.find(target, paths, args, unsaved);
+    bool searched = ProgressDialog::show(*m_renderer, "Rename Symbol", "Finding references to " + target.name + "...",
+        [&] { return rename.finished(); },
+        [&] { return std::make_pair(rename.done(), rename.total()); },
+        [&] { rename.cancel(); });
+    if (!searched) return;
+
+    ProjectReplace job(target.name, new_name);
+    job.adopt(rename.files());
+    if (job.files().empty()) {
+        msgwin("No references to '" + target.name + "' found.");
+        return;
+    }
+    ApplyReplaceInFiles(job, "Rename Symbol");
+}
+
 void TextEditor::handleToggleComment() {
     if (currentBufferIdx() == -1) return;
     EditorBuffer& buffer = currentBuffer();
@@ -3128,7 +5128,7 @@ void TextEditor::handleToggleComment() {
         }
     }
 
-    buffer.changed = true;
+    buffer.touch();
     update_cursor_and_scroll();
 }
 
@@ -3138,6 +5138,11 @@ void TextEditor::msgwin(const std::string& s) {
 
 void TextEditor::GoToLineDialog() {
     if (currentBufferIdx() == -1) return;
+    if (currentBuffer().hex_view) {
+        m_hex_prompt = HexPrompt::OFFSET;
+        m_hex_prompt_text.clear();
+        return;
+    }
     int line = GoToLineDialog::show(*m_renderer, currentBuffer().current_line_num, currentBuffer().total_lines);
     if (line != -1) {
         currentBuffer().current_line_num = line;
@@ -3205,6 +5210,8 @@ std::vector<PanelEntry> TextEditor::buildPanelEntries() const
         PanelEntry e;
         e.kind    = PanelEntry::BUILD_FILE;
         e.display = build_name;
+        e.file_id = PathRegistry::instance().intern(
+            (std::filesystem::path(m_project.root) / build_name).string());
         entries.push_back(std::move(e));
     }
 
@@ -3225,6 +5232,8 @@ std::vector<PanelEntry> TextEditor::buildPanelEntries() const
             src.target_idx = ti;
             src.source_idx = si;
             src.display    = tgt.sources[si];
+            src.file_id    = PathRegistry::instance().intern(
+                (std::filesystem::path(m_project.root) / tgt.sources[si]).string());
             entries.push_back(std::move(src));
         }
     }
@@ -3373,12 +5382,7 @@ void TextEditor::handleProjectPanelKey(wint_t ch) {
             std::string build_file_name =
                 m_project.build_system == "cmake" ? "CMakeLists.txt" :
                 m_project.build_system == "make"  ? "Makefile" : "meson.build";
-            std::string bfp = (std::filesystem::path(m_project.root) / build_file_name).string();
-            for (size_t i = 0; i < m_bufferManager->bufferCount(); ++i) {
-                if (m_bufferManager->getBuffer(i).filename == bfp) {
-                    read_file(m_bufferManager->getBuffer(i)); break;
-                }
-            }
+            reloadOpenBuffer((std::filesystem::path(m_project.root) / build_file_name).string());
             int new_count = (int)buildPanelEntries().size();
             if (m_project_panel_cursor >= new_count && m_project_panel_cursor > 0)
                 m_project_panel_cursor--;
@@ -3413,12 +5417,7 @@ void TextEditor::handleProjectPanelKey(wint_t ch) {
             }
 
             // Reload the build file in any open buffer
-            if (!build_file_path.empty()) {
-                for (size_t i = 0; i < m_bufferManager->bufferCount(); ++i) {
-                    EditorBuffer& buf = m_bufferManager->getBuffer(i);
-                    if (buf.filename == build_file_path) { read_file(buf); break; }
-                }
-            }
+            if (!build_file_path.empty()) reloadOpenBuffer(build_file_path);
 
             m_project.targets[ti].sources.erase(m_project.targets[ti].sources.begin() + si);
             m_project.save();
@@ -3456,12 +5455,7 @@ void TextEditor::handleProjectPanelKey(wint_t ch) {
         std::string build_file_name =
             m_project.build_system == "cmake" ? "CMakeLists.txt" :
             m_project.build_system == "make"  ? "Makefile" : "meson.build";
-        std::string bfp = (std::filesystem::path(m_project.root) / build_file_name).string();
-        for (size_t i = 0; i < m_bufferManager->bufferCount(); ++i) {
-            if (m_bufferManager->getBuffer(i).filename == bfp) {
-                read_file(m_bufferManager->getBuffer(i)); break;
-            }
-        }
+        reloadOpenBuffer((std::filesystem::path(m_project.root) / build_file_name).string());
 
         int new_count = (int)buildPanelEntries().size();
         if (m_project_panel_cursor >= new_count && m_project_panel_cursor > 0)
@@ -3502,15 +5496,14 @@ void TextEditor::openProjectPanelFile(int index) {
 
     std::string full = (fs::path(m_project.root) / rel).string();
 
-    for (size_t i = 0; i < m_bufferManager->bufferCount(); ++i) {
-        if (m_bufferManager->getBuffer(i).filename == full) {
-            SwitchToBuffer((int)i);
-            m_project_panel_open    = false;
-            m_project_panel_focused = false;
-            m_renderer->showCursor();
-            handleResize();
-            return;
-        }
+    int open_idx = m_bufferManager->findByFileId(e.file_id);
+    if (open_idx != -1) {
+        SwitchToBuffer(open_idx);
+        m_project_panel_open    = false;
+        m_project_panel_focused = false;
+        m_renderer->showCursor();
+        handleResize();
+        return;
     }
 
     if (fs::exists(full)) {
@@ -3674,11 +5667,6 @@ void TextEditor::ProjectProperties()
         std::string build_file_name =
             m_project.build_system == "cmake" ? "CMakeLists.txt" :
             m_project.build_system == "make"  ? "Makefile" : "meson.build";
-        std::string bfp = (std::filesystem::path(m_project.root) / build_file_name).string();
-        for (size_t i = 0; i < m_bufferManager->bufferCount(); ++i) {
-            if (m_bufferManager->getBuffer(i).filename == bfp) {
-                read_file(m_bufferManager->getBuffer(i)); break;
-            }
-        }
+        reloadOpenBuffer((std::filesystem::path(m_project.root) / build_file_name).string());
     }
 }
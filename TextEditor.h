@@ -8,6 +8,10 @@
 #include <vector>
 #include <memory>
 #include <future>
+#include <functional>
+#include <map>
+#include <unordered_map>
+#include <optional>
 
 #include "SyntaxHighlighter.h"
 #include "FileBrowser.h"
@@ -29,6 +33,27 @@
 #include "AddFileDialog.h"
 #include "GediProject.h"
 #include "ProjectPropertiesDialog.h"
+#include "TaskScheduler.h"
+#include "FileLoader.h"
+#include "StreamSource.h"
+#include "FileFollower.h"
+#include "LineFilter.h"
+#include "FilterDialog.h"
+#include "HexView.h"
+#include "WrapLayout.h"
+#include "OverviewRuler.h"
+#include "SearchMatches.h"
+#include "SyntaxModel.h"
+#include "SemanticHighlights.h"
+#include "TranslationUnitCache.h"
+#include "ProjectReplace.h"
+#include "TidyRunner.h"
+#include "LspClient.h"
+#include "PtyProcess.h"
+#include "Scrollback.h"
+#include "Terminal.h"
+#include "Benchmark.h"
+#include "GoogleBenchmark.h"
 
 enum MenuAction { CLOSE_MENU, ITEM_SELECTED, NAVIGATE_LEFT, NAVIGATE_RIGHT, RESIZE_OCCURRED };
 
@@ -38,6 +63,7 @@ struct PanelEntry {
     std::string display;
     int target_idx = -1;  // index into GediProject::targets
     int source_idx = -1;  // index into ProjectTarget::sources
+    FileId file_id = INVALID_FILE_ID;  // BUILD_FILE / SOURCE_FILE only
 };
 
 struct ViewState {
@@ -72,19 +98,90 @@ private:
     std::string m_search_term;
     std::string m_replace_term;
     ViewState m_search_origin;
+    FilterSpec m_filter_spec;   // last filter entered, offered again
+
+    // Status bar prompt of the hex view
+    enum class HexPrompt { NONE, OFFSET, FIND_TEXT, FIND_HEX };
+    HexPrompt m_hex_prompt = HexPrompt::NONE;
+    std::string m_hex_prompt_text;
+    std::string m_hex_needle;   // bytes of the last hex view search
 
     // Output Screens
     bool m_output_screen_visible = false;
-    std::string m_output_content;
+    // The program started by Run, on a pseudo-terminal.  The output screen
+    // shows its scrollback and passes keys to it while it runs.
+    static constexpr std::size_t RUN_POLL_BYTES = 256 * 1024;
+    std::unique_ptr<PtyProcess> m_run;
+    Scrollback m_run_output;
+    std::string m_run_name;
+    bool m_run_reported = false;             // exit line appended
+    std::optional<std::uint64_t> m_run_top;  // first line shown; unset follows the output
+    bool m_run_find_prompt = false;
+    std::string m_run_find_term;
+    std::uint64_t m_run_find_line = 0;       // last hit
+    // Integrated terminal: a shell on a pseudo-terminal in a pane below the
+    // text area.  At most TERMINAL_POLL_BYTES of its output is parsed per
+    // main loop iteration, so a flood of output cannot hold up the keyboard.
+    static constexpr std::size_t TERMINAL_POLL_BYTES = 64 * 1024;
+    std::unique_ptr<PtyProcess> m_shell;
+    std::unique_ptr<Terminal> m_terminal;
+    bool m_terminal_open = false;
+    bool m_terminal_focused = false;
+    int m_terminal_scroll = 0;               // history lines scrolled back
     bool m_compile_output_visible = false;
     std::vector<CompileMessage> m_compile_output_lines;
     int m_compile_output_scroll_pos = 0;
     int m_compile_output_cursor_pos = 0;
     ViewState m_pre_compile_view_state;
+    // What the output list shows.  Only build output counts as diagnostics.
+    enum class OutputList { Build, Tidy, References } m_compile_output_list = OutputList::Build;
+
+    // clang-tidy findings per analysed file; a diagnostic may point into a
+    // header, so msg.file_id need not be the key
+    std::unique_ptr<TidyRunner> m_tidy;
+    std::map<FileId, std::vector<CompileMessage>> m_tidy_findings;
+    std::string m_tidy_error;
+    // Timed runs of the compiled program; the dialog remembers the last
+    // settings
+    std::unique_ptr<BenchmarkRunner> m_bench;
+    int m_bench_runs = 10;
+    int m_bench_warmup = 3;
+    std::string m_bench_args;
+    std::string m_bench_label;
+    // A Google Benchmark program in progress and its report so far
+    std::unique_ptr<PtyProcess> m_gbench;
+    std::string m_gbench_output;
+    GoogleBenchmark::Progress m_gbench_progress;
+    std::string m_gbench_flags;
+    std::string m_gbench_baseline;   // path of the baseline file
+    // Language server (clangd).  Started for the first C/C++ buffer;
+    // diagnostics it publishes are keyed by the file they are about.
+    static constexpr std::size_t LSP_POLL_BYTES = 4 * 1024 * 1024;
+    std::unique_ptr<LspClient> m_lsp;
+    bool m_lsp_started = false;
+    int m_lsp_request = 0;          // pending definition/references request
+    std::string m_lsp_status;
+    std::map<FileId, std::vector<CompileMessage>> m_lsp_diagnostics;
+    // Bumped whenever the build output or any findings change
+    std::uint64_t m_diag_generation = 0;
+    struct GutterMarks {
+        FileId file = INVALID_FILE_ID;
+        std::uint64_t generation = ~0ull;
+        std::unordered_map<int, CompileMessage::CompileMessageType> lines;
+    } m_gutter_marks;
 
     // UI Coordinates
     int m_text_area_start_x = 1, m_text_area_start_y = 2, m_text_area_end_x = 0, m_text_area_end_y = 0;
     int m_gutter_width = 0;
+    int m_wrap_cursor_x = 0;   // cursor column within its visual row when soft-wrapping
+
+    // Incremental search term compiled once per term, for highlighting,
+    // counting and the overview column
+    std::shared_ptr<const LineMatcher> m_search_matcher;
+    std::string m_search_matcher_term;
+    IncrementalSearch m_incremental_search;
+    // Parsed units reused by rename; shared with the tasks using them
+    std::shared_ptr<TranslationUnitCache> m_tu_cache = std::make_shared<TranslationUnitCache>();
 
     // Menus
     std::vector<std::string> m_menus;
@@ -113,6 +210,11 @@ private:
     void drawMenuBar(int active_menu_id = -1);
     void drawStatusBar();
     void drawScrollbars();
+    void syncOverview(EditorBuffer& buffer);
+    const std::shared_ptr<const LineMatcher>& searchMatcher();
+    void syncSearchMatches(EditorBuffer& buffer);
+    void syncSemanticHighlights(EditorBuffer& buffer);
+    void drawOverviewRuler(EditorBuffer& buffer, int bar_x, int first_line, int last_line);
     void drawCompileOutputWindow();
     int msgwin_yesno(const std::string& question, const std::string& info);
     void msgwin(const std::string& s);
@@ -125,6 +227,15 @@ private:
     void HandleAltKey(wint_t key);
     void handleSmartBlockClose(wint_t closing_char);
     void update_cursor_and_scroll();
+    bool softWrap(const EditorBuffer& buffer) const;
+    WrapLayout& syncWrapLayout(EditorBuffer& buffer);
+    void scrollWrapped(EditorBuffer& buffer);
+    void moveWrapped(EditorBuffer& buffer, int rows);
+    void drawWrappedText(EditorBuffer& buffer, SyntaxModel* model);
+    void drawLineSegment(const Line* p, const std::vector<SyntaxToken>& tokens, bool highlight,
+                         const std::vector<SearchMatches::Span>& matches, const std::vector<std::size_t>& brackets,
+                         std::size_t from, std::size_t to, int screen_y);
+    void ToggleSoftWrap();
     void handleResize();
     void ClearSelection();
     void UpdateSelection();
@@ -132,7 +243,11 @@ private:
     void HandleCopy();
     void HandleCut();
     void HandlePaste();
-    void CreateUndoPoint(EditorBuffer& buffer);
+    void CreateUndoPoint(EditorBuffer& buffer, bool whole_document = false);
+    UndoRecord captureUndoRecord(EditorBuffer& buffer, int first_line, int count);
+    UndoRecord inverseUndoRecord(EditorBuffer& buffer, const UndoRecord& record);
+    int firstVisibleLineNum(const EditorBuffer& buffer) const;
+    Line* lineAt(EditorBuffer& buffer, int num);
     void HandleUndo();
     void HandleRedo();
     void RestoreStateFromRecord(EditorBuffer& buffer, const UndoRecord& record);
@@ -142,6 +257,25 @@ private:
     void ActivateReplace();
     void PerformReplace();
     void PerformReplaceAll();
+    void PerformReplaceInFiles();
+    std::vector<std::string> ProjectScope();
+    void ApplyReplaceInFiles(ProjectReplace& job, const std::string& title);
+    void RenameSymbol();
+    void RunTidy(const std::string& path);
+    void RunTidyOnProject();
+    void ShowTidyFindings();
+    void adoptTidyResult(TidyRunner::Result result);
+    std::vector<std::string> tidyArgs(const std::string& path);
+    std::string compileCommandsDir() const;
+    void syncLanguageServer();
+    void startLanguageServer(EditorBuffer& buffer);
+    void adoptLspDiagnostics(const LspClient::json& params);
+    bool lspDocument(EditorBuffer& buffer);
+    LspClient::json lspPosition(const EditorBuffer& buffer) const;
+    void lspGoToDefinition(const std::string& symbol_name);
+    void FindReferences();
+    void forEachDiagnostic(FileId file, const std::function<void(const CompileMessage&)>& fn) const;
+    int gutterMark(FileId file, int line_num);
     void GoToLineDialog();
     void GoToDefinition();
     void GoToNextWord();
@@ -162,9 +296,25 @@ private:
     void PreviousWindow();
     void CloseWindow();
     void SwitchToBuffer(int index);
+    std::string compileForRun();
     void compileAndRun();
     void compileOnly();
-    void ShowOutputScreen();
+    void BenchmarkProgram();
+    void adoptBenchmark(BenchmarkRunner::Summary summary, const std::string& history);
+    void startGoogleBenchmark(const std::string& exe, std::vector<std::string> args,
+                              const std::string& flags, const std::string& dir);
+    void syncGoogleBenchmark();
+    void startProgram(const std::string& exe);
+    void syncProgram();
+    void outputScreenFrame();
+    void handleOutputScreenKey(wint_t ch);
+    void findInRunOutput();
+    void ToggleTerminalFocus();
+    void ShowTerminal(bool show);
+    int terminalPaneHeight() const;
+    void syncTerminal();
+    void drawTerminalPane();
+    void handleTerminalKey(wint_t ch);
     void CompileOptionsDialog();
     void AboutBox();
     void handleToggleComment();
@@ -178,7 +328,35 @@ private:
     void handleProjectPanelKey(wint_t ch);
     void openProjectPanelFile(int index);
     void CloseProject();
-    void openFileAtLine(const std::string& abs_path, int line, int col);
+    void openFileAtLine(FileId file_id, int line, int col);
+    void reloadOpenBuffer(const std::string& path);
+    void openFilesInBackground(std::vector<FileArgument> files);
+    void streamRemainder(EditorBuffer& buffer, std::uintmax_t offset);
+    int  findLoadingBuffer(std::uint64_t load_id) const;
+    void openStdinBuffer();
+    void pumpStdin();
+    void ToggleFollow();
+    void FilterLines();
+    void CycleBufferMode();
+    FilteredView* activeFilteredView();
+    void drawFilteredView(FilteredView& view);
+    void handleFilteredViewKey(wint_t ch);
+    void closeFilteredView(bool jump_to_row);
+    HexView* activeHexView();
+    void drawHexView(HexView& view);
+    void handleHexViewKey(wint_t ch);
+    void handleHexPromptKey(HexView& view, wint_t ch);
+    void startHexSearch(const std::string& needle);
+    std::string hexPromptLabel() const;
+
+    FileFollower m_follower;
+
+    // Piped stdin ("gedi -")
+    static constexpr std::size_t STDIN_POLL_BYTES = 1024 * 1024;
+    std::unique_ptr<StreamSource> m_stdin_stream;
+    std::uint64_t m_stdin_load_id = 0;
+    std::size_t m_stdin_bytes_held = 0;
+    bool m_stdin_trimmed = false;
     void ProjectProperties();
     void regenerateBuildFile();
     int  pickTarget(const std::string& action_label, int exclude_idx = -1);
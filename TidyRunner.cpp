@@ -0,0 +1,376 @@
+#include "TidyRunner.h"
+
+#include "nlohmann/json.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <regex>
+#include <sstream>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+namespace {
+
+// FNV-1a: stable across runs and builds, unlike std::hash, so keys written
+// to the cache directory stay valid
+std::uint64_t fnv1a(std::string_view data, std::uint64_t h = 1469598103934665603ull) {
+    for (unsigned char c : data) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+std::string hex(std::uint64_t v) {
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)v);
+    return buf;
+}
+
+std::string shellQuote(const std::string& s) {
+    std::string out = "'";
+    for (char c : s) {
+        if (c == '\'') out += "'\\''";
+        else out += c;
+    }
+    return out + "'";
+}
+
+// clang-tidy's summary lines, which say nothing about the code
+bool isNoise(const std::string& line) {
+    static const std::regex noise(
+        R"(^(\d+ warnings?( and \d+ errors?)? generated\.|Suppressed \d+ warnings.*|Use -header-filter=.*|Error while processing .*|Found compiler errors?.*)$)");
+    return std::regex_match(line, noise);
+}
+
+bool readFile(const std::string& path, std::string& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return !in.bad();
+}
+
+// Written first in every cache file; a file from another format is a miss
+constexpr const char* RECORD_MAGIC = "gedi-tidy 2";
+
+// Words of a "command" of the compilation database, quoted as a POSIX
+// shell would take them
+std::vector<std::string> splitCommand(const std::string& command) {
+    std::vector<std::string> words;
+    std::string word;
+    bool in_word = false;
+    char quote = 0;
+    for (std::size_t i = 0; i < command.size(); ++i) {
+        const char c = command[i];
+        if (quote) {
+            if (c == quote) quote = 0;
+            else if (c == '\\' && quote == '"' && i + 1 < command.size()) word += command[++i];
+            else word += c;
+        } else if (c == '\'' || c == '"') {
+            quote = c;
+            in_word = true;
+        } else if (c == '\\' && i + 1 < command.size()) {
+            word += command[++i];
+            in_word = true;
+        } else if (std::isspace(static_cast<unsigned char>(c))) {
+            if (in_word) words.push_back(std::move(word));
+            word.clear();
+            in_word = false;
+        } else {
+            word += c;
+            in_word = true;
+        }
+    }
+    if (in_word) words.push_back(std::move(word));
+    return words;
+}
+
+// Prerequisites of the make rule -MM writes: "x.o: x.cpp a.h b.h", lines
+// continued with a backslash and spaces in names escaped with one
+std::vector<std::string> parseMakeRule(const std::string& rule) {
+    std::vector<std::string> words;
+    std::string word;
+    bool target = true;
+    for (std::size_t i = 0; i <= rule.size(); ++i) {
+        const char c = i < rule.size() ? rule[i] : ' ';
+        if (c == '\\' && i + 1 < rule.size() && (rule[i + 1] == ' ' || rule[i + 1] == '\n')) {
+            if (rule[++i] == ' ') word += ' ';
+            continue;
+        }
+        if (!std::isspace(static_cast<unsigned char>(c))) {
+            word += c;
+            continue;
+        }
+        if (word.empty()) continue;
+        if (target) target = word.back() != ':';
+        else words.push_back(word);
+        word.clear();
+    }
+    return words;
+}
+
+} // namespace
+
+std::string TidyRunner::defaultCacheDir() {
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) return std::string(xdg) + "/gedi/tidy";
+    if (const char* home = std::getenv("HOME"); home && *home) return std::string(home) + "/.cache/gedi/tidy";
+    return "";
+}
+
+TidyRunner::TidyRunner(std::string cache_dir) : m_cache_dir(std::move(cache_dir)) {}
+
+TidyRunner::~TidyRunner() {
+    m_token.cancel();
+}
+
+void TidyRunner::cancel() {
+    m_token.cancel();
+    m_token = CancellationToken();
+    m_state->in_flight.clear();
+}
+
+void TidyRunner::run(const std::string& path, const std::vector<std::string>& args, const std::string& checks) {
+    if (!m_state->in_flight.insert(path).second) return;
+    auto state = m_state;
+    TaskScheduler::instance().submit(TaskLane::Background,
+        [state, cache_dir = m_cache_dir, path, args, checks](const CancellationToken& token) {
+            auto result = std::make_shared<Result>(analyse(*state, cache_dir, path, args, checks));
+            if (token.cancelled()) return;
+            TaskScheduler::instance().post([state, token, result]() {
+                if (token.cancelled()) return;
+                state->in_flight.erase(result->path);
+                if (state->on_result) state->on_result(std::move(*result));
+            });
+        }, m_token);
+}
+
+TidyRunner::Dependency TidyRunner::stamp(const std::string& path) {
+    Dependency d;
+    d.path = path;
+    struct stat st;
+    if (::stat(path.c_str(), &st) == 0) {
+        d.mtime_ns = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+        d.size = st.st_size;
+    }
+    return d;
+}
+
+bool TidyRunner::unchanged(const Record& record) {
+    return std::all_of(record.dependencies.begin(), record.dependencies.end(), [](const Dependency& d) {
+        const Dependency now = stamp(d.path);
+        return now.mtime_ns == d.mtime_ns && now.size == d.size;
+    });
+}
+
+// "gedi-tidy 2", the number of dependencies, one "mtime size path" line
+// each, then the output
+std::string TidyRunner::encode(const Record& record) {
+    std::string data = std::string(RECORD_MAGIC) + "\n" + std::to_string(record.dependencies.size()) + "\n";
+    for (const Dependency& d : record.dependencies)
+        data += std::to_string(d.mtime_ns) + " " + std::to_string(d.size) + " " + d.path + "\n";
+    return data + record.output;
+}
+
+std::optional<TidyRunner::Record> TidyRunner::decode(const std::string& data) {
+    std::istringstream in(data);
+    std::string line;
+    std::size_t count = 0;
+    if (!std::getline(in, line) || line != RECORD_MAGIC || !(in >> count) || !std::getline(in, line)) return std::nullopt;
+    Record record;
+    for (std::size_t i = 0; i < count; ++i) {
+        Dependency d;
+        if (!(in >> d.mtime_ns >> d.size) || in.get() != ' ' || !std::getline(in, d.path)) return std::nullopt;
+        record.dependencies.push_back(std::move(d));
+    }
+    record.output.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return record;
+}
+
+std::optional<TidyRunner::CompileEntry> TidyRunner::compileEntry(State& state, const std::string& path,
+                                                                 const std::vector<std::string>& args) {
+    auto p = std::find(args.begin(), args.end(), "-p");
+    if (p == args.end() || p + 1 == args.end()) return std::nullopt;
+    const std::string build_dir = *(p + 1);
+    const std::string db_path = build_dir + "/compile_commands.json";
+    std::error_code ec;
+    const auto mtime = fs::last_write_time(db_path, ec);
+    if (ec) return std::nullopt;
+    const std::string source = fs::weakly_canonical(path, ec).string();
+
+    // Parsed once per change of the file, by whichever task gets here first
+    std::lock_guard<std::mutex> lock(state.mutex);
+    CompileDb& db = state.databases[build_dir];
+    if (db.entries.empty() || db.mtime != mtime) {
+        db = CompileDb{};
+        db.mtime = mtime;
+        std::ifstream in(db_path);
+        const json entries = json::parse(in, nullptr, false);
+        for (const json& e : entries.is_array() ? entries : json::array()) {
+            if (!e.is_object()) continue;
+            CompileEntry entry;
+            entry.directory = e.value("directory", "");
+            if (e.contains("arguments") && e["arguments"].is_array()) {
+                for (const json& a : e["arguments"]) if (a.is_string()) entry.argv.push_back(a.get<std::string>());
+            } else {
+                entry.argv = splitCommand(e.value("command", ""));
+            }
+            entry.hash = fnv1a(e.dump());
+            fs::path file = e.value("file", "");
+            if (file.is_relative()) file = fs::path(entry.directory) / file;
+            db.entries.emplace(fs::weakly_canonical(file, ec).string(), std::move(entry));
+        }
+    }
+    auto it = db.entries.find(source);
+    if (it == db.entries.end()) return std::nullopt;
+    return it->second;
+}
+
+std::optional<std::vector<std::string>> TidyRunner::includes(const std::string& path,
+                                                             const std::vector<std::string>& args,
+                                                             const std::optional<CompileEntry>& entry) {
+    std::vector<std::string> argv;
+    std::string dir;
+    if (entry) {
+        argv = entry->argv;
+        dir = entry->directory;
+    } else if (auto dash = std::find(args.begin(), args.end(), "--"); dash != args.end()) {
+        argv.push_back("clang");
+        argv.insert(argv.end(), dash + 1, args.end());
+        argv.push_back(path);
+    }
+    if (argv.empty()) return std::nullopt;
+
+    // The same compile, but only preprocessing and writing the make rule
+    std::string cmd = dir.empty() ? "" : "cd " + shellQuote(dir) + " && ";
+    cmd += shellQuote(argv[0]);
+    for (std::size_t i = 1; i < argv.size(); ++i) {
+        const std::string& a = argv[i];
+        if (a == "-o" || a == "-MF" || a == "-MT" || a == "-MQ") { ++i; continue; }
+        if (a == "-c" || a == "-M" || a == "-MM" || a == "-MD" || a == "-MMD" || a == "-MP") continue;
+        cmd += " " + shellQuote(a);
+    }
+    cmd += " -MM 2>/dev/null";
+
+    FILE* pipe = popen(cmd.c_str(), "r");
+    if (!pipe) return std::nullopt;
+    std::string rule;
+    char buf[4096];
+    std::size_t n;
+    while ((n = std::fread(buf, 1, sizeof(buf), pipe)) > 0) rule.append(buf, n);
+    const int status = pclose(pipe);
+    if (status == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) return std::nullopt;
+
+    std::vector<std::string> files = parseMakeRule(rule);
+    if (files.empty()) return std::nullopt;
+    files.erase(files.begin());   // the file itself, which the key covers
+    for (std::string& f : files) {
+        if (!dir.empty() && fs::path(f).is_relative()) f = (fs::path(dir) / f).lexically_normal().string();
+    }
+    return files;
+}
+
+TidyRunner::Result TidyRunner::analyse(State& state, const std::string& cache_dir, const std::string& path,
+                                       const std::vector<std::string>& args, const std::string& checks) {
+    Result result;
+    result.path = path;
+    result.file_id = PathRegistry::instance().intern(path);
+
+    std::string content;
+    if (!readFile(path, content)) {
+        result.failed = true;
+        result.output = path + ": cannot be read";
+        return result;
+    }
+
+    const std::optional<CompileEntry> entry = compileEntry(state, path, args);
+    std::string setup = path;
+    for (const std::string& a : args) setup += '\0' + a;
+    setup += '\0' + checks;
+    if (entry) setup += '\0' + hex(entry->hash);
+    const std::string key = hex(fnv1a(content)) + hex(fnv1a(setup));
+
+    std::optional<Record> known;
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        auto it = state.memo.find(key);
+        if (it != state.memo.end()) known = it->second;
+    }
+    const std::string cache_file = cache_dir.empty() ? "" : cache_dir + "/" + key;
+    std::string data;
+    if (!known && !cache_file.empty() && readFile(cache_file, data)) known = decode(data);
+    if (known && unchanged(*known)) {
+        result.output = known->output;
+        result.cached = true;
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.memo[key] = std::move(*known);
+        return result;
+    }
+
+    // Stamped before clang-tidy runs, so an include edited meanwhile makes
+    // the result stale rather than wrongly fresh
+    Record record;
+    const std::optional<std::vector<std::string>> included = includes(path, args, entry);
+    if (included) {
+        for (const std::string& f : *included) record.dependencies.push_back(stamp(f));
+        for (fs::path dir = fs::absolute(path).parent_path(); ; dir = dir.parent_path()) {
+            if (fs::exists(dir / ".clang-tidy")) record.dependencies.push_back(stamp((dir / ".clang-tidy").string()));
+            if (dir == dir.root_path() || dir.empty()) break;
+        }
+    }
+
+    std::string cmd = "clang-tidy --quiet";
+    if (!checks.empty()) cmd += " --checks=" + shellQuote(checks);
+    cmd += " " + shellQuote(path);
+    for (const std::string& a : args) cmd += " " + shellQuote(a);
+    cmd += " 2>&1";
+
+    FILE* pipe = popen(cmd.c_str(), "r");
+    if (!pipe) {
+        result.failed = true;
+        result.output = "clang-tidy could not be started";
+        return result;
+    }
+    std::string raw;
+    char buf[4096];
+    std::size_t n;
+    while ((n = std::fread(buf, 1, sizeof(buf), pipe)) > 0) raw.append(buf, n);
+    int status = pclose(pipe);
+    if (status == -1 || (WIFEXITED(status) && (WEXITSTATUS(status) == 126 || WEXITSTATUS(status) == 127))) {
+        result.failed = true;
+        result.output = "clang-tidy was not found";
+        return result;
+    }
+
+    std::istringstream lines(raw);
+    for (std::string line; std::getline(lines, line); ) {
+        if (!isNoise(line)) result.output += line + "\n";
+    }
+
+    // Without the list of includes nothing would notice a header change
+    if (!included) return result;
+    record.output = result.output;
+    if (!cache_file.empty()) {
+        std::error_code ec;
+        fs::create_directories(cache_dir, ec);
+        static std::atomic<unsigned> serial{0};
+        std::string tmp = cache_file + ".tmp" + std::to_string(::getpid()) + "." + std::to_string(serial++);
+        std::ofstream out(tmp, std::ios::binary);
+        out << encode(record);
+        out.close();
+        if (out) fs::rename(tmp, cache_file, ec);
+        if (!out || ec) fs::remove(tmp, ec);
+    }
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.memo[key] = std::move(record);
+    return result;
+}
@@ -0,0 +1,119 @@
+#ifndef TIDYRUNNER_H
+#define TIDYRUNNER_H
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "PathRegistry.h"
+#include "TaskScheduler.h"
+
+// Runs clang-tidy on files in the background and remembers what it said.
+//
+// Every file is one task on the TaskScheduler's Background lane.  A result
+// is stored under a key made of the file's content hash, its path, the
+// compiler flags, its compile_commands.json entry and the check set, in
+// memory and as a small file in the cache directory, so a file that has not
+// changed since it was last analysed -- in this session or an earlier one --
+// is answered without running clang-tidy.  The headers it includes (as the
+// compiler lists them with -MM) and the .clang-tidy files above it are
+// stored with the result, with their mtime and size, and a result is only
+// used while they are unchanged.  A result whose includes could not be
+// listed is not kept.
+class TidyRunner {
+public:
+    struct Result {
+        FileId file_id = INVALID_FILE_ID;
+        std::string path;
+        std::string output;    // clang-tidy's diagnostics, noise lines removed
+        bool cached = false;   // answered from the cache
+        bool failed = false;   // clang-tidy could not be run; output says why
+    };
+
+    // `cache_dir` may be empty: results are then kept in memory only.
+    explicit TidyRunner(std::string cache_dir = defaultCacheDir());
+    ~TidyRunner();
+    TidyRunner(const TidyRunner&) = delete;
+    TidyRunner& operator=(const TidyRunner&) = delete;
+
+    // $XDG_CACHE_HOME/gedi/tidy, or ~/.cache/gedi/tidy.
+    static std::string defaultCacheDir();
+
+    // Called on the UI thread with each result as it arrives.
+    void onResult(std::function<void(Result)> fn) { m_state->on_result = std::move(fn); }
+
+    // Queues `path` for analysis.  `args` are clang-tidy arguments after
+    // the file name (e.g. "--" and compiler flags, or "-p" and a build
+    // directory); `checks` is a --checks value, empty to let the
+    // .clang-tidy files decide.  A file already waiting is not queued again.
+    // UI thread only.
+    void run(const std::string& path, const std::vector<std::string>& args, const std::string& checks);
+
+    // Files queued or being analysed.
+    std::size_t pending() const { return m_state->in_flight.size(); }
+    // Drops everything queued; running clang-tidy processes finish unseen.
+    void cancel();
+
+private:
+    // A file a result depends on, as it was when the result was made.
+    struct Dependency {
+        std::string path;
+        std::int64_t mtime_ns = 0;
+        std::int64_t size = -1;   // -1: the file did not exist
+    };
+
+    struct Record {
+        std::vector<Dependency> dependencies;
+        std::string output;
+    };
+
+    // How the compilation database compiles one file.
+    struct CompileEntry {
+        std::string directory;
+        std::vector<std::string> argv;
+        std::uint64_t hash = 0;   // of the entry as written
+    };
+
+    // compile_commands.json of one directory, by canonical source path.
+    struct CompileDb {
+        std::filesystem::file_time_type mtime;
+        std::unordered_map<std::string, CompileEntry> entries;
+    };
+
+    // Shared with the tasks.  A result posted after cancel() or after the
+    // runner is gone is dropped by its token.
+    struct State {
+        std::function<void(Result)> on_result;
+        std::unordered_set<std::string> in_flight;       // UI thread only
+        std::mutex mutex;
+        std::unordered_map<std::string, Record> memo;    // key -> result
+        std::unordered_map<std::string, CompileDb> databases;   // by build directory
+    };
+
+    static Result analyse(State& state, const std::string& cache_dir, const std::string& path,
+                          const std::vector<std::string>& args, const std::string& checks);
+    // The database entry of `path` when `args` name a build directory.
+    static std::optional<CompileEntry> compileEntry(State& state, const std::string& path,
+                                                    const std::vector<std::string>& args);
+    static Dependency stamp(const std::string& path);
+    static bool unchanged(const Record& record);
+    static std::string encode(const Record& record);
+    static std::optional<Record> decode(const std::string& data);
+    // The files `path` includes, outside the system headers; nothing if
+    // the compiler could not list them.
+    static std::optional<std::vector<std::string>> includes(const std::string& path,
+                                                            const std::vector<std::string>& args,
+                                                            const std::optional<CompileEntry>& entry);
+
+    std::string m_cache_dir;
+    std::shared_ptr<State> m_state = std::make_shared<State>();
+    CancellationToken m_token;
+};
+
+#endif // TIDYRUNNER_H
@@ -0,0 +1,84 @@
+#include "TranslationUnitCache.h"
+
+UnsavedBuffers::UnsavedBuffers(BufferManager& buffers) {
+    for (std::size_t i = 0; i < buffers.bufferCount(); ++i) {
+        EditorBuffer& b = buffers.getBuffer(i);
+        if (b.file_id == INVALID_FILE_ID || b.hex_view) continue;   // stdin has no file name
+        snapshots.push_back(b.snapshot());
+        paths.push_back(PathRegistry::instance().path(b.file_id));
+    }
+    // Filled once the vectors above stop growing
+    for (std::size_t i = 0; i < snapshots.size(); ++i) {
+        const std::string& text = snapshots[i]->text();
+        files.push_back(CXUnsavedFile{paths[i].c_str(), text.c_str(), text.size()});
+    }
+}
+
+TranslationUnitCache::Unit::~Unit() {
+    if (tu) clang_disposeTranslationUnit(tu);
+}
+
+TranslationUnitCache::TranslationUnitCache(std::size_t capacity)
+    : m_index(clang_createIndex(0, 0)), m_capacity(capacity) {}
+
+TranslationUnitCache::~TranslationUnitCache() {
+    clear();
+    clang_disposeIndex(m_index);
+}
+
+void TranslationUnitCache::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_units.clear();
+    m_lru.clear();
+}
+
+TranslationUnitCache::UnitPtr TranslationUnitCache::acquire(const std::string& path) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_units.find(path);
+    if (it != m_units.end()) {
+        m_lru.splice(m_lru.begin(), m_lru, it->second.second);
+        return it->second.first;
+    }
+    m_lru.push_front(path);
+    auto unit = std::make_shared<Unit>();
+    m_units.emplace(path, std::make_pair(unit, m_lru.begin()));
+    // A unit still in use elsewhere is disposed of when that use ends
+    while (m_units.size() > m_capacity) {
+        m_units.erase(m_lru.back());
+        m_lru.pop_back();
+    }
+    return unit;
+}
+
+bool TranslationUnitCache::use(const std::string& path, const std::vector<std::string>& args,
+                               std::vector<CXUnsavedFile>& unsaved,
+                               const std::function<void(CXTranslationUnit)>& fn) {
+    UnitPtr unit = acquire(path);
+    std::lock_guard<std::mutex> lock(unit->mutex);
+
+    if (unit->tu && unit->args == args) {
+        if (clang_reparseTranslationUnit(unit->tu, unsaved.size(), unsaved.data(),
+                                         clang_defaultReparseOptions(unit->tu)) != 0) {
+            // A failed reparse leaves the unit unusable
+            clang_disposeTranslationUnit(unit->tu);
+            unit->tu = nullptr;
+        }
+    } else if (unit->tu) {
+        clang_disposeTranslationUnit(unit->tu);
+        unit->tu = nullptr;
+    }
+
+    if (!unit->tu) {
+        std::vector<const char*> argv;
+        argv.reserve(args.size());
+        for (const auto& a : args) argv.push_back(a.c_str());
+        unit->tu = clang_parseTranslationUnit(m_index, path.c_str(), argv.data(), argv.size(),
+                                              unsaved.data(), unsaved.size(),
+                                              CXTranslationUnit_PrecompiledPreamble | CXTranslationUnit_KeepGoing);
+        unit->args = args;
+        if (!unit->tu) return false;
+    }
+
+    fn(unit->tu);
+    return true;
+}
@@ -0,0 +1,66 @@
+#ifndef TRANSLATIONUNITCACHE_H
+#define TRANSLATIONUNITCACHE_H
+
+#include <clang-c/Index.h>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "BufferManager.h"
+
+// Every open buffer with a file name, as libclang unsaved files.  Holds the
+// snapshots the entries point into, so it must outlive the parses using it.
+struct UnsavedBuffers {
+    explicit UnsavedBuffers(BufferManager& buffers);
+    UnsavedBuffers(const UnsavedBuffers&) = delete;
+    UnsavedBuffers& operator=(const UnsavedBuffers&) = delete;
+
+    std::vector<BufferSnapshotPtr> snapshots;
+    std::vector<std::string> paths;
+    std::vector<CXUnsavedFile> files;
+};
+
+// Parsed libclang translation units, kept between uses.
+//
+// A unit is parsed with a precompiled preamble the first time it is asked
+// for and only reparsed after that, which skips the headers that did not
+// change.  Units for different files can be used from several threads at
+// once; the same unit is used by one thread at a time.  The least recently
+// used units are dropped once there are more than `capacity`.
+class TranslationUnitCache {
+public:
+    explicit TranslationUnitCache(std::size_t capacity = 32);
+    ~TranslationUnitCache();
+    TranslationUnitCache(const TranslationUnitCache&) = delete;
+    TranslationUnitCache& operator=(const TranslationUnitCache&) = delete;
+
+    // Calls fn(tu) with the unit for `path`, parsed or brought up to date
+    // with `unsaved`.  Returns false, without calling fn, if libclang could
+    // not parse the file.  A unit parsed with other `args` is parsed again.
+    bool use(const std::string& path, const std::vector<std::string>& args,
+             std::vector<CXUnsavedFile>& unsaved, const std::function<void(CXTranslationUnit)>& fn);
+
+    void clear();
+
+private:
+    struct Unit {
+        std::mutex mutex;
+        CXTranslationUnit tu = nullptr;
+        std::vector<std::string> args;
+        ~Unit();
+    };
+    using UnitPtr = std::shared_ptr<Unit>;
+
+    UnitPtr acquire(const std::string& path);
+
+    CXIndex m_index;
+    std::size_t m_capacity;
+    std::mutex m_mutex;
+    std::list<std::string> m_lru;   // most recently used first
+    std::unordered_map<std::string, std::pair<UnitPtr, std::list<std::string>::iterator>> m_units;
+};
+
+#endif // TRANSLATIONUNITCACHE_H
@@ -1,6 +1,7 @@
 #pragma once
 #include <ncurses.h>
 #include "Renderer.h"
+#include <algorithm>
 #include <string>
 #include <vector>
 #include <functional>
@@ -321,6 +322,10 @@ struct OptionList {
         { --cursor; return true; }
         if (ch == KEY_DOWN && cursor < (int)options.size() - 1)
         { ++cursor; return true; }
+        if (ch == KEY_PPAGE && cursor > 0)
+        { cursor = std::max(0, cursor - visible_rows); return true; }
+        if (ch == KEY_NPAGE && cursor < (int)options.size() - 1)
+        { cursor = std::min((int)options.size() - 1, cursor + visible_rows); return true; }
         if ((ch == ' ' || ch == KEY_ENTER || ch == 10 || ch == 13)
             && cursor < (int)options.size()) {
             auto& opt = options[cursor];
@@ -0,0 +1,191 @@
+#include "WrapLayout.h"
+
+#include <algorithm>
+
+namespace {
+
+// How often the background pass checks for cancellation.
+constexpr std::size_t CANCEL_CHECK_LINES = 4096;
+
+std::uint32_t estimateRows(std::size_t len, int width) {
+    return len <= (std::size_t)width ? 1 : static_cast<std::uint32_t>((len + width - 1) / width);
+}
+
+} // namespace
+
+std::vector<std::size_t> WrapLayout::rowStarts(std::string_view text, int width) {
+    std::vector<std::size_t> starts{0};
+    if (width <= 0) return starts;
+    const std::size_t w = static_cast<std::size_t>(width);
+    std::size_t start = 0;
+    while (text.size() - start > w) {
+        std::size_t space = text.rfind(' ', start + w - 1);
+        start = (space != std::string_view::npos && space >= start) ? space + 1 : start + w;
+        starts.push_back(start);
+    }
+    return starts;
+}
+
+int WrapLayout::rowCount(std::string_view text, int width) {
+    if (width <= 0 || text.size() <= (std::size_t)width) return 1;
+    return static_cast<int>(rowStarts(text, width).size());
+}
+
+WrapLayout::~WrapLayout() {
+    if (m_scan) m_scan->token.cancel();
+}
+
+void WrapLayout::sync(EditorBuffer& buffer, int width, int first_line, int rows) {
+    if (width <= 0) return;
+    if (m_scan && m_scan->done) adoptScan();
+    const bool relayout = (width != m_width);
+    if (!relayout && buffer.version == m_version && buffer.head_lines_dropped == m_dropped) {
+        // A pass that finished after an edit was thrown away above; run it
+        // again for the current text, or the estimates would stay for good.
+        if (m_estimated > 0 && !m_scan) startScan(buffer);
+        return;
+    }
+
+    std::vector<const Line*> lines;
+    lines.reserve(m_lines.size() + 1);
+    for (const Line* p = buffer.document_head; p; p = p->next) lines.push_back(p);
+    const std::size_t n = lines.size();
+
+    if (relayout) {
+        // Everything is guessed from its length except the screen, which
+        // is needed right now; the background pass fixes the rest.
+        if (m_scan) { m_scan->token.cancel(); m_scan.reset(); }
+        m_width = width;
+        m_lines = std::move(lines);
+        m_lens.resize(n);
+        m_rows.resize(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            m_lens[i] = static_cast<std::uint32_t>(m_lines[i]->text.size());
+            m_rows[i] = estimateRows(m_lens[i], width);
+        }
+        std::size_t from = std::min<std::size_t>(std::max(first_line, 1) - 1, n);
+        std::size_t to = std::min<std::size_t>(from + std::max(rows, 0), n);
+        for (std::size_t i = from; i < to; ++i) m_rows[i] = rowCount(m_lines[i]->text, width);
+        m_estimated = n - (to - from);
+    } else {
+        // Lines trimmed off the head of a stream
+        std::size_t dropped = std::min<std::size_t>(buffer.head_lines_dropped - m_dropped, m_lines.size());
+        m_lines.erase(m_lines.begin(), m_lines.begin() + dropped);
+        m_lens.erase(m_lens.begin(), m_lens.begin() + dropped);
+        m_rows.erase(m_rows.begin(), m_rows.begin() + dropped);
+
+        // Keep the counts of the unchanged lines at either end and wrap
+        // whatever lies between them: the edited, inserted or appended lines.
+        // A same-length edit goes unnoticed here; setRows() corrects it
+        // when the line is drawn.
+        auto same = [&](std::size_t old_idx, std::size_t new_idx) {
+            return m_lines[old_idx] == lines[new_idx] && m_lens[old_idx] == lines[new_idx]->text.size();
+        };
+        const std::size_t old_n = m_lines.size();
+        std::size_t front = 0;
+        while (front < old_n && front < n && same(front, front)) ++front;
+        std::size_t back = 0;
+        while (back < old_n - front && back < n - front && same(old_n - 1 - back, n - 1 - back)) ++back;
+
+        std::vector<std::uint32_t> lens, counts;
+        for (std::size_t i = front; i < n - back; ++i) {
+            lens.push_back(static_cast<std::uint32_t>(lines[i]->text.size()));
+            counts.push_back(rowCount(lines[i]->text, width));
+        }
+        m_lens.erase(m_lens.begin() + front, m_lens.begin() + (old_n - back));
+        m_lens.insert(m_lens.begin() + front, lens.begin(), lens.end());
+        m_rows.erase(m_rows.begin() + front, m_rows.begin() + (old_n - back));
+        m_rows.insert(m_rows.begin() + front, counts.begin(), counts.end());
+        m_lines = std::move(lines);
+    }
+
+    m_version = buffer.version;
+    m_dropped = buffer.head_lines_dropped;
+    rebuildTree();
+    // An edit during the background pass makes its result unusable; start
+    // over once it is out of the way.
+    if (m_estimated > 0 && !m_scan) startScan(buffer);
+}
+
+void WrapLayout::startScan(EditorBuffer& buffer) {
+    auto scan = std::make_shared<Scan>();
+    scan->snapshot = buffer.snapshot();
+    scan->width = m_width;
+    m_scan = scan;
+
+    TaskScheduler::instance().submit(TaskLane::Background,
+        [scan](const CancellationToken& token) {
+            const BufferSnapshot& snap = *scan->snapshot;
+            std::vector<std::uint32_t> rows(snap.lineCount());
+            for (std::size_t i = 0; i < rows.size(); ++i) {
+                rows[i] = rowCount(snap.line(i), scan->width);
+                if ((i + 1) % CANCEL_CHECK_LINES == 0 && token.cancelled()) return;
+            }
+            scan->rows = std::move(rows);
+            scan->done = true;
+        }, scan->token);
+}
+
+// Takes the counts of a finished background pass if the text has not
+// changed since it started.
+void WrapLayout::adoptScan() {
+    std::shared_ptr<Scan> scan = std::move(m_scan);
+    if (scan->width != m_width || scan->snapshot->version() != m_version || scan->rows.size() != m_rows.size()) return;
+    m_rows = std::move(scan->rows);
+    m_estimated = 0;
+    rebuildTree();
+}
+
+void WrapLayout::rebuildTree() {
+    const std::size_t n = m_rows.size();
+    m_tree.assign(n + 1, 0);
+    for (std::size_t i = 1; i <= n; ++i) {
+        m_tree[i] += m_rows[i - 1];
+        std::size_t parent = i + (i & (~i + 1));
+        if (parent <= n) m_tree[parent] += m_tree[i];
+    }
+}
+
+void WrapLayout::update(std::size_t idx, std::int64_t delta) {
+    for (std::size_t i = idx + 1; i < m_tree.size(); i += i & (~i + 1)) m_tree[i] += delta;
+}
+
+std::uint64_t WrapLayout::rowOfLine(int line_num) const {
+    std::uint64_t sum = 0;
+    std::size_t i = std::min<std::size_t>(std::max(line_num - 1, 0), m_rows.size());
+    for (; i > 0; i -= i & (~i + 1)) sum += m_tree[i];
+    return sum;
+}
+
+std::uint64_t WrapLayout::totalRows() const {
+    return rowOfLine(static_cast<int>(m_rows.size()) + 1);
+}
+
+int WrapLayout::lineOfRow(std::uint64_t row, int& sub_row) const {
+    const std::size_t n = m_rows.size();
+    if (n == 0) { sub_row = 0; return 1; }
+    std::size_t step = 1;
+    while (step * 2 <= n) step *= 2;
+    // Largest pos with rows[0 .. pos) summing to at most `row`
+    std::size_t pos = 0;
+    for (; step > 0; step /= 2) {
+        if (pos + step <= n && m_tree[pos + step] <= row) {
+            pos += step;
+            row -= m_tree[pos];
+        }
+    }
+    if (pos >= n) {
+        sub_row = static_cast<int>(m_rows[n - 1]) - 1;
+        return static_cast<int>(n);
+    }
+    sub_row = static_cast<int>(row);
+    return static_cast<int>(pos) + 1;
+}
+
+void WrapLayout::setRows(int line_num, int rows) {
+    if (line_num < 1 || (std::size_t)line_num > m_rows.size()) return;
+    std::uint32_t& cached = m_rows[line_num - 1];
+    if (cached == (std::uint32_t)rows) return;
+    update(line_num - 1, (std::int64_t)rows - (std::int64_t)cached);
+    cached = static_cast<std::uint32_t>(rows);
+}
@@ -0,0 +1,82 @@
+#ifndef WRAPLAYOUT_H
+#define WRAPLAYOUT_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+#include "EditorBuffer.h"
+#include "TaskScheduler.h"
+
+// Soft-wrap layout of one buffer: how many screen rows each line takes at
+// the current width, and a Fenwick tree over those counts so that visual
+// rows and document lines map onto each other in O(log n).
+//
+// Row counts are cached per line and only recomputed for lines that were
+// edited, inserted or appended since the last sync().  A width change
+// re-wraps the visible lines at once, estimates the others from their
+// length, and corrects the estimates from a background pass over a
+// BufferSnapshot.
+class WrapLayout {
+public:
+    // Offsets at which the visual rows of `text` start; the first is 0.  A
+    // row ends after the last space that fits in `width` columns, or at
+    // `width` inside a longer word.
+    static std::vector<std::size_t> rowStarts(std::string_view text, int width);
+    static int rowCount(std::string_view text, int width);
+
+    WrapLayout() = default;
+    ~WrapLayout();
+    WrapLayout(const WrapLayout&) = delete;
+    WrapLayout& operator=(const WrapLayout&) = delete;
+
+    // Brings the layout up to date with `buffer` at `width` columns.  Lines
+    // first_line .. first_line + rows - 1 (the screen) are wrapped exactly.
+    // UI thread only; call before the queries below.
+    void sync(EditorBuffer& buffer, int width, int first_line, int rows);
+
+    int width() const { return m_width; }
+    std::uint64_t totalRows() const;
+    // First visual row (0-based) of line `line_num` (1-based).
+    std::uint64_t rowOfLine(int line_num) const;
+    // Line containing visual row `row`; `sub_row` receives the row's index
+    // within that line.
+    int lineOfRow(std::uint64_t row, int& sub_row) const;
+    int rowsOf(int line_num) const { return m_rows[line_num - 1]; }
+
+    // Records the row count of a line wrapped for drawing, correcting an
+    // estimate or a stale count.
+    void setRows(int line_num, int rows);
+
+    // True while the background pass after a width change is running.
+    bool relayingOut() const { return m_scan != nullptr; }
+
+private:
+    // Shared between the background pass and the UI thread.
+    struct Scan {
+        CancellationToken token;
+        BufferSnapshotPtr snapshot;
+        int width = 0;
+        std::vector<std::uint32_t> rows;
+        std::atomic<bool> done{false};
+    };
+
+    void startScan(EditorBuffer& buffer);
+    void adoptScan();
+    void update(std::size_t idx, std::int64_t delta);
+    void rebuildTree();
+
+    int m_width = 0;
+    std::uint64_t m_version = 0;
+    std::uint64_t m_dropped = 0;
+    // Per line: the node and text length the count was computed for
+    std::vector<const Line*> m_lines;
+    std::vector<std::uint32_t> m_lens;
+    std::vector<std::uint32_t> m_rows;
+    std::size_t m_estimated = 0;        // counts guessed from the length only
+    std::vector<std::uint64_t> m_tree;  // Fenwick tree over m_rows, 1-based
+    std::shared_ptr<Scan> m_scan;
+};
+
+#endif // WRAPLAYOUT_H
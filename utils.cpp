@@ -53,6 +53,12 @@ std::string formatSize(off_t size) {
     return ss.str() + " MB";
 }
 
+std::string formatCount(std::size_t count) {
+    std::string digits = std::to_string(count);
+    for (int i = (int)digits.length() - 3; i > 0; i -= 3) digits.insert(i, ",");
+    return digits;
+}
+
 bool ends_with(const std::string &str, const std::string &suffix) {
     if (str.length() < suffix.length()) { return false; }
     return str.rfind(suffix) == (str.length() - suffix.length());
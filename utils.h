@@ -7,6 +7,9 @@
 // Formats file size into a human-readable string (B, KB, MB)
 std::string formatSize(off_t size);
 
+// Formats a count with thousands separators (3,481)
+std::string formatCount(std::size_t count);
+
 // Formats a time_t into a YYYY-MM-DD HH:MM:SS string
 std::string formatTime(time_t mod_time);
 